@@ -0,0 +1,75 @@
+#include "AsyncJob.h"
+
+AsyncJob::AsyncJob() :
+    _async( new uv_async_t ), _finished( false )
+{
+    v8::Isolate* isolate = v8::Isolate::GetCurrent();
+    _resolver.Reset( isolate, v8::Promise::Resolver::New( isolate ) );
+
+    uv_async_init( uv_default_loop(), _async,
+        [] ( uv_async_t* handle ) {
+            static_cast<AsyncJob*>( handle->data )->handleAsync();
+        }
+    );
+    _async->data = this;
+}
+
+AsyncJob::~AsyncJob()
+{
+    delete _async;
+}
+
+v8::Local<v8::Promise> AsyncJob::promise()
+{
+    v8::Isolate* isolate = v8::Isolate::GetCurrent();
+    return v8::Local<v8::Promise::Resolver>::New( isolate, _resolver )->GetPromise();
+}
+
+void AsyncJob::notify()
+{
+    uv_async_send( _async );
+}
+
+void AsyncJob::finish()
+{
+    _finished = true;
+    uv_async_send( _async );
+}
+
+void AsyncJob::fail( const std::string& error )
+{
+    _error = error;
+    finish();
+}
+
+void AsyncJob::handleAsync()
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    //flag is read before onNotify(), so everything published by worker
+    //before finish() is already seen by it when job is resolved.
+    //finish() called during onNotify() schedules one more call.
+    const bool finished = _finished;
+
+    onNotify();
+
+    if( !finished )
+        return;
+
+    Local<Promise::Resolver> resolver = Local<Promise::Resolver>::New( isolate, _resolver );
+    if( _error.empty() )
+        resolver->Resolve( result() );
+    else
+        resolver->Reject( Exception::Error( String::NewFromUtf8( isolate, _error.c_str() ) ) );
+
+    _resolver.Reset();
+
+    uv_close( reinterpret_cast<uv_handle_t*>( _async ),
+        [] ( uv_handle_t* handle ) {
+            delete static_cast<AsyncJob*>( handle->data );
+        }
+    );
+}
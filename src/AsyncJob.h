@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+
+#include <v8.h>
+#include <uv.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//Base class for work done on background threads, with result delivered to js
+//as promise. Should be created with new on gui thread, deletes itself
+//after result is delivered.
+class AsyncJob
+{
+public:
+    v8::Local<v8::Promise> promise();
+
+protected:
+    AsyncJob();
+    virtual ~AsyncJob();
+
+    //could be called from any thread, onNotify() will be called on gui thread
+    void notify();
+    //could be called from any thread, but only once. After that job
+    //should not be touched by caller, since it could be deleted at any moment.
+    //Everything published before finish() is seen by last onNotify() call.
+    void finish();
+    void fail( const std::string& error );
+
+    //called on gui thread
+    virtual void onNotify() {}
+    virtual v8::Local<v8::Value> result() = 0;
+
+private:
+    void handleAsync();
+
+private:
+    uv_async_t* _async;
+    std::atomic<bool> _finished;
+    std::string _error;
+
+    v8::UniquePersistent<v8::Promise::Resolver> _resolver;
+};
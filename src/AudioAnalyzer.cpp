@@ -0,0 +1,236 @@
+#include "AudioAnalyzer.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const double Pi = 3.14159265358979323846;
+
+const float MinBandFrequency = 20.f;
+const float MaxBandFrequency = 20000.f;
+
+}
+
+AudioAnalyzer::AudioAnalyzer() :
+    _channels( 0 ), _fftSize( 0 ), _bands( 0 ), _levels( nullptr ),
+    _blockFrames( 0 ), _amplitudeScale( 0 ), _sequence( 0 )
+{
+}
+
+void AudioAnalyzer::setup( unsigned channels, unsigned rate,
+                           unsigned fftSize, unsigned bands, Window window,
+                           float* levels )
+{
+    _levels = nullptr;
+
+    if( !levels || !channels || !rate || fftSize < 4 || ( fftSize & ( fftSize - 1 ) ) )
+        return;
+
+    _channels = channels;
+    _fftSize = fftSize;
+    _bands = bands;
+
+    _sumSquares.assign( channels, 0.f );
+    _peaks.assign( channels, 0.f );
+    _input.assign( fftSize, 0.f );
+    _real.assign( fftSize, 0.f );
+    _imag.assign( fftSize, 0.f );
+
+    _window.resize( fftSize );
+    double windowSum = 0;
+    for( unsigned i = 0; i < fftSize; ++i ) {
+        const double x = static_cast<double>( i ) / fftSize;
+        switch( window ) {
+            case Window::Hann:
+                _window[i] = static_cast<float>( 0.5 - 0.5 * cos( 2 * Pi * x ) );
+                break;
+            case Window::Blackman:
+                _window[i] = static_cast<float>( 0.42 - 0.5 * cos( 2 * Pi * x ) + 0.08 * cos( 4 * Pi * x ) );
+                break;
+            case Window::None:
+            default:
+                _window[i] = 1.f;
+                break;
+        }
+        windowSum += _window[i];
+    }
+    //sine of full scale amplitude gives 1 in its bin
+    _amplitudeScale = static_cast<float>( 2 / windowSum );
+
+    _cos.resize( fftSize / 2 );
+    _sin.resize( fftSize / 2 );
+    for( unsigned i = 0; i < fftSize / 2; ++i ) {
+        _cos[i] = static_cast<float>( cos( 2 * Pi * i / fftSize ) );
+        _sin[i] = static_cast<float>( -sin( 2 * Pi * i / fftSize ) );
+    }
+
+    unsigned bits = 0;
+    while( ( 1u << bits ) < fftSize )
+        ++bits;
+    _bitReverse.resize( fftSize );
+    for( unsigned i = 0; i < fftSize; ++i ) {
+        unsigned reversed = 0;
+        for( unsigned b = 0; b < bits; ++b )
+            reversed |= ( ( i >> b ) & 1 ) << ( bits - 1 - b );
+        _bitReverse[i] = reversed;
+    }
+
+    const float maxFrequency = std::min( MaxBandFrequency, rate / 2.f );
+    const float binWidth = static_cast<float>( rate ) / fftSize;
+    _bandBins.resize( bands + 1 );
+    for( unsigned b = 0; b <= bands; ++b ) {
+        const float frequency =
+            MinBandFrequency * powf( maxFrequency / MinBandFrequency, static_cast<float>( b ) / bands );
+        _bandBins[b] = std::min( fftSize / 2, static_cast<unsigned>( frequency / binWidth + 0.5f ) );
+    }
+    //every band should contain at least one bin
+    for( unsigned b = 1; b <= bands; ++b )
+        _bandBins[b] = std::min( fftSize / 2, std::max( _bandBins[b], _bandBins[b - 1] + 1 ) );
+
+    _levels = levels;
+    std::fill( _levels, _levels + levelsCount( channels, bands ), 0.f );
+
+    reset();
+}
+
+void AudioAnalyzer::reset()
+{
+    std::fill( _sumSquares.begin(), _sumSquares.end(), 0.f );
+    std::fill( _peaks.begin(), _peaks.end(), 0.f );
+    _blockFrames = 0;
+}
+
+void AudioAnalyzer::process( const void* frames, unsigned count, AudioSampleFormat format )
+{
+    if( !_levels )
+        return;
+
+    while( count ) {
+        const unsigned chunk = std::min( count, _fftSize - _blockFrames );
+
+        if( AudioSampleFormat::F32 == format ) {
+            const float* samples = static_cast<const float*>( frames );
+            accumulate( samples, chunk, 1.f );
+            frames = samples + chunk * _channels;
+        } else {
+            const int16_t* samples = static_cast<const int16_t*>( frames );
+            accumulate( samples, chunk, 1.f / 32768 );
+            frames = samples + chunk * _channels;
+        }
+
+        count -= chunk;
+        _blockFrames += chunk;
+
+        if( _blockFrames == _fftSize ) {
+            analyze();
+            reset();
+        }
+    }
+}
+
+template<typename T>
+void AudioAnalyzer::accumulate( const T* frames, unsigned count, float scale )
+{
+    float* input = _input.data() + _blockFrames;
+    const float mixScale = scale / _channels;
+
+    for( unsigned f = 0; f < count; ++f ) {
+        float sum = 0;
+        for( unsigned c = 0; c < _channels; ++c )
+            sum += frames[f * _channels + c];
+        input[f] = sum * mixScale;
+    }
+
+    unsigned samples = 0;
+#ifdef USE_SSE2
+    if( sizeof( T ) == sizeof( float ) && 0 == 4 % _channels ) {
+        //4 interleaved samples of 1, 2 or 4 channels at once,
+        //lane i always belongs to channel i % channels
+        const float* data = reinterpret_cast<const float*>( frames );
+        const __m128 absMask = _mm_castsi128_ps( _mm_set1_epi32( 0x7FFFFFFF ) );
+        __m128 sumSquares = _mm_setzero_ps();
+        __m128 peaks = _mm_setzero_ps();
+        for( ; samples + 4 <= count * _channels; samples += 4 ) {
+            const __m128 v = _mm_loadu_ps( data + samples );
+            sumSquares = _mm_add_ps( sumSquares, _mm_mul_ps( v, v ) );
+            peaks = _mm_max_ps( peaks, _mm_and_ps( v, absMask ) );
+        }
+
+        float laneSums[4], lanePeaks[4];
+        _mm_storeu_ps( laneSums, sumSquares );
+        _mm_storeu_ps( lanePeaks, peaks );
+        for( unsigned l = 0; l < 4; ++l ) {
+            _sumSquares[l % _channels] += laneSums[l];
+            _peaks[l % _channels] = std::max( _peaks[l % _channels], lanePeaks[l] );
+        }
+    }
+#endif
+
+    for( ; samples < count * _channels; ++samples ) {
+        const unsigned c = samples % _channels;
+        const float v = frames[samples] * scale;
+        _sumSquares[c] += v * v;
+        _peaks[c] = std::max( _peaks[c], fabsf( v ) );
+    }
+}
+
+void AudioAnalyzer::analyze()
+{
+    fft();
+
+    float* rms = _levels;
+    float* peaks = _levels + _channels;
+    float* bands = _levels + _channels * 2;
+
+    for( unsigned c = 0; c < _channels; ++c ) {
+        rms[c] = sqrtf( _sumSquares[c] / _fftSize );
+        peaks[c] = _peaks[c];
+    }
+
+    for( unsigned b = 0; b < _bands; ++b ) {
+        float maxMagnitude = 0;
+        for( unsigned bin = _bandBins[b]; bin < _bandBins[b + 1]; ++bin ) {
+            maxMagnitude =
+                std::max( maxMagnitude, _real[bin] * _real[bin] + _imag[bin] * _imag[bin] );
+        }
+        bands[b] = sqrtf( maxMagnitude ) * _amplitudeScale;
+    }
+
+    _sequence.fetch_add( 1, std::memory_order_release );
+}
+
+void AudioAnalyzer::fft()
+{
+    for( unsigned i = 0; i < _fftSize; ++i ) {
+        const unsigned j = _bitReverse[i];
+        _real[j] = _input[i] * _window[i];
+        _imag[j] = 0;
+    }
+
+    //iterative radix-2 decimation in time
+    for( unsigned size = 2; size <= _fftSize; size <<= 1 ) {
+        const unsigned half = size / 2;
+        const unsigned tableStep = _fftSize / size;
+        for( unsigned start = 0; start < _fftSize; start += size ) {
+            for( unsigned k = 0; k < half; ++k ) {
+                const float wr = _cos[k * tableStep];
+                const float wi = _sin[k * tableStep];
+                const unsigned even = start + k;
+                const unsigned odd = even + half;
+                const float tr = _real[odd] * wr - _imag[odd] * wi;
+                const float ti = _real[odd] * wi + _imag[odd] * wr;
+                _real[odd] = _real[even] - tr;
+                _imag[odd] = _imag[even] - ti;
+                _real[even] += tr;
+                _imag[even] += ti;
+            }
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+
+#include "AudioConverter.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//Audio levels metering, intended to run on audio thread.
+//Every fftSize frames per channel RMS and peak and spectrum bands
+//are published to levels array (usually typed array storage) as
+//[ rms[channels], peak[channels], bands[bands] ],
+//all values are linear amplitudes relative to full scale.
+//Bands are logarithmically spaced from 20Hz to min(20kHz, nyquist),
+//band value is the maximum bin amplitude in band.
+class AudioAnalyzer
+{
+public:
+    enum class Window
+    {
+        None = 0,
+        Hann,
+        Blackman,
+    };
+
+    AudioAnalyzer();
+
+    static unsigned levelsCount( unsigned channels, unsigned bands )
+        { return channels * 2 + bands; }
+
+    //fftSize should be power of two.
+    //levels should have place for levelsCount( channels, bands ) values,
+    //nullptr levels disables analysis
+    void setup( unsigned channels, unsigned rate,
+                unsigned fftSize, unsigned bands, Window,
+                float* levels );
+    void reset();
+
+    bool isActive() const
+        { return _levels != nullptr; }
+
+    void process( const void* frames, unsigned count, AudioSampleFormat );
+
+    //incremented every time levels are updated
+    unsigned sequence() const
+        { return _sequence.load( std::memory_order_acquire ); }
+
+private:
+    template<typename T>
+    void accumulate( const T* frames, unsigned count, float scale );
+    void analyze();
+    void fft();
+
+private:
+    unsigned _channels;
+    unsigned _fftSize;
+    unsigned _bands;
+    float* _levels;
+
+    //current block accumulators
+    std::vector<float> _sumSquares;
+    std::vector<float> _peaks;
+    unsigned _blockFrames;
+
+    //mono mix of current block
+    std::vector<float> _input;
+    std::vector<float> _window;
+    float _amplitudeScale;
+
+    //fft work buffers and tables
+    std::vector<float> _real;
+    std::vector<float> _imag;
+    std::vector<float> _cos;
+    std::vector<float> _sin;
+    std::vector<unsigned> _bitReverse;
+
+    //[first, last) bins of every band
+    std::vector<unsigned> _bandBins;
+
+    std::atomic<unsigned> _sequence;
+};
@@ -0,0 +1,404 @@
+#include "AudioConverter.h"
+
+#include <string.h>
+#include <math.h>
+
+#include <algorithm>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+enum ChannelRole {
+    L, R, ML, MR, RL, RR, RC, C, LFE,
+    NoRole,
+};
+
+//channels layouts as they are configured by libvlc for channels count,
+//in libvlc channels order
+const ChannelRole Layouts[][9] = {
+    { NoRole },
+    { C, NoRole },
+    { L, R, NoRole },
+    { L, R, LFE, NoRole },
+    { L, R, RL, RR, NoRole },
+    { L, R, RL, RR, C, NoRole },
+    { L, R, RL, RR, C, LFE, NoRole },
+    { L, R, ML, MR, RL, RR, C, NoRole },
+    { L, R, ML, MR, RL, RR, C, LFE, NoRole },
+};
+const unsigned MaxLayoutChannels = sizeof( Layouts ) / sizeof( Layouts[0] ) - 1;
+
+//where channel goes if output has no such channel,
+//groups are tried in order, first group present in output is used
+struct FoldGroup
+{
+    ChannelRole first;
+    ChannelRole second;
+};
+
+const FoldGroup End = { NoRole, NoRole };
+
+const FoldGroup Folds[][4] = {
+    /* L   */ { { C, NoRole }, End },
+    /* R   */ { { C, NoRole }, End },
+    /* ML  */ { { RL, NoRole }, { L, NoRole }, { C, NoRole }, End },
+    /* MR  */ { { RR, NoRole }, { R, NoRole }, { C, NoRole }, End },
+    /* RL  */ { { ML, NoRole }, { L, NoRole }, { C, NoRole }, End },
+    /* RR  */ { { MR, NoRole }, { R, NoRole }, { C, NoRole }, End },
+    /* RC  */ { { RL, RR }, { L, R }, { C, NoRole }, End },
+    /* C   */ { { L, R }, End },
+    /* LFE */ { End }, //dropped
+};
+
+const float FoldGain = 0.70710678f;
+
+//filter taps per phase, should be multiple of 4
+const unsigned Taps = 16;
+const unsigned Phases = 256;
+
+int FindRole( unsigned channels, ChannelRole role )
+{
+    if( channels > MaxLayoutChannels || NoRole == role )
+        return -1;
+
+    for( unsigned c = 0; c < channels; ++c ) {
+        if( Layouts[channels][c] == role )
+            return static_cast<int>( c );
+    }
+
+    return -1;
+}
+
+}
+
+AudioChannel AudioChannelAt( unsigned channels, unsigned index )
+{
+    if( channels > MaxLayoutChannels || index >= channels )
+        return AudioChannel::Unknown;
+
+    return static_cast<AudioChannel>( Layouts[channels][index] );
+}
+
+namespace {
+
+inline float DotProduct( const float* a, const float* b )
+{
+#ifdef USE_SSE2
+    __m128 sum = _mm_setzero_ps();
+    for( unsigned t = 0; t < Taps; t += 4 )
+        sum = _mm_add_ps( sum, _mm_mul_ps( _mm_loadu_ps( a + t ), _mm_loadu_ps( b + t ) ) );
+    sum = _mm_add_ps( sum, _mm_movehl_ps( sum, sum ) );
+    sum = _mm_add_ss( sum, _mm_shuffle_ps( sum, sum, 1 ) );
+    return _mm_cvtss_f32( sum );
+#else
+    float sum = 0;
+    for( unsigned t = 0; t < Taps; ++t )
+        sum += a[t] * b[t];
+    return sum;
+#endif
+}
+
+//clamped before conversion and rounded to nearest
+//(the same way as _mm_cvtps_epi32 does with default rounding mode),
+//so SSE2 and scalar paths produce the same samples
+inline int16_t ToS16( float sample )
+{
+    return static_cast<int16_t>(
+        lrintf( std::max( -32768.f, std::min( 32767.f, sample * 32767.f ) ) ) );
+}
+
+}
+
+AudioConverter::AudioConverter() :
+    _inRate( 0 ), _inChannels( 0 ), _outFormat( AudioSampleFormat::F32 ),
+    _outRate( 0 ), _outChannels( 0 ), _passthrough( true ),
+    _historyLength( 0 ), _position( 0 ), _step( 0 )
+{
+}
+
+void AudioConverter::setup( unsigned inRate, unsigned inChannels,
+                            AudioSampleFormat outFormat, unsigned outRate, unsigned outChannels )
+{
+    _inRate = inRate;
+    _inChannels = inChannels;
+    _outFormat = outFormat;
+    _outRate = outRate;
+    _outChannels = outChannels;
+    _passthrough = inRate == outRate && inChannels == outChannels &&
+                   AudioSampleFormat::F32 == outFormat;
+
+    buildMixMatrix();
+    buildFilter();
+
+    _history.assign( outChannels, std::vector<float>() );
+    _planar.assign( outChannels, std::vector<float>() );
+
+    reset();
+}
+
+void AudioConverter::reset()
+{
+    //filter is centered at output position, so Taps / 2 - 1 samples
+    //of silence are needed before first input sample
+    _historyLength = _inRate == _outRate ? 0 : Taps / 2 - 1;
+    for( std::vector<float>& history: _history ) {
+        if( history.size() < _historyLength )
+            history.resize( _historyLength );
+        std::fill( history.begin(), history.begin() + _historyLength, 0.f );
+    }
+
+    _position = static_cast<uint64_t>( _historyLength ) << 32;
+}
+
+void AudioConverter::buildMixMatrix()
+{
+    _matrix.assign( _outChannels * _inChannels, 0.f );
+
+    if( _inChannels == _outChannels ||
+        _inChannels > MaxLayoutChannels || _outChannels > MaxLayoutChannels )
+    {
+        //unknown layouts are matched by channel index
+        for( unsigned c = 0; c < std::min( _inChannels, _outChannels ); ++c )
+            _matrix[c * _inChannels + c] = 1.f;
+        return;
+    }
+
+    for( unsigned i = 0; i < _inChannels; ++i ) {
+        const ChannelRole role = Layouts[_inChannels][i];
+
+        const int direct = FindRole( _outChannels, role );
+        if( direct >= 0 ) {
+            _matrix[direct * _inChannels + i] = 1.f;
+            continue;
+        }
+
+        for( const FoldGroup& group: Folds[role] ) {
+            if( NoRole == group.first )
+                break;
+
+            const int first = FindRole( _outChannels, group.first );
+            const int second = FindRole( _outChannels, group.second );
+            if( first < 0 || ( NoRole != group.second && second < 0 ) )
+                continue;
+
+            _matrix[first * _inChannels + i] = FoldGain;
+            if( second >= 0 )
+                _matrix[second * _inChannels + i] = FoldGain;
+            break;
+        }
+    }
+
+    //keep full scale input from clipping
+    for( unsigned o = 0; o < _outChannels; ++o ) {
+        float* row = &_matrix[o * _inChannels];
+        float sum = 0;
+        for( unsigned i = 0; i < _inChannels; ++i )
+            sum += row[i];
+        if( sum > 1.f ) {
+            for( unsigned i = 0; i < _inChannels; ++i )
+                row[i] /= sum;
+        }
+    }
+}
+
+void AudioConverter::buildFilter()
+{
+    _filter.clear();
+    _step = 0;
+
+    if( !_inRate || !_outRate || _inRate == _outRate )
+        return;
+
+    _step = ( static_cast<uint64_t>( _inRate ) << 32 ) / _outRate;
+
+    //cutoff below lower nyquist, with some room for transition band
+    const double cutoff = 0.9 * std::min( 1.0, static_cast<double>( _outRate ) / _inRate );
+    const double pi = 3.14159265358979323846;
+    const int center = Taps / 2 - 1;
+
+    _filter.resize( Phases * Taps );
+    for( unsigned p = 0; p < Phases; ++p ) {
+        const double fraction = static_cast<double>( p ) / Phases;
+        float* coefficients = &_filter[p * Taps];
+
+        double sum = 0;
+        for( unsigned t = 0; t < Taps; ++t ) {
+            const double x = static_cast<int>( t ) - center - fraction;
+            const double sinc = 0 == x ? 1. : sin( pi * cutoff * x ) / ( pi * cutoff * x );
+            //Blackman window over filter span
+            const double w = ( x + Taps / 2. ) / Taps;
+            const double window =
+                w <= 0 || w >= 1 ? 0 :
+                0.42 - 0.5 * cos( 2 * pi * w ) + 0.08 * cos( 4 * pi * w );
+            coefficients[t] = static_cast<float>( sinc * window );
+            sum += coefficients[t];
+        }
+
+        //unity gain for every phase
+        for( unsigned t = 0; t < Taps; ++t )
+            coefficients[t] = static_cast<float>( coefficients[t] / sum );
+    }
+}
+
+unsigned AudioConverter::process( const float* samples, unsigned frames )
+{
+    if( !frames || !_outChannels )
+        return 0;
+
+    mix( samples, frames );
+
+    const unsigned outFrames = resample();
+    convert( outFrames );
+
+    return outFrames;
+}
+
+void AudioConverter::mix( const float* samples, unsigned frames )
+{
+    const size_t length = _historyLength + frames;
+    for( std::vector<float>& history: _history ) {
+        if( history.size() < length )
+            history.resize( length );
+    }
+
+    for( unsigned o = 0; o < _outChannels; ++o ) {
+        const float* row = &_matrix[o * _inChannels];
+        float* out = _history[o].data() + _historyLength;
+
+        //most channels are either copied or skipped
+        unsigned nonZero = 0, source = 0;
+        for( unsigned i = 0; i < _inChannels; ++i ) {
+            if( row[i] != 0.f ) {
+                ++nonZero;
+                source = i;
+            }
+        }
+
+        if( 0 == nonZero ) {
+            std::fill( out, out + frames, 0.f );
+        } else if( 1 == nonZero ) {
+            const float gain = row[source];
+            const float* in = samples + source;
+            for( unsigned f = 0; f < frames; ++f, in += _inChannels )
+                out[f] = in[0] * gain;
+        } else {
+            const float* in = samples;
+            for( unsigned f = 0; f < frames; ++f, in += _inChannels ) {
+                float sum = 0;
+                for( unsigned i = 0; i < _inChannels; ++i )
+                    sum += in[i] * row[i];
+                out[f] = sum;
+            }
+        }
+    }
+
+    _historyLength += frames;
+}
+
+unsigned AudioConverter::resample()
+{
+    if( !_step ) {
+        //no resampling, history is just planar input
+        for( unsigned o = 0; o < _outChannels; ++o )
+            _planar[o].swap( _history[o] );
+        const unsigned frames = _historyLength;
+        _historyLength = 0;
+        return frames;
+    }
+
+    const unsigned half = Taps / 2;
+    if( _historyLength < Taps )
+        return 0;
+
+    //count of output frames computable with current history
+    const uint64_t last = static_cast<uint64_t>( _historyLength - half ) << 32;
+    const unsigned frames =
+        _position < last ? static_cast<unsigned>( ( last - _position + _step - 1 ) / _step ) : 0;
+
+    for( unsigned o = 0; o < _outChannels; ++o ) {
+        std::vector<float>& planar = _planar[o];
+        if( planar.size() < frames )
+            planar.resize( frames );
+
+        const float* history = _history[o].data();
+        uint64_t position = _position;
+        for( unsigned f = 0; f < frames; ++f, position += _step ) {
+            const unsigned index = static_cast<unsigned>( position >> 32 );
+            const unsigned phase = static_cast<unsigned>( position >> 24 ) & ( Phases - 1 );
+            planar[f] = DotProduct( history + index - ( half - 1 ), &_filter[phase * Taps] );
+        }
+    }
+
+    _position += _step * frames;
+
+    //drop history which is not needed for next output frames
+    const unsigned consumed = static_cast<unsigned>( _position >> 32 ) - ( half - 1 );
+    for( unsigned o = 0; o < _outChannels; ++o ) {
+        float* history = _history[o].data();
+        memmove( history, history + consumed, ( _historyLength - consumed ) * sizeof( float ) );
+    }
+    _historyLength -= consumed;
+    _position -= static_cast<uint64_t>( consumed ) << 32;
+
+    return frames;
+}
+
+void AudioConverter::convert( unsigned frames )
+{
+    const size_t sampleSize =
+        AudioSampleFormat::F32 == _outFormat ? sizeof( float ) : sizeof( int16_t );
+    const size_t size = static_cast<size_t>( frames ) * _outChannels * sampleSize;
+    if( _output.size() < size )
+        _output.resize( size );
+
+    if( AudioSampleFormat::F32 == _outFormat ) {
+        float* out = reinterpret_cast<float*>( _output.data() );
+        for( unsigned o = 0; o < _outChannels; ++o ) {
+            const float* in = _planar[o].data();
+            for( unsigned f = 0; f < frames; ++f )
+                out[f * _outChannels + o] = in[f];
+        }
+        return;
+    }
+
+    int16_t* out = reinterpret_cast<int16_t*>( _output.data() );
+
+#ifdef USE_SSE2
+    if( 2 == _outChannels ) {
+        //the most common case: conversion and interleaving at once
+        const float* left = _planar[0].data();
+        const float* right = _planar[1].data();
+        const __m128 scale = _mm_set1_ps( 32767.f );
+        const __m128 high = _mm_set1_ps( 32767.f );
+        const __m128 low = _mm_set1_ps( -32768.f );
+        unsigned f = 0;
+        for( ; f + 4 <= frames; f += 4 ) {
+            //min/max order is the same as in ToS16, so NaN ends up as 32767 too
+            const __m128 lf = _mm_max_ps( _mm_min_ps(
+                _mm_mul_ps( _mm_loadu_ps( left + f ), scale ), high ), low );
+            const __m128 rf = _mm_max_ps( _mm_min_ps(
+                _mm_mul_ps( _mm_loadu_ps( right + f ), scale ), high ), low );
+            const __m128i l = _mm_cvtps_epi32( lf );
+            const __m128i r = _mm_cvtps_epi32( rf );
+            const __m128i lr = _mm_packs_epi32( _mm_unpacklo_epi32( l, r ),
+                                                _mm_unpackhi_epi32( l, r ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( out + f * 2 ), lr );
+        }
+        for( ; f < frames; ++f ) {
+            out[f * 2] = ToS16( left[f] );
+            out[f * 2 + 1] = ToS16( right[f] );
+        }
+        return;
+    }
+#endif
+
+    for( unsigned o = 0; o < _outChannels; ++o ) {
+        const float* in = _planar[o].data();
+        for( unsigned f = 0; f < frames; ++f )
+            out[f * _outChannels + o] = ToS16( in[f] );
+    }
+}
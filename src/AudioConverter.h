@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+enum class AudioSampleFormat
+{
+    S16 = 0,
+    F32,
+};
+
+enum class AudioChannel
+{
+    Left = 0,
+    Right,
+    MiddleLeft,
+    MiddleRight,
+    RearLeft,
+    RearRight,
+    RearCenter,
+    Center,
+    LFE,
+    Unknown,
+};
+
+//position of channel in layout libvlc uses for channels count
+AudioChannel AudioChannelAt( unsigned channels, unsigned index );
+
+///////////////////////////////////////////////////////////////////////////////
+//Downmix, resample and sample format conversion of interleaved float audio.
+//Input channels are expected in libvlc order
+//(L R [ML MR] [RL RR] [RC] [C] [LFE]), output uses the same order.
+//Resampling is done with polyphase windowed sinc filter,
+//inner products are vectorized with SSE if it's available.
+//All buffers are allocated on setup() and grow only if bigger
+//packet arrives, so steady state processing doesn't allocate.
+class AudioConverter
+{
+public:
+    AudioConverter();
+
+    void setup( unsigned inRate, unsigned inChannels,
+                AudioSampleFormat outFormat, unsigned outRate, unsigned outChannels );
+    void reset(); //drops filter history, i.e. on flush
+
+    bool isPassthrough() const
+        { return _passthrough; }
+
+    unsigned inRate() const
+        { return _inRate; }
+    unsigned inChannels() const
+        { return _inChannels; }
+
+    //returns count of produced frames, which are available with output()
+    unsigned process( const float* samples, unsigned frames );
+    const void* output() const
+        { return _output.data(); }
+
+private:
+    void buildMixMatrix();
+    void buildFilter();
+
+    void mix( const float* samples, unsigned frames );
+    unsigned resample();
+    void convert( unsigned frames );
+
+private:
+    unsigned _inRate;
+    unsigned _inChannels;
+    AudioSampleFormat _outFormat;
+    unsigned _outRate;
+    unsigned _outChannels;
+    bool _passthrough;
+
+    //_outChannels x _inChannels
+    std::vector<float> _matrix;
+
+    //planar downmixed input, with filter history at the beginning
+    std::vector<std::vector<float> > _history;
+    unsigned _historyLength;
+    //position of next output frame in history, 32.32 fixed point
+    uint64_t _position;
+    uint64_t _step;
+
+    //_phases x _taps coefficients
+    std::vector<float> _filter;
+
+    //planar resampled audio
+    std::vector<std::vector<float> > _planar;
+
+    std::vector<uint8_t> _output;
+};
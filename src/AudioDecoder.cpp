@@ -0,0 +1,147 @@
+#include "AudioDecoder.h"
+
+#include <stdio.h>
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "MediaInfo.h"
+
+namespace {
+
+struct DecodeContext
+{
+    DecodeContext( const DecodedAudioHandler& handler ) :
+        handler( handler ), decoded( false ), done( false ), failed( false ), stopped( false ) {}
+
+    const DecodedAudioHandler& handler;
+    std::vector<uint8_t> buffer;
+    bool decoded;
+
+    std::mutex guard;
+    std::condition_variable finished;
+    bool done;
+    bool failed;
+    //set by handler, after that nothing should be delivered
+    std::atomic<bool> stopped;
+};
+
+//smem callbacks, called from sout thread
+void AudioPrerender( void* data, uint8_t** buffer, size_t size )
+{
+    DecodeContext* context = static_cast<DecodeContext*>( data );
+
+    //packets come one by one, so single buffer is enough
+    if( context->buffer.size() < size )
+        context->buffer.resize( size );
+    *buffer = context->buffer.data();
+}
+
+void AudioPostrender( void* data, uint8_t* buffer,
+                      unsigned channels, unsigned rate, unsigned frames,
+                      unsigned bitsPerSample, size_t /*size*/, int64_t pts )
+{
+    DecodeContext* context = static_cast<DecodeContext*>( data );
+
+    if( context->stopped || 32 != bitsPerSample || !channels || !frames )
+        return;
+
+    context->decoded = true;
+
+    DecodedAudio audio;
+    audio.samples = reinterpret_cast<const float*>( buffer );
+    audio.frames = frames;
+    audio.channels = channels;
+    audio.rate = rate;
+    audio.pts = pts;
+
+    if( !context->handler( audio ) ) {
+        std::lock_guard<std::mutex> lock( context->guard );
+        context->stopped = true;
+        context->done = true;
+        context->finished.notify_one();
+    }
+}
+
+void OnPlayerEvent( const libvlc_event_t* event, void* data )
+{
+    DecodeContext* context = static_cast<DecodeContext*>( data );
+
+    std::lock_guard<std::mutex> lock( context->guard );
+    if( libvlc_MediaPlayerEncounteredError == event->type )
+        context->failed = true;
+    context->done = true;
+    context->finished.notify_one();
+}
+
+const libvlc_event_e FinishEvents[] = {
+    libvlc_MediaPlayerEndReached,
+    libvlc_MediaPlayerEncounteredError,
+    libvlc_MediaPlayerStopped,
+};
+
+}
+
+bool DecodeAudio( libvlc_instance_t* libvlc, const std::string& mrl,
+                  unsigned rate, unsigned channels,
+                  const DecodedAudioHandler& handler )
+{
+    libvlc_media_t* media = CreateMedia( libvlc, mrl );
+    if( !media )
+        return false;
+
+    DecodeContext context( handler );
+
+    std::string transcode = "acodec=fl32";
+    if( rate )
+        transcode += ",samplerate=" + std::to_string( rate );
+    if( channels )
+        transcode += ",channels=" + std::to_string( channels );
+
+    //smem takes callbacks addresses as integers
+    char smem[256];
+    snprintf( smem, sizeof( smem ),
+              "smem{audio-prerender-callback=%lld,audio-postrender-callback=%lld,"
+              "audio-data=%lld,time-sync=false}",
+              static_cast<long long>( reinterpret_cast<intptr_t>( &AudioPrerender ) ),
+              static_cast<long long>( reinterpret_cast<intptr_t>( &AudioPostrender ) ),
+              static_cast<long long>( reinterpret_cast<intptr_t>( &context ) ) );
+
+    const std::string sout = ":sout=#transcode{" + transcode + "}:" + smem;
+    libvlc_media_add_option( media, sout.c_str() );
+    //video and subtitles are not even decoded
+    libvlc_media_add_option( media, ":no-sout-video" );
+    libvlc_media_add_option( media, ":no-sout-spu" );
+    libvlc_media_add_option( media, ":sout-smem-time-sync=false" );
+
+    libvlc_media_player_t* mp = libvlc_media_player_new_from_media( media );
+    libvlc_media_release( media );
+    if( !mp )
+        return false;
+
+    libvlc_event_manager_t* eventManager = libvlc_media_player_event_manager( mp );
+    for( libvlc_event_e e: FinishEvents )
+        libvlc_event_attach( eventManager, e, OnPlayerEvent, &context );
+
+    if( 0 == libvlc_media_player_play( mp ) ) {
+        std::unique_lock<std::mutex> lock( context.guard );
+        context.finished.wait( lock, [&context] () { return context.done; } );
+    } else
+        context.failed = true;
+
+    {
+        //late packets (delivered during stop) are ignored
+        std::lock_guard<std::mutex> lock( context.guard );
+        context.stopped = true;
+    }
+
+    for( libvlc_event_e e: FinishEvents )
+        libvlc_event_detach( eventManager, e, OnPlayerEvent, &context );
+
+    libvlc_media_player_stop( mp );
+    libvlc_media_player_release( mp );
+
+    return !context.failed && context.decoded;
+}
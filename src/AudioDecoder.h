@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <functional>
+#include <stdint.h>
+
+#include <vlc/vlc.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//Decode only audio pass: audio track of media is decoded as fast as possible,
+//without clock synchronization, audio output and video/subtitles decoding,
+//and is delivered as interleaved float samples.
+struct DecodedAudio
+{
+    const float* samples;
+    unsigned frames;
+    unsigned channels;
+    unsigned rate;
+    //in microseconds
+    int64_t pts;
+};
+
+//should return false to stop decoding
+typedef std::function<bool( const DecodedAudio& )> DecodedAudioHandler;
+
+//rate and channels == 0 keep source format.
+//Blocks until media is decoded, stopped by handler or failed,
+//so should be called only from worker thread.
+//Returns false if decoding failed or no audio was decoded.
+bool DecodeAudio( libvlc_instance_t*, const std::string& mrl,
+                  unsigned rate, unsigned channels,
+                  const DecodedAudioHandler& );
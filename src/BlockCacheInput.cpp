@@ -0,0 +1,309 @@
+#include "BlockCacheInput.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace {
+
+//read-ahead window limits, in blocks
+const unsigned MinReadAhead = 2;
+const unsigned MaxReadAhead = 64;
+
+//MP4 moov or MKV cues are usually in first or last few hundreds of kilobytes
+const uint64_t HeadPrefetchSize = 256 * 1024;
+const uint64_t TailPrefetchSize = 1024 * 1024;
+
+}
+
+BlockCacheInput::BlockCacheInput( const std::shared_ptr<MediaInput>& source, size_t cacheSize ) :
+    _source( source ), _maxBlocks( std::max<size_t>( cacheSize / BlockSize, MaxReadAhead + 1 ) ),
+    _size( 0 ), _blockCount( 0 ), _position( 0 ), _sourcePosition( 0 ),
+    _opened( false ), _demanded( false ), _demandedBlock( 0 ),
+    _failed( false ), _interrupted( false ), _suspended( false ), _fetching( false ),
+    _stopping( false ),
+    _readAheadFrom( 0 ), _readAheadTo( 0 ), _readAheadWindow( MinReadAhead ), _lastReadBlock( 0 ),
+    _hits( 0 ), _misses( 0 ), _fetchedBlocks( 0 )
+{
+}
+
+BlockCacheInput::~BlockCacheInput()
+{
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+        _stopping = true;
+    }
+    _source->interrupt();
+    _changed.notify_all();
+
+    if( _fetchThread.joinable() )
+        _fetchThread.join();
+}
+
+bool BlockCacheInput::open( uint64_t* size )
+{
+    std::unique_lock<std::mutex> lock( _guard );
+
+    //source position is changed by open, so fetching should be stopped,
+    //in-flight fetch is interrupted instead of waiting for slow source
+    _suspended = true;
+    if( _fetching ) {
+        lock.unlock();
+        _source->interrupt();
+        lock.lock();
+        _changed.wait( lock, [this] () { return !_fetching; } );
+    }
+
+    lock.unlock();
+    uint64_t sourceSize = UnknownSize;
+    const bool opened = _source->open( &sourceSize ) && UnknownSize != sourceSize;
+    lock.lock();
+
+    _suspended = false;
+    //previous failure is forgotten on reopen, failed open stops fetching
+    _failed = !opened;
+    _changed.notify_all();
+    if( !opened )
+        return false;
+
+    //source is (re)opened at beginning
+    _sourcePosition = 0;
+    _position = 0;
+    _demanded = false;
+    _interrupted = false;
+    _readAheadFrom = _readAheadTo = 0;
+    _readAheadWindow = MinReadAhead;
+
+    if( !_opened ) {
+        _opened = true;
+        _size = sourceSize;
+        _blockCount = ( _size + BlockSize - 1 ) / BlockSize;
+
+        const uint64_t headBlocks = std::min( _blockCount, HeadPrefetchSize / BlockSize );
+        for( uint64_t b = 0; b < headBlocks; ++b )
+            _prefetch.push_back( b );
+        const uint64_t tailBlocks = std::min( _blockCount, TailPrefetchSize / BlockSize );
+        for( uint64_t b = _blockCount - tailBlocks; b < _blockCount; ++b ) {
+            if( b >= headBlocks )
+                _prefetch.push_back( b );
+        }
+
+        _fetchThread = std::thread( &BlockCacheInput::fetchThread, this );
+    }
+
+    *size = _size;
+
+    _changed.notify_all();
+
+    return true;
+}
+
+int64_t BlockCacheInput::read( uint8_t* buffer, size_t size )
+{
+    std::unique_lock<std::mutex> lock( _guard );
+
+    if( _position >= _size )
+        return 0;
+
+    const uint64_t block = _position / BlockSize;
+
+    auto it = _blocks.find( block );
+    if( it != _blocks.end() )
+        ++_hits;
+    else {
+        ++_misses;
+        _demanded = true;
+        _demandedBlock = block;
+        _changed.notify_all();
+
+        _changed.wait( lock,
+            [this, block, &it] () {
+                it = _blocks.find( block );
+                return it != _blocks.end() || _failed || _interrupted;
+            } );
+        _demanded = false;
+
+        if( it == _blocks.end() )
+            return -1;
+    }
+
+    _lru.splice( _lru.begin(), _lru, it->second.lruIt );
+
+    //read-ahead window grows while reads are sequential
+    if( block != _lastReadBlock ) {
+        if( block == _lastReadBlock + 1 )
+            _readAheadWindow = std::min( _readAheadWindow * 2, MaxReadAhead );
+        else
+            _readAheadWindow = MinReadAhead;
+        _lastReadBlock = block;
+    }
+    const uint64_t readAheadFrom = block + 1;
+    const uint64_t readAheadTo = std::min( readAheadFrom + _readAheadWindow, _blockCount );
+    if( readAheadFrom != _readAheadFrom || readAheadTo != _readAheadTo ) {
+        _readAheadFrom = readAheadFrom;
+        _readAheadTo = readAheadTo;
+        _changed.notify_all();
+    }
+
+    const std::vector<uint8_t>& data = it->second.data;
+    const size_t offset = static_cast<size_t>( _position - block * BlockSize );
+    if( offset >= data.size() )
+        return 0; //source is shorter than reported
+
+    const size_t count = std::min( size, data.size() - offset );
+    memcpy( buffer, data.data() + offset, count );
+    _position += count;
+
+    return static_cast<int64_t>( count );
+}
+
+bool BlockCacheInput::seek( uint64_t offset )
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    if( offset > _size )
+        return false;
+
+    //source is touched only if block is not cached
+    _position = offset;
+
+    return true;
+}
+
+void BlockCacheInput::close()
+{
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+        _readAheadFrom = _readAheadTo = 0;
+    }
+
+    _source->close();
+}
+
+void BlockCacheInput::interrupt()
+{
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+        _interrupted = true;
+    }
+
+    _source->interrupt();
+    _changed.notify_all();
+}
+
+bool BlockCacheInput::nextFetch( uint64_t* block )
+{
+    if( _interrupted || _failed || _suspended )
+        return false;
+
+    if( _demanded && !isCached( _demandedBlock ) ) {
+        *block = _demandedBlock;
+        return true;
+    }
+
+    for( uint64_t b = _readAheadFrom; b < _readAheadTo; ++b ) {
+        if( !isCached( b ) ) {
+            *block = b;
+            return true;
+        }
+    }
+
+    while( !_prefetch.empty() ) {
+        const uint64_t b = _prefetch.front();
+        _prefetch.erase( _prefetch.begin() );
+        if( !isCached( b ) ) {
+            *block = b;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void BlockCacheInput::fetchThread()
+{
+    std::vector<uint8_t> data;
+
+    std::unique_lock<std::mutex> lock( _guard );
+    while( !_stopping ) {
+        uint64_t block;
+        if( !nextFetch( &block ) ) {
+            _changed.wait( lock );
+            continue;
+        }
+
+        _fetching = true;
+        lock.unlock();
+        const bool fetched = fetch( block, &data );
+        lock.lock();
+        _fetching = false;
+
+        if( fetched )
+            store( block, &data );
+        else if( !_interrupted && !_suspended && !_stopping )
+            _failed = true; //fetch interrupted by open is not failure
+
+        _changed.notify_all();
+    }
+}
+
+bool BlockCacheInput::fetch( uint64_t block, std::vector<uint8_t>* data )
+{
+    const uint64_t offset = block * BlockSize;
+    if( offset != _sourcePosition ) {
+        if( !_source->seek( offset ) )
+            return false;
+        _sourcePosition = offset;
+    }
+
+    const size_t size = static_cast<size_t>( std::min<uint64_t>( BlockSize, _size - offset ) );
+    data->resize( size );
+
+    size_t filled = 0;
+    while( filled < size ) {
+        const int64_t read = _source->read( data->data() + filled, size - filled );
+        if( read < 0 )
+            return false;
+        if( 0 == read )
+            break;
+
+        filled += static_cast<size_t>( read );
+        _sourcePosition += read;
+    }
+    data->resize( filled );
+
+    return true;
+}
+
+void BlockCacheInput::store( uint64_t block, std::vector<uint8_t>* data )
+{
+    //cache holds more than read-ahead window,
+    //so just fetched blocks are not evicted before they are read
+    while( _blocks.size() >= _maxBlocks ) {
+        const uint64_t evicted = _lru.back();
+        _lru.pop_back();
+        _blocks.erase( evicted );
+    }
+
+    Block& cached = _blocks[block];
+    cached.data.swap( *data );
+    _lru.push_front( block );
+    cached.lruIt = _lru.begin();
+
+    ++_fetchedBlocks;
+}
+
+void BlockCacheInput::stats( MediaInputStats* stats ) const
+{
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+
+        stats->push_back( { "cacheHits", static_cast<double>( _hits ) } );
+        stats->push_back( { "cacheMisses", static_cast<double>( _misses ) } );
+        stats->push_back( { "cachedBytes", static_cast<double>( _blocks.size() ) * BlockSize } );
+        stats->push_back( { "fetchedBlocks", static_cast<double>( _fetchedBlocks ) } );
+        stats->push_back( { "readAheadBlocks", static_cast<double>( _readAheadWindow ) } );
+    }
+
+    _source->stats( stats );
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "MediaInput.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//Byte range cache in front of slow seekable input (with known size).
+//Input is read by fixed size blocks on dedicated thread, blocks are kept
+//in LRU cache, so libvlc reads and seeks inside already fetched ranges
+//never touch source. Fetch order is: block requested by libvlc,
+//sequential read-ahead (window grows while reads are sequential),
+//head and tail of file (where container indexes usually are).
+class BlockCacheInput : public MediaInput
+{
+public:
+    enum {
+        BlockSize = 64 * 1024,
+    };
+
+    BlockCacheInput( const std::shared_ptr<MediaInput>& source, size_t cacheSize );
+    ~BlockCacheInput();
+
+    bool open( uint64_t* size ) override;
+    int64_t read( uint8_t* buffer, size_t size ) override;
+    bool seek( uint64_t offset ) override;
+    void close() override;
+    void interrupt() override;
+    void stats( MediaInputStats* ) const override;
+
+private:
+    struct Block
+    {
+        std::vector<uint8_t> data;
+        std::list<uint64_t>::iterator lruIt;
+    };
+
+    void fetchThread();
+    //should be called with _guard locked
+    bool nextFetch( uint64_t* block );
+    bool isCached( uint64_t block ) const
+        { return _blocks.find( block ) != _blocks.end(); }
+    bool fetch( uint64_t block, std::vector<uint8_t>* data );
+    void store( uint64_t block, std::vector<uint8_t>* data );
+
+private:
+    const std::shared_ptr<MediaInput> _source;
+    const size_t _maxBlocks;
+
+    mutable std::mutex _guard;
+    std::condition_variable _changed;
+
+    std::unordered_map<uint64_t, Block> _blocks;
+    //most recently used first
+    std::list<uint64_t> _lru;
+
+    uint64_t _size;
+    uint64_t _blockCount;
+    //position of next byte to read by libvlc
+    uint64_t _position;
+    //source position, accessed only by fetch thread
+    uint64_t _sourcePosition;
+
+    bool _opened;
+    bool _demanded;
+    uint64_t _demandedBlock;
+    bool _failed;
+    bool _interrupted;
+    //fetching is suspended while source is reopened
+    bool _suspended;
+    bool _fetching;
+    bool _stopping;
+
+    //read-ahead is fetched in [_readAheadFrom, _readAheadTo)
+    uint64_t _readAheadFrom;
+    uint64_t _readAheadTo;
+    unsigned _readAheadWindow;
+    uint64_t _lastReadBlock;
+
+    //head and tail blocks, fetched once after first open
+    std::vector<uint64_t> _prefetch;
+
+    //stats
+    uint64_t _hits;
+    uint64_t _misses;
+    uint64_t _fetchedBlocks;
+
+    std::thread _fetchThread;
+};
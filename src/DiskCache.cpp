@@ -0,0 +1,620 @@
+#include "DiskCache.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "MappedFile.h"
+
+static const char CatalogSignature[] = "WCJSDC01";
+static const char CatalogName[] = "catalog";
+
+//catalog is saved after every such amount of newly cached data,
+//so crash loses only tail of cached ranges
+static const uint64_t CatalogSaveInterval = 8 * 1024 * 1024;
+
+//eviction frees such part of max size more than needed,
+//so it (and catalog save) doesn't happen on every written chunk
+static const unsigned EvictionSlack = 8;
+
+///////////////////////////////////////////////////////////////////////////////
+namespace {
+
+FILE* OpenFile( const std::string& path, const char* mode )
+{
+#ifdef _WIN32
+    const std::string modeStr = mode;
+    return _wfopen( Utf8ToWide( path ).c_str(),
+                    std::wstring( modeStr.begin(), modeStr.end() ).c_str() );
+#else
+    return fopen( path.c_str(), mode );
+#endif
+}
+
+bool SeekFile( FILE* file, uint64_t offset )
+{
+#ifdef _WIN32
+    return 0 == _fseeki64( file, static_cast<__int64>( offset ), SEEK_SET );
+#else
+    return 0 == fseeko( file, static_cast<off_t>( offset ), SEEK_SET );
+#endif
+}
+
+void RemoveFile( const std::string& path )
+{
+#ifdef _WIN32
+    _wremove( Utf8ToWide( path ).c_str() );
+#else
+    remove( path.c_str() );
+#endif
+}
+
+bool ReadFile( const std::string& path, std::string* data )
+{
+    FILE* file = OpenFile( path, "rb" );
+    if( !file )
+        return false;
+
+    char buffer[64 * 1024];
+    size_t read;
+    while( ( read = fread( buffer, 1, sizeof( buffer ), file ) ) > 0 )
+        data->append( buffer, read );
+    fclose( file );
+
+    return true;
+}
+
+bool ReplaceFile( const std::string& from, const std::string& to )
+{
+#ifdef _WIN32
+    //rename doesn't overwrite existing file on windows
+    _wremove( Utf8ToWide( to ).c_str() );
+    return 0 == _wrename( Utf8ToWide( from ).c_str(), Utf8ToWide( to ).c_str() );
+#else
+    return 0 == rename( from.c_str(), to.c_str() );
+#endif
+}
+
+//FNV-1a
+std::string UrlKey( const std::string& url )
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for( char c: url ) {
+        hash ^= static_cast<uint8_t>( c );
+        hash *= 1099511628211ULL;
+    }
+
+    static const char Digits[] = "0123456789abcdef";
+    std::string key( 16, '0' );
+    for( int i = 15; i >= 0; --i ) {
+        key[i] = Digits[hash & 0xF];
+        hash >>= 4;
+    }
+
+    return key;
+}
+
+//adds [start, end) to ranges, merging adjacent ones,
+//returns count of bytes which were not in ranges before
+uint64_t AddRange( std::map<uint64_t, uint64_t>* ranges, uint64_t start, uint64_t end )
+{
+    auto it = ranges->upper_bound( start );
+    if( it != ranges->begin() ) {
+        auto prevIt = std::prev( it );
+        if( prevIt->second >= start )
+            it = prevIt;
+    }
+
+    uint64_t covered = 0;
+    uint64_t mergedStart = start;
+    uint64_t mergedEnd = end;
+    while( it != ranges->end() && it->first <= end ) {
+        const uint64_t overlapStart = std::max( it->first, start );
+        const uint64_t overlapEnd = std::min( it->second, end );
+        if( overlapEnd > overlapStart )
+            covered += overlapEnd - overlapStart;
+
+        mergedStart = std::min( mergedStart, it->first );
+        mergedEnd = std::max( mergedEnd, it->second );
+        it = ranges->erase( it );
+    }
+
+    ( *ranges )[mergedStart] = mergedEnd;
+
+    return ( end - start ) - covered;
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+DiskCache::Entry::Entry( DiskCache* cache, const std::string& key, const std::string& url ) :
+    _cache( cache ), _key( key ), _url( url ), _file( nullptr ),
+    _size( MediaInput::UnknownSize ), _generation( 0 ), _lastAccess( 0 ), _cachedBytes( 0 )
+{
+}
+
+DiskCache::Entry::~Entry()
+{
+    closeFile();
+}
+
+FILE* DiskCache::Entry::file()
+{
+    if( !_file ) {
+        const std::string path = _cache->dataPath( _key );
+        _file = OpenFile( path, "r+b" );
+        if( !_file )
+            _file = OpenFile( path, "w+b" );
+    }
+
+    return _file;
+}
+
+void DiskCache::Entry::closeFile()
+{
+    if( _file ) {
+        fclose( _file );
+        _file = nullptr;
+    }
+}
+
+uint64_t DiskCache::Entry::size() const
+{
+    std::lock_guard<std::mutex> lock( _cache->_guard );
+
+    return _size;
+}
+
+void DiskCache::Entry::setSize( uint64_t size )
+{
+    //nothing is written to data file until it's removed
+    std::lock_guard<std::mutex> fileLock( _fileGuard );
+
+    bool dropData = false;
+    {
+        std::lock_guard<std::mutex> lock( _cache->_guard );
+
+        if( size == _size )
+            return;
+
+        //resource was changed on server, cached data is useless
+        if( !_ranges.empty() ) {
+            _cache->_cachedBytes -= _cachedBytes;
+            _cachedBytes = 0;
+            _ranges.clear();
+            ++_generation;
+            dropData = true;
+        }
+
+        _size = size;
+    }
+
+    if( dropData ) {
+        closeFile();
+        RemoveFile( _cache->dataPath( _key ) );
+    }
+}
+
+uint64_t DiskCache::Entry::cachedFrom( uint64_t offset ) const
+{
+    std::lock_guard<std::mutex> lock( _cache->_guard );
+
+    auto it = _ranges.upper_bound( offset );
+    if( it == _ranges.begin() )
+        return 0;
+
+    --it;
+
+    return it->second > offset ? it->second - offset : 0;
+}
+
+uint64_t DiskCache::Entry::nextCached( uint64_t offset ) const
+{
+    std::lock_guard<std::mutex> lock( _cache->_guard );
+
+    auto it = _ranges.upper_bound( offset );
+
+    return it != _ranges.end() ? it->first : _size;
+}
+
+uint64_t DiskCache::Entry::cachedBytes() const
+{
+    std::lock_guard<std::mutex> lock( _cache->_guard );
+
+    return _cachedBytes;
+}
+
+bool DiskCache::Entry::read( uint64_t offset, uint8_t* buffer, size_t size )
+{
+    unsigned generation;
+    {
+        std::lock_guard<std::mutex> lock( _cache->_guard );
+
+        auto it = _ranges.upper_bound( offset );
+        if( it == _ranges.begin() || std::prev( it )->second < offset + size )
+            return false;
+
+        generation = _generation;
+    }
+
+    {
+        std::lock_guard<std::mutex> fileLock( _fileGuard );
+
+        FILE* dataFile = file();
+        if( !dataFile || !SeekFile( dataFile, offset ) ||
+            fread( buffer, 1, size, dataFile ) != size )
+        {
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock( _cache->_guard );
+
+    //data was dropped while it was read
+    if( generation != _generation )
+        return false;
+
+    _cache->_readBytes += size;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+DiskCache::DiskCache() :
+    _maxSize( 0 ), _cachedBytes( 0 ), _unsavedBytes( 0 ),
+    _readBytes( 0 ), _networkBytes( 0 ), _evictedEntries( 0 ),
+    _catalogSerial( 0 ), _savedCatalogSerial( 0 ),
+    _writer( new ThreadPool( 1 ) )
+{
+}
+
+DiskCache::~DiskCache()
+{
+    //waits for pending writes
+    _writer.reset();
+
+    saveCatalog();
+
+    for( auto& entry: _entries )
+        entry.second->closeFile();
+}
+
+std::string DiskCache::dataPath( const std::string& key ) const
+{
+    return _directory + "/" + key + ".data";
+}
+
+bool DiskCache::open( const std::string& directory, uint64_t maxSize )
+{
+#ifdef _WIN32
+    _wmkdir( Utf8ToWide( directory ).c_str() );
+#else
+    mkdir( directory.c_str(), 0755 );
+#endif
+
+    std::string catalog;
+    const bool catalogRead = ReadFile( directory + "/" + CatalogName, &catalog );
+
+    Entries evicted;
+    bool loaded;
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+
+        _directory = directory;
+        _maxSize = maxSize;
+
+        loaded = catalogRead && loadCatalog( catalog );
+        if( loaded ) {
+            //max size could be lowered since last run
+            evict( &evicted );
+        } else {
+            //missing or broken catalog, start new one
+            for( auto& entry: _entries )
+                evicted.push_back( entry.second );
+            _entries.clear();
+            _cachedBytes = 0;
+        }
+    }
+
+    //catalog is saved before data files are removed,
+    //so it never lists missing ones
+    const bool saved = ( loaded && evicted.empty() ) || saveCatalog();
+    removeEntries( evicted );
+
+    return loaded || saved;
+}
+
+//catalog: signature line, then line per entry:
+//key size lastAccess rangeCount [start end]... url
+bool DiskCache::loadCatalog( const std::string& data )
+{
+    size_t lineStart = 0;
+    size_t lineEnd = data.find( '\n' );
+    if( lineEnd == std::string::npos || 0 != data.compare( 0, lineEnd, CatalogSignature ) )
+        return false;
+
+    while( ( lineStart = lineEnd + 1 ) < data.size() ) {
+        lineEnd = data.find( '\n', lineStart );
+        if( lineEnd == std::string::npos )
+            break; //truncated line
+
+        const std::string line = data.substr( lineStart, lineEnd - lineStart );
+        const char* pos = line.c_str();
+        char* end;
+
+        const size_t keyEnd = line.find( ' ' );
+        if( keyEnd == std::string::npos )
+            return false;
+        const std::string key = line.substr( 0, keyEnd );
+        pos += keyEnd;
+
+        const uint64_t size = strtoull( pos, &end, 10 ); pos = end;
+        const int64_t lastAccess = strtoll( pos, &end, 10 ); pos = end;
+        const uint64_t rangeCount = strtoull( pos, &end, 10 ); pos = end;
+
+        std::map<uint64_t, uint64_t> ranges;
+        uint64_t cachedBytes = 0;
+        for( uint64_t i = 0; i < rangeCount; ++i ) {
+            const uint64_t start = strtoull( pos, &end, 10 ); pos = end;
+            const uint64_t rangeEnd = strtoull( pos, &end, 10 ); pos = end;
+            if( rangeEnd <= start || rangeEnd > size )
+                return false;
+            cachedBytes += AddRange( &ranges, start, rangeEnd );
+        }
+
+        if( ' ' != *pos )
+            return false;
+        const std::string url = pos + 1;
+        if( url.empty() || UrlKey( url ) != key )
+            return false;
+
+        std::shared_ptr<Entry> entry( new Entry( this, key, url ), deleteEntry );
+        entry->_size = size;
+        entry->_lastAccess = lastAccess;
+        entry->_ranges.swap( ranges );
+        entry->_cachedBytes = cachedBytes;
+
+        _cachedBytes += cachedBytes;
+        _entries[key] = entry;
+    }
+
+    return true;
+}
+
+std::string DiskCache::catalogData() const
+{
+    std::string data = CatalogSignature;
+    data += '\n';
+    for( const auto& it: _entries ) {
+        const Entry& entry = *it.second;
+
+        data += entry._key;
+        data += ' ' + std::to_string( entry._size );
+        data += ' ' + std::to_string( entry._lastAccess );
+        data += ' ' + std::to_string( entry._ranges.size() );
+        for( const auto& range: entry._ranges ) {
+            data += ' ' + std::to_string( range.first );
+            data += ' ' + std::to_string( range.second );
+        }
+        data += ' ' + entry._url;
+        data += '\n';
+    }
+
+    return data;
+}
+
+bool DiskCache::saveCatalog()
+{
+    std::string data;
+    std::string path;
+    unsigned serial;
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+
+        if( _directory.empty() )
+            return false;
+
+        data = catalogData();
+        path = _directory + "/" + CatalogName;
+        serial = ++_catalogSerial;
+        _unsavedBytes = 0;
+    }
+
+    std::lock_guard<std::mutex> catalogLock( _catalogGuard );
+
+    //newer catalog was already saved by other thread
+    if( serial < _savedCatalogSerial )
+        return true;
+
+    //catalog is replaced at once, so it's never seen half written
+    const std::string tmpPath = path + ".tmp";
+
+    FILE* file = OpenFile( tmpPath, "wb" );
+    if( !file )
+        return false;
+
+    const bool written = fwrite( data.data(), 1, data.size(), file ) == data.size();
+    fclose( file );
+
+    if( !written || !ReplaceFile( tmpPath, path ) )
+        return false;
+
+    _savedCatalogSerial = serial;
+
+    return true;
+}
+
+//evicted entries are removed on writer thread, so entry acquired meanwhile
+//for the same url can't get data written to file being removed
+void DiskCache::removeEntries( const Entries& entries )
+{
+    for( const std::shared_ptr<Entry>& entry: entries ) {
+        std::lock_guard<std::mutex> fileLock( entry->_fileGuard );
+
+        entry->closeFile();
+        RemoveFile( dataPath( entry->_key ) );
+    }
+}
+
+std::shared_ptr<DiskCache::Entry> DiskCache::acquire( const std::string& url )
+{
+    const std::string key = UrlKey( url );
+
+    Entries replaced;
+    std::shared_ptr<Entry> acquired;
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+
+        std::shared_ptr<Entry>& entry = _entries[key];
+        if( !entry || entry->_url != url ) {
+            //new url, or (unlikely) key collision
+            if( entry ) {
+                _cachedBytes -= entry->_cachedBytes;
+                replaced.push_back( entry );
+            }
+
+            entry.reset( new Entry( this, key, url ), deleteEntry );
+        }
+
+        entry->_lastAccess = time( nullptr );
+        acquired = entry;
+    }
+
+    removeEntries( replaced );
+
+    return acquired;
+}
+
+void DiskCache::flush( const std::shared_ptr<Entry>& entry )
+{
+    {
+        std::lock_guard<std::mutex> fileLock( entry->_fileGuard );
+
+        entry->closeFile();
+    }
+
+    saveCatalog();
+}
+
+void DiskCache::write( const std::shared_ptr<Entry>& entry, uint64_t offset,
+                       const std::shared_ptr<std::vector<uint8_t> >& data,
+                       const std::function<void()>& done )
+{
+    _writer->post(
+        [this, entry, offset, data, done] () {
+            store( entry, offset, *data );
+            done();
+        } );
+}
+
+void DiskCache::store( const std::shared_ptr<Entry>& entry, uint64_t offset,
+                       const std::vector<uint8_t>& data )
+{
+    unsigned generation;
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+
+        _networkBytes += data.size();
+
+        if( data.empty() || offset + data.size() > entry->_size )
+            return;
+
+        generation = entry->_generation;
+    }
+
+    {
+        std::lock_guard<std::mutex> fileLock( entry->_fileGuard );
+
+        //writing beyond end of file leaves hole, so only written ranges take disk space
+        //(on file systems with sparse files support).
+        //data should reach disk before it's listed in catalog
+        FILE* dataFile = entry->file();
+        if( !dataFile || !SeekFile( dataFile, offset ) ||
+            fwrite( data.data(), 1, data.size(), dataFile ) != data.size() ||
+            0 != fflush( dataFile ) )
+        {
+            return;
+        }
+    }
+
+    Entries evicted;
+    bool save;
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+
+        //cached data was dropped while chunk was written
+        if( generation != entry->_generation )
+            return;
+
+        const uint64_t added = AddRange( &entry->_ranges, offset, offset + data.size() );
+        entry->_cachedBytes += added;
+        _cachedBytes += added;
+        _unsavedBytes += added;
+
+        save = evict( &evicted ) || _unsavedBytes >= CatalogSaveInterval;
+    }
+
+    if( save )
+        saveCatalog();
+    removeEntries( evicted );
+}
+
+bool DiskCache::evict( Entries* evicted )
+{
+    if( _cachedBytes <= _maxSize )
+        return false;
+
+    const uint64_t targetSize = _maxSize - _maxSize / EvictionSlack;
+
+    //entry is in use if somebody except cache holds reference to it
+    Entries candidates;
+    for( const auto& it: _entries ) {
+        if( it.second.use_count() == 1 )
+            candidates.push_back( it.second );
+    }
+
+    std::sort( candidates.begin(), candidates.end(),
+        [] ( const std::shared_ptr<Entry>& l, const std::shared_ptr<Entry>& r ) {
+            return l->_lastAccess < r->_lastAccess;
+        } );
+
+    const size_t evictedCount = evicted->size();
+    for( const std::shared_ptr<Entry>& entry: candidates ) {
+        if( _cachedBytes <= targetSize )
+            break;
+
+        //data file is removed by caller, after catalog is saved
+        _cachedBytes -= entry->_cachedBytes;
+        _entries.erase( entry->_key );
+        evicted->push_back( entry );
+
+        ++_evictedEntries;
+    }
+
+    return evicted->size() > evictedCount;
+}
+
+void DiskCache::stats( MediaInputStats* stats ) const
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    //share of data served to libvlc without network access
+    const double hitRatio =
+        _readBytes > _networkBytes ?
+            static_cast<double>( _readBytes - _networkBytes ) / _readBytes : 0.;
+
+    stats->push_back( { "cachedBytes", static_cast<double>( _cachedBytes ) } );
+    stats->push_back( { "maxSize", static_cast<double>( _maxSize ) } );
+    stats->push_back( { "entryCount", static_cast<double>( _entries.size() ) } );
+    stats->push_back( { "evictedEntries", static_cast<double>( _evictedEntries ) } );
+    stats->push_back( { "readBytes", static_cast<double>( _readBytes ) } );
+    stats->push_back( { "networkBytes", static_cast<double>( _networkBytes ) } );
+    stats->push_back( { "hitRatio", hitRatio } );
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <stdio.h>
+
+#include "MediaInput.h"
+#include "ThreadPool.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//Persistent byte range cache of network resources.
+//Every url has sparse data file in cache directory, cached ranges of all
+//urls are listed in catalog file. Total size is bounded,
+//least recently used entries are evicted first (entries in use never are).
+//Data is written on dedicated thread. All public methods are thread safe,
+//file IO is done outside of cache guard.
+class DiskCache
+{
+public:
+    class Entry
+    {
+    public:
+        //UnknownSize until first network response
+        uint64_t size() const;
+        //drops cached data if size differs from cached one
+        void setSize( uint64_t size );
+
+        //count of bytes cached contiguously from offset
+        uint64_t cachedFrom( uint64_t offset ) const;
+        //start of first cached range after offset, or size
+        uint64_t nextCached( uint64_t offset ) const;
+        uint64_t cachedBytes() const;
+
+        //reads only cached data
+        bool read( uint64_t offset, uint8_t* buffer, size_t size );
+
+    private:
+        friend class DiskCache;
+
+        Entry( DiskCache* cache, const std::string& key, const std::string& url );
+        ~Entry();
+
+        //should be called with _fileGuard locked
+        FILE* file();
+        void closeFile();
+
+    private:
+        DiskCache* const _cache;
+        const std::string _key;
+        const std::string _url;
+
+        //serializes data file access, locked before cache guard
+        std::mutex _fileGuard;
+        FILE* _file;
+
+        //fields below are guarded by cache guard
+        uint64_t _size;
+        //incremented when cached data is dropped,
+        //so data written or read meanwhile is not trusted
+        unsigned _generation;
+        int64_t _lastAccess;
+        //cached ranges [start, end), by start
+        std::map<uint64_t, uint64_t> _ranges;
+        uint64_t _cachedBytes;
+    };
+
+    DiskCache();
+    ~DiskCache(); //waits for pending writes
+
+    //directory is created if it doesn't exist
+    bool open( const std::string& directory, uint64_t maxSize );
+
+    //entry is created if there is no one for url yet
+    std::shared_ptr<Entry> acquire( const std::string& url );
+    //saves entry ranges and closes it's data file (reopened on next access)
+    void flush( const std::shared_ptr<Entry>& );
+
+    //data is written on writer thread, done is called after that
+    void write( const std::shared_ptr<Entry>&, uint64_t offset,
+                const std::shared_ptr<std::vector<uint8_t> >& data,
+                const std::function<void()>& done );
+
+    void stats( MediaInputStats* ) const;
+
+private:
+    typedef std::vector<std::shared_ptr<Entry> > Entries;
+
+    void store( const std::shared_ptr<Entry>&, uint64_t offset, const std::vector<uint8_t>& data );
+
+    //should be called with _guard locked,
+    //returns false if no entry was evicted
+    bool evict( Entries* evicted );
+    bool loadCatalog( const std::string& data );
+    std::string catalogData() const;
+
+    //should be called with _guard unlocked
+    bool saveCatalog();
+    void removeEntries( const Entries& );
+
+    std::string dataPath( const std::string& key ) const;
+
+    static void deleteEntry( Entry* entry )
+        { delete entry; }
+
+private:
+    mutable std::mutex _guard;
+    std::string _directory;
+    uint64_t _maxSize;
+
+    std::unordered_map<std::string, std::shared_ptr<Entry> > _entries;
+    uint64_t _cachedBytes;
+    //bytes written since catalog was saved
+    uint64_t _unsavedBytes;
+
+    //stats
+    uint64_t _readBytes;
+    uint64_t _networkBytes;
+    unsigned _evictedEntries;
+
+    //serializes catalog file writes
+    std::mutex _catalogGuard;
+    //catalog snapshots are numbered, so older one never overwrites newer
+    unsigned _catalogSerial;
+    unsigned _savedCatalogSerial;
+
+    std::unique_ptr<ThreadPool> _writer;
+};
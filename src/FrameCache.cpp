@@ -0,0 +1,103 @@
+#include "FrameCache.h"
+
+#include <string.h>
+
+FrameCache::FrameCache() :
+    _limit( 0 ), _usedBytes( 0 ), _lastSerial( 0 )
+{
+}
+
+void FrameCache::setLimit( size_t limit )
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    _limit = limit;
+    shrink( limit );
+    if( !limit )
+        std::vector<uint8_t>().swap( _spare );
+}
+
+size_t FrameCache::limit() const
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    return _limit;
+}
+
+void FrameCache::clear()
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    shrink( 0 );
+}
+
+void FrameCache::shrink( size_t limit )
+{
+    while( !_frames.empty() && _usedBytes > limit ) {
+        _usedBytes -= _frames.front().data.size();
+        _spare.swap( _frames.front().data );
+        _frames.pop_front();
+    }
+}
+
+uint64_t FrameCache::add( const void* frame, size_t size )
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    if( !size || size > _limit ) {
+        //cached frames are not followed by this one anymore
+        shrink( 0 );
+        return 0;
+    }
+
+    shrink( _limit - size );
+
+    CachedFrame cachedFrame;
+    cachedFrame.serial = ++_lastSerial;
+    cachedFrame.data.swap( _spare );
+    cachedFrame.data.resize( size );
+    memcpy( cachedFrame.data.data(), frame, size );
+
+    _frames.push_back( std::move( cachedFrame ) );
+    _usedBytes += size;
+
+    return _lastSerial;
+}
+
+bool FrameCache::copy( uint64_t serial, void* frame, size_t size ) const
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    if( _frames.empty() || serial < _frames.front().serial || serial > _frames.back().serial )
+        return false;
+
+    //serials of cached frames are contiguous
+    const CachedFrame& cachedFrame = _frames[serial - _frames.front().serial];
+    if( cachedFrame.data.size() != size )
+        return false;
+
+    memcpy( frame, cachedFrame.data.data(), size );
+
+    return true;
+}
+
+uint64_t FrameCache::lastSerial() const
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    return _frames.empty() ? 0 : _lastSerial;
+}
+
+size_t FrameCache::usedBytes() const
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    return _usedBytes;
+}
+
+unsigned FrameCache::frameCount() const
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    return static_cast<unsigned>( _frames.size() );
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//Copies of recently displayed frames, limited by total size in bytes.
+//Every added frame gets serial number, which is never reused (even after clear()),
+//so stale serials just miss. Thread safe.
+class FrameCache
+{
+public:
+    FrameCache();
+
+    //0 - disabled, oldest frames are dropped to fit new limit
+    void setLimit( size_t );
+    size_t limit() const;
+
+    void clear();
+
+    //returns serial of added frame, or 0 if cache is disabled or frame doesn't fit limit
+    uint64_t add( const void* frame, size_t size );
+    //returns false if frame is not in cache or has other size
+    bool copy( uint64_t serial, void* frame, size_t size ) const;
+
+    //serial of last added frame (0 if none)
+    uint64_t lastSerial() const;
+
+    size_t usedBytes() const;
+    unsigned frameCount() const;
+
+private:
+    void shrink( size_t limit );
+
+private:
+    struct CachedFrame
+    {
+        uint64_t serial;
+        std::vector<uint8_t> data;
+    };
+
+    mutable std::mutex _guard;
+    size_t _limit;
+    size_t _usedBytes;
+    uint64_t _lastSerial;
+    //oldest first
+    std::deque<CachedFrame> _frames;
+    //buffer of dropped frame, reused to avoid allocation on every frame
+    std::vector<uint8_t> _spare;
+};
@@ -0,0 +1,183 @@
+#include "FrameGrabber.h"
+
+#include <string.h>
+
+#include <chrono>
+#include <algorithm>
+
+#include "MediaInfo.h"
+
+namespace {
+
+const char CHROMA[] = "RV32";
+const unsigned PIXEL_BYTES = 4;
+
+const libvlc_event_e PlayerEvents[] = {
+    libvlc_MediaPlayerPaused,
+    libvlc_MediaPlayerEndReached,
+    libvlc_MediaPlayerEncounteredError,
+    libvlc_MediaPlayerStopped,
+};
+
+}
+
+FrameGrabber::FrameGrabber( unsigned width ) :
+    _width( width ), _height( 0 ), _length( 0 ), _player( nullptr ),
+    _displayedCount( 0 ), _paused( false ), _failed( false )
+{
+}
+
+FrameGrabber::~FrameGrabber()
+{
+    close();
+}
+
+unsigned FrameGrabber::formatCallback( void** opaque, char* chroma,
+                                       unsigned* width, unsigned* height,
+                                       unsigned* pitches, unsigned* lines )
+{
+    FrameGrabber* grabber = static_cast<FrameGrabber*>( *opaque );
+
+    if( !*width || !*height )
+        return 0;
+
+    //libvlc scales to requested size
+    unsigned scaledHeight = ( grabber->_width * *height + *width / 2 ) / *width;
+    scaledHeight = std::max( 2u, scaledHeight & ~1u );
+
+    memcpy( chroma, CHROMA, sizeof( CHROMA ) - 1 );
+    *width = grabber->_width;
+    *height = scaledHeight;
+    *pitches = grabber->_width * PIXEL_BYTES;
+    *lines = scaledHeight;
+
+    std::lock_guard<std::mutex> lock( grabber->_guard );
+    grabber->_height = scaledHeight;
+    grabber->_frame.assign( *pitches * *lines, 0 );
+
+    return 1;
+}
+
+void* FrameGrabber::lockCallback( void* opaque, void** planes )
+{
+    FrameGrabber* grabber = static_cast<FrameGrabber*>( opaque );
+    *planes = grabber->_frame.data();
+
+    return nullptr;
+}
+
+void FrameGrabber::displayCallback( void* opaque, void* /*picture*/ )
+{
+    FrameGrabber* grabber = static_cast<FrameGrabber*>( opaque );
+
+    std::lock_guard<std::mutex> lock( grabber->_guard );
+    ++grabber->_displayedCount;
+    grabber->_changed.notify_all();
+}
+
+void FrameGrabber::onPlayerEvent( const libvlc_event_t* event, void* opaque )
+{
+    FrameGrabber* grabber = static_cast<FrameGrabber*>( opaque );
+
+    std::lock_guard<std::mutex> lock( grabber->_guard );
+    if( libvlc_MediaPlayerPaused == event->type )
+        grabber->_paused = true;
+    else
+        grabber->_failed = true;
+    grabber->_changed.notify_all();
+}
+
+bool FrameGrabber::open( libvlc_instance_t* libvlc, const std::string& mrl, unsigned timeout )
+{
+    close();
+
+    libvlc_media_t* media = CreateMedia( libvlc, mrl );
+    if( !media )
+        return false;
+
+    libvlc_media_add_option( media, ":no-audio" );
+    libvlc_media_add_option( media, ":no-spu" );
+    libvlc_media_add_option( media, ":no-osd" );
+
+    _player = libvlc_media_player_new_from_media( media );
+    libvlc_media_release( media );
+    if( !_player )
+        return false;
+
+    libvlc_video_set_callbacks( _player, lockCallback, nullptr, displayCallback, this );
+    libvlc_video_set_format_callbacks( _player, formatCallback, nullptr );
+
+    libvlc_event_manager_t* eventManager = libvlc_media_player_event_manager( _player );
+    for( libvlc_event_e e: PlayerEvents )
+        libvlc_event_attach( eventManager, e, onPlayerEvent, this );
+
+    if( 0 != libvlc_media_player_play( _player ) || !waitFrame( 0, timeout ) ) {
+        close();
+        return false;
+    }
+
+    //frames are decoded only on seeks from now
+    libvlc_media_player_set_pause( _player, 1 );
+    {
+        std::unique_lock<std::mutex> lock( _guard );
+        _changed.wait_for( lock, std::chrono::milliseconds( timeout ),
+            [this] () { return _paused || _failed; } );
+        if( !_paused ) {
+            lock.unlock();
+            close();
+            return false;
+        }
+    }
+
+    _length = libvlc_media_player_get_length( _player );
+
+    return true;
+}
+
+void FrameGrabber::close()
+{
+    if( !_player )
+        return;
+
+    libvlc_event_manager_t* eventManager = libvlc_media_player_event_manager( _player );
+    for( libvlc_event_e e: PlayerEvents )
+        libvlc_event_detach( eventManager, e, onPlayerEvent, this );
+
+    libvlc_media_player_stop( _player );
+    libvlc_media_player_release( _player );
+    _player = nullptr;
+
+    _displayedCount = 0;
+    _paused = false;
+    _failed = false;
+}
+
+bool FrameGrabber::waitFrame( unsigned displayedCount, unsigned timeout )
+{
+    std::unique_lock<std::mutex> lock( _guard );
+
+    return _changed.wait_for( lock, std::chrono::milliseconds( timeout ),
+        [this, displayedCount] () {
+            return _displayedCount > displayedCount || _failed;
+        } ) && !_failed;
+}
+
+const uint8_t* FrameGrabber::grab( libvlc_time_t time, unsigned timeout )
+{
+    if( !_player )
+        return nullptr;
+
+    unsigned displayedCount;
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+        displayedCount = _displayedCount;
+    }
+
+    //paused player decodes (and displays) only frame at new position
+    libvlc_media_player_set_time( _player, time );
+
+    if( !waitFrame( displayedCount, timeout ) )
+        return nullptr;
+
+    return _frame.data();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+
+#include <vlc/vlc.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//Headless video decode on its own media player (without audio and subtitles),
+//so it doesn't interfere with players and their VlcVideoOutput.
+//Frames are scaled by libvlc to requested width (height keeps aspect ratio)
+//and delivered as RV32 (BGRA in memory).
+//All methods block, so should be called only from worker thread.
+class FrameGrabber
+{
+public:
+    explicit FrameGrabber( unsigned width );
+    ~FrameGrabber();
+
+    //starts decoding and pauses on first frame, timeout is in ms
+    bool open( libvlc_instance_t*, const std::string& mrl, unsigned timeout );
+    void close();
+
+    unsigned width() const
+        { return _width; }
+    //valid after successful open()
+    unsigned height() const
+        { return _height; }
+    libvlc_time_t length() const
+        { return _length; }
+
+    //seeks to time (in ms) while paused, and waits for frame displayed after seek.
+    //Returns nullptr on failure or timeout. Frame is valid until next grab().
+    const uint8_t* grab( libvlc_time_t time, unsigned timeout );
+
+private:
+    static unsigned formatCallback( void** opaque, char* chroma,
+                                    unsigned* width, unsigned* height,
+                                    unsigned* pitches, unsigned* lines );
+    static void* lockCallback( void* opaque, void** planes );
+    static void displayCallback( void* opaque, void* picture );
+    static void onPlayerEvent( const libvlc_event_t*, void* opaque );
+
+    //waits until frame is displayed after displayedCount frames, or failure
+    bool waitFrame( unsigned displayedCount, unsigned timeout );
+
+private:
+    const unsigned _width;
+    unsigned _height;
+    libvlc_time_t _length;
+
+    libvlc_media_player_t* _player;
+    std::vector<uint8_t> _frame;
+
+    std::mutex _guard;
+    std::condition_variable _changed;
+    unsigned _displayedCount;
+    bool _paused;
+    bool _failed;
+};
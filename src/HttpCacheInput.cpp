@@ -0,0 +1,319 @@
+#include "HttpCacheInput.h"
+
+#include <algorithm>
+
+namespace {
+
+//download is paused while it's this far ahead of read position
+const uint64_t ReadAheadSize = 16 * 1024 * 1024;
+//read-ahead download is started when read position comes this close to missing range,
+//but only while reads are sequential (i.e. not for short reads after scrubbing seeks)
+const uint64_t ReadAheadStart = 4 * 1024 * 1024;
+const uint64_t ReadAheadTrigger = 1024 * 1024;
+//read waits for running download if it will reach read position soon,
+//otherwise new download is started from read position
+const uint64_t JoinDistance = 512 * 1024;
+//download is paused while cache writer is behind
+const size_t MaxPendingWrite = 4 * 1024 * 1024;
+
+}
+
+HttpCacheInput::HttpCacheInput( const std::shared_ptr<DiskCache>& cache, const std::string& url,
+                                const std::function<void()>& notify ) :
+    _cache( cache ), _entry( cache->acquire( url ) ), _url( url ), _notify( notify ),
+    _size( UnknownSize ), _position( 0 ), _sequentialBytes( 0 ),
+    _generation( 0 ), _requestPending( false ), _downloading( false ),
+    _downloadStart( 0 ), _downloadNext( 0 ), _downloadEnd( 0 ), _pendingWrite( 0 ),
+    _interrupted( false ), _sizeUnknown( false ), _rangesIgnored( false ),
+    _bytesRead( 0 ), _networkBytes( 0 ), _requestCount( 0 )
+{
+}
+
+HttpCacheInput::~HttpCacheInput()
+{
+    //let downloader know input is gone
+    _notify();
+}
+
+void HttpCacheInput::requestFrom( uint64_t offset )
+{
+    ++_generation;
+    ++_requestCount;
+
+    _requestPending = true;
+    _downloading = true;
+    _downloadStart = _downloadNext = offset;
+    //already cached data is not downloaded again
+    _downloadEnd = UnknownSize == _size ? UnknownSize : _entry->nextCached( offset );
+
+    _notify();
+}
+
+bool HttpCacheInput::reaches( uint64_t offset ) const
+{
+    //without ranges restarted download would come from beginning anyway
+    return _downloading &&
+           offset >= _downloadStart && offset < _downloadEnd &&
+           ( offset < _downloadNext + JoinDistance || _rangesIgnored );
+}
+
+bool HttpCacheInput::takeRequest( uint64_t* offset, uint64_t* end, unsigned* generation )
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    if( !_requestPending )
+        return false;
+
+    _requestPending = false;
+
+    *offset = _downloadNext;
+    *end = _downloadEnd;
+    *generation = _generation;
+
+    return true;
+}
+
+bool HttpCacheInput::isDownloading( unsigned generation ) const
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    return _downloading && generation == _generation;
+}
+
+bool HttpCacheInput::wantsData( unsigned generation ) const
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    return _downloading && generation == _generation &&
+           _downloadNext < _position + ReadAheadSize &&
+           _pendingWrite < MaxPendingWrite;
+}
+
+void HttpCacheInput::responded( unsigned generation, uint64_t size )
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    if( !_downloading || generation != _generation )
+        return;
+
+    if( UnknownSize == size ) {
+        //resource of unknown size can't be cached
+        _sizeUnknown = true;
+        _downloading = false;
+        _changed.notify_all();
+        return;
+    }
+
+    if( size != _size ) {
+        _entry->setSize( size );
+        _size = size;
+    }
+
+    _downloadEnd = std::min( _downloadEnd, _entry->nextCached( _downloadNext ) );
+
+    _changed.notify_all();
+}
+
+void HttpCacheInput::rangesIgnored()
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    _rangesIgnored = true;
+}
+
+bool HttpCacheInput::received( unsigned generation, const void* data, size_t size )
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    if( !_downloading || generation != _generation )
+        return false;
+
+    size = static_cast<size_t>( std::min<uint64_t>( size, _downloadEnd - _downloadNext ) );
+
+    const uint8_t* bytes = static_cast<const uint8_t*>( data );
+    std::shared_ptr<std::vector<uint8_t> > chunk =
+        std::make_shared<std::vector<uint8_t> >( bytes, bytes + size );
+
+    std::weak_ptr<HttpCacheInput> weakThis = shared_from_this();
+    _cache->write( _entry, _downloadNext, chunk,
+        [weakThis, size] () {
+            if( std::shared_ptr<HttpCacheInput> input = weakThis.lock() )
+                input->written( size );
+        } );
+
+    _downloadNext += size;
+    _pendingWrite += size;
+    _networkBytes += size;
+
+    if( _downloadNext >= _downloadEnd )
+        _downloading = false;
+
+    return _downloading;
+}
+
+void HttpCacheInput::written( size_t size )
+{
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+        _pendingWrite -= size;
+        _changed.notify_all();
+    }
+
+    //download could be paused by pending writes limit
+    _notify();
+}
+
+void HttpCacheInput::finished( unsigned generation, bool /*error*/ )
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    if( !_downloading || generation != _generation )
+        return;
+
+    //waiting read will start new download or fail
+    _downloading = false;
+    _changed.notify_all();
+}
+
+bool HttpCacheInput::open( uint64_t* size )
+{
+    std::unique_lock<std::mutex> lock( _guard );
+
+    _interrupted = false;
+    _position = 0;
+    _sequentialBytes = 0;
+
+    //size of already cached resource is known without network access
+    if( UnknownSize == _size )
+        _size = _entry->size();
+
+    if( UnknownSize == _size ) {
+        requestFrom( 0 );
+        _changed.wait( lock,
+            [this] () {
+                return UnknownSize != _size || !_downloading || _interrupted;
+            } );
+
+        if( UnknownSize == _size )
+            return false;
+    }
+
+    *size = _size;
+
+    return true;
+}
+
+int64_t HttpCacheInput::read( uint8_t* buffer, size_t size )
+{
+    std::unique_lock<std::mutex> lock( _guard );
+
+    if( _position >= _size )
+        return 0;
+
+    bool requested = false;
+    uint64_t cached;
+    for( ;; ) {
+        if( _interrupted )
+            return -1;
+
+        cached = _entry->cachedFrom( _position );
+        if( cached )
+            break;
+
+        if( !reaches( _position ) && !_pendingWrite ) {
+            //download was already restarted once for this read
+            if( requested )
+                return -1;
+
+            requestFrom( _position );
+            requested = true;
+        }
+
+        _changed.wait( lock );
+    }
+
+    const size_t count = static_cast<size_t>( std::min<uint64_t>( size, cached ) );
+    if( !_entry->read( _position, buffer, count ) )
+        return -1;
+
+    _position += count;
+    _bytesRead += count;
+    _sequentialBytes += count;
+
+    //read-ahead, so playback doesn't stall on next missing range
+    const uint64_t missing = _position + _entry->cachedFrom( _position );
+    if( _sequentialBytes >= ReadAheadTrigger &&
+        missing < _size && missing < _position + ReadAheadStart && !reaches( missing ) )
+    {
+        requestFrom( missing );
+    }
+    else if( _downloading )
+        _notify(); //paused download could be resumed
+
+    return static_cast<int64_t>( count );
+}
+
+bool HttpCacheInput::seek( uint64_t offset )
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    if( offset > _size )
+        return false;
+
+    //network is touched only if data at new position is not cached
+    if( offset != _position )
+        _sequentialBytes = 0;
+    _position = offset;
+
+    return true;
+}
+
+void HttpCacheInput::close()
+{
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+        _downloading = false;
+        _requestPending = false;
+    }
+
+    _notify();
+
+    _cache->flush( _entry );
+}
+
+void HttpCacheInput::interrupt()
+{
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+        _interrupted = true;
+        _downloading = false;
+        _requestPending = false;
+    }
+
+    _changed.notify_all();
+    _notify();
+}
+
+bool HttpCacheInput::fallbackToMrl() const
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    return _sizeUnknown;
+}
+
+void HttpCacheInput::stats( MediaInputStats* stats ) const
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    const double hitRatio =
+        _bytesRead > _networkBytes ?
+            static_cast<double>( _bytesRead - _networkBytes ) / _bytesRead : 0.;
+
+    stats->push_back( { "size", UnknownSize == _size ? -1. : static_cast<double>( _size ) } );
+    stats->push_back( { "cachedBytes", static_cast<double>( _entry->cachedBytes() ) } );
+    stats->push_back( { "bytesRead", static_cast<double>( _bytesRead ) } );
+    stats->push_back( { "networkBytes", static_cast<double>( _networkBytes ) } );
+    stats->push_back( { "requestCount", static_cast<double>( _requestCount ) } );
+    stats->push_back( { "rangesIgnored", _rangesIgnored ? 1. : 0. } );
+    stats->push_back( { "hitRatio", hitRatio } );
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "MediaInput.h"
+#include "DiskCache.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//Network resource input served from DiskCache.
+//libvlc reads inside cached ranges never touch network, missing ranges
+//are requested from downloader (producer side), which feeds received data
+//to cache. Download is limited by next cached range, and is throttled
+//while it's too far ahead of read position.
+//notify is called (from any thread) when downloader attention is needed:
+//new request, download cancelled, read position changed, input destroyed.
+class HttpCacheInput : public MediaInput,
+                       public std::enable_shared_from_this<HttpCacheInput>
+{
+public:
+    HttpCacheInput( const std::shared_ptr<DiskCache>& cache, const std::string& url,
+                    const std::function<void()>& notify );
+    ~HttpCacheInput();
+
+    const std::string& url() const
+        { return _url; }
+
+    //downloader side
+    //returns true if new download should be started (previous one should be dropped),
+    //end is UnknownSize if resource size is not known yet
+    bool takeRequest( uint64_t* offset, uint64_t* end, unsigned* generation );
+    //false if download was cancelled or is complete
+    bool isDownloading( unsigned generation ) const;
+    //false if download should be paused for a while
+    bool wantsData( unsigned generation ) const;
+    //total resource size from response headers
+    void responded( unsigned generation, uint64_t size );
+    //server ignores Range header, so every download starts from beginning
+    //of resource: running download is awaited instead of restarted
+    void rangesIgnored();
+    //returns false if no more data is needed for this download
+    bool received( unsigned generation, const void* data, size_t size );
+    void finished( unsigned generation, bool error );
+
+    //MediaInput
+    bool open( uint64_t* size ) override;
+    int64_t read( uint8_t* buffer, size_t size ) override;
+    bool seek( uint64_t offset ) override;
+    void close() override;
+    void interrupt() override;
+    bool fallbackToMrl() const override;
+    void stats( MediaInputStats* ) const override;
+
+private:
+    //should be called with _guard locked
+    void requestFrom( uint64_t offset );
+    //true if running download will provide data at offset soon
+    bool reaches( uint64_t offset ) const;
+    void written( size_t size );
+
+private:
+    const std::shared_ptr<DiskCache> _cache;
+    const std::shared_ptr<DiskCache::Entry> _entry;
+    const std::string _url;
+    const std::function<void()> _notify;
+
+    mutable std::mutex _guard;
+    std::condition_variable _changed;
+
+    uint64_t _size;
+    //position of next byte to read by libvlc
+    uint64_t _position;
+    //read since last seek
+    uint64_t _sequentialBytes;
+
+    unsigned _generation;
+    bool _requestPending;
+    bool _downloading;
+    //download range, _downloadNext is offset of next byte to receive
+    uint64_t _downloadStart;
+    uint64_t _downloadNext;
+    uint64_t _downloadEnd;
+    //received but not written to cache yet
+    size_t _pendingWrite;
+
+    bool _interrupted;
+    //resource of unknown size can't be cached
+    bool _sizeUnknown;
+    bool _rangesIgnored;
+
+    //stats
+    uint64_t _bytesRead;
+    uint64_t _networkBytes;
+    unsigned _requestCount;
+};
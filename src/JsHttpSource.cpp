@@ -0,0 +1,484 @@
+#include "JsHttpSource.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include <node_buffer.h>
+
+#include "NodeTools.h"
+
+static const uint64_t DEFAULT_DISK_CACHE_SIZE = 1024ULL * 1024 * 1024;
+static const unsigned MAX_REDIRECTS = 5;
+
+///////////////////////////////////////////////////////////////////////////////
+namespace {
+
+std::string HeaderValue( const v8::Local<v8::Object>& response, const char* name )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    //node.js lower cases header names
+    Local<Value> headers =
+        response->Get( String::NewFromUtf8( isolate, "headers", v8::String::kInternalizedString ) );
+    if( !headers->IsObject() )
+        return std::string();
+
+    Local<Value> value =
+        Local<Object>::Cast( headers )->Get( String::NewFromUtf8( isolate, name ) );
+
+    return value->IsString() ? FromJsValue<std::string>( value ) : std::string();
+}
+
+//"bytes start-end/total"
+uint64_t ContentRangeTotal( const std::string& contentRange, uint64_t* start )
+{
+    const size_t startPos = contentRange.find( ' ' );
+    const size_t totalPos = contentRange.find( '/' );
+    if( startPos == std::string::npos || totalPos == std::string::npos ||
+        '*' == contentRange[totalPos + 1] )
+    {
+        return MediaInput::UnknownSize;
+    }
+
+    *start = strtoull( contentRange.c_str() + startPos + 1, nullptr, 10 );
+
+    return strtoull( contentRange.c_str() + totalPos + 1, nullptr, 10 );
+}
+
+bool IsHttpUrl( const std::string& url )
+{
+    return 0 == url.compare( 0, 7, "http://" ) || 0 == url.compare( 0, 8, "https://" );
+}
+
+//"scheme://host:port" part of url
+std::string UrlOrigin( const std::string& url )
+{
+    const size_t hostPos = url.find( "://" );
+    if( hostPos == std::string::npos )
+        return url;
+
+    return url.substr( 0, url.find_first_of( "/?#", hostPos + 3 ) );
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<DiskCache> JsHttpSource::_diskCache;
+std::set<std::string> JsHttpSource::_rangesIgnoringOrigins;
+
+void JsHttpSource::initJsApi( const v8::Local<v8::Function>& playerConstructor )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    playerConstructor->Set(
+        String::NewFromUtf8( isolate, "openDiskCache", v8::String::kInternalizedString ),
+        FunctionTemplate::New( isolate, jsOpenDiskCache )->GetFunction() );
+    playerConstructor->Set(
+        String::NewFromUtf8( isolate, "closeDiskCache", v8::String::kInternalizedString ),
+        FunctionTemplate::New( isolate, jsCloseDiskCache )->GetFunction() );
+    playerConstructor->Set(
+        String::NewFromUtf8( isolate, "diskCacheStats", v8::String::kInternalizedString ),
+        FunctionTemplate::New( isolate, jsDiskCacheStats )->GetFunction() );
+}
+
+void JsHttpSource::closeDiskCache()
+{
+    //inputs keep their own reference to cache,
+    //so it will be closed when last of them is released
+    _diskCache.reset();
+}
+
+void JsHttpSource::jsOpenDiskCache( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    closeDiskCache();
+
+    if( !args[0]->IsString() ) {
+        args.GetReturnValue().Set( false );
+        return;
+    }
+
+    uint64_t maxSize = DEFAULT_DISK_CACHE_SIZE;
+    if( args[1]->IsNumber() && args[1]->NumberValue() > 0 )
+        maxSize = static_cast<uint64_t>( args[1]->NumberValue() );
+
+    std::shared_ptr<DiskCache> diskCache = std::make_shared<DiskCache>();
+    if( diskCache->open( FromJsValue<std::string>( args[0] ), maxSize ) )
+        _diskCache = diskCache;
+
+    args.GetReturnValue().Set( _diskCache != nullptr );
+}
+
+void JsHttpSource::jsCloseDiskCache( const v8::FunctionCallbackInfo<v8::Value>& /*args*/ )
+{
+    closeDiskCache();
+}
+
+void JsHttpSource::jsDiskCacheStats( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    if( !_diskCache )
+        return;
+
+    MediaInputStats stats;
+    _diskCache->stats( &stats );
+
+    Local<Object> jsStats = Object::New( isolate );
+    for( const MediaInputStat& stat: stats ) {
+        jsStats->Set( String::NewFromUtf8( isolate, stat.name, v8::String::kInternalizedString ),
+                      Number::New( isolate, stat.value ) );
+    }
+
+    args.GetReturnValue().Set( jsStats );
+}
+
+std::shared_ptr<MediaInput> JsHttpSource::create( const std::string& url )
+{
+    if( !_diskCache || !IsHttpUrl( url ) )
+        return std::shared_ptr<MediaInput>();
+
+    JsHttpSource* source = new JsHttpSource( url );
+
+    std::shared_ptr<AsyncNotifier> notifier = source->_notifier;
+    std::shared_ptr<HttpCacheInput> input =
+        std::make_shared<HttpCacheInput>( _diskCache, url,
+                                          [notifier] () { notifier->send(); } );
+    if( _rangesIgnoringOrigins.count( UrlOrigin( url ) ) )
+        input->rangesIgnored();
+    source->_input = input;
+
+    return input;
+}
+
+JsHttpSource::JsHttpSource( const std::string& url ) :
+    _async( new uv_async_t ), _notifier( std::make_shared<AsyncNotifier>( _async ) ),
+    _url( url ), _redirects( 0 ),
+    _generation( 0 ), _requestOffset( 0 ), _requestEnd( 0 ), _skip( 0 ), _paused( false )
+{
+    uv_async_init( uv_default_loop(), _async,
+        [] ( uv_async_t* handle ) {
+            static_cast<JsHttpSource*>( handle->data )->process();
+        }
+    );
+    _async->data = this;
+}
+
+JsHttpSource::~JsHttpSource()
+{
+    _notifier->reset();
+
+    uv_close( reinterpret_cast<uv_handle_t*>( _async ),
+        [] ( uv_handle_t* handle ) {
+            delete reinterpret_cast<uv_async_t*>( handle );
+        }
+    );
+}
+
+void JsHttpSource::process()
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    std::shared_ptr<HttpCacheInput> input = _input.lock();
+    if( !input ) {
+        abortRequest();
+        delete this;
+        return;
+    }
+
+    uint64_t offset;
+    uint64_t end;
+    unsigned generation;
+    if( input->takeRequest( &offset, &end, &generation ) ) {
+        //url resolved by redirects is reused
+        abortRequest();
+        _redirects = 0;
+        startRequest( offset, end, generation );
+        return;
+    }
+
+    if( _jsRequest.IsEmpty() )
+        return;
+
+    if( !input->isDownloading( _generation ) )
+        abortRequest();
+    else
+        updateFlow( *input );
+}
+
+void JsHttpSource::startRequest( uint64_t offset, uint64_t end, unsigned generation )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    _generation = generation;
+    _requestOffset = offset;
+    _requestEnd = end;
+    _skip = 0;
+    _paused = false;
+
+    Local<Value> parseArgv[] = { ToJsValue( _url ) };
+    Local<Value> options = CallJsMethod( Require( "url" ), "parse", 1, parseArgv );
+
+    //server would answer with whole resource anyway
+    Local<Object> headers = Object::New( isolate );
+    if( !_rangesIgnoringOrigins.count( UrlOrigin( _url ) ) ) {
+        std::string range = "bytes=" + std::to_string( offset ) + "-";
+        if( MediaInput::UnknownSize != end )
+            range += std::to_string( end - 1 );
+
+        headers->Set( String::NewFromUtf8( isolate, "Range" ), ToJsValue( range ) );
+    }
+
+    Local<Value> request;
+    if( !options.IsEmpty() && options->IsObject() ) {
+        Local<Object> jsOptions = Local<Object>::Cast( options );
+        jsOptions->Set( String::NewFromUtf8( isolate, "headers" ), headers );
+
+        const bool https =
+            "https:" == FromJsValue<std::string>(
+                jsOptions->Get( String::NewFromUtf8( isolate, "protocol" ) ) );
+
+        Local<Object> context = Object::New( isolate );
+        context->Set( String::NewFromUtf8( isolate, "source" ), External::New( isolate, this ) );
+        _jsContext.Reset( isolate, context );
+
+        Local<Value> getArgv[] =
+            { jsOptions, Function::New( isolate, jsOnResponse, context ) };
+        request = CallJsMethod( Require( https ? "https" : "http" ), "get", 2, getArgv );
+    }
+
+    if( request.IsEmpty() || !request->IsObject() ) {
+        abortRequest();
+        if( std::shared_ptr<HttpCacheInput> input = _input.lock() )
+            input->finished( generation, true );
+        return;
+    }
+
+    Local<Object> jsRequest = Local<Object>::Cast( request );
+    _jsRequest.Reset( isolate, jsRequest );
+
+    Local<Value> onArgv[] = {
+        String::NewFromUtf8( isolate, "error", v8::String::kInternalizedString ),
+        Function::New( isolate, jsOnError, Local<Object>::New( isolate, _jsContext ) ) };
+    CallJsMethod( jsRequest, "on", 2, onArgv );
+}
+
+void JsHttpSource::abortRequest()
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    //late events of aborted request are ignored
+    if( !_jsContext.IsEmpty() ) {
+        Local<Object>::New( isolate, _jsContext )->Set(
+            String::NewFromUtf8( isolate, "source" ), Null( isolate ) );
+        _jsContext.Reset();
+    }
+
+    if( !_jsRequest.IsEmpty() ) {
+        CallJsMethod( Local<Object>::New( isolate, _jsRequest ), "abort", 0, nullptr );
+        _jsRequest.Reset();
+    }
+
+    _jsResponse.Reset();
+}
+
+void JsHttpSource::updateFlow( HttpCacheInput& input )
+{
+    using namespace v8;
+
+    if( _jsResponse.IsEmpty() )
+        return;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    Local<Object> jsResponse = Local<Object>::New( isolate, _jsResponse );
+
+    const bool wantsData = input.wantsData( _generation );
+    if( !_paused && !wantsData ) {
+        _paused = true;
+        CallJsMethod( jsResponse, "pause", 0, nullptr );
+    } else if( _paused && wantsData ) {
+        _paused = false;
+        CallJsMethod( jsResponse, "resume", 0, nullptr );
+    }
+}
+
+JsHttpSource* JsHttpSource::contextSource( const v8::Local<v8::Value>& context )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+
+    Local<Value> source =
+        Local<Object>::Cast( context )->Get( String::NewFromUtf8( isolate, "source" ) );
+    if( !source->IsExternal() )
+        return nullptr;
+
+    return static_cast<JsHttpSource*>( Local<External>::Cast( source )->Value() );
+}
+
+void JsHttpSource::onResponse( const v8::Local<v8::Object>& response )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    std::shared_ptr<HttpCacheInput> input = _input.lock();
+    if( !input ) {
+        abortRequest();
+        return;
+    }
+
+    const unsigned status =
+        FromJsValue<unsigned>(
+            response->Get( String::NewFromUtf8( isolate, "statusCode" ) ) );
+
+    const std::string location = HeaderValue( response, "location" );
+    if( status >= 300 && status < 400 && !location.empty() && _redirects < MAX_REDIRECTS ) {
+        Local<Value> resolveArgv[] = { ToJsValue( _url ), ToJsValue( location ) };
+        Local<Value> url = CallJsMethod( Require( "url" ), "resolve", 2, resolveArgv );
+        if( !url.IsEmpty() && url->IsString() ) {
+            ++_redirects;
+            _url = FromJsValue<std::string>( url );
+
+            abortRequest();
+            startRequest( _requestOffset, _requestEnd, _generation );
+            return;
+        }
+    }
+
+    uint64_t size = MediaInput::UnknownSize;
+    if( 206 == status ) {
+        uint64_t start = 0;
+        size = ContentRangeTotal( HeaderValue( response, "content-range" ), &start );
+        if( start != _requestOffset )
+            size = MediaInput::UnknownSize;
+    } else if( 200 == status ) {
+        //server doesn't support ranges, so response starts from beginning
+        const std::string contentLength = HeaderValue( response, "content-length" );
+        if( !contentLength.empty() )
+            size = strtoull( contentLength.c_str(), nullptr, 10 );
+        _skip = _requestOffset;
+
+        //every seek would download resource from beginning again
+        if( MediaInput::UnknownSize != size ) {
+            _rangesIgnoringOrigins.insert( UrlOrigin( _url ) );
+            input->rangesIgnored();
+        }
+    }
+
+    input->responded( _generation, size );
+    if( MediaInput::UnknownSize == size || !input->isDownloading( _generation ) ) {
+        input->finished( _generation, true );
+        abortRequest();
+        return;
+    }
+
+    _jsResponse.Reset( isolate, response );
+
+    Local<Object> context = Local<Object>::New( isolate, _jsContext );
+    Local<Value> dataArgv[] = {
+        String::NewFromUtf8( isolate, "data", v8::String::kInternalizedString ),
+        Function::New( isolate, jsOnData, context ) };
+    CallJsMethod( response, "on", 2, dataArgv );
+    Local<Value> endArgv[] = {
+        String::NewFromUtf8( isolate, "end", v8::String::kInternalizedString ),
+        Function::New( isolate, jsOnEnd, context ) };
+    CallJsMethod( response, "on", 2, endArgv );
+    Local<Value> errorArgv[] = {
+        String::NewFromUtf8( isolate, "error", v8::String::kInternalizedString ),
+        Function::New( isolate, jsOnError, context ) };
+    CallJsMethod( response, "on", 2, errorArgv );
+
+    updateFlow( *input );
+}
+
+void JsHttpSource::onData( const v8::Local<v8::Value>& chunk )
+{
+    std::shared_ptr<HttpCacheInput> input = _input.lock();
+    if( !input ) {
+        abortRequest();
+        return;
+    }
+
+    if( !node::Buffer::HasInstance( chunk ) )
+        return;
+
+    const char* data = node::Buffer::Data( chunk );
+    size_t size = node::Buffer::Length( chunk );
+
+    const size_t skip = static_cast<size_t>( std::min<uint64_t>( _skip, size ) );
+    data += skip;
+    size -= skip;
+    _skip -= skip;
+
+    if( size && !input->received( _generation, data, size ) ) {
+        //requested range is done, or download was cancelled
+        abortRequest();
+        return;
+    }
+
+    updateFlow( *input );
+}
+
+void JsHttpSource::onEnd()
+{
+    if( std::shared_ptr<HttpCacheInput> input = _input.lock() )
+        input->finished( _generation, false );
+
+    abortRequest();
+}
+
+void JsHttpSource::onError()
+{
+    if( std::shared_ptr<HttpCacheInput> input = _input.lock() )
+        input->finished( _generation, true );
+
+    abortRequest();
+}
+
+void JsHttpSource::jsOnResponse( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    if( JsHttpSource* source = contextSource( args.Data() ) ) {
+        if( args[0]->IsObject() )
+            source->onResponse( v8::Local<v8::Object>::Cast( args[0] ) );
+    }
+}
+
+void JsHttpSource::jsOnData( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    if( JsHttpSource* source = contextSource( args.Data() ) )
+        source->onData( args[0] );
+}
+
+void JsHttpSource::jsOnEnd( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    if( JsHttpSource* source = contextSource( args.Data() ) )
+        source->onEnd();
+}
+
+void JsHttpSource::jsOnError( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    if( JsHttpSource* source = contextSource( args.Data() ) )
+        source->onError();
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <set>
+
+#include <v8.h>
+#include <uv.h>
+
+#include "DiskCache.h"
+#include "HttpCacheInput.h"
+#include "NodeTools.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//Downloads missing ranges of HttpCacheInput with node.js http/https modules
+//(Range requests, redirects are followed). Response flow is paused
+//while input doesn't want more data. Origins which answered ranged
+//request with whole resource are not sent Range header anymore.
+//Source lives on gui thread while input is alive, and is deleted after.
+class JsHttpSource
+{
+public:
+    static void initJsApi( const v8::Local<v8::Function>& playerConstructor );
+
+    static void closeDiskCache();
+
+    //returns empty pointer if disk cache is not opened, or url is not http(s)
+    static std::shared_ptr<MediaInput> create( const std::string& url );
+
+private:
+    explicit JsHttpSource( const std::string& url );
+    ~JsHttpSource();
+
+    void process();
+
+    void startRequest( uint64_t offset, uint64_t end, unsigned generation );
+    void abortRequest();
+    void updateFlow( HttpCacheInput& );
+
+    void onResponse( const v8::Local<v8::Object>& response );
+    void onData( const v8::Local<v8::Value>& chunk );
+    void onEnd();
+    void onError();
+
+    //returns nullptr if request of context was aborted
+    static JsHttpSource* contextSource( const v8::Local<v8::Value>& context );
+
+    static void jsOpenDiskCache( const v8::FunctionCallbackInfo<v8::Value>& args );
+    static void jsCloseDiskCache( const v8::FunctionCallbackInfo<v8::Value>& args );
+    static void jsDiskCacheStats( const v8::FunctionCallbackInfo<v8::Value>& args );
+
+    static void jsOnResponse( const v8::FunctionCallbackInfo<v8::Value>& args );
+    static void jsOnData( const v8::FunctionCallbackInfo<v8::Value>& args );
+    static void jsOnEnd( const v8::FunctionCallbackInfo<v8::Value>& args );
+    static void jsOnError( const v8::FunctionCallbackInfo<v8::Value>& args );
+
+private:
+    static std::shared_ptr<DiskCache> _diskCache;
+    //"scheme://host:port" of servers ignoring Range header
+    static std::set<std::string> _rangesIgnoringOrigins;
+
+    std::weak_ptr<HttpCacheInput> _input;
+    uv_async_t* _async;
+    std::shared_ptr<AsyncNotifier> _notifier;
+
+    //current url, could be changed by redirects
+    std::string _url;
+    unsigned _redirects;
+
+    //callbacks of request are bound to context object,
+    //which is detached from source when request is aborted
+    v8::UniquePersistent<v8::Object> _jsContext;
+    v8::UniquePersistent<v8::Object> _jsRequest;
+    v8::UniquePersistent<v8::Object> _jsResponse;
+
+    unsigned _generation;
+    uint64_t _requestOffset;
+    uint64_t _requestEnd;
+    //bytes to drop from response (if server ignored Range header)
+    uint64_t _skip;
+    bool _paused;
+};
@@ -0,0 +1,506 @@
+#include "JsStreamSource.h"
+
+#include <algorithm>
+
+#include <node_buffer.h>
+
+#include "NodeTools.h"
+
+//max size of single read() request to object source
+static const size_t READ_SIZE = 256 * 1024;
+
+///////////////////////////////////////////////////////////////////////////////
+namespace {
+
+struct PromiseWait
+{
+    typedef void ( JsStreamSource::* Handler )( unsigned, const v8::Local<v8::Value>& );
+
+    JsStreamSource* source;
+    unsigned generation;
+    Handler fulfilled;
+    Handler rejected;
+};
+
+}
+
+bool JsStreamSource::isReadable( const v8::Local<v8::Object>& source )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+
+    return
+        source->Get( String::NewFromUtf8( isolate, "pipe", v8::String::kInternalizedString ) )->IsFunction() &&
+        source->Get( String::NewFromUtf8( isolate, "on", v8::String::kInternalizedString ) )->IsFunction();
+}
+
+std::shared_ptr<StreamInput> JsStreamSource::create( const v8::Local<v8::Object>& source,
+                                                     size_t capacity )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    const bool readable = isReadable( source );
+
+    uint64_t size = StreamInput::UnknownSize;
+    bool seekable = false;
+    if( !readable ) {
+        if( !source->Get( String::NewFromUtf8( isolate, "read", v8::String::kInternalizedString ) )->IsFunction() )
+            return std::shared_ptr<StreamInput>();
+
+        Local<Value> jsSize =
+            source->Get( String::NewFromUtf8( isolate, "size", v8::String::kInternalizedString ) );
+        if( jsSize->IsNumber() && jsSize->NumberValue() >= 0 )
+            size = static_cast<uint64_t>( jsSize->NumberValue() );
+
+        seekable =
+            source->Get( String::NewFromUtf8( isolate, "seek", v8::String::kInternalizedString ) )->IsFunction();
+    }
+
+    JsStreamSource* jsSource = new JsStreamSource( source, readable, capacity );
+
+    std::shared_ptr<AsyncNotifier> notifier = jsSource->_notifier;
+    std::shared_ptr<StreamInput> input =
+        std::make_shared<StreamInput>( size, seekable, capacity,
+                                       [notifier] () { notifier->send(); } );
+    jsSource->_input = input;
+
+    //prebuffering starts right away
+    jsSource->process();
+
+    return input;
+}
+
+JsStreamSource::JsStreamSource( const v8::Local<v8::Object>& source, bool readable, size_t capacity ) :
+    _async( new uv_async_t ), _notifier( std::make_shared<AsyncNotifier>( _async ) ),
+    _readable( readable ), _capacity( capacity ), _releasedChunks( 0 ),
+    _referenced( true ), _paused( false ), _readPending( false ), _seekPending( false ),
+    _pendingPromises( 0 ), _destroyed( false )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    uv_async_init( uv_default_loop(), _async,
+        [] ( uv_async_t* handle ) {
+            static_cast<JsStreamSource*>( handle->data )->process();
+        }
+    );
+    _async->data = this;
+
+    _jsSource.Reset( isolate, source );
+
+    if( !_readable )
+        return;
+
+    Local<External> jsThis = External::New( isolate, this );
+    Local<Function> onData = Function::New( isolate, jsOnData, jsThis );
+    Local<Function> onEnd = Function::New( isolate, jsOnEnd, jsThis );
+    Local<Function> onError = Function::New( isolate, jsOnError, jsThis );
+    _jsOnData.Reset( isolate, onData );
+    _jsOnEnd.Reset( isolate, onEnd );
+    _jsOnError.Reset( isolate, onError );
+
+    bool failed = false;
+    Local<Value> dataArgv[] =
+        { String::NewFromUtf8( isolate, "data", v8::String::kInternalizedString ), onData };
+    callMethod( "on", 2, dataArgv, &failed );
+    Local<Value> endArgv[] =
+        { String::NewFromUtf8( isolate, "end", v8::String::kInternalizedString ), onEnd };
+    callMethod( "on", 2, endArgv, &failed );
+    Local<Value> errorArgv[] =
+        { String::NewFromUtf8( isolate, "error", v8::String::kInternalizedString ), onError };
+    callMethod( "on", 2, errorArgv, &failed );
+}
+
+JsStreamSource::~JsStreamSource()
+{
+    _notifier->reset();
+
+    uv_close( reinterpret_cast<uv_handle_t*>( _async ),
+        [] ( uv_handle_t* handle ) {
+            delete reinterpret_cast<uv_async_t*>( handle );
+        }
+    );
+}
+
+void JsStreamSource::destroy()
+{
+    using namespace v8;
+
+    if( _destroyed )
+        return;
+
+    _destroyed = true;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    if( _readable ) {
+        bool failed = false;
+        Local<Value> dataArgv[] = {
+            String::NewFromUtf8( isolate, "data", v8::String::kInternalizedString ),
+            Local<Function>::New( isolate, _jsOnData ) };
+        callMethod( "removeListener", 2, dataArgv, &failed );
+        Local<Value> endArgv[] = {
+            String::NewFromUtf8( isolate, "end", v8::String::kInternalizedString ),
+            Local<Function>::New( isolate, _jsOnEnd ) };
+        callMethod( "removeListener", 2, endArgv, &failed );
+        Local<Value> errorArgv[] = {
+            String::NewFromUtf8( isolate, "error", v8::String::kInternalizedString ),
+            Local<Function>::New( isolate, _jsOnError ) };
+        callMethod( "removeListener", 2, errorArgv, &failed );
+    }
+
+    _chunks.clear();
+
+    //pending promise callbacks still reference this
+    if( !_pendingPromises )
+        delete this;
+}
+
+v8::Local<v8::Value> JsStreamSource::callMethod( const char* name,
+                                                 int argc, v8::Local<v8::Value> argv[],
+                                                 bool* failed )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    EscapableHandleScope scope( isolate );
+
+    //exceptions thrown by source are treated as stream errors
+    Local<Value> result =
+        CallJsMethod( Local<Object>::New( isolate, _jsSource ), name, argc, argv );
+    if( result.IsEmpty() ) {
+        *failed = true;
+        return scope.Escape( Local<Value>( Undefined( isolate ) ) );
+    }
+
+    return scope.Escape( result );
+}
+
+void JsStreamSource::waitPromise( const v8::Local<v8::Value>& promise, unsigned generation,
+                                  void ( JsStreamSource::* fulfilled )( unsigned, const v8::Local<v8::Value>& ),
+                                  void ( JsStreamSource::* rejected )( unsigned, const v8::Local<v8::Value>& ) )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    PromiseWait* wait = new PromiseWait { this, generation, fulfilled, rejected };
+    Local<External> jsWait = External::New( isolate, wait );
+
+    //promise is settled only once, so only one of callbacks is called
+    Local<Array> jsFulfilledData = Array::New( isolate, 2 );
+    jsFulfilledData->Set( 0, jsWait );
+    jsFulfilledData->Set( 1, Boolean::New( isolate, true ) );
+    Local<Array> jsRejectedData = Array::New( isolate, 2 );
+    jsRejectedData->Set( 0, jsWait );
+    jsRejectedData->Set( 1, Boolean::New( isolate, false ) );
+
+    Local<Value> argv[] = {
+        Function::New( isolate, jsPromiseSettled, jsFulfilledData ),
+        Function::New( isolate, jsPromiseSettled, jsRejectedData ),
+    };
+
+    Local<Object> jsPromise = Local<Object>::Cast( promise );
+    Local<Value> then =
+        jsPromise->Get( String::NewFromUtf8( isolate, "then", v8::String::kInternalizedString ) );
+
+    ++_pendingPromises;
+    Local<Function>::Cast( then )->Call( jsPromise, 2, argv );
+}
+
+void JsStreamSource::jsPromiseSettled( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    Local<Array> data = Local<Array>::Cast( args.Data() );
+    PromiseWait* wait = static_cast<PromiseWait*>( Local<External>::Cast( data->Get( 0 ) )->Value() );
+    const bool fulfilled = data->Get( 1 )->IsTrue();
+
+    JsStreamSource* source = wait->source;
+    --source->_pendingPromises;
+    if( source->_destroyed ) {
+        if( !source->_pendingPromises )
+            delete source;
+    } else
+        ( source->*( fulfilled ? wait->fulfilled : wait->rejected ) )( wait->generation, args[0] );
+
+    delete wait;
+}
+
+void JsStreamSource::process()
+{
+    using namespace v8;
+
+    if( _destroyed )
+        return;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    std::shared_ptr<StreamInput> input = _input.lock();
+    if( !input ) {
+        destroy();
+        return;
+    }
+
+    releaseConsumed( input->consumedChunks() );
+
+    serve( *input );
+
+    if( !_destroyed )
+        updateRef( *input );
+}
+
+void JsStreamSource::serve( StreamInput& input )
+{
+    if( _readable ) {
+        updateFlow( input );
+        return;
+    }
+
+    //source is asked for seek only when it has no pending read
+    if( _readPending || _seekPending )
+        return;
+
+    uint64_t offset;
+    unsigned generation;
+    if( input.takeSeek( &offset, &generation ) ) {
+        callSeek( input, offset, generation );
+        if( _seekPending )
+            return;
+    }
+
+    pull( input );
+}
+
+void JsStreamSource::updateRef( StreamInput& input )
+{
+    //ended or full input waits for libvlc, not for source
+    const bool active = !input.atEnd() && input.freeSpace() > 0;
+    if( active == _referenced )
+        return;
+
+    _referenced = active;
+    if( active )
+        uv_ref( reinterpret_cast<uv_handle_t*>( _async ) );
+    else
+        uv_unref( reinterpret_cast<uv_handle_t*>( _async ) );
+}
+
+void JsStreamSource::releaseConsumed( uint64_t consumedChunks )
+{
+    while( _releasedChunks < consumedChunks && !_chunks.empty() ) {
+        _chunks.pop_front();
+        ++_releasedChunks;
+    }
+}
+
+void JsStreamSource::pushChunk( StreamInput& input, unsigned generation,
+                                const v8::Local<v8::Value>& chunk )
+{
+    if( !node::Buffer::HasInstance( chunk ) )
+        return;
+
+    v8::Local<v8::Object> buffer = v8::Local<v8::Object>::Cast( chunk );
+    if( input.push( generation, node::Buffer::Data( buffer ), node::Buffer::Length( buffer ) ) )
+        _chunks.emplace_back( v8::Isolate::GetCurrent(), buffer );
+}
+
+void JsStreamSource::updateFlow( StreamInput& input )
+{
+    const size_t freeSpace = input.freeSpace();
+
+    bool failed = false;
+    if( !_paused && !freeSpace && !input.atEnd() ) {
+        _paused = true;
+        callMethod( "pause", 0, nullptr, &failed );
+    } else if( _paused && freeSpace >= _capacity / 2 ) {
+        _paused = false;
+        callMethod( "resume", 0, nullptr, &failed );
+    }
+}
+
+void JsStreamSource::pull( StreamInput& input )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    while( !_readPending && !_destroyed ) {
+        const size_t freeSpace = input.freeSpace();
+        if( !freeSpace )
+            return;
+
+        const unsigned generation = input.generation();
+
+        bool failed = false;
+        Local<Value> argv[] =
+            { Number::New( isolate, static_cast<double>( std::min( freeSpace, READ_SIZE ) ) ) };
+        Local<Value> result = callMethod( "read", 1, argv, &failed );
+        if( failed ) {
+            input.endOfStream( generation, true );
+            return;
+        }
+
+        if( result->IsPromise() ) {
+            _readPending = true;
+            waitPromise( result, generation,
+                         &JsStreamSource::readFulfilled, &JsStreamSource::readRejected );
+            return;
+        }
+
+        if( !readDone( input, generation, result ) )
+            return;
+    }
+}
+
+bool JsStreamSource::readDone( StreamInput& input, unsigned generation,
+                               const v8::Local<v8::Value>& result )
+{
+    if( !node::Buffer::HasInstance( result ) || !node::Buffer::Length( result ) ) {
+        input.endOfStream( generation, false );
+        return false;
+    }
+
+    pushChunk( input, generation, result );
+
+    return true;
+}
+
+void JsStreamSource::readFulfilled( unsigned generation, const v8::Local<v8::Value>& result )
+{
+    _readPending = false;
+
+    std::shared_ptr<StreamInput> input = _input.lock();
+    if( !input ) {
+        destroy();
+        return;
+    }
+
+    readDone( *input, generation, result );
+    process();
+}
+
+void JsStreamSource::readRejected( unsigned generation, const v8::Local<v8::Value>& )
+{
+    _readPending = false;
+
+    std::shared_ptr<StreamInput> input = _input.lock();
+    if( !input ) {
+        destroy();
+        return;
+    }
+
+    input->endOfStream( generation, true );
+    process();
+}
+
+void JsStreamSource::callSeek( StreamInput& input, uint64_t offset, unsigned generation )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    bool failed = false;
+    Local<Value> argv[] = { Number::New( isolate, static_cast<double>( offset ) ) };
+    Local<Value> result = callMethod( "seek", 1, argv, &failed );
+
+    if( !failed && result->IsPromise() ) {
+        _seekPending = true;
+        waitPromise( result, generation,
+                     &JsStreamSource::seekFulfilled, &JsStreamSource::seekRejected );
+        return;
+    }
+
+    if( failed || result->IsFalse() )
+        input.endOfStream( generation, true );
+}
+
+void JsStreamSource::seekFulfilled( unsigned generation, const v8::Local<v8::Value>& result )
+{
+    _seekPending = false;
+
+    std::shared_ptr<StreamInput> input = _input.lock();
+    if( !input ) {
+        destroy();
+        return;
+    }
+
+    if( result->IsFalse() )
+        input->endOfStream( generation, true );
+
+    process();
+}
+
+void JsStreamSource::seekRejected( unsigned generation, const v8::Local<v8::Value>& )
+{
+    _seekPending = false;
+
+    std::shared_ptr<StreamInput> input = _input.lock();
+    if( !input ) {
+        destroy();
+        return;
+    }
+
+    input->endOfStream( generation, true );
+    process();
+}
+
+void JsStreamSource::jsOnData( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    using namespace v8;
+
+    JsStreamSource* source =
+        static_cast<JsStreamSource*>( Local<External>::Cast( args.Data() )->Value() );
+
+    std::shared_ptr<StreamInput> input = source->_input.lock();
+    if( source->_destroyed || !input )
+        return;
+
+    source->pushChunk( *input, input->generation(), args[0] );
+    source->updateFlow( *input );
+    source->updateRef( *input );
+}
+
+void JsStreamSource::jsOnEnd( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    using namespace v8;
+
+    JsStreamSource* source =
+        static_cast<JsStreamSource*>( Local<External>::Cast( args.Data() )->Value() );
+
+    std::shared_ptr<StreamInput> input = source->_input.lock();
+    if( source->_destroyed || !input )
+        return;
+
+    input->endOfStream( input->generation(), false );
+    source->updateRef( *input );
+}
+
+void JsStreamSource::jsOnError( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    using namespace v8;
+
+    JsStreamSource* source =
+        static_cast<JsStreamSource*>( Local<External>::Cast( args.Data() )->Value() );
+
+    std::shared_ptr<StreamInput> input = source->_input.lock();
+    if( source->_destroyed || !input )
+        return;
+
+    input->endOfStream( input->generation(), true );
+    source->updateRef( *input );
+}
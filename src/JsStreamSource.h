@@ -0,0 +1,85 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+
+#include <v8.h>
+#include <uv.h>
+
+#include "StreamInput.h"
+#include "NodeTools.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//Feeds StreamInput from js: node.js Readable stream (not seekable, flow is
+//paused while input is full), or object { read( length ), seek( offset ), size }
+//(pulled while input has free space). read() should return Buffer,
+//or null at end of stream; read() and seek() could also return promise.
+//Buffers are queued without copying and are released when consumed by libvlc.
+//Source lives on gui thread while input is alive, and is deleted after.
+class JsStreamSource
+{
+public:
+    static bool isReadable( const v8::Local<v8::Object>& source );
+    //returns empty pointer if source is neither Readable nor has read()
+    static std::shared_ptr<StreamInput> create( const v8::Local<v8::Object>& source,
+                                                size_t capacity );
+
+private:
+    JsStreamSource( const v8::Local<v8::Object>& source, bool readable, size_t capacity );
+    ~JsStreamSource();
+
+    void process();
+    void serve( StreamInput& );
+    void destroy();
+    //async handle keeps node.js loop alive only while source is pulled
+    void updateRef( StreamInput& );
+
+    void releaseConsumed( uint64_t consumedChunks );
+    void pushChunk( StreamInput&, unsigned generation, const v8::Local<v8::Value>& chunk );
+    void updateFlow( StreamInput& );
+    void pull( StreamInput& );
+    void callSeek( StreamInput&, uint64_t offset, unsigned generation );
+    //returns false if pulling should be stopped
+    bool readDone( StreamInput&, unsigned generation, const v8::Local<v8::Value>& result );
+
+    v8::Local<v8::Value> callMethod( const char* name, int argc, v8::Local<v8::Value> argv[],
+                                     bool* failed );
+    //calls method on promise fulfillment/rejection, keeps source alive until that
+    void waitPromise( const v8::Local<v8::Value>& promise, unsigned generation,
+                      void ( JsStreamSource::* fulfilled )( unsigned, const v8::Local<v8::Value>& ),
+                      void ( JsStreamSource::* rejected )( unsigned, const v8::Local<v8::Value>& ) );
+
+    void readFulfilled( unsigned generation, const v8::Local<v8::Value>& );
+    void readRejected( unsigned generation, const v8::Local<v8::Value>& );
+    void seekFulfilled( unsigned generation, const v8::Local<v8::Value>& );
+    void seekRejected( unsigned generation, const v8::Local<v8::Value>& );
+
+    static void jsPromiseSettled( const v8::FunctionCallbackInfo<v8::Value>& args );
+    static void jsOnData( const v8::FunctionCallbackInfo<v8::Value>& args );
+    static void jsOnEnd( const v8::FunctionCallbackInfo<v8::Value>& args );
+    static void jsOnError( const v8::FunctionCallbackInfo<v8::Value>& args );
+
+private:
+    std::weak_ptr<StreamInput> _input;
+    uv_async_t* _async;
+    std::shared_ptr<AsyncNotifier> _notifier;
+
+    const bool _readable;
+    const size_t _capacity;
+
+    v8::UniquePersistent<v8::Object> _jsSource;
+    v8::UniquePersistent<v8::Function> _jsOnData;
+    v8::UniquePersistent<v8::Function> _jsOnEnd;
+    v8::UniquePersistent<v8::Function> _jsOnError;
+
+    //queued (not consumed yet) buffers
+    std::deque<v8::UniquePersistent<v8::Object> > _chunks;
+    uint64_t _releasedChunks;
+
+    bool _referenced;
+    bool _paused;
+    bool _readPending;
+    bool _seekPending;
+    unsigned _pendingPromises;
+    bool _destroyed;
+};
@@ -42,6 +42,7 @@ void JsVlcAudio::initJsApi()
     SET_RO_INDEXED_PROPERTY( instanceTemplate, &JsVlcAudio::description );
 
     SET_RO_PROPERTY( instanceTemplate, "count", &JsVlcAudio::count );
+    SET_RO_PROPERTY( instanceTemplate, "tracks", &JsVlcAudio::tracks );
 
     SET_RW_PROPERTY( instanceTemplate, "track", &JsVlcAudio::track, &JsVlcAudio::setTrack );
     SET_RW_PROPERTY( instanceTemplate, "mute", &JsVlcAudio::muted, &JsVlcAudio::setMuted );
@@ -102,87 +103,113 @@ JsVlcAudio::JsVlcAudio( v8::Local<v8::Object>& thisObject, JsVlcPlayer* jsPlayer
 
 std::string JsVlcAudio::description( uint32_t index )
 {
-    vlc_player& p = _jsPlayer->player();
+    if( _jsPlayer->closing() )
+        return std::string();
 
-    std::string name;
+    const std::vector<JsVlcPlayer::TrackDescription>& tracks =
+        _jsPlayer->tracks( libvlc_track_audio );
 
-    libvlc_track_description_t* rootTrackDesc =
-        libvlc_audio_get_track_description( p.get_mp() );
-    if( !rootTrackDesc )
-        return name;
-
-    unsigned count = _jsPlayer->player().audio().track_count();
-    if( count && index < count ) {
-        libvlc_track_description_t* trackDesc = rootTrackDesc;
-        for( ; index && trackDesc; --index ){
-            trackDesc = trackDesc->p_next;
-        }
-
-        if ( trackDesc && trackDesc->psz_name ) {
-            name = trackDesc->psz_name;
-        }
-    }
-    libvlc_track_description_list_release( rootTrackDesc );
+    return index < tracks.size() ? tracks[index].name : std::string();
+}
 
-    return name;
+v8::Local<v8::Array> JsVlcAudio::tracks()
+{
+    return _jsPlayer->jsTracks( libvlc_track_audio );
 }
 
 unsigned JsVlcAudio::count()
 {
-    return _jsPlayer->player().audio().track_count();
+    if( _jsPlayer->closing() )
+        return 0;
+
+    //the same list as descriptions, so both are invalidated together
+    return static_cast<unsigned>( _jsPlayer->tracks( libvlc_track_audio ).size() );
 }
 
 int JsVlcAudio::track()
 {
+    if( _jsPlayer->closing() )
+        return -1;
+
     return _jsPlayer->player().audio().get_track();
 }
 
 void JsVlcAudio::setTrack( int track )
 {
+    if( _jsPlayer->closing() )
+        return;
+
     _jsPlayer->player().audio().set_track( track );
 }
 
 int JsVlcAudio::delay()
 {
+    if( _jsPlayer->closing() )
+        return 0;
+
     return static_cast<int>( _jsPlayer->player().audio().get_delay() );
 }
 
 void JsVlcAudio::setDelay( int delay )
 {
+    if( _jsPlayer->closing() )
+        return;
+
     _jsPlayer->player().audio().set_delay( delay );
 }
 
 bool JsVlcAudio::muted()
 {
+    if( _jsPlayer->closing() )
+        return false;
+
     return _jsPlayer->player().audio().is_muted();
 }
 
 void JsVlcAudio::setMuted( bool muted )
 {
+    if( _jsPlayer->closing() )
+        return;
+
     _jsPlayer->player().audio().set_mute( muted );
 }
 
 unsigned JsVlcAudio::volume()
 {
+    if( _jsPlayer->closing() )
+        return 0;
+
     return _jsPlayer->player().audio().get_volume();
 }
 
 void JsVlcAudio::setVolume( unsigned volume )
 {
+    if( _jsPlayer->closing() )
+        return;
+
     _jsPlayer->player().audio().set_volume( volume );
 }
 
 int JsVlcAudio::channel()
 {
+    if( _jsPlayer->closing() )
+        return 0;
+
     return _jsPlayer->player().audio().get_channel();
 }
 
 void JsVlcAudio::setChannel( unsigned channel )
 {
+    if( _jsPlayer->closing() )
+        return;
+
     _jsPlayer->player().audio().set_channel( (libvlc_audio_output_channel_t) channel );
 }
 
 void JsVlcAudio::toggleMute()
 {
+    if( _jsPlayer->closing() )
+        return;
+
     _jsPlayer->player().audio().toggle_mute();
 }
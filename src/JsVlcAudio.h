@@ -15,6 +15,7 @@ public:
     static v8::UniquePersistent<v8::Object> create( JsVlcPlayer& player );
 
     std::string description( uint32_t index );
+    v8::Local<v8::Array> tracks();
 
     unsigned count();
 
@@ -0,0 +1,451 @@
+#include "JsVlcAudioAnalysis.h"
+
+#include <math.h>
+
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+
+#include "NodeTools.h"
+#include "AsyncJob.h"
+#include "ThreadPool.h"
+#include "MediaInfo.h"
+#include "AudioDecoder.h"
+#include "LoudnessMeter.h"
+#include "WaveformBuilder.h"
+
+//EBU R128 target level
+static const double DEFAULT_TARGET_LOUDNESS = -23.;
+static const double DEFAULT_MAX_TRUE_PEAK = -1.;
+//audio.volume limits
+static const unsigned MAX_VOLUME = 200;
+
+static const unsigned DEFAULT_WAVEFORM_BUCKETS = 1024;
+static const unsigned MAX_WAVEFORM_BUCKETS = 1 << 20;
+//minimal interval between progress notifications, in ms
+static const unsigned WAVEFORM_PROGRESS_INTERVAL = 100;
+
+///////////////////////////////////////////////////////////////////////////////
+namespace {
+
+//shared by all loudness jobs, so concurrent calls don't oversubscribe cpu.
+//Never destroyed: it would wait for running analysis on process exit
+ThreadPool& AnalysisPool()
+{
+    static ThreadPool* pool =
+        new ThreadPool( std::max( 1u, std::thread::hardware_concurrency() ) );
+    return *pool;
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+struct LoudnessInfo
+{
+    LoudnessInfo() :
+        analyzed( false ), integrated( -HUGE_VAL ), range( 0 ),
+        truePeak( -HUGE_VAL ), samplePeak( -HUGE_VAL ), duration( 0 ) {}
+
+    std::string mrl;
+    bool analyzed;
+    double integrated;
+    double range;
+    double truePeak;
+    double samplePeak;
+    double duration;
+};
+
+class LoudnessJob : public AsyncJob
+{
+public:
+    LoudnessJob( libvlc_instance_t* libvlc, const std::vector<std::string>& mrls,
+                 bool singleResult, unsigned concurrency,
+                 double targetLoudness, double maxTruePeak );
+
+    void start();
+
+protected:
+    v8::Local<v8::Value> result() override;
+
+private:
+    void run();
+    void analyze( LoudnessInfo* );
+    v8::Local<v8::Object> toJsValue( const LoudnessInfo& );
+
+private:
+    //released when job is done, after last runner is finished
+    const LibvlcRef _libvlc;
+    const bool _singleResult;
+    const unsigned _concurrency;
+    const double _targetLoudness;
+    const double _maxTruePeak;
+
+    std::vector<LoudnessInfo> _infos;
+    std::atomic<unsigned> _nextIdx;
+    std::atomic<unsigned> _activeRunners;
+};
+
+LoudnessJob::LoudnessJob( libvlc_instance_t* libvlc, const std::vector<std::string>& mrls,
+                          bool singleResult, unsigned concurrency,
+                          double targetLoudness, double maxTruePeak ) :
+    _libvlc( libvlc ), _singleResult( singleResult ),
+    _concurrency( std::max( 1u, concurrency ) ),
+    _targetLoudness( targetLoudness ), _maxTruePeak( maxTruePeak ),
+    _infos( mrls.size() ), _nextIdx( 0 ), _activeRunners( 0 )
+{
+    for( unsigned i = 0; i < mrls.size(); ++i ) {
+        _infos[i].mrl = mrls[i];
+    }
+}
+
+void LoudnessJob::start()
+{
+    if( _infos.empty() ) {
+        finish();
+        return;
+    }
+
+    //every file is decoded by its own libvlc threads,
+    //so files are spread across cores by runners count,
+    //which is limited by concurrency option and by shared pool size
+    const unsigned runners =
+        std::min<unsigned>( _concurrency, _infos.size() );
+    _activeRunners = runners;
+    for( unsigned r = 0; r < runners; ++r )
+        AnalysisPool().post( [this] () { run(); } );
+}
+
+void LoudnessJob::run()
+{
+    for( unsigned i = _nextIdx++; i < _infos.size(); i = _nextIdx++ )
+        analyze( &_infos[i] );
+
+    //job is not touched by other runners after their decrement,
+    //so the last one could finish (and so delete) it
+    if( 0 == --_activeRunners )
+        finish();
+}
+
+void LoudnessJob::analyze( LoudnessInfo* info )
+{
+    std::unique_ptr<LoudnessMeter> meter;
+
+    const bool decoded =
+        DecodeAudio( _libvlc.get(), info->mrl, 0, 0,
+            [&meter] ( const DecodedAudio& audio ) {
+                if( !meter )
+                    meter.reset( new LoudnessMeter( audio.rate, audio.channels ) );
+
+                //format changes inside file are not expected
+                if( audio.rate == meter->rate() && audio.channels == meter->channels() )
+                    meter->process( audio.samples, audio.frames );
+
+                return true;
+            } );
+
+    if( !decoded || !meter )
+        return;
+
+    info->analyzed = true;
+    info->integrated = meter->integrated();
+    info->range = meter->range();
+    info->truePeak = meter->truePeak();
+    info->samplePeak = meter->samplePeak();
+    info->duration = 1000. * meter->processedFrames() / meter->rate();
+}
+
+v8::Local<v8::Object> LoudnessJob::toJsValue( const LoudnessInfo& info )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    EscapableHandleScope scope( isolate );
+
+    Local<Object> jsInfo = Object::New( isolate );
+
+    jsInfo->Set( String::NewFromUtf8( isolate, "mrl", v8::String::kInternalizedString ),
+                 ToJsValue( info.mrl ) );
+    jsInfo->Set( String::NewFromUtf8( isolate, "analyzed", v8::String::kInternalizedString ),
+                 ToJsValue( info.analyzed ) );
+    jsInfo->Set( String::NewFromUtf8( isolate, "integrated", v8::String::kInternalizedString ),
+                 ToJsValue( info.integrated ) );
+    jsInfo->Set( String::NewFromUtf8( isolate, "range", v8::String::kInternalizedString ),
+                 ToJsValue( info.range ) );
+    jsInfo->Set( String::NewFromUtf8( isolate, "truePeak", v8::String::kInternalizedString ),
+                 ToJsValue( info.truePeak ) );
+    jsInfo->Set( String::NewFromUtf8( isolate, "samplePeak", v8::String::kInternalizedString ),
+                 ToJsValue( info.samplePeak ) );
+    jsInfo->Set( String::NewFromUtf8( isolate, "duration", v8::String::kInternalizedString ),
+                 ToJsValue( info.duration ) );
+
+    //gain to reach target loudness, limited to keep true peak below maximum
+    double gain = 0;
+    if( info.analyzed && std::isfinite( info.integrated ) ) {
+        gain = _targetLoudness - info.integrated;
+        if( std::isfinite( info.truePeak ) )
+            gain = std::min( gain, _maxTruePeak - info.truePeak );
+    }
+    //audio.volume is linear, 100 is unity gain
+    const unsigned volume =
+        static_cast<unsigned>( std::min<double>( MAX_VOLUME, 100. * pow( 10., gain / 20 ) + 0.5 ) );
+
+    jsInfo->Set( String::NewFromUtf8( isolate, "gain", v8::String::kInternalizedString ),
+                 ToJsValue( gain ) );
+    jsInfo->Set( String::NewFromUtf8( isolate, "volume", v8::String::kInternalizedString ),
+                 ToJsValue( volume ) );
+
+    return scope.Escape( jsInfo );
+}
+
+v8::Local<v8::Value> LoudnessJob::result()
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    EscapableHandleScope scope( isolate );
+
+    if( _singleResult && 1 == _infos.size() )
+        return scope.Escape( toJsValue( _infos[0] ) );
+
+    Local<Array> jsInfos = Array::New( isolate, _infos.size() );
+    for( unsigned i = 0; i < _infos.size(); ++i ) {
+        jsInfos->Set( i, toJsValue( _infos[i] ) );
+    }
+
+    return scope.Escape( jsInfos );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//Waveform is written directly to Float32Array memory by worker thread,
+//so partial results are available to js without copying.
+class WaveformJob : public AsyncJob
+{
+public:
+    WaveformJob( libvlc_instance_t* libvlc, const std::string& mrl, unsigned buckets,
+                 const v8::Local<v8::Function>& onProgress );
+
+    void start();
+
+protected:
+    void onNotify() override;
+    v8::Local<v8::Value> result() override;
+
+private:
+    void build();
+
+private:
+    //released after workers are stopped
+    const LibvlcRef _libvlc;
+    const std::string _mrl;
+    const unsigned _buckets;
+
+    v8::UniquePersistent<v8::Object> _jsWaveform;
+    v8::UniquePersistent<v8::Function> _jsOnProgress;
+    float* _waveform;
+
+    libvlc_time_t _duration;
+    std::atomic<unsigned> _completedBuckets;
+
+    ThreadPool _worker; //should be last member, to be destroyed first
+};
+
+WaveformJob::WaveformJob( libvlc_instance_t* libvlc, const std::string& mrl, unsigned buckets,
+                          const v8::Local<v8::Function>& onProgress ) :
+    _libvlc( libvlc ), _mrl( mrl ), _buckets( buckets ),
+    _duration( 0 ), _completedBuckets( 0 ), _worker( 1 )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    Local<Object> jsWaveform =
+        NewTypedArray( "Float32Array", buckets * WaveformBuilder::ValuesPerBucket );
+    _waveform = static_cast<float*>( jsWaveform->GetIndexedPropertiesExternalArrayData() );
+    _jsWaveform.Reset( isolate, jsWaveform );
+
+    if( !onProgress.IsEmpty() )
+        _jsOnProgress.Reset( isolate, onProgress );
+}
+
+void WaveformJob::start()
+{
+    _worker.post( [this] () { build(); } );
+}
+
+void WaveformJob::build()
+{
+    MediaInfo info;
+    if( !ParseMedia( _libvlc.get(), _mrl, -1, &info ) || info.duration <= 0 ) {
+        fail( "Can't get media duration" );
+        return;
+    }
+    _duration = info.duration;
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point lastNotify = Clock::now();
+
+    //every bucket is reduced from all channels, so source is downmixed to mono
+    std::unique_ptr<WaveformBuilder> builder;
+    const bool decoded =
+        DecodeAudio( _libvlc.get(), _mrl, 0, 1,
+            [&] ( const DecodedAudio& audio ) {
+                if( !builder ) {
+                    const uint64_t totalFrames = static_cast<uint64_t>( _duration ) * audio.rate / 1000;
+                    builder.reset( new WaveformBuilder( _waveform, _buckets, totalFrames ) );
+                }
+
+                builder->process( audio.samples, audio.frames );
+
+                const Clock::time_point now = Clock::now();
+                if( now - lastNotify >= std::chrono::milliseconds( WAVEFORM_PROGRESS_INTERVAL ) ) {
+                    _completedBuckets = builder->completedBuckets();
+                    lastNotify = now;
+                    notify();
+                }
+
+                return true;
+            } );
+
+    if( !decoded || !builder ) {
+        fail( "Can't decode audio" );
+        return;
+    }
+
+    builder->finish();
+    _completedBuckets = _buckets;
+    finish();
+}
+
+void WaveformJob::onNotify()
+{
+    using namespace v8;
+
+    if( _jsOnProgress.IsEmpty() )
+        return;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    Local<Function> jsOnProgress = Local<Function>::New( isolate, _jsOnProgress );
+    Local<Value> argv[] = {
+        Local<Object>::New( isolate, _jsWaveform ),
+        ToJsValue( static_cast<double>( _completedBuckets ) / _buckets ),
+    };
+    jsOnProgress->Call( isolate->GetCurrentContext()->Global(), 2, argv );
+}
+
+v8::Local<v8::Value> WaveformJob::result()
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    EscapableHandleScope scope( isolate );
+
+    Local<Object> jsWaveform = Local<Object>::New( isolate, _jsWaveform );
+
+    jsWaveform->ForceSet( String::NewFromUtf8( isolate, "buckets", v8::String::kInternalizedString ),
+                          ToJsValue( _buckets ),
+                          static_cast<v8::PropertyAttribute>( ReadOnly | DontDelete ) );
+    jsWaveform->ForceSet( String::NewFromUtf8( isolate, "duration", v8::String::kInternalizedString ),
+                          ToJsValue( static_cast<double>( _duration ) ),
+                          static_cast<v8::PropertyAttribute>( ReadOnly | DontDelete ) );
+
+    return scope.Escape( jsWaveform );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void JsVlcAudioAnalysis::initJsApi( const v8::Local<v8::Function>& playerConstructor )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    playerConstructor->Set(
+        String::NewFromUtf8( isolate, "analyzeLoudness", v8::String::kInternalizedString ),
+        FunctionTemplate::New( isolate, jsAnalyzeLoudness )->GetFunction() );
+    playerConstructor->Set(
+        String::NewFromUtf8( isolate, "waveform", v8::String::kInternalizedString ),
+        FunctionTemplate::New( isolate, jsWaveform )->GetFunction() );
+}
+
+void JsVlcAudioAnalysis::jsAnalyzeLoudness( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    std::vector<std::string> mrls;
+    if( args[0]->IsArray() )
+        mrls = FromJsValue<std::vector<std::string> >( args[0] );
+    else if( args[0]->IsString() )
+        mrls.push_back( FromJsValue<std::string>( args[0] ) );
+
+    unsigned concurrency = std::thread::hardware_concurrency();
+    double targetLoudness = DEFAULT_TARGET_LOUDNESS;
+    double maxTruePeak = DEFAULT_MAX_TRUE_PEAK;
+
+    if( args[1]->IsObject() ) {
+        Local<Object> options = Local<Object>::Cast( args[1] );
+
+        Local<Value> jsConcurrency =
+            options->Get( String::NewFromUtf8( isolate, "concurrency", v8::String::kInternalizedString ) );
+        if( jsConcurrency->IsNumber() )
+            concurrency = FromJsValue<unsigned>( jsConcurrency );
+
+        Local<Value> jsTarget =
+            options->Get( String::NewFromUtf8( isolate, "target", v8::String::kInternalizedString ) );
+        if( jsTarget->IsNumber() )
+            targetLoudness = FromJsValue<double>( jsTarget );
+
+        Local<Value> jsMaxTruePeak =
+            options->Get( String::NewFromUtf8( isolate, "maxTruePeak", v8::String::kInternalizedString ) );
+        if( jsMaxTruePeak->IsNumber() )
+            maxTruePeak = FromJsValue<double>( jsMaxTruePeak );
+    }
+
+    LoudnessJob* job =
+        new LoudnessJob( SharedLibvlc(), mrls, args[0]->IsString(), concurrency,
+                         targetLoudness, maxTruePeak );
+    args.GetReturnValue().Set( job->promise() );
+    job->start();
+}
+
+void JsVlcAudioAnalysis::jsWaveform( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    if( !args[0]->IsString() ) {
+        isolate->ThrowException(
+            Exception::TypeError( String::NewFromUtf8( isolate, "mrl should be a string" ) ) );
+        return;
+    }
+
+    unsigned buckets = DEFAULT_WAVEFORM_BUCKETS;
+    Local<Function> onProgress;
+
+    if( args[1]->IsObject() ) {
+        Local<Object> options = Local<Object>::Cast( args[1] );
+
+        Local<Value> jsBuckets =
+            options->Get( String::NewFromUtf8( isolate, "buckets", v8::String::kInternalizedString ) );
+        if( jsBuckets->IsNumber() )
+            buckets = std::min( std::max( 1u, FromJsValue<unsigned>( jsBuckets ) ), MAX_WAVEFORM_BUCKETS );
+
+        Local<Value> jsOnProgress =
+            options->Get( String::NewFromUtf8( isolate, "onProgress", v8::String::kInternalizedString ) );
+        if( jsOnProgress->IsFunction() )
+            onProgress = Local<Function>::Cast( jsOnProgress );
+    }
+
+    WaveformJob* job =
+        new WaveformJob( SharedLibvlc(), FromJsValue<std::string>( args[0] ), buckets, onProgress );
+    args.GetReturnValue().Set( job->promise() );
+    job->start();
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <v8.h>
+
+//offline (decode only) audio analysis of media files
+class JsVlcAudioAnalysis
+{
+public:
+    //adds static methods to VlcPlayer constructor
+    static void initJsApi( const v8::Local<v8::Function>& playerConstructor );
+
+private:
+    static void jsAnalyzeLoudness( const v8::FunctionCallbackInfo<v8::Value>& args );
+    static void jsWaveform( const v8::FunctionCallbackInfo<v8::Value>& args );
+};
@@ -0,0 +1,374 @@
+#include "JsVlcAudioOutput.h"
+
+#include "NodeTools.h"
+#include "JsVlcPlayer.h"
+
+v8::Persistent<v8::Function> JsVlcAudioOutput::_jsConstructor;
+
+//1 second at 48kHz, rounded up to power of two
+static const unsigned DEFAULT_FRAMES = 65536;
+static const unsigned MAX_FRAMES = 1 << 22;
+static const unsigned MAX_CHANNELS = 8;
+
+static const unsigned DEFAULT_FFT_SIZE = 1024;
+static const unsigned MAX_FFT_SIZE = 16384;
+static const unsigned DEFAULT_BANDS = 16;
+static const unsigned MAX_BANDS = 256;
+
+void JsVlcAudioOutput::initJsApi()
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    Local<FunctionTemplate> constructorTemplate = FunctionTemplate::New( isolate, jsCreate );
+    constructorTemplate->SetClassName(
+        String::NewFromUtf8( isolate, "VlcAudioOutput", v8::String::kInternalizedString ) );
+
+    Local<ObjectTemplate> protoTemplate = constructorTemplate->PrototypeTemplate();
+    Local<ObjectTemplate> instanceTemplate = constructorTemplate->InstanceTemplate();
+    instanceTemplate->SetInternalFieldCount( 1 );
+
+    protoTemplate->Set( String::NewFromUtf8( isolate, "S16", v8::String::kInternalizedString ),
+                        Integer::New( isolate, static_cast<int>( VlcAudioOutput::SampleFormat::S16 ) ),
+                        static_cast<v8::PropertyAttribute>( ReadOnly | DontDelete ) );
+    protoTemplate->Set( String::NewFromUtf8( isolate, "F32", v8::String::kInternalizedString ),
+                        Integer::New( isolate, static_cast<int>( VlcAudioOutput::SampleFormat::F32 ) ),
+                        static_cast<v8::PropertyAttribute>( ReadOnly | DontDelete ) );
+
+    //indexes in cursors array
+    protoTemplate->Set( String::NewFromUtf8( isolate, "WriteCursor", v8::String::kInternalizedString ),
+                        Integer::New( isolate, VlcAudioOutput::WriteCursor ),
+                        static_cast<v8::PropertyAttribute>( ReadOnly | DontDelete ) );
+    protoTemplate->Set( String::NewFromUtf8( isolate, "ReadCursor", v8::String::kInternalizedString ),
+                        Integer::New( isolate, VlcAudioOutput::ReadCursor ),
+                        static_cast<v8::PropertyAttribute>( ReadOnly | DontDelete ) );
+    protoTemplate->Set( String::NewFromUtf8( isolate, "OverrunFrames", v8::String::kInternalizedString ),
+                        Integer::New( isolate, VlcAudioOutput::OverrunFrames ),
+                        static_cast<v8::PropertyAttribute>( ReadOnly | DontDelete ) );
+    protoTemplate->Set( String::NewFromUtf8( isolate, "FlushCount", v8::String::kInternalizedString ),
+                        Integer::New( isolate, VlcAudioOutput::FlushCount ),
+                        static_cast<v8::PropertyAttribute>( ReadOnly | DontDelete ) );
+    protoTemplate->Set( String::NewFromUtf8( isolate, "Paused", v8::String::kInternalizedString ),
+                        Integer::New( isolate, VlcAudioOutput::Paused ),
+                        static_cast<v8::PropertyAttribute>( ReadOnly | DontDelete ) );
+
+    SET_RO_PROPERTY( instanceTemplate, "enabled", &JsVlcAudioOutput::enabled );
+    SET_RO_PROPERTY( instanceTemplate, "buffer", &JsVlcAudioOutput::buffer );
+    SET_RO_PROPERTY( instanceTemplate, "cursors", &JsVlcAudioOutput::cursors );
+    SET_RO_PROPERTY( instanceTemplate, "format", &JsVlcAudioOutput::format );
+    SET_RO_PROPERTY( instanceTemplate, "rate", &JsVlcAudioOutput::rate );
+    SET_RO_PROPERTY( instanceTemplate, "channels", &JsVlcAudioOutput::channels );
+    SET_RO_PROPERTY( instanceTemplate, "frames", &JsVlcAudioOutput::frames );
+    SET_RO_PROPERTY( instanceTemplate, "converter", &JsVlcAudioOutput::converter );
+    SET_RO_PROPERTY( instanceTemplate, "levels", &JsVlcAudioOutput::levels );
+    SET_RO_PROPERTY( instanceTemplate, "bands", &JsVlcAudioOutput::bands );
+
+    SET_METHOD( constructorTemplate, "enable", &JsVlcAudioOutput::enable );
+    SET_METHOD( constructorTemplate, "disable", &JsVlcAudioOutput::disable );
+
+    Local<Function> constructor = constructorTemplate->GetFunction();
+    _jsConstructor.Reset( isolate, constructor );
+}
+
+v8::UniquePersistent<v8::Object> JsVlcAudioOutput::create( JsVlcPlayer& player )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    Local<Function> constructor =
+        Local<Function>::New( isolate, _jsConstructor );
+
+    Local<Value> argv[] = { player.handle() };
+
+    return { isolate, constructor->NewInstance( sizeof( argv ) / sizeof( argv[0] ), argv ) };
+}
+
+void JsVlcAudioOutput::jsCreate( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    Local<Object> thisObject = args.Holder();
+    if( args.IsConstructCall() && thisObject->InternalFieldCount() > 0 ) {
+        JsVlcPlayer* jsPlayer =
+            ObjectWrap::Unwrap<JsVlcPlayer>( Handle<Object>::Cast( args[0] ) );
+        if( jsPlayer ) {
+            new JsVlcAudioOutput( thisObject, jsPlayer );
+            args.GetReturnValue().Set( thisObject );
+        }
+    } else {
+        Local<Function> constructor =
+            Local<Function>::New( isolate, _jsConstructor );
+        Local<Value> argv[] = { args[0] };
+        args.GetReturnValue().Set(
+            constructor->NewInstance( sizeof( argv ) / sizeof( argv[0] ), argv ) );
+    }
+}
+
+JsVlcAudioOutput::JsVlcAudioOutput( v8::Local<v8::Object>& thisObject, JsVlcPlayer* jsPlayer ) :
+    _jsPlayer( jsPlayer ), _frames( 0 ), _bands( 0 )
+{
+    Wrap( thisObject );
+}
+
+bool JsVlcAudioOutput::enable( v8::Local<v8::Value> options )
+{
+    if( _jsPlayer->closing() )
+        return false;
+
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    VlcAudioOutput::SampleFormat format = VlcAudioOutput::SampleFormat::S16;
+    unsigned rate = 44100;
+    unsigned channels = 2;
+    unsigned frames = DEFAULT_FRAMES;
+    unsigned eventInterval = 0;
+    bool nativeConversion = false;
+
+    bool analysis = false;
+    unsigned fftSize = DEFAULT_FFT_SIZE;
+    unsigned bands = DEFAULT_BANDS;
+    AudioAnalyzer::Window window = AudioAnalyzer::Window::Hann;
+    unsigned levelsInterval = 0;
+
+    if( options->IsObject() ) {
+        Local<Object> jsOptions = Local<Object>::Cast( options );
+
+        Local<Value> jsFormat =
+            jsOptions->Get( String::NewFromUtf8( isolate, "format", v8::String::kInternalizedString ) );
+        if( jsFormat->IsNumber() ) {
+            if( FromJsValue<unsigned>( jsFormat ) == static_cast<unsigned>( VlcAudioOutput::SampleFormat::F32 ) )
+                format = VlcAudioOutput::SampleFormat::F32;
+        } else if( jsFormat->IsString() ) {
+            const std::string formatName = FromJsValue<std::string>( jsFormat );
+            if( formatName == "F32" || formatName == "f32" )
+                format = VlcAudioOutput::SampleFormat::F32;
+            else if( formatName != "S16" && formatName != "s16" )
+                return false;
+        }
+
+        Local<Value> jsRate =
+            jsOptions->Get( String::NewFromUtf8( isolate, "rate", v8::String::kInternalizedString ) );
+        if( jsRate->IsNumber() )
+            rate = FromJsValue<unsigned>( jsRate );
+
+        Local<Value> jsChannels =
+            jsOptions->Get( String::NewFromUtf8( isolate, "channels", v8::String::kInternalizedString ) );
+        if( jsChannels->IsNumber() )
+            channels = FromJsValue<unsigned>( jsChannels );
+
+        Local<Value> jsFrames =
+            jsOptions->Get( String::NewFromUtf8( isolate, "frames", v8::String::kInternalizedString ) );
+        if( jsFrames->IsNumber() )
+            frames = FromJsValue<unsigned>( jsFrames );
+
+        Local<Value> jsEventInterval =
+            jsOptions->Get( String::NewFromUtf8( isolate, "eventInterval", v8::String::kInternalizedString ) );
+        if( jsEventInterval->IsNumber() )
+            eventInterval = FromJsValue<unsigned>( jsEventInterval );
+
+        Local<Value> jsConverter =
+            jsOptions->Get( String::NewFromUtf8( isolate, "converter", v8::String::kInternalizedString ) );
+        if( jsConverter->IsString() ) {
+            const std::string converter = FromJsValue<std::string>( jsConverter );
+            if( converter == "native" )
+                nativeConversion = true;
+            else if( converter != "libvlc" )
+                return false;
+        }
+
+        Local<Value> jsLevels =
+            jsOptions->Get( String::NewFromUtf8( isolate, "levels", v8::String::kInternalizedString ) );
+        if( jsLevels->IsTrue() ) {
+            analysis = true;
+        } else if( jsLevels->IsObject() ) {
+            analysis = true;
+
+            Local<Object> jsLevelsOptions = Local<Object>::Cast( jsLevels );
+
+            Local<Value> jsFftSize =
+                jsLevelsOptions->Get( String::NewFromUtf8( isolate, "fftSize", v8::String::kInternalizedString ) );
+            if( jsFftSize->IsNumber() )
+                fftSize = FromJsValue<unsigned>( jsFftSize );
+
+            Local<Value> jsBands =
+                jsLevelsOptions->Get( String::NewFromUtf8( isolate, "bands", v8::String::kInternalizedString ) );
+            if( jsBands->IsNumber() )
+                bands = FromJsValue<unsigned>( jsBands );
+
+            Local<Value> jsWindow =
+                jsLevelsOptions->Get( String::NewFromUtf8( isolate, "window", v8::String::kInternalizedString ) );
+            if( jsWindow->IsString() ) {
+                const std::string windowName = FromJsValue<std::string>( jsWindow );
+                if( windowName == "none" )
+                    window = AudioAnalyzer::Window::None;
+                else if( windowName == "blackman" )
+                    window = AudioAnalyzer::Window::Blackman;
+                else if( windowName != "hann" )
+                    return false;
+            }
+
+            Local<Value> jsLevelsInterval =
+                jsLevelsOptions->Get( String::NewFromUtf8( isolate, "eventInterval", v8::String::kInternalizedString ) );
+            if( jsLevelsInterval->IsNumber() )
+                levelsInterval = FromJsValue<unsigned>( jsLevelsInterval );
+        }
+    }
+
+    if( analysis &&
+        ( fftSize < 64 || fftSize > MAX_FFT_SIZE || ( fftSize & ( fftSize - 1 ) ) ||
+          !bands || bands > MAX_BANDS ) )
+    {
+        return false;
+    }
+
+    if( rate < 8000 || rate > 192000 || !channels || channels > MAX_CHANNELS ||
+        !frames || frames > MAX_FRAMES )
+    {
+        return false;
+    }
+
+    libvlc_media_player_t* mp = _jsPlayer->player().get_mp();
+    if( !mp )
+        return false;
+
+    //so cursors could be converted to buffer positions with "& ( frames - 1 )"
+    unsigned capacity = 1;
+    while( capacity < frames )
+        capacity <<= 1;
+
+    Local<Object> jsBuffer =
+        NewTypedArray( VlcAudioOutput::SampleFormat::F32 == format ? "Float32Array" : "Int16Array",
+                       capacity * channels );
+    Local<Object> jsCursors =
+        NewTypedArray( "Uint32Array", VlcAudioOutput::CursorsCount );
+
+    VlcAudioOutput& output = _jsPlayer->audioOutput();
+
+    //old buffer should not be touched by audio thread anymore
+    output.setBuffer( nullptr, 0, nullptr );
+    output.open( mp, format, rate, channels, nativeConversion );
+    output.setBuffer( jsBuffer->GetIndexedPropertiesExternalArrayData(), capacity,
+                      static_cast<uint32_t*>( jsCursors->GetIndexedPropertiesExternalArrayData() ) );
+
+    _frames = capacity;
+    _jsBuffer.Reset( isolate, jsBuffer );
+    _jsCursors.Reset( isolate, jsCursors );
+
+    if( analysis ) {
+        Local<Object> jsLevels =
+            NewTypedArray( "Float32Array", AudioAnalyzer::levelsCount( channels, bands ) );
+        output.setAnalysis( static_cast<float*>( jsLevels->GetIndexedPropertiesExternalArrayData() ),
+                            fftSize, bands, window );
+        _bands = bands;
+        _jsLevels.Reset( isolate, jsLevels );
+    } else {
+        _bands = 0;
+        _jsLevels.Reset();
+    }
+
+    _jsPlayer->setAudioDataInterval( eventInterval );
+    _jsPlayer->setAudioLevelsInterval( analysis ? levelsInterval : 0 );
+
+    return true;
+}
+
+void JsVlcAudioOutput::disable()
+{
+    if( _jsPlayer->closing() )
+        return;
+
+    VlcAudioOutput& output = _jsPlayer->audioOutput();
+
+    output.setBuffer( nullptr, 0, nullptr );
+    output.close();
+
+    _jsPlayer->setAudioDataInterval( 0 );
+    _jsPlayer->setAudioLevelsInterval( 0 );
+
+    _frames = 0;
+    _bands = 0;
+    _jsBuffer.Reset();
+    _jsCursors.Reset();
+    _jsLevels.Reset();
+}
+
+bool JsVlcAudioOutput::enabled()
+{
+    return _jsPlayer->audioOutput().isOpen();
+}
+
+v8::Local<v8::Value> JsVlcAudioOutput::buffer()
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+
+    if( _jsBuffer.IsEmpty() )
+        return Null( isolate );
+
+    return Local<Object>::New( isolate, _jsBuffer );
+}
+
+v8::Local<v8::Value> JsVlcAudioOutput::levels()
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+
+    if( _jsLevels.IsEmpty() )
+        return Null( isolate );
+
+    return Local<Object>::New( isolate, _jsLevels );
+}
+
+v8::Local<v8::Value> JsVlcAudioOutput::cursors()
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+
+    if( _jsCursors.IsEmpty() )
+        return Null( isolate );
+
+    return Local<Object>::New( isolate, _jsCursors );
+}
+
+unsigned JsVlcAudioOutput::format()
+{
+    return static_cast<unsigned>( _jsPlayer->audioOutput().sampleFormat() );
+}
+
+unsigned JsVlcAudioOutput::rate()
+{
+    return _jsPlayer->audioOutput().rate();
+}
+
+unsigned JsVlcAudioOutput::channels()
+{
+    return _jsPlayer->audioOutput().channels();
+}
+
+unsigned JsVlcAudioOutput::frames()
+{
+    return _frames;
+}
+
+unsigned JsVlcAudioOutput::bands()
+{
+    return _bands;
+}
+
+std::string JsVlcAudioOutput::converter()
+{
+    return _jsPlayer->audioOutput().nativeConversion() ? "native" : "libvlc";
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+
+#include <v8.h>
+#include <node_object_wrap.h>
+
+class JsVlcPlayer; //#include "JsVlcPlayer.h"
+
+//Decoded audio access: when enabled, audio of next started media
+//goes to ring buffer (typed array) instead of audio device
+class JsVlcAudioOutput :
+    public node::ObjectWrap
+{
+public:
+    static void initJsApi();
+    static v8::UniquePersistent<v8::Object> create( JsVlcPlayer& player );
+
+    //options: { format: "S16" | "F32", rate, channels,
+    //           frames: buffer capacity (rounded up to power of two),
+    //           eventInterval: AudioData event interval in ms, 0 - no events,
+    //           converter: "libvlc" | "native" - who downmixes/resamples audio,
+    //           levels: true | { fftSize, bands, window: "none" | "hann" | "blackman",
+    //                            eventInterval: AudioLevels event interval in ms } }
+    bool enable( v8::Local<v8::Value> options );
+    void disable();
+
+    bool enabled();
+
+    v8::Local<v8::Value> buffer();
+    v8::Local<v8::Value> cursors();
+    //Float32Array [ rms[channels], peak[channels], bands[bands] ] or null
+    v8::Local<v8::Value> levels();
+
+    unsigned format();
+    unsigned rate();
+    unsigned channels();
+    unsigned frames();
+    std::string converter();
+    unsigned bands();
+
+private:
+    static void jsCreate( const v8::FunctionCallbackInfo<v8::Value>& args );
+    JsVlcAudioOutput( v8::Local<v8::Object>& thisObject, JsVlcPlayer* );
+
+private:
+    static v8::Persistent<v8::Function> _jsConstructor;
+
+    JsVlcPlayer* _jsPlayer;
+
+    unsigned _frames;
+    v8::UniquePersistent<v8::Object> _jsBuffer;
+    v8::UniquePersistent<v8::Object> _jsCursors;
+
+    unsigned _bands;
+    v8::UniquePersistent<v8::Object> _jsLevels;
+};
@@ -74,10 +74,16 @@ JsVlcDeinterlace::JsVlcDeinterlace( v8::Local<v8::Object>& thisObject, JsVlcPlay
 
 void JsVlcDeinterlace::enable( const std::string& mode )
 {
+    if( _jsPlayer->closing() )
+        return;
+
     libvlc_video_set_deinterlace( _jsPlayer->player().get_mp(), mode.c_str() );
 }
 
 void JsVlcDeinterlace::disable()
 {
+    if( _jsPlayer->closing() )
+        return;
+
     libvlc_video_set_deinterlace( _jsPlayer->player().get_mp(), nullptr );
 }
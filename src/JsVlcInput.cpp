@@ -88,46 +88,73 @@ JsVlcInput::JsVlcInput( v8::Local<v8::Object>& thisObject, JsVlcPlayer* jsPlayer
 
 double JsVlcInput::length()
 {
+    if( _jsPlayer->closing() )
+        return 0;
+
     return static_cast<double>( _jsPlayer->player().get_length() );
 }
 
 double JsVlcInput::fps()
 {
+    if( _jsPlayer->closing() )
+        return 0;
+
     return _jsPlayer->player().get_fps();
 }
 
 unsigned JsVlcInput::state()
 {
+    if( _jsPlayer->closing() )
+        return libvlc_Stopped;
+
     return _jsPlayer->player().get_state();
 }
 
 double JsVlcInput::position()
 {
+    if( _jsPlayer->closing() )
+        return 0;
+
     return _jsPlayer->player().get_position();
 }
 
 void JsVlcInput::setPosition( double position )
 {
+    if( _jsPlayer->closing() )
+        return;
+
     _jsPlayer->player().set_position( static_cast<float>( position ) );
 }
 
 double JsVlcInput::time()
 {
+    if( _jsPlayer->closing() )
+        return 0;
+
     return static_cast<double>( _jsPlayer->player().get_time() );
 }
 
 void JsVlcInput::setTime( double time )
 {
+    if( _jsPlayer->closing() )
+        return;
+
     return _jsPlayer->player().set_time( static_cast<libvlc_time_t>( time ) );
 }
 
 double JsVlcInput::rate()
 {
+    if( _jsPlayer->closing() )
+        return 0;
+
     return _jsPlayer->player().get_rate();
 }
 
 void JsVlcInput::setRate( double rate )
 {
+    if( _jsPlayer->closing() )
+        return;
+
     _jsPlayer->player().set_rate( static_cast<float>( rate ) );
 }
 
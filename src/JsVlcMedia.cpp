@@ -35,6 +35,7 @@ void JsVlcMedia::initJsApi()
     SET_RO_PROPERTY( instanceTemplate, "artworkURL", &JsVlcMedia::artworkURL );
     SET_RO_PROPERTY( instanceTemplate, "trackID", &JsVlcMedia::trackID );
     SET_RO_PROPERTY( instanceTemplate, "mrl", &JsVlcMedia::mrl );
+    SET_RO_PROPERTY( instanceTemplate, "inputStats", &JsVlcMedia::inputStats );
 
     SET_RW_PROPERTY( instanceTemplate, "title",
                      &JsVlcMedia::title,
@@ -189,6 +190,17 @@ std::string JsVlcMedia::trackID()
 
 std::string JsVlcMedia::mrl()
 {
+    if( _jsPlayer->closing() )
+        return std::string();
+
+    //libvlc reports "imem://" for items read through custom input,
+    //so original mrl is taken from store
+    PlaylistStore& store = _jsPlayer->playlistStore();
+    const int idx =
+        store.fromPlayerIndex( _jsPlayer->player().find_media_index( get_media() ) );
+    if( idx >= 0 && store.input( idx ) )
+        return store.mrl( idx );
+
     return get_media().mrl();
 }
 
@@ -199,11 +211,22 @@ std::string JsVlcMedia::title()
 
 void JsVlcMedia::setTitle( const std::string& title )
 {
+    if( _jsPlayer->closing() )
+        return;
+
     setMeta( libvlc_meta_Title, title );
+
+    PlaylistStore& store = _jsPlayer->playlistStore();
+    const int idx = store.fromPlayerIndex( _jsPlayer->player().find_media_index( get_media() ) );
+    if( idx >= 0 )
+        store.updateMeta( idx );
 }
 
 std::string JsVlcMedia::setting()
 {
+    if( _jsPlayer->closing() )
+        return std::string();
+
     vlc_player& p = _jsPlayer->player();
 
     int idx = p.find_media_index( get_media() );
@@ -216,6 +239,9 @@ std::string JsVlcMedia::setting()
 
 void JsVlcMedia::setSetting( const std::string& setting )
 {
+    if( _jsPlayer->closing() )
+        return;
+
     vlc_player& p = _jsPlayer->player();
 
     int idx = p.find_media_index( get_media() );
@@ -226,6 +252,9 @@ void JsVlcMedia::setSetting( const std::string& setting )
 
 bool JsVlcMedia::disabled()
 {
+    if( _jsPlayer->closing() )
+        return false;
+
     vlc_player& p = _jsPlayer->player();
 
     int idx = p.find_media_index( get_media() );
@@ -234,6 +263,9 @@ bool JsVlcMedia::disabled()
 
 void JsVlcMedia::setDisabled( bool disabled )
 {
+    if( _jsPlayer->closing() )
+        return;
+
     vlc_player& p = _jsPlayer->player();
 
     int idx = p.find_media_index( get_media() );
@@ -242,3 +274,29 @@ void JsVlcMedia::setDisabled( bool disabled )
     }
 }
 
+v8::Local<v8::Value> JsVlcMedia::inputStats()
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    EscapableHandleScope scope( isolate );
+
+    PlaylistStore& store = _jsPlayer->playlistStore();
+
+    const int idx =
+        store.fromPlayerIndex( _jsPlayer->player().find_media_index( get_media() ) );
+    std::shared_ptr<MediaInput> input = idx < 0 ? nullptr : store.input( idx );
+    if( !input )
+        return scope.Escape( Local<Value>( Undefined( isolate ) ) );
+
+    MediaInputStats stats;
+    input->stats( &stats );
+
+    Local<Object> jsStats = Object::New( isolate );
+    for( const MediaInputStat& stat: stats ) {
+        jsStats->Set( String::NewFromUtf8( isolate, stat.name, v8::String::kInternalizedString ),
+                      Number::New( isolate, stat.value ) );
+    }
+
+    return scope.Escape( jsStats );
+}
@@ -44,6 +44,9 @@ public:
     bool disabled();
     void setDisabled( bool );
 
+    //counters of custom input (i.e. added with playlist.addStream)
+    v8::Local<v8::Value> inputStats();
+
 private:
     JsVlcMedia( v8::Local<v8::Object>& thisObject,
                 JsVlcPlayer*,
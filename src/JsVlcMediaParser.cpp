@@ -0,0 +1,262 @@
+#include "JsVlcMediaParser.h"
+
+#include <thread>
+
+#include "NodeTools.h"
+#include "AsyncJob.h"
+#include "ThreadPool.h"
+
+///////////////////////////////////////////////////////////////////////////////
+class MediaParseJob : public AsyncJob
+{
+public:
+    MediaParseJob( libvlc_instance_t* libvlc,
+                   const std::shared_ptr<MetaCache>& metaCache,
+                   const std::vector<std::string>& mrls,
+                   unsigned concurrency, int timeout );
+
+    void start();
+
+protected:
+    v8::Local<v8::Value> result() override;
+
+private:
+    //released after workers are stopped
+    const LibvlcRef _libvlc;
+    const std::shared_ptr<MetaCache> _metaCache;
+    const int _timeout;
+
+    std::vector<MediaInfo> _mediaInfos;
+    std::atomic<unsigned> _parsedCount;
+
+    ThreadPool _workers; //should be last member, to be destroyed first
+};
+
+MediaParseJob::MediaParseJob( libvlc_instance_t* libvlc,
+                              const std::shared_ptr<MetaCache>& metaCache,
+                              const std::vector<std::string>& mrls,
+                              unsigned concurrency, int timeout ) :
+    _libvlc( libvlc ), _metaCache( metaCache ), _timeout( timeout ),
+    _mediaInfos( mrls.size() ), _parsedCount( 0 ),
+    _workers( concurrency )
+{
+    for( unsigned i = 0; i < mrls.size(); ++i ) {
+        _mediaInfos[i].mrl = mrls[i];
+    }
+}
+
+void MediaParseJob::start()
+{
+    if( _mediaInfos.empty() ) {
+        finish();
+        return;
+    }
+
+    for( unsigned i = 0; i < _mediaInfos.size(); ++i ) {
+        _workers.post(
+            [this, i] () {
+                MediaInfo& info = _mediaInfos[i];
+                if( !_metaCache || !_metaCache->find( info.mrl, &info ) ) {
+                    if( ParseMedia( _libvlc.get(), info.mrl, _timeout, &info ) && _metaCache )
+                        _metaCache->store( info );
+                }
+
+                if( ++_parsedCount == _mediaInfos.size() )
+                    finish();
+            } );
+    }
+}
+
+v8::Local<v8::Value> MediaParseJob::result()
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    EscapableHandleScope scope( isolate );
+
+    Local<Array> jsInfos = Array::New( isolate, _mediaInfos.size() );
+    for( unsigned i = 0; i < _mediaInfos.size(); ++i ) {
+        jsInfos->Set( i, JsVlcMediaParser::toJsValue( _mediaInfos[i] ) );
+    }
+
+    return scope.Escape( jsInfos );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<MetaCache> JsVlcMediaParser::_metaCache;
+
+void JsVlcMediaParser::initJsApi( const v8::Local<v8::Function>& playerConstructor )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    playerConstructor->Set(
+        String::NewFromUtf8( isolate, "parseMedia", v8::String::kInternalizedString ),
+        FunctionTemplate::New( isolate, jsParseMedia )->GetFunction() );
+    playerConstructor->Set(
+        String::NewFromUtf8( isolate, "openMetaCache", v8::String::kInternalizedString ),
+        FunctionTemplate::New( isolate, jsOpenMetaCache )->GetFunction() );
+    playerConstructor->Set(
+        String::NewFromUtf8( isolate, "closeMetaCache", v8::String::kInternalizedString ),
+        FunctionTemplate::New( isolate, jsCloseMetaCache )->GetFunction() );
+}
+
+void JsVlcMediaParser::closeMetaCache()
+{
+    //running jobs keep their own reference to cache,
+    //so it will be closed when last of them is done
+    _metaCache.reset();
+}
+
+void JsVlcMediaParser::jsOpenMetaCache( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    closeMetaCache();
+
+    if( !args[0]->IsString() ) {
+        args.GetReturnValue().Set( false );
+        return;
+    }
+
+    std::shared_ptr<MetaCache> metaCache = std::make_shared<MetaCache>();
+    if( metaCache->open( FromJsValue<std::string>( args[0] ) ) )
+        _metaCache = metaCache;
+
+    args.GetReturnValue().Set( _metaCache != nullptr );
+}
+
+void JsVlcMediaParser::jsCloseMetaCache( const v8::FunctionCallbackInfo<v8::Value>& /*args*/ )
+{
+    closeMetaCache();
+}
+
+static std::string FourccToString( uint32_t fourcc )
+{
+    std::string str( 4, ' ' );
+    for( unsigned i = 0; i < 4; ++i ) {
+        const char c = static_cast<char>( ( fourcc >> ( i * 8 ) ) & 0xff );
+        if( c )
+            str[i] = c;
+    }
+
+    return str;
+}
+
+static const char* TrackTypeName( libvlc_track_type_t type )
+{
+    switch( type ) {
+        case libvlc_track_audio:
+            return "audio";
+        case libvlc_track_video:
+            return "video";
+        case libvlc_track_text:
+            return "text";
+        default:
+            return "unknown";
+    }
+}
+
+v8::Local<v8::Object> JsVlcMediaParser::toJsValue( const MediaInfo& info )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    EscapableHandleScope scope( isolate );
+
+    Local<Object> jsInfo = Object::New( isolate );
+
+    jsInfo->Set( String::NewFromUtf8( isolate, "mrl", v8::String::kInternalizedString ),
+                 ToJsValue( info.mrl ) );
+    jsInfo->Set( String::NewFromUtf8( isolate, "parsed", v8::String::kInternalizedString ),
+                 ToJsValue( info.parsed ) );
+    jsInfo->Set( String::NewFromUtf8( isolate, "duration", v8::String::kInternalizedString ),
+                 ToJsValue( static_cast<double>( info.duration ) ) );
+
+    for( unsigned i = 0; i < MediaInfo::MetaCount; ++i ) {
+        jsInfo->Set( String::NewFromUtf8( isolate, MetaNames[i], v8::String::kInternalizedString ),
+                     ToJsValue( info.meta[i] ) );
+    }
+
+    Local<Array> jsTracks = Array::New( isolate, info.tracks.size() );
+    for( unsigned i = 0; i < info.tracks.size(); ++i ) {
+        const MediaTrackInfo& track = info.tracks[i];
+
+        Local<Object> jsTrack = Object::New( isolate );
+        jsTrack->Set( String::NewFromUtf8( isolate, "type", v8::String::kInternalizedString ),
+                      ToJsValue( std::string( TrackTypeName( track.type ) ) ) );
+        jsTrack->Set( String::NewFromUtf8( isolate, "id", v8::String::kInternalizedString ),
+                      ToJsValue( track.id ) );
+        jsTrack->Set( String::NewFromUtf8( isolate, "codec", v8::String::kInternalizedString ),
+                      ToJsValue( FourccToString( track.codec ) ) );
+        jsTrack->Set( String::NewFromUtf8( isolate, "bitrate", v8::String::kInternalizedString ),
+                      ToJsValue( track.bitrate ) );
+        jsTrack->Set( String::NewFromUtf8( isolate, "language", v8::String::kInternalizedString ),
+                      ToJsValue( track.language ) );
+        jsTrack->Set( String::NewFromUtf8( isolate, "description", v8::String::kInternalizedString ),
+                      ToJsValue( track.description ) );
+
+        switch( track.type ) {
+            case libvlc_track_audio:
+                jsTrack->Set( String::NewFromUtf8( isolate, "channels", v8::String::kInternalizedString ),
+                              ToJsValue( track.channels ) );
+                jsTrack->Set( String::NewFromUtf8( isolate, "rate", v8::String::kInternalizedString ),
+                              ToJsValue( track.rate ) );
+                break;
+            case libvlc_track_video: {
+                jsTrack->Set( String::NewFromUtf8( isolate, "width", v8::String::kInternalizedString ),
+                              ToJsValue( track.width ) );
+                jsTrack->Set( String::NewFromUtf8( isolate, "height", v8::String::kInternalizedString ),
+                              ToJsValue( track.height ) );
+                const double fps = track.frameRateDen ?
+                    static_cast<double>( track.frameRateNum ) / track.frameRateDen : 0.;
+                jsTrack->Set( String::NewFromUtf8( isolate, "fps", v8::String::kInternalizedString ),
+                              ToJsValue( fps ) );
+                break;
+            }
+            default:
+                break;
+        }
+
+        jsTracks->Set( i, jsTrack );
+    }
+    jsInfo->Set( String::NewFromUtf8( isolate, "tracks", v8::String::kInternalizedString ), jsTracks );
+
+    return scope.Escape( jsInfo );
+}
+
+void JsVlcMediaParser::jsParseMedia( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    std::vector<std::string> mrls;
+    if( args[0]->IsArray() )
+        mrls = FromJsValue<std::vector<std::string> >( args[0] );
+    else if( args[0]->IsString() )
+        mrls.push_back( FromJsValue<std::string>( args[0] ) );
+
+    unsigned concurrency = std::thread::hardware_concurrency();
+    int timeout = -1;
+
+    if( args[1]->IsObject() ) {
+        Local<Object> options = Local<Object>::Cast( args[1] );
+
+        Local<Value> jsConcurrency =
+            options->Get( String::NewFromUtf8( isolate, "concurrency", v8::String::kInternalizedString ) );
+        if( jsConcurrency->IsNumber() )
+            concurrency = FromJsValue<unsigned>( jsConcurrency );
+
+        Local<Value> jsTimeout =
+            options->Get( String::NewFromUtf8( isolate, "timeout", v8::String::kInternalizedString ) );
+        if( jsTimeout->IsNumber() )
+            timeout = FromJsValue<int>( jsTimeout );
+    }
+
+    MediaParseJob* job =
+        new MediaParseJob( SharedLibvlc(), _metaCache, mrls, concurrency, timeout );
+    args.GetReturnValue().Set( job->promise() );
+    job->start();
+}
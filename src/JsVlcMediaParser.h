@@ -0,0 +1,29 @@
+#pragma once
+
+#include <memory>
+
+#include <v8.h>
+
+#include "MediaInfo.h"
+#include "MetaCache.h"
+
+class JsVlcMediaParser
+{
+public:
+    //adds static methods to VlcPlayer constructor
+    static void initJsApi( const v8::Local<v8::Function>& playerConstructor );
+
+    static v8::Local<v8::Object> toJsValue( const MediaInfo& );
+
+    static std::shared_ptr<MetaCache> metaCache()
+        { return _metaCache; }
+    static void closeMetaCache();
+
+private:
+    static void jsParseMedia( const v8::FunctionCallbackInfo<v8::Value>& args );
+    static void jsOpenMetaCache( const v8::FunctionCallbackInfo<v8::Value>& args );
+    static void jsCloseMetaCache( const v8::FunctionCallbackInfo<v8::Value>& args );
+
+private:
+    static std::shared_ptr<MetaCache> _metaCache;
+};
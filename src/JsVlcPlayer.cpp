@@ -1,13 +1,23 @@
 #include "JsVlcPlayer.h"
 
 #include <string.h>
+#include <math.h>
+
+#include <thread>
+#include <algorithm>
 
 #include "NodeTools.h"
 #include "JsVlcInput.h"
 #include "JsVlcAudio.h"
+#include "JsVlcAudioOutput.h"
 #include "JsVlcVideo.h"
 #include "JsVlcSubtitles.h"
 #include "JsVlcPlaylist.h"
+#include "JsVlcMediaParser.h"
+#include "JsVlcAudioAnalysis.h"
+#include "JsHttpSource.h"
+#include "JsVlcVideoPreview.h"
+#include "MetaCache.h"
 
 const char* JsVlcPlayer::callbackNames[] =
 {
@@ -31,12 +41,114 @@ const char* JsVlcPlayer::callbackNames[] =
     "PositionChanged",
     "SeekableChanged",
     "PausableChanged",
-    "LengthChanged"
+    "LengthChanged",
+
+    "PlaylistLoadProgress",
+
+    "AudioData",
+    "AudioLevels"
 };
 
 v8::Persistent<v8::Function> JsVlcPlayer::_jsConstructor;
 std::set<JsVlcPlayer*> JsVlcPlayer::_instances;
 
+//how long before end of current item next item is preparsed (in ms)
+static const libvlc_time_t PREPARSE_TIME = 3000;
+
+//if accurate seek doesn't reach target frame in this time (in ms),
+//it's replaced with plain seek to target time
+static const uint64_t ACCURATE_SEEK_TIMEOUT = 1000;
+
+//max distance between reported time and keyframe of landed accurate seek (in ms)
+static const libvlc_time_t ACCURATE_SEEK_TOLERANCE = 1000;
+
+//if coalesced seek doesn't produce frame in this time (in ms),
+//next pending seek is issued anyway
+static const uint64_t SCHEDULED_SEEK_TIMEOUT = 500;
+//paused vout could render nothing after seek took effect,
+//so such seek is done after this time (in ms) anyway
+static const uint64_t LANDED_SEEK_TIMEOUT = 100;
+
+//used by frame stepping if media has no frame rate info (in ms)
+static const double DEFAULT_FRAME_DURATION = 40;
+
+//scan mode limits
+static const double MIN_SCAN_SPEED = 2;
+static const double MAX_SCAN_SPEED = 64;
+static const unsigned DEFAULT_SCAN_FPS = 8;
+static const unsigned MAX_SCAN_FPS = 30;
+
+//events changing track lists, which are not delivered by vlc::player
+static const libvlc_event_e TrackEvents[] = {
+    libvlc_MediaPlayerVout,
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION( 3, 0, 0, 0 )
+    libvlc_MediaPlayerESAdded,
+    libvlc_MediaPlayerESDeleted,
+    libvlc_MediaPlayerESSelected,
+#endif
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//Player could be destroyed before close callbacks are called,
+//so handles are freed by last close callback or by player destructor,
+//whichever comes last.
+struct JsVlcPlayer::UvHandles
+{
+    UvHandles() :
+        closingCount( 0 ), orphaned( false ), unrefPlayer( nullptr ) {}
+
+    void close();
+    static void closed( uv_handle_t* );
+
+    uv_async_t async;
+    uv_timer_t errorTimer;
+    uv_timer_t audioDataTimer;
+    uv_timer_t audioLevelsTimer;
+    uv_timer_t seekTimer;
+    uv_timer_t scheduledSeekTimer;
+    uv_timer_t scanTimer;
+
+    unsigned closingCount;
+    //player is destroyed already
+    bool orphaned;
+    //reference to release when all handles are closed
+    JsVlcPlayer* unrefPlayer;
+};
+
+void JsVlcPlayer::UvHandles::close()
+{
+    uv_handle_t *const handles[] = {
+        reinterpret_cast<uv_handle_t*>( &async ),
+        reinterpret_cast<uv_handle_t*>( &errorTimer ),
+        reinterpret_cast<uv_handle_t*>( &audioDataTimer ),
+        reinterpret_cast<uv_handle_t*>( &audioLevelsTimer ),
+        reinterpret_cast<uv_handle_t*>( &seekTimer ),
+        reinterpret_cast<uv_handle_t*>( &scheduledSeekTimer ),
+        reinterpret_cast<uv_handle_t*>( &scanTimer ),
+    };
+
+    for( uv_handle_t* handle: handles ) {
+        //only close callback is called after uv_close,
+        //so data doesn't have to point to player anymore
+        handle->data = this;
+        ++closingCount;
+        uv_close( handle, closed );
+    }
+}
+
+void JsVlcPlayer::UvHandles::closed( uv_handle_t* handle )
+{
+    UvHandles* handles = static_cast<UvHandles*>( handle->data );
+    if( --handles->closingCount )
+        return;
+
+    if( handles->unrefPlayer )
+        handles->unrefPlayer->Unref();
+
+    if( handles->orphaned )
+        delete handles;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 struct JsVlcPlayer::AsyncData
 {
@@ -62,17 +174,113 @@ void JsVlcPlayer::CallbackData::process( JsVlcPlayer* jsPlayer )
 ///////////////////////////////////////////////////////////////////////////////
 struct JsVlcPlayer::LibvlcEvent : public JsVlcPlayer::AsyncData
 {
-    LibvlcEvent( const libvlc_event_t& libvlcEvent ) :
-        libvlcEvent( libvlcEvent ) {}
+    LibvlcEvent( const libvlc_event_t& libvlcEvent, uint64_t displayedFrames ) :
+        libvlcEvent( libvlcEvent ), displayedFrames( displayedFrames ) {}
 
     void process( JsVlcPlayer* );
 
     const libvlc_event_t libvlcEvent;
+    const uint64_t displayedFrames;
 };
 
 void JsVlcPlayer::LibvlcEvent::process( JsVlcPlayer* jsPlayer )
 {
-    jsPlayer->handleLibvlcEvent( libvlcEvent );
+    if( jsPlayer->_closing )
+        return;
+
+    jsPlayer->handleLibvlcEvent( libvlcEvent, displayedFrames );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+struct JsVlcPlayer::CommandCompleted : public JsVlcPlayer::AsyncData
+{
+    CommandCompleted( unsigned commandId, const CommandCompletePart& completePart,
+                      bool waitStopped ) :
+        commandId( commandId ), completePart( completePart ), waitStopped( waitStopped ) {}
+
+    void process( JsVlcPlayer* );
+
+    const unsigned commandId;
+    const CommandCompletePart completePart;
+    const bool waitStopped;
+};
+
+void JsVlcPlayer::CommandCompleted::process( JsVlcPlayer* jsPlayer )
+{
+    if( completePart && !jsPlayer->_closing )
+        completePart( jsPlayer );
+
+    //resolved by libvlc_MediaPlayerStopped handler
+    if( waitStopped && libvlc_Stopped != jsPlayer->_snapshot.state &&
+        !jsPlayer->_closing )
+    {
+        jsPlayer->_stopCommands.push_back( commandId );
+        return;
+    }
+
+    jsPlayer->commandCompleted( commandId );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+struct JsVlcPlayer::CloseCompleted : public JsVlcPlayer::AsyncData
+{
+    CloseCompleted( unsigned commandId ) :
+        commandId( commandId ) {}
+
+    void process( JsVlcPlayer* );
+
+    const unsigned commandId;
+};
+
+void JsVlcPlayer::CloseCompleted::process( JsVlcPlayer* jsPlayer )
+{
+    //closeHandles() rejects all still pending commands
+    jsPlayer->commandCompleted( commandId );
+
+    //reference taken by closeAsync() is released when all handles are closed,
+    //so player is not destroyed while it's still on stack
+    jsPlayer->_handles->unrefPlayer = jsPlayer;
+    jsPlayer->closeHandles();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+struct JsVlcPlayer::TracksChanged : public JsVlcPlayer::AsyncData
+{
+    //voutCount is -1 if event is not libvlc_MediaPlayerVout
+    TracksChanged( int voutCount ) :
+        voutCount( voutCount ) {}
+
+    void process( JsVlcPlayer* );
+
+    const int voutCount;
+};
+
+void JsVlcPlayer::TracksChanged::process( JsVlcPlayer* jsPlayer )
+{
+    jsPlayer->invalidateTracks();
+
+    //next item of gapless switch has no video, so held frame will not be reused
+    if( 0 == voutCount && jsPlayer->_gaplessSwitchStarted )
+        jsPlayer->releaseHeldFrame();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+struct JsVlcPlayer::KeyframeIndexReady : public JsVlcPlayer::AsyncData
+{
+    KeyframeIndexReady( unsigned request, const std::shared_ptr<const KeyframeIndex>& index ) :
+        request( request ), index( index ) {}
+
+    void process( JsVlcPlayer* );
+
+    const unsigned request;
+    const std::shared_ptr<const KeyframeIndex> index;
+};
+
+void JsVlcPlayer::KeyframeIndexReady::process( JsVlcPlayer* jsPlayer )
+{
+    //current item could be changed while index was built
+    if( request == jsPlayer->_keyframeIndexRequest )
+        jsPlayer->_keyframeIndex = index;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -96,6 +304,7 @@ void JsVlcPlayer::initJsApi( const v8::Handle<v8::Object>& exports )
 
     JsVlcInput::initJsApi();
     JsVlcAudio::initJsApi();
+    JsVlcAudioOutput::initJsApi();
     JsVlcVideo::initJsApi();
     JsVlcSubtitles::initJsApi();
     JsVlcPlaylist::initJsApi();
@@ -166,9 +375,15 @@ void JsVlcPlayer::initJsApi( const v8::Handle<v8::Object>& exports )
     SET_CALLBACK_PROPERTY( instanceTemplate, "onPausableChanged", CB_MediaPlayerPausableChanged );
     SET_CALLBACK_PROPERTY( instanceTemplate, "onLengthChanged", CB_MediaPlayerLengthChanged );
 
+    SET_CALLBACK_PROPERTY( instanceTemplate, "onPlaylistLoadProgress", CB_PlaylistLoadProgress );
+
+    SET_CALLBACK_PROPERTY( instanceTemplate, "onAudioData", CB_AudioData );
+    SET_CALLBACK_PROPERTY( instanceTemplate, "onAudioLevels", CB_AudioLevels );
+
     SET_RO_PROPERTY( instanceTemplate, "playing", &JsVlcPlayer::playing );
     SET_RO_PROPERTY( instanceTemplate, "length", &JsVlcPlayer::length );
     SET_RO_PROPERTY( instanceTemplate, "state", &JsVlcPlayer::state );
+    SET_RO_PROPERTY( instanceTemplate, "snapshot", &JsVlcPlayer::snapshot );
 
     SET_RO_PROPERTY( instanceTemplate, "input", &JsVlcPlayer::input );
     SET_RO_PROPERTY( instanceTemplate, "audio", &JsVlcPlayer::audio );
@@ -178,12 +393,18 @@ void JsVlcPlayer::initJsApi( const v8::Handle<v8::Object>& exports )
 
     SET_RO_PROPERTY( instanceTemplate, "videoFrame", &JsVlcPlayer::getVideoFrame );
     SET_RO_PROPERTY( instanceTemplate, "events", &JsVlcPlayer::getEventEmitter );
+    SET_RO_PROPERTY( instanceTemplate, "audioOutput", &JsVlcPlayer::getAudioOutput );
+
+    SET_RO_PROPERTY( instanceTemplate, "seekStats", &JsVlcPlayer::seekStats );
+    SET_RO_PROPERTY( instanceTemplate, "frameCacheStats", &JsVlcPlayer::frameCacheStats );
+    SET_RO_PROPERTY( instanceTemplate, "scanSpeed", &JsVlcPlayer::scanSpeed );
 
     SET_RW_PROPERTY( instanceTemplate, "pixelFormat", &JsVlcPlayer::pixelFormat, &JsVlcPlayer::setPixelFormat );
     SET_RW_PROPERTY( instanceTemplate, "position", &JsVlcPlayer::position, &JsVlcPlayer::setPosition );
     SET_RW_PROPERTY( instanceTemplate, "time", &JsVlcPlayer::time, &JsVlcPlayer::setTime );
     SET_RW_PROPERTY( instanceTemplate, "volume", &JsVlcPlayer::volume, &JsVlcPlayer::setVolume );
     SET_RW_PROPERTY( instanceTemplate, "mute", &JsVlcPlayer::muted, &JsVlcPlayer::setMuted );
+    SET_RW_PROPERTY( instanceTemplate, "frameCacheLimit", &JsVlcPlayer::frameCacheLimit, &JsVlcPlayer::setFrameCacheLimit );
 
     NODE_SET_PROTOTYPE_METHOD( constructorTemplate, "play", jsPlay );
     SET_METHOD( constructorTemplate, "pause", &JsVlcPlayer::pause );
@@ -191,7 +412,20 @@ void JsVlcPlayer::initJsApi( const v8::Handle<v8::Object>& exports )
     SET_METHOD( constructorTemplate, "stop",  &JsVlcPlayer::stop );
     SET_METHOD( constructorTemplate, "toggleMute", &JsVlcPlayer::toggleMute );
 
+    NODE_SET_PROTOTYPE_METHOD( constructorTemplate, "playAsync", jsPlayAsync );
+    SET_METHOD( constructorTemplate, "stopAsync", &JsVlcPlayer::stopAsync );
+    SET_METHOD( constructorTemplate, "close", &JsVlcPlayer::closeAsync );
+    SET_METHOD( constructorTemplate, "seekAsync", &JsVlcPlayer::seekAsync );
+    SET_METHOD( constructorTemplate, "seek", &JsVlcPlayer::seek );
+    SET_METHOD( constructorTemplate, "stepFrame", &JsVlcPlayer::stepFrame );
+    SET_METHOD( constructorTemplate, "scan", &JsVlcPlayer::scan );
+    SET_METHOD( constructorTemplate, "stopScan", &JsVlcPlayer::stopScan );
+
     Local<Function> constructor = constructorTemplate->GetFunction();
+    JsVlcMediaParser::initJsApi( constructor );
+    JsVlcAudioAnalysis::initJsApi( constructor );
+    JsHttpSource::initJsApi( constructor );
+    JsVlcVideoPreview::initJsApi( constructor );
     _jsConstructor.Reset( isolate, constructor );
     exports->Set( String::NewFromUtf8( isolate, "VlcPlayer", v8::String::kInternalizedString ), constructor );
     exports->Set( String::NewFromUtf8( isolate, "createPlayer", v8::String::kInternalizedString ), constructor );
@@ -223,25 +457,71 @@ void JsVlcPlayer::jsCreate( const v8::FunctionCallbackInfo<v8::Value>& args )
 
 void JsVlcPlayer::closeAll()
 {
+    //libvlc teardown could take a while for every player,
+    //so do it in parallel
+    std::vector<std::thread> closeThreads;
     for( JsVlcPlayer* p : _instances ) {
-        p->close();
+        p->_playlistStore.interruptInputs();
+        closeThreads.emplace_back(
+            [p] () {
+                //waits for already queued commands (including async close)
+                p->_commandQueue.reset();
+                p->_indexQueue.reset();
+                p->closeLibvlc();
+            } );
     }
+
+    for( std::thread& thread: closeThreads ) {
+        thread.join();
+    }
+
+    for( JsVlcPlayer* p : _instances ) {
+        p->closeHandles();
+    }
+
+    JsVlcMediaParser::closeMetaCache();
+    JsHttpSource::closeDiskCache();
+    ReleaseSharedLibvlc();
 }
 
 JsVlcPlayer::JsVlcPlayer( v8::Local<v8::Object>& thisObject, const v8::Local<v8::Array>& vlcOpts ) :
-    _libvlc( nullptr )
+    _libvlc( nullptr ), _playlistStore( _player ), _handles( new UvHandles ), _lastCommandId( 0 ),
+    _closing( false ), _libvlcClosed( false ),
+    _keyframeIndexRequest( 0 ), _skipFrames( 0 ), _resumeAfterSeek( false ), _seekTarget( 0 ),
+    _accurateSeekTarget( -1 ), _accurateSeekKeyframe( 0 ), _accurateSeekFromTime( 0 ),
+    _accurateSeekLanded( false ), _accurateSeekIssuedFrame( 0 ), _accurateSeekLandedFrame( 0 ),
+    _accurateSeekPlayerTime( -1 ), _accurateSeekFrameTime( 0 ),
+    _frameTime( -1 ), _viewedFrame( 0 ),
+    _scanSpeed( 0 ), _scanStartTime( 0 ), _scanStartClock( 0 ), _scanLastTime( -1 ),
+    _scanResume( false ), _scanUnmute( false ),
+    _gapless( false ),
+    _gaplessSwitch( false ), _gaplessSwitchStarted( false ), _nextItemPreparsed( false ),
+    _tracksValid(), _lastAudioDataCursor( 0 ),
+    _lastAudioLevelsSequence( 0 )
 {
     Wrap( thisObject );
 
     _instances.insert( this );
 
     initLibvlc( vlcOpts );
+    _playlistStore.setLibvlc( _libvlc );
+    _playlistStore.setInputFactory(
+        [] ( const std::string& mode, const std::string& mrl ) {
+            //http(s) items are read through disk cache (if it's opened)
+            return "cache" == mode ?
+                JsHttpSource::create( mrl ) : std::shared_ptr<MediaInput>();
+        } );
 
     _player.set_playback_mode( vlc::mode_normal );
 
     if( _libvlc && _player.open( _libvlc ) ) {
         _player.register_callback( this );
         VlcVideoOutput::open( &_player.basic_player() );
+
+        libvlc_event_manager_t* eventManager =
+            libvlc_media_player_event_manager( _player.get_mp() );
+        for( libvlc_event_e e: TrackEvents )
+            libvlc_event_attach( eventManager, e, tracksChanged, this );
     } else {
         assert( false );
     }
@@ -259,19 +539,35 @@ JsVlcPlayer::JsVlcPlayer( v8::Local<v8::Object>& thisObject, const v8::Local<v8:
     _jsVideo = JsVlcVideo::create( *this );
     _jsSubtitles = JsVlcSubtitles::create( *this );
     _jsPlaylist = JsVlcPlaylist::create( *this );
+    _jsAudioOutput = JsVlcAudioOutput::create( *this );
 
     uv_loop_t* loop = uv_default_loop();
 
-    uv_async_init( loop, &_async,
+    uv_async_init( loop, &_handles->async,
         [] ( uv_async_t* handle ) {
             if( handle->data )
                 reinterpret_cast<JsVlcPlayer*>( handle->data )->handleAsync();
         }
     );
-    _async.data = this;
+    _handles->async.data = this;
+
+    uv_timer_init( loop, &_handles->errorTimer );
+    _handles->errorTimer.data = this;
 
-    uv_timer_init( loop, &_errorTimer );
-    _errorTimer.data = this;
+    uv_timer_init( loop, &_handles->audioDataTimer );
+    _handles->audioDataTimer.data = this;
+
+    uv_timer_init( loop, &_handles->audioLevelsTimer );
+    _handles->audioLevelsTimer.data = this;
+
+    uv_timer_init( loop, &_handles->seekTimer );
+    _handles->seekTimer.data = this;
+
+    uv_timer_init( loop, &_handles->scheduledSeekTimer );
+    _handles->scheduledSeekTimer.data = this;
+
+    uv_timer_init( loop, &_handles->scanTimer );
+    _handles->scanTimer.data = this;
 }
 
 void JsVlcPlayer::initLibvlc( const v8::Local<v8::Array>& vlcOpts )
@@ -306,34 +602,122 @@ JsVlcPlayer::~JsVlcPlayer()
 {
     close();
 
+    //otherwise it's freed by last close callback
+    if( _handles->closingCount )
+        _handles->orphaned = true;
+    else
+        delete _handles;
+
     _instances.erase( this );
 }
 
 void JsVlcPlayer::close()
 {
+    _playlistStore.interruptInputs();
+
+    //waits for already queued commands
+    _commandQueue.reset();
+    _indexQueue.reset();
+
+    closeLibvlc();
+    closeHandles();
+}
+
+void JsVlcPlayer::closeLibvlc()
+{
+    if( _libvlcClosed )
+        return;
+
     _player.unregister_callback( this );
+    if( libvlc_media_player_t* mp = _player.get_mp() ) {
+        libvlc_event_manager_t* eventManager =
+            libvlc_media_player_event_manager( mp );
+        for( libvlc_event_e e: TrackEvents )
+            libvlc_event_detach( eventManager, e, tracksChanged, this );
+    }
     VlcVideoOutput::close();
+    _audioOutput.close();
 
     _player.close();
 
-    _async.data = nullptr;
-    uv_close( reinterpret_cast<uv_handle_t*>( &_async ), 0 );
-
-    _errorTimer.data = nullptr;
-    uv_timer_stop( &_errorTimer );
-
     if( _libvlc ) {
         libvlc_release( _libvlc );
         _libvlc = nullptr;
     }
+
+    _libvlcClosed = true;
+}
+
+void JsVlcPlayer::closeHandles()
+{
+    _closing = true;
+
+    if( uv_is_closing( reinterpret_cast<uv_handle_t*>( &_handles->async ) ) )
+        return;
+
+    _handles->close();
+
+    //completions of already queued commands will never be delivered
+    rejectPendingCommands();
+}
+
+v8::Local<v8::Value> JsVlcPlayer::closeAsync()
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    EscapableHandleScope scope( isolate );
+
+    Local<Promise::Resolver> resolver = Promise::Resolver::New( isolate );
+
+    if( _closing ) {
+        resolver->Resolve( Undefined( isolate ) );
+        return scope.Escape( resolver->GetPromise() );
+    }
+
+    //from now libvlc events and command completions are ignored
+    _closing = true;
+    uv_timer_stop( &_handles->errorTimer );
+    uv_timer_stop( &_handles->audioDataTimer );
+    uv_timer_stop( &_handles->audioLevelsTimer );
+    uv_timer_stop( &_handles->seekTimer );
+    uv_timer_stop( &_handles->scheduledSeekTimer );
+    uv_timer_stop( &_handles->scanTimer );
+
+    const unsigned commandId = ++_lastCommandId;
+    _pendingCommands[commandId].Reset( isolate, resolver );
+
+    //custom inputs should not block libvlc teardown
+    _playlistStore.interruptInputs();
+
+    //player should stay alive until libvlc teardown is finished
+    Ref();
+
+    if( !_commandQueue )
+        _commandQueue.reset( new ThreadPool( 1 ) );
+
+    //all already queued commands will be done before teardown
+    _commandQueue->post(
+        [this, commandId] () {
+            closeLibvlc();
+            postAsyncData( new CloseCompleted( commandId ) );
+        } );
+
+    return scope.Escape( resolver->GetPromise() );
 }
 
 void JsVlcPlayer::media_player_event( const libvlc_event_t* e )
+{
+    //frames displayed before event are older than state reported by it
+    postAsyncData( new LibvlcEvent( *e, displayedFrames() ) );
+}
+
+void JsVlcPlayer::postAsyncData( AsyncData* data )
 {
     _asyncDataGuard.lock();
-    _asyncData.emplace_back( new LibvlcEvent( *e ) );
+    _asyncData.emplace_back( data );
     _asyncDataGuard.unlock();
-    uv_async_send( &_async );
+    uv_async_send( &_handles->async );
 }
 
 void JsVlcPlayer::handleAsync()
@@ -454,11 +838,19 @@ void JsVlcPlayer::onFrameReady()
 {
     using namespace v8;
 
+    if( skipDecodedFrame() )
+        return;
+
     Isolate* isolate = Isolate::GetCurrent();
     HandleScope scope( isolate );
 
     assert( !_jsFrameBuffer.IsEmpty() ); //FIXME! maybe it worth add condition here
     callCallback( CB_FrameReady, { Local<Value>::New( Isolate::GetCurrent(), _jsFrameBuffer ) } );
+    _viewedFrame = 0;
+
+    //previous seek is done, so it's time for next one
+    if( _seekScheduler.frameDisplayed( VlcVideoOutput::displayedFrames() ) )
+        scheduledSeekDone( false );
 }
 
 void JsVlcPlayer::onFrameCleanup()
@@ -466,7 +858,8 @@ void JsVlcPlayer::onFrameCleanup()
     callCallback( CB_FrameCleanup );
 }
 
-void JsVlcPlayer::handleLibvlcEvent( const libvlc_event_t& libvlcEvent )
+void JsVlcPlayer::handleLibvlcEvent( const libvlc_event_t& libvlcEvent,
+                                     uint64_t displayedFrames )
 {
     using namespace v8;
 
@@ -478,12 +871,28 @@ void JsVlcPlayer::handleLibvlcEvent( const libvlc_event_t& libvlcEvent )
     switch( libvlcEvent.type ) {
         case libvlc_MediaPlayerMediaChanged:
             callback = CB_MediaPlayerMediaChanged;
+            _nextItemPreparsed = false;
+            //vout events from now on are from next item of gapless switch
+            _gaplessSwitchStarted = _gaplessSwitch;
+            _snapshot.currentItem = currentItem();
+            _snapshot.time = _snapshot.position = _snapshot.length = 0;
+            invalidateTracks();
+            prefetchNextItem();
+            endScan( false );
+            cancelAccurateSeek();
+            resetScheduledSeeks();
+            frameCache().clear();
+            _viewedFrame = 0;
+            _frameTime = -1;
+            updateKeyframeIndex();
             break;
         case libvlc_MediaPlayerNothingSpecial:
             callback = CB_MediaPlayerNothingSpecial;
+            _snapshot.state = libvlc_NothingSpecial;
             break;
         case libvlc_MediaPlayerOpening:
             callback = CB_MediaPlayerOpening;
+            _snapshot.state = libvlc_Opening;
             break;
         case libvlc_MediaPlayerBuffering: {
             callCallback( CB_MediaPlayerBuffering,
@@ -493,12 +902,31 @@ void JsVlcPlayer::handleLibvlcEvent( const libvlc_event_t& libvlcEvent )
         }
         case libvlc_MediaPlayerPlaying:
             callback = CB_MediaPlayerPlaying;
+            //time of displayed frame is not tracked while playing
+            _frameTime = -1;
+            _viewedFrame = 0;
+            _snapshot.state = libvlc_Playing;
+            _snapshot.currentItem = currentItem();
+            if( _snapshot.currentItem >= 0 )
+                _playlistStore.updateMeta( _snapshot.currentItem );
+            invalidateTracks();
+            //vout event is not guaranteed for media without video
+            if( _gaplessSwitch && currentMediaHasNoVideo() )
+                releaseHeldFrame();
             break;
         case libvlc_MediaPlayerPaused:
             callback = CB_MediaPlayerPaused;
+            _snapshot.state = libvlc_Paused;
             break;
         case libvlc_MediaPlayerStopped:
             callback = CB_MediaPlayerStopped;
+            _snapshot.state = libvlc_Stopped;
+            for( unsigned commandId: _stopCommands )
+                commandCompleted( commandId );
+            _stopCommands.clear();
+            invalidateTracks();
+            if( _gaplessSwitch && !player().is_playing() )
+                releaseHeldFrame();
             break;
         case libvlc_MediaPlayerForward:
             callback = CB_MediaPlayerForward;
@@ -508,29 +936,58 @@ void JsVlcPlayer::handleLibvlcEvent( const libvlc_event_t& libvlcEvent )
             break;
         case libvlc_MediaPlayerEndReached:
             callback = CB_MediaPlayerEndReached;
-            uv_timer_stop( &_errorTimer );
+            _snapshot.state = libvlc_Ended;
+            uv_timer_stop( &_handles->errorTimer );
             currentItemEndReached();
             break;
         case libvlc_MediaPlayerEncounteredError:
+            //custom input can't serve item, so it's played from mrl instead
+            if( _snapshot.currentItem >= 0 &&
+                _playlistStore.fallbackToMrl( _snapshot.currentItem ) )
+            {
+                _playlistStore.play( _snapshot.currentItem );
+                break;
+            }
             callback = CB_MediaPlayerEncounteredError;
+            _snapshot.state = libvlc_Error;
+            if( _gaplessSwitch )
+                releaseHeldFrame();
             //sometimes libvlc do some internal error handling
             //and sends EndReached after that,
             //so we have to wait it some time,
             //to not break playlist ligic.
-            uv_timer_start( &_errorTimer,
+            uv_timer_start( &_handles->errorTimer,
                 [] ( uv_timer_t* handle ) {
                     if( handle->data )
                         static_cast<JsVlcPlayer*>( handle->data )->currentItemEndReached();
                 }, 1000, 0 );
             break;
         case libvlc_MediaPlayerTimeChanged: {
-            const double new_time =
-                static_cast<double>( libvlcEvent.u.media_player_time_changed.new_time );
+            const libvlc_time_t new_time = libvlcEvent.u.media_player_time_changed.new_time;
+            _snapshot.time = static_cast<double>( new_time );
+            //frame of landed seek could be displayed before event is delivered
+            if( _seekScheduler.timeChanged( new_time, displayedFrames ) ) {
+                //there is no frame to wait for without vout
+                if( !libvlc_media_player_has_vout( player().get_mp() ) ||
+                    _seekScheduler.frameDisplayed( VlcVideoOutput::displayedFrames() ) )
+                    scheduledSeekDone( false );
+                else
+                    startScheduledSeekTimer( LANDED_SEEK_TIMEOUT );
+            }
+            accurateSeekTimeChanged( new_time, displayedFrames );
+            if( _gapless && !_nextItemPreparsed ) {
+                const libvlc_time_t length = player().get_length();
+                if( length > 0 && length - new_time <= PREPARSE_TIME ) {
+                    _nextItemPreparsed = true;
+                    preparseNextItem();
+                }
+            }
             callCallback( CB_MediaPlayerTimeChanged,
                           { Number::New( isolate, static_cast<double>( new_time ) ) } );
             break;
         }
         case libvlc_MediaPlayerPositionChanged: {
+            _snapshot.position = libvlcEvent.u.media_player_position_changed.new_position;
             callCallback( CB_MediaPlayerPositionChanged,
                           { Number::New( isolate,
                                          libvlcEvent.u.media_player_position_changed.new_position ) } );
@@ -551,6 +1008,7 @@ void JsVlcPlayer::handleLibvlcEvent( const libvlc_event_t& libvlcEvent )
         case libvlc_MediaPlayerLengthChanged: {
             const double new_length =
                 static_cast<double>( libvlcEvent.u.media_player_length_changed.new_length );
+            _snapshot.length = new_length;
             callCallback( CB_MediaPlayerLengthChanged, { Number::New( isolate, new_length ) } );
             break;
         }
@@ -563,11 +1021,289 @@ void JsVlcPlayer::handleLibvlcEvent( const libvlc_event_t& libvlcEvent )
 
 void JsVlcPlayer::currentItemEndReached()
 {
+    if( _gapless && nextItemIndex() >= 0 ) {
+        //don't stop to avoid black frame between items,
+        //current frame buffer will be reused by next item if possible
+        VlcVideoOutput::holdFrame();
+        _gaplessSwitch = true;
+        _gaplessSwitchStarted = false;
+        playNext();
+        return;
+    }
+
     //have to stop to force video_cleanup_cb and as consequence fill frame with black
     player().stop();
 
     if( vlc::mode_single != player().get_playback_mode() )
-        player().next();
+        playNext();
+}
+
+void JsVlcPlayer::playlistLoadProgress( unsigned addedCount, double progress )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    if( _closing )
+        return;
+
+    callCallback( CB_PlaylistLoadProgress,
+                  { Integer::NewFromUnsigned( isolate, addedCount ), Number::New( isolate, progress ) } );
+}
+
+void JsVlcPlayer::tracksChanged( const libvlc_event_t* e, void* param )
+{
+    JsVlcPlayer* jsPlayer = static_cast<JsVlcPlayer*>( param );
+    jsPlayer->postAsyncData(
+        new TracksChanged( libvlc_MediaPlayerVout == e->type ?
+                           e->u.media_player_vout.new_count : -1 ) );
+}
+
+void JsVlcPlayer::invalidateTracks()
+{
+    for( bool& valid: _tracksValid )
+        valid = false;
+}
+
+const std::vector<JsVlcPlayer::TrackDescription>&
+JsVlcPlayer::tracks( libvlc_track_type_t type )
+{
+    unsigned listIdx;
+    switch( type ) {
+        case libvlc_track_audio:
+            listIdx = AudioTracks;
+            break;
+        case libvlc_track_video:
+            listIdx = VideoTracks;
+            break;
+        default:
+            listIdx = TextTracks;
+            type = libvlc_track_text;
+            break;
+    }
+
+    std::vector<TrackDescription>& tracks = _tracks[listIdx];
+    if( _tracksValid[listIdx] )
+        return tracks;
+
+    tracks.clear();
+
+    libvlc_media_player_t* mp = player().get_mp();
+    if( !mp || _closing )
+        return tracks;
+
+    _tracksValid[listIdx] = true;
+
+    libvlc_track_description_t* rootDesc = nullptr;
+    switch( type ) {
+        case libvlc_track_audio:
+            rootDesc = libvlc_audio_get_track_description( mp );
+            break;
+        case libvlc_track_video:
+            rootDesc = libvlc_video_get_track_description( mp );
+            break;
+        default:
+            rootDesc = libvlc_video_get_spu_description( mp );
+            break;
+    }
+
+    for( libvlc_track_description_t* desc = rootDesc; desc; desc = desc->p_next ) {
+        TrackDescription track;
+        track.id = desc->i_id;
+        if( desc->psz_name )
+            track.name = desc->psz_name;
+        tracks.push_back( track );
+    }
+
+    if( rootDesc )
+        libvlc_track_description_list_release( rootDesc );
+
+    //languages are known only from media tracks
+    if( libvlc_media_t* media = libvlc_media_player_get_media( mp ) ) {
+        libvlc_media_track_t** mediaTracks = nullptr;
+        const unsigned count = libvlc_media_tracks_get( media, &mediaTracks );
+        for( unsigned i = 0; i < count; ++i ) {
+            const libvlc_media_track_t* mediaTrack = mediaTracks[i];
+            if( mediaTrack->i_type != type || !mediaTrack->psz_language )
+                continue;
+
+            for( TrackDescription& track: tracks ) {
+                if( track.id == mediaTrack->i_id ) {
+                    track.language = mediaTrack->psz_language;
+                    break;
+                }
+            }
+        }
+        if( mediaTracks )
+            libvlc_media_tracks_release( mediaTracks, count );
+        libvlc_media_release( media );
+    }
+
+    return tracks;
+}
+
+v8::Local<v8::Array> JsVlcPlayer::jsTracks( libvlc_track_type_t type )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    EscapableHandleScope scope( isolate );
+
+    const std::vector<TrackDescription>& tracks = this->tracks( type );
+
+    Local<String> idKey =
+        String::NewFromUtf8( isolate, "id", v8::String::kInternalizedString );
+    Local<String> nameKey =
+        String::NewFromUtf8( isolate, "name", v8::String::kInternalizedString );
+    Local<String> langKey =
+        String::NewFromUtf8( isolate, "lang", v8::String::kInternalizedString );
+
+    Local<Array> jsTracks = Array::New( isolate, tracks.size() );
+    for( unsigned i = 0; i < tracks.size(); ++i ) {
+        Local<Object> jsTrack = Object::New( isolate );
+        jsTrack->Set( idKey, Integer::New( isolate, tracks[i].id ) );
+        jsTrack->Set( nameKey, ToJsValue( tracks[i].name ) );
+        jsTrack->Set( langKey, ToJsValue( tracks[i].language ) );
+        jsTracks->Set( i, jsTrack );
+    }
+
+    return scope.Escape( jsTracks );
+}
+
+int JsVlcPlayer::currentItem()
+{
+    if( _closing )
+        return -1;
+
+    return _playlistStore.current();
+}
+
+void JsVlcPlayer::playlistChanged()
+{
+    _snapshot.currentItem = currentItem();
+}
+
+bool JsVlcPlayer::playItem( unsigned idx )
+{
+    if( _closing )
+        return false;
+
+    return _playlistStore.play( idx );
+}
+
+void JsVlcPlayer::playNext()
+{
+    if( _closing )
+        return;
+
+    const int idx = siblingItemIndex( 1 );
+    if( idx >= 0 )
+        _playlistStore.play( idx );
+}
+
+void JsVlcPlayer::playPrev()
+{
+    if( _closing )
+        return;
+
+    const int idx = siblingItemIndex( -1 );
+    if( idx >= 0 )
+        _playlistStore.play( idx );
+}
+
+int JsVlcPlayer::siblingItemIndex( int step )
+{
+    const int count = _playlistStore.count();
+    if( count <= 0 )
+        return -1;
+
+    int current = currentItem();
+    if( current < 0 )
+        current = step > 0 ? -1 : count;
+
+    const bool loop = vlc::mode_loop == player().get_playback_mode();
+
+    for( int i = 1; i <= count; ++i ) {
+        int idx = current + i * step;
+        if( idx < 0 || idx >= count ) {
+            if( !loop )
+                return -1;
+            idx = ( idx % count + count ) % count;
+        }
+
+        if( !_playlistStore.isDisabled( idx ) )
+            return idx;
+    }
+
+    return -1;
+}
+
+int JsVlcPlayer::nextItemIndex()
+{
+    if( vlc::mode_single == player().get_playback_mode() || currentItem() < 0 )
+        return -1;
+
+    return siblingItemIndex( 1 );
+}
+
+void JsVlcPlayer::prefetchNextItem()
+{
+    //create libvlc media for next item,
+    //so switch to it will not wait media creation
+    const int nextIdx = nextItemIndex();
+    if( nextIdx >= 0 )
+        _playlistStore.prefetch( nextIdx );
+}
+
+void JsVlcPlayer::releaseHeldFrame()
+{
+    _gaplessSwitch = _gaplessSwitchStarted = false;
+    VlcVideoOutput::releaseFrame();
+}
+
+bool JsVlcPlayer::currentMediaHasNoVideo()
+{
+    libvlc_media_player_t* mp = player().get_mp();
+    libvlc_media_t* media = mp ? libvlc_media_player_get_media( mp ) : nullptr;
+    if( !media )
+        return false;
+
+    //tracks are known if media was preparsed (see preparseNextItem())
+    libvlc_media_track_t** mediaTracks = nullptr;
+    const unsigned count = libvlc_media_tracks_get( media, &mediaTracks );
+    bool hasVideo = false;
+    for( unsigned i = 0; i < count; ++i ) {
+        if( libvlc_track_video == mediaTracks[i]->i_type )
+            hasVideo = true;
+    }
+    if( mediaTracks )
+        libvlc_media_tracks_release( mediaTracks, count );
+    libvlc_media_release( media );
+
+    return count > 0 && !hasVideo;
+}
+
+void JsVlcPlayer::preparseNextItem()
+{
+    const int nextIdx = nextItemIndex();
+    if( nextIdx < 0 || nextIdx == currentItem() )
+        return;
+
+    //next item is not prerolled (libvlc can't hand prerolled input over
+    //to playing media player), only its meta and tracks are preparsed
+    //in background (network items too). Switch itself skips stop()
+    //and reuses current frame buffer (see currentItemEndReached())
+    vlc::media media = _playlistStore.media( nextIdx );
+    if( !media.get_md() )
+        return;
+
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION( 3, 0, 0, 0 )
+    libvlc_media_parse_with_options( media.get_md(), libvlc_media_parse_network,
+                                     static_cast<int>( PREPARSE_TIME ) );
+#else
+    libvlc_media_parse_async( media.get_md() );
+#endif
 }
 
 void JsVlcPlayer::callCallback( Callbacks_e callback,
@@ -619,6 +1355,43 @@ void JsVlcPlayer::jsPlay( const v8::FunctionCallbackInfo<v8::Value>& args )
     }
 }
 
+void JsVlcPlayer::jsPlayAsync( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    using namespace v8;
+
+    JsVlcPlayer* jsPlayer = ObjectWrap::Unwrap<JsVlcPlayer>( args.Holder() );
+
+    std::string mrl;
+    if( args.Length() > 0 ) {
+        String::Utf8Value jsMrl( args[0]->ToString() );
+        if( jsMrl.length() )
+            mrl = *jsMrl;
+    }
+
+    //resume (same as play()) doesn't block,
+    //so it's just ordered with other queued commands
+    if( mrl.empty() ) {
+        args.GetReturnValue().Set(
+            jsPlayer->queueCommand(
+                CommandBlockingPart(),
+                [] ( JsVlcPlayer* jsPlayer ) {
+                    jsPlayer->play();
+                } ) );
+        return;
+    }
+
+    //only stop could block for a long time,
+    //after it playback start is cheap enough to do it on gui thread
+    args.GetReturnValue().Set(
+        jsPlayer->queueCommand(
+            [] ( libvlc_media_player_t* mp ) {
+                libvlc_media_player_stop( mp );
+            },
+            [mrl] ( JsVlcPlayer* jsPlayer ) {
+                jsPlayer->play( mrl );
+            } ) );
+}
+
 void JsVlcPlayer::getJsCallback( v8::Local<v8::String> property,
                                  const v8::PropertyCallbackInfo<v8::Value>& info,
                                  Callbacks_e callback )
@@ -658,16 +1431,25 @@ void JsVlcPlayer::setJsCallback( v8::Local<v8::String> property,
 
 bool JsVlcPlayer::playing()
 {
+    if( _closing )
+        return false;
+
     return player().is_playing();
 }
 
 double JsVlcPlayer::length()
 {
+    if( _closing )
+        return 0;
+
     return static_cast<double>( player().get_length() );
 }
 
 unsigned JsVlcPlayer::state()
 {
+    if( _closing )
+        return libvlc_Stopped;
+
     return player().get_state();
 }
 
@@ -681,98 +1463,902 @@ v8::Local<v8::Object> JsVlcPlayer::getEventEmitter()
     return v8::Local<v8::Object>::New( v8::Isolate::GetCurrent(), _jsEventEmitter );
 }
 
-unsigned JsVlcPlayer::pixelFormat()
+v8::Local<v8::Object> JsVlcPlayer::getAudioOutput()
 {
-    return static_cast<unsigned>( VlcVideoOutput::pixelFormat() );
+    return v8::Local<v8::Object>::New( v8::Isolate::GetCurrent(), _jsAudioOutput );
 }
 
-void JsVlcPlayer::setPixelFormat( unsigned format )
+void JsVlcPlayer::setAudioDataInterval( unsigned interval )
 {
-    switch( format ) {
-        case static_cast<unsigned>( PixelFormat::RV32 ):
-            VlcVideoOutput::setPixelFormat( PixelFormat::RV32 );
-            break;
-        case static_cast<unsigned>( PixelFormat::I420 ):
-            VlcVideoOutput::setPixelFormat( PixelFormat::I420 );
-            break;
-    }
+    uv_timer_stop( &_handles->audioDataTimer );
+
+    if( !interval || _closing || !_handles->audioDataTimer.data )
+        return;
+
+    _lastAudioDataCursor = _audioOutput.cursor( VlcAudioOutput::WriteCursor );
+    uv_timer_start( &_handles->audioDataTimer,
+        [] ( uv_timer_t* handle ) {
+            if( handle->data )
+                static_cast<JsVlcPlayer*>( handle->data )->checkAudioData();
+        }, interval, interval );
+}
+
+void JsVlcPlayer::checkAudioData()
+{
+    using namespace v8;
+
+    const uint32_t writeCursor = _audioOutput.cursor( VlcAudioOutput::WriteCursor );
+    if( _closing || writeCursor == _lastAudioDataCursor )
+        return;
+
+    _lastAudioDataCursor = writeCursor;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    const uint32_t unread = writeCursor - _audioOutput.cursor( VlcAudioOutput::ReadCursor );
+    callCallback( CB_AudioData, { Integer::NewFromUnsigned( isolate, unread ) } );
+}
+
+void JsVlcPlayer::setAudioLevelsInterval( unsigned interval )
+{
+    uv_timer_stop( &_handles->audioLevelsTimer );
+
+    if( !interval || _closing || !_handles->audioLevelsTimer.data )
+        return;
+
+    _lastAudioLevelsSequence = _audioOutput.levelsSequence();
+    uv_timer_start( &_handles->audioLevelsTimer,
+        [] ( uv_timer_t* handle ) {
+            if( handle->data )
+                static_cast<JsVlcPlayer*>( handle->data )->checkAudioLevels();
+        }, interval, interval );
+}
+
+void JsVlcPlayer::checkAudioLevels()
+{
+    using namespace v8;
+
+    const unsigned sequence = _audioOutput.levelsSequence();
+    if( _closing || sequence == _lastAudioLevelsSequence )
+        return;
+
+    _lastAudioLevelsSequence = sequence;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    JsVlcAudioOutput* jsAudioOutput =
+        ObjectWrap::Unwrap<JsVlcAudioOutput>( getAudioOutput() );
+    callCallback( CB_AudioLevels, { jsAudioOutput->levels() } );
+}
+
+unsigned JsVlcPlayer::pixelFormat()
+{
+    return static_cast<unsigned>( VlcVideoOutput::pixelFormat() );
+}
+
+void JsVlcPlayer::setPixelFormat( unsigned format )
+{
+    switch( format ) {
+        case static_cast<unsigned>( PixelFormat::RV32 ):
+            VlcVideoOutput::setPixelFormat( PixelFormat::RV32 );
+            break;
+        case static_cast<unsigned>( PixelFormat::I420 ):
+            VlcVideoOutput::setPixelFormat( PixelFormat::I420 );
+            break;
+    }
 }
 
 double JsVlcPlayer::position()
 {
+    if( _closing )
+        return 0;
+
     return player().get_position();
 }
 
 void JsVlcPlayer::setPosition( double position )
 {
-    player().set_position( static_cast<float>( position ) );
+    if( _closing )
+        return;
+
+    endScan( false );
+
+    const libvlc_time_t length = player().get_length();
+    if( length > 0 ) {
+        cancelAccurateSeek();
+        scheduleSeek( static_cast<libvlc_time_t>( position * length ) );
+    } else {
+        frameCache().clear();
+        _viewedFrame = 0;
+        _frameTime = -1;
+        player().set_position( static_cast<float>( position ) );
+    }
 }
 
 double JsVlcPlayer::time()
 {
+    if( _closing )
+        return 0;
+
     return static_cast<double>( player().get_time() );
 }
 
 void JsVlcPlayer::setTime( double time )
 {
-    player().set_time( static_cast<libvlc_time_t>( time ) );
+    if( _closing )
+        return;
+
+    endScan( false );
+    cancelAccurateSeek();
+    scheduleSeek( static_cast<libvlc_time_t>( time ) );
 }
 
 unsigned JsVlcPlayer::volume()
 {
+    if( _closing )
+        return 0;
+
     return player().audio().get_volume();
 }
 
 void JsVlcPlayer::setVolume( unsigned volume )
 {
+    if( _closing )
+        return;
+
     player().audio().set_volume( volume );
 }
 
 bool JsVlcPlayer::muted()
 {
+    if( _closing )
+        return false;
+
     return player().audio().is_muted();
 }
 
 void JsVlcPlayer::setMuted( bool mute )
 {
+    if( _closing )
+        return;
+
     player().audio().set_mute( mute );
 }
 
 void JsVlcPlayer::play()
 {
-    player().play();
+    if( _closing )
+        return;
+
+    //playback continues from last scan position
+    if( _scanSpeed ) {
+        _scanResume = true;
+        endScan( true );
+        return;
+    }
+
+    if( currentItem() < 0 && _playlistStore.count() ) {
+        //nothing is materialized yet
+        const int idx = siblingItemIndex( 1 );
+        if( idx >= 0 )
+            _playlistStore.play( idx );
+    } else
+        player().play();
 }
 
 void JsVlcPlayer::play( const std::string& mrl )
 {
-    vlc::player& p = player();
+    if( _closing )
+        return;
 
-    p.clear_items();
-    const int idx = p.add_media( mrl.c_str() );
+    _playlistStore.clear();
+    playlistChanged();
+    const int idx = _playlistStore.add( mrl );
     if( idx >= 0 )
-        p.play( idx );
+        _playlistStore.play( idx );
 }
 
 void JsVlcPlayer::pause()
 {
+    if( _closing )
+        return;
+
+    //player is already paused while scanning
+    endScan( false );
     player().pause();
 }
 
 void JsVlcPlayer::togglePause()
 {
+    if( _closing )
+        return;
+
+    //scan looks like playback if it was started while playing
+    if( _scanSpeed ) {
+        _scanResume = !_scanResume;
+        endScan( true );
+        return;
+    }
+
     player().togglePause();
 }
 
 void JsVlcPlayer::stop()
 {
+    if( _closing )
+        return;
+
+    resetPlaybackState();
+    _playlistStore.interruptInputs();
     player().stop();
 }
 
+void JsVlcPlayer::resetPlaybackState()
+{
+    endScan( false );
+    cancelAccurateSeek();
+    resetScheduledSeeks();
+    frameCache().clear();
+    _viewedFrame = 0;
+}
+
 void JsVlcPlayer::toggleMute()
 {
+    if( _closing )
+        return;
+
     player().audio().toggle_mute();
 }
 
+v8::Local<v8::Value> JsVlcPlayer::stopAsync()
+{
+    _playlistStore.interruptInputs();
+
+    return queueCommand(
+        [] ( libvlc_media_player_t* mp ) {
+            libvlc_media_player_stop( mp );
+        },
+        //player is already stopped, so only gui side state is reset,
+        //stop() here could cancel playback started by next queued command
+        [] ( JsVlcPlayer* jsPlayer ) {
+            jsPlayer->resetPlaybackState();
+        },
+        true );
+}
+
+v8::Local<v8::Value> JsVlcPlayer::seekAsync( double time )
+{
+    const libvlc_time_t newTime = static_cast<libvlc_time_t>( time );
+
+    return queueCommand(
+        [newTime] ( libvlc_media_player_t* mp ) {
+            libvlc_media_player_set_time( mp, newTime );
+        },
+        CommandCompletePart() );
+}
+
+double JsVlcPlayer::seek( double time, v8::Local<v8::Value> options )
+{
+    if( _closing )
+        return -1;
+
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    bool accurate = true;
+    if( options->IsObject() ) {
+        Local<Value> jsMode =
+            Local<Object>::Cast( options )->Get(
+                String::NewFromUtf8( isolate, "mode", v8::String::kInternalizedString ) );
+        if( jsMode->IsString() )
+            accurate = "keyframe" != FromJsValue<std::string>( jsMode );
+    }
+
+    endScan( false );
+    cancelAccurateSeek();
+
+    const libvlc_state_t state = player().get_state();
+    if( !_keyframeIndex || ( libvlc_Playing != state && libvlc_Paused != state ) ) {
+        //without index it's up to libvlc
+        scheduleSeek( static_cast<libvlc_time_t>( time ) );
+        _frameTime = -1;
+        return time;
+    }
+
+    const KeyframeIndex& index = *_keyframeIndex;
+
+    if( !accurate ) {
+        const Keyframe& keyframe =
+            index.keyframes()[index.nearest( static_cast<int64_t>( time * 1000 ) )];
+        scheduleSeek( static_cast<libvlc_time_t>( keyframe.time / 1000 ) );
+        _frameTime = static_cast<double>( keyframe.time / 1000 );
+        return _frameTime;
+    }
+
+    return accurateSeek( time, libvlc_Playing == state );
+}
+
+double JsVlcPlayer::accurateSeek( double time, bool resume )
+{
+    //accurate seek is not coalesced, it replaces pending seeks
+    resetScheduledSeeks();
+    frameCache().clear();
+    _viewedFrame = 0;
+
+    const KeyframeIndex& index = *_keyframeIndex;
+    const int64_t target = static_cast<int64_t>( time * 1000 );
+
+    const Keyframe& keyframe = index.keyframes()[index.floor( target )];
+    const libvlc_time_t keyframeTime = static_cast<libvlc_time_t>( keyframe.time / 1000 );
+    //frame time reported to js is only estimated, frames are picked by their time
+    const int64_t frameDuration = index.frameDuration();
+    const int64_t skip =
+        frameDuration > 0 && target > keyframe.time ?
+            ( target - keyframe.time + frameDuration / 2 ) / frameDuration : 0;
+
+    const libvlc_time_t fromTime = static_cast<libvlc_time_t>( _snapshot.time );
+    player().set_time( keyframeTime );
+    _frameTime = static_cast<double>( ( keyframe.time + skip * frameDuration ) / 1000 );
+    if( 0 == skip )
+        return _frameTime;
+
+    //frames after keyframe are decoded one by one (by next_frame) while paused,
+    //and only target frame is delivered to js
+    _resumeAfterSeek = resume;
+    if( _resumeAfterSeek )
+        player().pause();
+
+    _accurateSeekTarget = time;
+    _accurateSeekKeyframe = keyframeTime;
+    _accurateSeekFromTime = fromTime;
+    _accurateSeekLanded = false;
+    _accurateSeekIssuedFrame = VlcVideoOutput::displayedFrames();
+    _accurateSeekLandedFrame = 0;
+    _accurateSeekPlayerTime = -1;
+    _accurateSeekFrameTime = static_cast<double>( keyframeTime );
+    startSeekTimeout( time );
+
+    return _frameTime;
+}
+
+void JsVlcPlayer::accurateSeekTimeChanged( libvlc_time_t time, uint64_t displayedFrames )
+{
+    if( _accurateSeekTarget < 0 || _accurateSeekLanded )
+        return;
+
+    //seek took effect when reported time is near keyframe
+    //(and is closer to it than to time before seek)
+    const libvlc_time_t distance = std::abs( time - _accurateSeekKeyframe );
+    if( distance > ACCURATE_SEEK_TOLERANCE || distance > std::abs( time - _accurateSeekFromTime ) )
+        return;
+
+    _accurateSeekLanded = true;
+    _accurateSeekLandedFrame = displayedFrames;
+
+    //keyframe was displayed (and dropped) before event was delivered,
+    //and nothing will be decoded while paused without next_frame
+    if( displayedFrames > _accurateSeekIssuedFrame &&
+        VlcVideoOutput::displayedFrames() == displayedFrames )
+    {
+        libvlc_media_player_next_frame( player().get_mp() );
+    }
+}
+
+void JsVlcPlayer::decodeForward( unsigned count, double fallbackTime )
+{
+    _skipFrames = count;
+    startSeekTimeout( fallbackTime );
+}
+
+void JsVlcPlayer::startSeekTimeout( double fallbackTime )
+{
+    _seekTarget = fallbackTime;
+
+    uv_timer_start( &_handles->seekTimer,
+        [] ( uv_timer_t* handle ) {
+            if( !handle->data )
+                return;
+
+            JsVlcPlayer* jsPlayer = static_cast<JsVlcPlayer*>( handle->data );
+            const double target = jsPlayer->_seekTarget;
+            const bool resume = jsPlayer->_resumeAfterSeek;
+            jsPlayer->cancelAccurateSeek();
+            if( target >= 0 ) {
+                jsPlayer->frameCache().clear();
+                jsPlayer->_viewedFrame = 0;
+                jsPlayer->player().set_time( static_cast<libvlc_time_t>( target ) );
+            }
+            if( resume )
+                jsPlayer->player().play();
+        }, ACCURATE_SEEK_TIMEOUT, 0 );
+}
+
+void JsVlcPlayer::stepFrame( int count )
+{
+    if( _closing )
+        return;
+
+    const libvlc_state_t state = player().get_state();
+    if( !count || ( libvlc_Playing != state && libvlc_Paused != state ) )
+        return;
+
+    endScan( false );
+    cancelAccurateSeek();
+    resetScheduledSeeks();
+    if( libvlc_Playing == state )
+        player().pause();
+
+    const double frameTime = _frameTime >= 0 ? _frameTime : time();
+    _frameTime = std::max( 0., frameTime + count * frameDuration() );
+
+    const uint64_t lastFrame = frameCache().lastSerial();
+    const uint64_t viewedFrame = _viewedFrame ? _viewedFrame : lastFrame;
+
+    if( count < 0 ) {
+        const uint64_t steps = static_cast<uint64_t>( -static_cast<int64_t>( count ) );
+        if( viewedFrame > steps && showCachedFrame( viewedFrame - steps ) )
+            return;
+
+        //out of cache: seek to preceding keyframe and decode forward silently
+        if( _keyframeIndex ) {
+            accurateSeek( _frameTime, false );
+        } else {
+            frameCache().clear();
+            _viewedFrame = 0;
+            player().set_time( static_cast<libvlc_time_t>( _frameTime ) );
+        }
+        return;
+    }
+
+    //frames decoded after viewed one could be still in cache,
+    //if target one isn't, nothing is shown until it's decoded
+    const uint64_t target = viewedFrame + count;
+    if( viewedFrame && target <= lastFrame && showCachedFrame( target ) )
+        return;
+
+    const uint64_t decodeCount = lastFrame && target > lastFrame ? target - lastFrame : count;
+    libvlc_media_player_next_frame( player().get_mp() );
+    decodeForward( static_cast<unsigned>( decodeCount ), -1 );
+}
+
+bool JsVlcPlayer::showCachedFrame( uint64_t serial )
+{
+    using namespace v8;
+
+    if( _jsFrameBuffer.IsEmpty() || !restoreCachedFrame( serial ) )
+        return false;
+
+    _viewedFrame = serial;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    callCallback( CB_FrameReady, { Local<Value>::New( isolate, _jsFrameBuffer ) } );
+
+    return true;
+}
+
+double JsVlcPlayer::frameDuration()
+{
+    if( _keyframeIndex && _keyframeIndex->frameDuration() > 0 )
+        return _keyframeIndex->frameDuration() / 1000.;
+
+    const float fps = libvlc_media_player_get_fps( player().get_mp() );
+
+    return fps > 0 ? 1000. / fps : DEFAULT_FRAME_DURATION;
+}
+
+void JsVlcPlayer::scan( double speed, v8::Local<v8::Value> options )
+{
+    if( _closing )
+        return;
+
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    const double absSpeed = fabs( speed );
+    if( absSpeed < MIN_SCAN_SPEED ) {
+        stopScan();
+        return;
+    }
+
+    unsigned fps = DEFAULT_SCAN_FPS;
+    if( options->IsObject() ) {
+        Local<Value> jsFps =
+            Local<Object>::Cast( options )->Get(
+                String::NewFromUtf8( isolate, "fps", v8::String::kInternalizedString ) );
+        if( jsFps->IsNumber() )
+            fps = std::min( std::max( 1u, FromJsValue<unsigned>( jsFps ) ), MAX_SCAN_FPS );
+    }
+
+    const libvlc_state_t state = player().get_state();
+    if( !_scanSpeed ) {
+        if( libvlc_Playing != state && libvlc_Paused != state )
+            return;
+
+        cancelAccurateSeek();
+
+        //nothing is decoded between seeks
+        _scanResume = libvlc_Playing == state;
+        if( _scanResume )
+            player().pause();
+        _scanUnmute = !player().audio().is_muted();
+        if( _scanUnmute )
+            player().audio().set_mute( true );
+    }
+
+    //speed change continues from last shown position
+    _scanStartTime = _scanLastTime >= 0 ? _scanLastTime : time();
+    _scanStartClock = uv_now( uv_default_loop() );
+    _scanSpeed = copysign( std::min( absSpeed, MAX_SCAN_SPEED ), speed );
+
+    uv_timer_start( &_handles->scanTimer,
+        [] ( uv_timer_t* handle ) {
+            if( handle->data )
+                static_cast<JsVlcPlayer*>( handle->data )->scanStep();
+        }, 0, 1000 / fps );
+}
+
+void JsVlcPlayer::stopScan()
+{
+    if( _closing )
+        return;
+
+    endScan( true );
+}
+
+void JsVlcPlayer::endScan( bool restorePlayback )
+{
+    if( !_scanSpeed )
+        return;
+
+    uv_timer_stop( &_handles->scanTimer );
+    _scanSpeed = 0;
+
+    //pending scan seek shouldn't be issued after scan
+    resetScheduledSeeks();
+
+    if( _scanUnmute )
+        player().audio().set_mute( false );
+
+    //playback continues from last shown frame
+    if( restorePlayback && _scanResume ) {
+        if( _scanLastTime >= 0 )
+            player().set_time( static_cast<libvlc_time_t>( _scanLastTime ) );
+        player().play();
+    }
+
+    _scanLastTime = -1;
+    _scanResume = _scanUnmute = false;
+}
+
+void JsVlcPlayer::scanStep()
+{
+    //decoder is slower than requested fps, so this frame is skipped
+    if( _seekScheduler.inFlight() )
+        return;
+
+    const double elapsed = static_cast<double>( uv_now( uv_default_loop() ) - _scanStartClock );
+    const libvlc_time_t length = player().get_length();
+
+    double target = _scanStartTime + _scanSpeed * elapsed;
+    const bool bound = target <= 0 || ( length > 0 && target >= length );
+    if( bound )
+        target = std::max( 0., std::min( target, static_cast<double>( length ) ) );
+
+    //only keyframes are decoded (if index is available),
+    //so decode cost doesn't depend on scan speed
+    double time = target;
+    if( _keyframeIndex ) {
+        const Keyframe& keyframe =
+            _keyframeIndex->keyframes()[_keyframeIndex->floor( static_cast<int64_t>( target * 1000 ) )];
+        time = static_cast<double>( keyframe.time / 1000 );
+    }
+
+    if( bound ) {
+        //scan stops (paused) at media bounds,
+        //bound is sought directly since endScan() drops scheduled seeks
+        endScan( false );
+        issueSeek( static_cast<libvlc_time_t>( time ) );
+        return;
+    }
+
+    if( time != _scanLastTime ) {
+        _scanLastTime = time;
+        scheduleSeek( static_cast<libvlc_time_t>( time ) );
+    }
+}
+
+double JsVlcPlayer::scanSpeed()
+{
+    return _scanSpeed;
+}
+
+double JsVlcPlayer::frameCacheLimit()
+{
+    return static_cast<double>( frameCache().limit() );
+}
+
+void JsVlcPlayer::setFrameCacheLimit( double limit )
+{
+    frameCache().setLimit( limit > 0 ? static_cast<size_t>( limit ) : 0 );
+}
+
+v8::Local<v8::Object> JsVlcPlayer::frameCacheStats()
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    EscapableHandleScope scope( isolate );
+
+    Local<Object> jsStats = Object::New( isolate );
+    jsStats->Set( String::NewFromUtf8( isolate, "limit", v8::String::kInternalizedString ),
+                  Number::New( isolate, static_cast<double>( frameCache().limit() ) ) );
+    jsStats->Set( String::NewFromUtf8( isolate, "usedBytes", v8::String::kInternalizedString ),
+                  Number::New( isolate, static_cast<double>( frameCache().usedBytes() ) ) );
+    jsStats->Set( String::NewFromUtf8( isolate, "frames", v8::String::kInternalizedString ),
+                  Integer::NewFromUnsigned( isolate, frameCache().frameCount() ) );
+
+    return scope.Escape( jsStats );
+}
+
+void JsVlcPlayer::cancelAccurateSeek()
+{
+    if( !_skipFrames && _accurateSeekTarget < 0 )
+        return;
+
+    _skipFrames = 0;
+    _accurateSeekTarget = -1;
+    _resumeAfterSeek = false;
+    uv_timer_stop( &_handles->seekTimer );
+}
+
+bool JsVlcPlayer::skipDecodedFrame()
+{
+    if( _accurateSeekTarget >= 0 ) {
+        //frame from position before seek
+        if( !_accurateSeekLanded ||
+            VlcVideoOutput::displayedFrames() <= _accurateSeekLandedFrame )
+        {
+            return true;
+        }
+
+        //vmem doesn't provide frame timestamps, so frame time is player time
+        //(updated by libvlc while frames are stepped), if it's not updated
+        //since previous frame, frame is assumed to follow previous one
+        const libvlc_time_t playerTime = player().get_time();
+        if( playerTime != _accurateSeekPlayerTime ) {
+            _accurateSeekPlayerTime = playerTime;
+            _accurateSeekFrameTime = static_cast<double>( playerTime );
+        } else
+            _accurateSeekFrameTime += frameDuration();
+
+        if( _accurateSeekFrameTime + frameDuration() / 2 < _accurateSeekTarget ) {
+            libvlc_media_player_next_frame( player().get_mp() );
+            return true;
+        }
+
+        _frameTime = _accurateSeekFrameTime;
+        _accurateSeekTarget = -1;
+    } else {
+        if( !_skipFrames )
+            return false;
+
+        --_skipFrames;
+        if( _skipFrames ) {
+            libvlc_media_player_next_frame( player().get_mp() );
+            return true;
+        }
+    }
+
+    //target frame is reached
+    uv_timer_stop( &_handles->seekTimer );
+    if( _resumeAfterSeek ) {
+        _resumeAfterSeek = false;
+        player().play();
+    }
+
+    return false;
+}
+
+void JsVlcPlayer::scheduleSeek( libvlc_time_t time )
+{
+    //audio only seeks are cheap, and there is no frame to wait for
+    if( !libvlc_media_player_has_vout( player().get_mp() ) ) {
+        resetScheduledSeeks();
+        player().set_time( time );
+        return;
+    }
+
+    const int64_t currentTime = static_cast<int64_t>( _snapshot.time );
+    if( _seekScheduler.request( time, currentTime, uv_hrtime() / 1e6 ) )
+        issueSeek( time );
+}
+
+void JsVlcPlayer::issueSeek( libvlc_time_t time )
+{
+    frameCache().clear();
+    _viewedFrame = 0;
+    _frameTime = -1;
+
+    player().set_time( time );
+
+    startScheduledSeekTimer( SCHEDULED_SEEK_TIMEOUT );
+}
+
+void JsVlcPlayer::startScheduledSeekTimer( uint64_t timeout )
+{
+    uv_timer_start( &_handles->scheduledSeekTimer,
+        [] ( uv_timer_t* handle ) {
+            if( handle->data )
+                static_cast<JsVlcPlayer*>( handle->data )->scheduledSeekDone( true );
+        }, timeout, 0 );
+}
+
+void JsVlcPlayer::scheduledSeekDone( bool timedOut )
+{
+    uv_timer_stop( &_handles->scheduledSeekTimer );
+
+    int64_t time;
+    if( _seekScheduler.completed( uv_hrtime() / 1e6, timedOut, &time ) )
+        issueSeek( static_cast<libvlc_time_t>( time ) );
+}
+
+void JsVlcPlayer::resetScheduledSeeks()
+{
+    _seekScheduler.reset();
+    uv_timer_stop( &_handles->scheduledSeekTimer );
+}
+
+v8::Local<v8::Object> JsVlcPlayer::seekStats()
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    EscapableHandleScope scope( isolate );
+
+    Local<Object> jsStats = Object::New( isolate );
+    jsStats->Set( String::NewFromUtf8( isolate, "seeks", v8::String::kInternalizedString ),
+                  Integer::NewFromUnsigned( isolate, _seekScheduler.seekCount() ) );
+    jsStats->Set( String::NewFromUtf8( isolate, "coalesced", v8::String::kInternalizedString ),
+                  Integer::NewFromUnsigned( isolate, _seekScheduler.coalescedCount() ) );
+    jsStats->Set( String::NewFromUtf8( isolate, "timeouts", v8::String::kInternalizedString ),
+                  Integer::NewFromUnsigned( isolate, _seekScheduler.timeoutCount() ) );
+    jsStats->Set( String::NewFromUtf8( isolate, "lastLatency", v8::String::kInternalizedString ),
+                  Number::New( isolate, _seekScheduler.lastLatency() ) );
+    jsStats->Set( String::NewFromUtf8( isolate, "averageLatency", v8::String::kInternalizedString ),
+                  Number::New( isolate, _seekScheduler.averageLatency() ) );
+    jsStats->Set( String::NewFromUtf8( isolate, "maxLatency", v8::String::kInternalizedString ),
+                  Number::New( isolate, _seekScheduler.maxLatency() ) );
+
+    return scope.Escape( jsStats );
+}
+
+void JsVlcPlayer::updateKeyframeIndex()
+{
+    _keyframeIndex.reset();
+    const unsigned request = ++_keyframeIndexRequest;
+
+    const int idx = currentItem();
+    if( idx < 0 )
+        return;
+
+    //only local files have container index accessible without libvlc
+    const std::string path = MetaCache::localPath( _playlistStore.mrl( idx ) );
+    if( path.empty() )
+        return;
+
+    if( !_indexQueue )
+        _indexQueue.reset( new ThreadPool( 1 ) );
+
+    _indexQueue->post(
+        [this, request, path] () {
+            postAsyncData( new KeyframeIndexReady( request, KeyframeIndex::get( path ) ) );
+        } );
+}
+
+v8::Local<v8::Value> JsVlcPlayer::queueCommand( const CommandBlockingPart& blockingPart,
+                                                const CommandCompletePart& completePart,
+                                                bool waitStopped )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    EscapableHandleScope scope( isolate );
+
+    Local<Promise::Resolver> resolver = Promise::Resolver::New( isolate );
+
+    if( _closing ) {
+        //player is already closed
+        resolver->Reject(
+            Exception::Error( String::NewFromUtf8( isolate, "Player is closed" ) ) );
+        return scope.Escape( resolver->GetPromise() );
+    }
+
+    const unsigned commandId = ++_lastCommandId;
+    _pendingCommands[commandId].Reset( isolate, resolver );
+
+    if( !_commandQueue )
+        _commandQueue.reset( new ThreadPool( 1 ) );
+
+    libvlc_media_player_t* mp = player().get_mp();
+    _commandQueue->post(
+        [this, mp, commandId, blockingPart, completePart, waitStopped] () {
+            if( blockingPart )
+                blockingPart( mp );
+
+            postAsyncData( new CommandCompleted( commandId, completePart, waitStopped ) );
+        } );
+
+    return scope.Escape( resolver->GetPromise() );
+}
+
+void JsVlcPlayer::commandCompleted( unsigned commandId )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    auto it = _pendingCommands.find( commandId );
+    if( it == _pendingCommands.end() )
+        return;
+
+    Local<Promise::Resolver> resolver = Local<Promise::Resolver>::New( isolate, it->second );
+    _pendingCommands.erase( it );
+
+    resolver->Resolve( snapshot() );
+}
+
+void JsVlcPlayer::rejectPendingCommands()
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    std::map<unsigned, v8::UniquePersistent<v8::Promise::Resolver> > pendingCommands;
+    pendingCommands.swap( _pendingCommands );
+    _stopCommands.clear();
+
+    for( auto& command: pendingCommands ) {
+        Local<Promise::Resolver> resolver =
+            Local<Promise::Resolver>::New( isolate, command.second );
+        resolver->Reject(
+            Exception::Error( String::NewFromUtf8( isolate, "Player is closed" ) ) );
+    }
+}
+
+v8::Local<v8::Object> JsVlcPlayer::snapshot()
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    EscapableHandleScope scope( isolate );
+
+    Local<Object> jsSnapshot = Object::New( isolate );
+    jsSnapshot->Set( String::NewFromUtf8( isolate, "state", v8::String::kInternalizedString ),
+                     Integer::New( isolate, _snapshot.state ) );
+    jsSnapshot->Set( String::NewFromUtf8( isolate, "playing", v8::String::kInternalizedString ),
+                     Boolean::New( isolate, libvlc_Playing == _snapshot.state ) );
+    jsSnapshot->Set( String::NewFromUtf8( isolate, "time", v8::String::kInternalizedString ),
+                     Number::New( isolate, _snapshot.time ) );
+    jsSnapshot->Set( String::NewFromUtf8( isolate, "position", v8::String::kInternalizedString ),
+                     Number::New( isolate, _snapshot.position ) );
+    jsSnapshot->Set( String::NewFromUtf8( isolate, "length", v8::String::kInternalizedString ),
+                     Number::New( isolate, _snapshot.length ) );
+    jsSnapshot->Set( String::NewFromUtf8( isolate, "currentItem", v8::String::kInternalizedString ),
+                     Integer::New( isolate, _snapshot.currentItem ) );
+
+    return scope.Escape( jsSnapshot );
+}
+
 v8::Local<v8::Object> JsVlcPlayer::input()
 {
     return v8::Local<v8::Object>::New( v8::Isolate::GetCurrent(), _jsInput );
@@ -797,3 +2383,16 @@ v8::Local<v8::Object> JsVlcPlayer::playlist()
 {
     return v8::Local<v8::Object>::New( v8::Isolate::GetCurrent(), _jsPlaylist );
 }
+
+bool JsVlcPlayer::gapless()
+{
+    return _gapless;
+}
+
+void JsVlcPlayer::setGapless( bool gapless )
+{
+    _gapless = gapless;
+
+    if( !_gapless && _gaplessSwitch )
+        releaseHeldFrame();
+}
@@ -3,6 +3,9 @@
 #include <memory>
 #include <deque>
 #include <set>
+#include <map>
+#include <vector>
+#include <functional>
 
 #include <v8.h>
 #include <node.h>
@@ -13,6 +16,11 @@
 #include <libvlc_wrapper/vlc_vmem.h>
 
 #include "VlcVideoOutput.h"
+#include "VlcAudioOutput.h"
+#include "ThreadPool.h"
+#include "PlaylistStore.h"
+#include "KeyframeIndex.h"
+#include "SeekScheduler.h"
 
 class JsVlcPlayer :
     public node::ObjectWrap,
@@ -42,6 +50,11 @@ class JsVlcPlayer :
         CB_MediaPlayerPausableChanged,
         CB_MediaPlayerLengthChanged,
 
+        CB_PlaylistLoadProgress,
+
+        CB_AudioData,
+        CB_AudioLevels,
+
         CB_Max,
     };
 
@@ -51,6 +64,7 @@ public:
     static void initJsApi( const v8::Handle<v8::Object>& exports );
 
     static void jsPlay( const v8::FunctionCallbackInfo<v8::Value>& args );
+    static void jsPlayAsync( const v8::FunctionCallbackInfo<v8::Value>& args );
 
     static void getJsCallback( v8::Local<v8::String> property,
                                const v8::PropertyCallbackInfo<v8::Value>& info,
@@ -66,6 +80,7 @@ public:
 
     v8::Local<v8::Value> getVideoFrame();
     v8::Local<v8::Object> getEventEmitter();
+    v8::Local<v8::Object> getAudioOutput();
 
     unsigned pixelFormat();
     void setPixelFormat( unsigned );
@@ -74,6 +89,8 @@ public:
     void setPosition( double );
 
     double time();
+    //seeks are coalesced while previous one didn't produce frame yet
+    //(if there is no vout, seek is issued immediately)
     void setTime( double );
 
     unsigned volume();
@@ -88,6 +105,58 @@ public:
     void togglePause();
     void stop();
     void toggleMute();
+    //gui side part of stop(), doesn't touch libvlc
+    void resetPlaybackState();
+
+    //detaches player from js immediately,
+    //libvlc teardown is done on player's command thread
+    v8::Local<v8::Value> closeAsync();
+
+    v8::Local<v8::Value> stopAsync();
+    v8::Local<v8::Value> seekAsync( double time );
+
+    //seek( time, { mode: "keyframe" | "accurate" } ), uses keyframe index of local files:
+    //"keyframe" lands on nearest keyframe, "accurate" decodes forward from
+    //preceding keyframe without delivering intermediate frames.
+    //Returns time (in ms) player will land on, or -1 if player is closed.
+    double seek( double time, v8::Local<v8::Value> options );
+
+    //pauses and steps count frames forward (count > 0) or backward (count < 0).
+    //Steps within frame cache are instant, backward steps out of it
+    //seek to keyframe and decode forward silently.
+    void stepFrame( int count );
+
+    //scan( speed, { fps } ): trick play, player is paused and seeks
+    //keyframe to keyframe fps times per second, with audio muted.
+    //Negative speed scans backward, |speed| < 2 stops scan.
+    void scan( double speed, v8::Local<v8::Value> options );
+    //restores audio and playback (from last shown frame)
+    void stopScan();
+    //0 if player is not scanning
+    double scanSpeed();
+
+    //frame cache limit in bytes, 0 (default) - disabled
+    double frameCacheLimit();
+    void setFrameCacheLimit( double );
+    //{ limit, usedBytes, frames }
+    v8::Local<v8::Object> frameCacheStats();
+
+    //blockingPart is executed on player's command thread,
+    //and after that completePart is executed on gui thread.
+    //Returns promise resolved with state snapshot when command is done
+    //(with waitStopped - when player reported stopped state),
+    //or rejected if player is closed before that.
+    typedef std::function<void( libvlc_media_player_t* )> CommandBlockingPart;
+    typedef std::function<void( JsVlcPlayer* )> CommandCompletePart;
+    v8::Local<v8::Value> queueCommand( const CommandBlockingPart& blockingPart,
+                                       const CommandCompletePart& completePart,
+                                       bool waitStopped = false );
+
+    //cached player state, doesn't call libvlc
+    v8::Local<v8::Object> snapshot();
+
+    //{ seeks, coalesced, timeouts, lastLatency, averageLatency, maxLatency }, latencies in ms
+    v8::Local<v8::Object> seekStats();
 
     v8::Local<v8::Object> input();
     v8::Local<v8::Object> audio();
@@ -95,9 +164,59 @@ public:
     v8::Local<v8::Object> subtitles();
     v8::Local<v8::Object> playlist();
 
+    //in gapless mode playlist switches to next item without stop(),
+    //so frame buffer is reused if geometry matches (no black frame).
+    //Next item is only preparsed, its input is not prerolled
+    bool gapless();
+    void setGapless( bool );
+
+    //emits PlaylistLoadProgress( addedCount, progress ) event
+    void playlistLoadProgress( unsigned addedCount, double progress );
+
+    VlcAudioOutput& audioOutput()
+        { return _audioOutput; }
+    //AudioData( unreadFrames ) event is emitted not more often than
+    //once per interval (in ms) if new audio was written. 0 - disabled.
+    void setAudioDataInterval( unsigned interval );
+    //AudioLevels( levels ) event is emitted not more often than
+    //once per interval (in ms) if levels were updated. 0 - disabled.
+    void setAudioLevelsInterval( unsigned interval );
+
+    struct TrackDescription
+    {
+        int id;
+        std::string name;
+        std::string language;
+    };
+
+    //cached libvlc track descriptions (audio, video or text),
+    //invalidated on media change and elementary streams events.
+    //Track count is size of this list ("Disable" entry included)
+    const std::vector<TrackDescription>& tracks( libvlc_track_type_t );
+    //array of { id, name, lang }
+    v8::Local<v8::Array> jsTracks( libvlc_track_type_t );
+
     vlc::player& player()
         { return _player; }
 
+    //true since close is requested, libvlc should not be touched anymore
+    bool closing() const
+        { return _closing; }
+
+    //all playlist access should go through store,
+    //since vlc::player contains only materialized items
+    PlaylistStore& playlistStore()
+        { return _playlistStore; }
+
+    //store index of current item or -1
+    int currentItem();
+    //should be called after items are removed or moved,
+    //since index of current item could be changed
+    void playlistChanged();
+    bool playItem( unsigned idx );
+    void playNext();
+    void playPrev();
+
 private:
     static void jsCreate( const v8::FunctionCallbackInfo<v8::Value>& args );
     JsVlcPlayer( v8::Local<v8::Object>& thisObject, const v8::Local<v8::Array>& vlcOpts );
@@ -106,20 +225,91 @@ private:
     struct AsyncData;
     struct CallbackData;
     struct LibvlcEvent;
+    struct CommandCompleted;
+    struct CloseCompleted;
+    struct TracksChanged;
+    struct KeyframeIndexReady;
+
+    struct StateSnapshot
+    {
+        StateSnapshot() :
+            state( libvlc_NothingSpecial ), time( 0 ), position( 0 ), length( 0 ),
+            currentItem( -1 ) {}
+
+        libvlc_state_t state;
+        double time;
+        double position;
+        double length;
+        int currentItem;
+    };
 
     static void closeAll();
     void initLibvlc( const v8::Local<v8::Array>& vlcOpts );
     void close();
+    void closeLibvlc(); //could be called from any thread
+    void closeHandles();
 
+    void postAsyncData( AsyncData* );
     void handleAsync();
 
+    void commandCompleted( unsigned commandId );
+    void rejectPendingCommands();
+
     //could come from worker thread
     void media_player_event( const libvlc_event_t* );
 
-    void handleLibvlcEvent( const libvlc_event_t& );
+    //displayedFrames is count of frames displayed before event was emitted
+    void handleLibvlcEvent( const libvlc_event_t&, uint64_t displayedFrames );
+
+    //could come from worker thread
+    static void tracksChanged( const libvlc_event_t*, void* );
+    void invalidateTracks();
 
     void currentItemEndReached();
 
+    void checkAudioData();
+    void checkAudioLevels();
+
+    //index of next/previous (step > 0 / step < 0) enabled item
+    //according to loop mode, or -1
+    int siblingItemIndex( int step );
+    int nextItemIndex();
+    void prefetchNextItem();
+    void preparseNextItem();
+    //releases frame held for gapless switch
+    void releaseHeldFrame();
+    //false if tracks of current media are not known yet
+    bool currentMediaHasNoVideo();
+
+    //builds keyframe index of current item in background
+    void updateKeyframeIndex();
+    void cancelAccurateSeek();
+    //returns time (in ms) of target frame
+    double accurateSeek( double time, bool resume );
+    //only last of count frames decoded from now is delivered to js;
+    //if they are not decoded in time, player seeks to fallbackTime (if >= 0)
+    void decodeForward( unsigned count, double fallbackTime );
+    //if accurate seek or decodeForward() is not done in time,
+    //player seeks to fallbackTime (if >= 0)
+    void startSeekTimeout( double fallbackTime );
+    //detects when accurate seek took effect
+    void accurateSeekTimeChanged( libvlc_time_t time, uint64_t displayedFrames );
+    bool showCachedFrame( uint64_t serial );
+    //in ms
+    double frameDuration();
+
+    void endScan( bool restorePlayback );
+    void scanStep();
+
+    void scheduleSeek( libvlc_time_t );
+    void issueSeek( libvlc_time_t );
+    //in-flight seek is considered done (timed out) after timeout (in ms)
+    void startScheduledSeekTimer( uint64_t timeout );
+    void scheduledSeekDone( bool timedOut );
+    void resetScheduledSeeks();
+    //returns true if frame should not be delivered to js
+    bool skipDecodedFrame();
+
     void callCallback( Callbacks_e callback,
                        std::initializer_list<v8::Local<v8::Value> > list = std::initializer_list<v8::Local<v8::Value> >() );
 
@@ -135,11 +325,25 @@ private:
 
     libvlc_instance_t* _libvlc;
     vlc::player _player;
+    PlaylistStore _playlistStore;
+    VlcAudioOutput _audioOutput;
 
-    uv_async_t _async;
+    struct UvHandles;
+    //uv handles are closed asynchronously, so they are kept out of player
+    UvHandles* _handles;
     std::mutex _asyncDataGuard;
     std::deque<std::unique_ptr<AsyncData> > _asyncData;
 
+    std::unique_ptr<ThreadPool> _commandQueue;
+    unsigned _lastCommandId;
+    std::map<unsigned, v8::UniquePersistent<v8::Promise::Resolver> > _pendingCommands;
+    //stop commands waiting for libvlc_MediaPlayerStopped
+    std::vector<unsigned> _stopCommands;
+    StateSnapshot _snapshot;
+
+    bool _closing;
+    bool _libvlcClosed;
+
     v8::UniquePersistent<v8::Value> _jsFrameBuffer;
 
     v8::UniquePersistent<v8::Function> _jsCallbacks[CB_Max];
@@ -150,6 +354,64 @@ private:
     v8::UniquePersistent<v8::Object> _jsVideo;
     v8::UniquePersistent<v8::Object> _jsSubtitles;
     v8::UniquePersistent<v8::Object> _jsPlaylist;
-
-    uv_timer_t _errorTimer;
+    v8::UniquePersistent<v8::Object> _jsAudioOutput;
+
+    uint32_t _lastAudioDataCursor;
+    unsigned _lastAudioLevelsSequence;
+
+    //keyframe index of current item, could be empty
+    std::unique_ptr<ThreadPool> _indexQueue;
+    unsigned _keyframeIndexRequest;
+    std::shared_ptr<const KeyframeIndex> _keyframeIndex;
+
+    //frame stepping state: frames left to decode (including target one)
+    unsigned _skipFrames;
+    bool _resumeAfterSeek;
+    double _seekTarget;
+
+    //accurate seek state: target time (in ms, < 0 if there is no accurate seek),
+    //frames are dropped until one with time at target is displayed.
+    //Frames displayed before seek took effect (player reported time near
+    //keyframe) are from previous position and are dropped too.
+    double _accurateSeekTarget;
+    libvlc_time_t _accurateSeekKeyframe;
+    libvlc_time_t _accurateSeekFromTime;
+    bool _accurateSeekLanded;
+    //displayed frames counter when seek was issued and when it took effect
+    uint64_t _accurateSeekIssuedFrame;
+    uint64_t _accurateSeekLandedFrame;
+    //player time read for last dropped frame, and time of that frame
+    libvlc_time_t _accurateSeekPlayerTime;
+    double _accurateSeekFrameTime;
+
+    //time of displayed frame, tracked while frames are stepped (-1 if unknown)
+    double _frameTime;
+    //serial of cached frame shown by stepFrame(), 0 - last decoded frame is shown
+    uint64_t _viewedFrame;
+
+    SeekScheduler _seekScheduler;
+
+    //scan mode state, _scanSpeed == 0 if not scanning
+    double _scanSpeed;
+    double _scanStartTime;
+    uint64_t _scanStartClock;
+    //time of last scan seek
+    double _scanLastTime;
+    bool _scanResume;
+    bool _scanUnmute;
+
+    bool _gapless;
+    bool _gaplessSwitch;
+    //MediaChanged of next item is already received
+    bool _gaplessSwitchStarted;
+    bool _nextItemPreparsed;
+
+    enum {
+        AudioTracks = 0,
+        VideoTracks,
+        TextTracks,
+        TrackListsCount,
+    };
+    std::vector<TrackDescription> _tracks[TrackListsCount];
+    bool _tracksValid[TrackListsCount];
 };
@@ -1,8 +1,254 @@
 #include "JsVlcPlaylist.h"
 
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <stdio.h>
+
 #include "NodeTools.h"
 #include "JsVlcPlayer.h"
 #include "JsVlcPlaylistItems.h"
+#include "AsyncJob.h"
+#include "ThreadPool.h"
+#include "MappedFile.h"
+#include "PlaylistFile.h"
+#include "JsStreamSource.h"
+#include "BlockCacheInput.h"
+
+//native buffer size of custom stream input
+static const size_t DEFAULT_STREAM_CAPACITY = 8 * 1024 * 1024;
+static const size_t MIN_STREAM_CAPACITY = 64 * 1024;
+//byte range cache size of seekable custom stream input
+static const size_t DEFAULT_STREAM_CACHE_SIZE = 32 * 1024 * 1024;
+
+///////////////////////////////////////////////////////////////////////////////
+class PlaylistLoadJob : public AsyncJob
+{
+public:
+    PlaylistLoadJob( JsVlcPlayer* jsPlayer, const std::string& path );
+
+    void start();
+
+protected:
+    void onNotify() override;
+    v8::Local<v8::Value> result() override;
+
+private:
+    void load();
+
+private:
+    //items parsed in one batch before gui thread is notified
+    static const unsigned BatchSize = 1000;
+    //max items added to playlist in one gui thread iteration
+    static const unsigned MaxAddSize = 5000;
+
+    JsVlcPlayer *const _jsPlayer;
+    //keeps player alive while job is running
+    v8::UniquePersistent<v8::Object> _jsPlayerObject;
+    const std::string _path;
+
+    std::mutex _guard;
+    std::deque<PlaylistFileItem> _parsedItems;
+    std::atomic<uint64_t> _processedBytes;
+    std::atomic<uint64_t> _fileSize;
+    std::atomic<bool> _parseDone;
+
+    int _startIdx;
+    unsigned _addedCount;
+    std::vector<const char*> _optionsPtrs;
+
+    ThreadPool _worker; //should be last member, to be destroyed first
+};
+
+PlaylistLoadJob::PlaylistLoadJob( JsVlcPlayer* jsPlayer, const std::string& path ) :
+    _jsPlayer( jsPlayer ),
+    _jsPlayerObject( v8::Isolate::GetCurrent(), jsPlayer->handle() ),
+    _path( path ), _processedBytes( 0 ), _fileSize( 0 ), _parseDone( false ),
+    _startIdx( -1 ), _addedCount( 0 )
+{
+}
+
+void PlaylistLoadJob::start()
+{
+    _worker.post( [this] () { load(); } );
+}
+
+void PlaylistLoadJob::load()
+{
+    MappedFile file;
+    if( !file.open( _path ) ) {
+        _parseDone = true;
+        fail( "Can't open playlist file" );
+        return;
+    }
+
+    file.adviseAccess( MappedFile::AccessPattern::Sequential );
+    _fileSize = file.size();
+
+    const PlaylistFormat format = DetectPlaylistFormat( _path, file.data(), file.size() );
+
+    std::vector<PlaylistFileItem> batch;
+    batch.reserve( BatchSize );
+
+    auto flush = [this, &batch] () {
+        std::lock_guard<std::mutex> lock( _guard );
+        for( PlaylistFileItem& item: batch )
+            _parsedItems.push_back( std::move( item ) );
+        batch.clear();
+    };
+
+    ParsePlaylist( format, file.data(), file.size(), DirName( _path ),
+        [&] ( PlaylistFileItem& item, uint64_t processed ) {
+            batch.push_back( std::move( item ) );
+            if( batch.size() >= BatchSize ) {
+                _processedBytes = processed;
+                flush();
+                notify();
+            }
+        } );
+
+    flush();
+    _processedBytes = file.size();
+    _parseDone = true;
+
+    finish();
+}
+
+void PlaylistLoadJob::onNotify()
+{
+    //all items should be added before promise is resolved:
+    //parser sets flag after last batch is queued, so if it's set
+    //whole queue is drained (without MaxAddSize limit)
+    const bool parseDone = _parseDone;
+
+    std::deque<PlaylistFileItem> items;
+    bool hasMore = false;
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+        if( parseDone || _parsedItems.size() <= MaxAddSize ) {
+            items.swap( _parsedItems );
+        } else {
+            //don't block gui thread for too long
+            items.insert( items.end(),
+                          std::make_move_iterator( _parsedItems.begin() ),
+                          std::make_move_iterator( _parsedItems.begin() + MaxAddSize ) );
+            _parsedItems.erase( _parsedItems.begin(), _parsedItems.begin() + MaxAddSize );
+            hasMore = true;
+        }
+    }
+
+    //player closed while loading: the rest of file is dropped
+    if( items.empty() || _jsPlayer->closing() )
+        return;
+
+    PlaylistStore& store = _jsPlayer->playlistStore();
+
+    for( const PlaylistFileItem& item: items ) {
+        _optionsPtrs.clear();
+        for( const std::string& option: item.options )
+            _optionsPtrs.push_back( option.c_str() );
+
+        const int idx =
+            store.add( item.mrl.data(), item.mrl.size(),
+                       _optionsPtrs.size(), _optionsPtrs.data(),
+                       item.title.data(), item.title.size() );
+        if( idx >= 0 ) {
+            if( _startIdx < 0 )
+                _startIdx = idx;
+            ++_addedCount;
+        }
+    }
+
+    const uint64_t fileSize = _fileSize;
+    const double progress =
+        parseDone && !hasMore ? 1. :
+        fileSize ? static_cast<double>( _processedBytes ) / fileSize : 0.;
+    _jsPlayer->playlistLoadProgress( _addedCount, progress );
+
+    if( hasMore )
+        notify();
+}
+
+v8::Local<v8::Value> PlaylistLoadJob::result()
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    EscapableHandleScope scope( isolate );
+
+    const unsigned startIdx =
+        _startIdx < 0 ? _jsPlayer->playlistStore().count() : _startIdx;
+
+    Local<Object> jsRange = Object::New( isolate );
+    jsRange->Set( String::NewFromUtf8( isolate, "start", v8::String::kInternalizedString ),
+                  Integer::New( isolate, startIdx ) );
+    jsRange->Set( String::NewFromUtf8( isolate, "end", v8::String::kInternalizedString ),
+                  Integer::New( isolate, startIdx + _addedCount ) );
+
+    return scope.Escape( jsRange );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+class PlaylistSaveJob : public AsyncJob
+{
+public:
+    PlaylistSaveJob( const std::string& path, std::vector<PlaylistFileItem>* items );
+
+    void start();
+
+protected:
+    v8::Local<v8::Value> result() override;
+
+private:
+    void save();
+
+private:
+    const std::string _path;
+    std::vector<PlaylistFileItem> _items;
+
+    ThreadPool _worker; //should be last member, to be destroyed first
+};
+
+PlaylistSaveJob::PlaylistSaveJob( const std::string& path,
+                                  std::vector<PlaylistFileItem>* items ) :
+    _path( path )
+{
+    _items.swap( *items );
+}
+
+void PlaylistSaveJob::start()
+{
+    _worker.post( [this] () { save(); } );
+}
+
+void PlaylistSaveJob::save()
+{
+    const std::string data = FormatPlaylist( DetectPlaylistFormat( _path ), _items );
+
+#ifdef _WIN32
+    FILE* file = _wfopen( Utf8ToWide( _path ).c_str(), L"wb" );
+#else
+    FILE* file = fopen( _path.c_str(), "wb" );
+#endif
+    if( !file ) {
+        fail( "Can't open playlist file for writing" );
+        return;
+    }
+
+    const bool written = fwrite( data.data(), 1, data.size(), file ) == data.size();
+    if( 0 != fclose( file ) || !written ) {
+        fail( "Can't write playlist file" );
+        return;
+    }
+
+    finish();
+}
+
+v8::Local<v8::Value> PlaylistSaveJob::result()
+{
+    return v8::Boolean::New( v8::Isolate::GetCurrent(), true );
+}
 
 v8::Persistent<v8::Function> JsVlcPlaylist::_jsConstructor;
 
@@ -38,11 +284,16 @@ void JsVlcPlaylist::initJsApi()
 
     SET_RW_PROPERTY( instanceTemplate, "currentItem", &JsVlcPlaylist::currentItem, &JsVlcPlaylist::setCurrentItem );
     SET_RW_PROPERTY( instanceTemplate, "mode", &JsVlcPlaylist::mode, &JsVlcPlaylist::setMode );
+    SET_RW_PROPERTY( instanceTemplate, "gapless", &JsVlcPlaylist::gapless, &JsVlcPlaylist::setGapless );
 
     SET_METHOD( constructorTemplate, "add", &JsVlcPlaylist::add );
     SET_METHOD( constructorTemplate, "addWithOptions", &JsVlcPlaylist::addWithOptions );
+    NODE_SET_PROTOTYPE_METHOD( constructorTemplate, "addMany", jsAddMany );
+    NODE_SET_PROTOTYPE_METHOD( constructorTemplate, "addStream", jsAddStream );
+    NODE_SET_PROTOTYPE_METHOD( constructorTemplate, "search", jsSearch );
     SET_METHOD( constructorTemplate, "play", &JsVlcPlaylist::play );
     SET_METHOD( constructorTemplate, "playItem", &JsVlcPlaylist::playItem );
+    SET_METHOD( constructorTemplate, "playItemAsync", &JsVlcPlaylist::playItemAsync );
     SET_METHOD( constructorTemplate, "pause", &JsVlcPlaylist::pause );
     SET_METHOD( constructorTemplate, "togglePause", &JsVlcPlaylist::togglePause );
     SET_METHOD( constructorTemplate, "stop",  &JsVlcPlaylist::stop );
@@ -51,6 +302,8 @@ void JsVlcPlaylist::initJsApi()
     SET_METHOD( constructorTemplate, "clear",  &JsVlcPlaylist::clear );
     SET_METHOD( constructorTemplate, "removeItem",  &JsVlcPlaylist::removeItem );
     SET_METHOD( constructorTemplate, "advanceItem",  &JsVlcPlaylist::advanceItem );
+    SET_METHOD( constructorTemplate, "loadFile",  &JsVlcPlaylist::loadFile );
+    SET_METHOD( constructorTemplate, "saveFile",  &JsVlcPlaylist::saveFile );
 
     Local<Function> constructor = constructorTemplate->GetFunction();
     _jsConstructor.Reset( isolate, constructor );
@@ -105,21 +358,30 @@ JsVlcPlaylist::JsVlcPlaylist( v8::Local<v8::Object>& thisObject, JsVlcPlayer* js
 
 unsigned JsVlcPlaylist::itemCount()
 {
-    return _jsPlayer->player().item_count();
+    return _jsPlayer->playlistStore().count();
 }
 
 bool JsVlcPlaylist::isPlaying()
 {
+    if( _jsPlayer->closing() )
+        return false;
+
     return _jsPlayer->player().is_playing();
 }
 
 unsigned JsVlcPlaylist::mode()
 {
+    if( _jsPlayer->closing() )
+        return 0;
+
     return static_cast<unsigned>( _jsPlayer->player().get_playback_mode() );
 }
 
 void JsVlcPlaylist::setMode( unsigned  mode )
 {
+    if( _jsPlayer->closing() )
+        return;
+
     vlc::player& p = _jsPlayer->player();
 
     switch( mode ) {
@@ -135,87 +397,370 @@ void JsVlcPlaylist::setMode( unsigned  mode )
     }
 }
 
+bool JsVlcPlaylist::gapless()
+{
+    return _jsPlayer->gapless();
+}
+
+void JsVlcPlaylist::setGapless( bool gapless )
+{
+    _jsPlayer->setGapless( gapless );
+}
+
 int JsVlcPlaylist::currentItem()
 {
-    return _jsPlayer->player().current_item();
+    return _jsPlayer->currentItem();
 }
 
 void JsVlcPlaylist::setCurrentItem( unsigned idx )
 {
-    _jsPlayer->player().set_current( idx );
+    if( _jsPlayer->closing() )
+        return;
+
+    _jsPlayer->playlistStore().setCurrent( idx );
 }
 
 int JsVlcPlaylist::add( const std::string& mrl )
 {
-    return _jsPlayer->player().add_media( mrl.c_str() );
+    if( _jsPlayer->closing() )
+        return -1;
+
+    return _jsPlayer->playlistStore().add( mrl );
 }
 
 int JsVlcPlaylist::addWithOptions( const std::string& mrl,
                                    const std::vector<std::string>& options )
 {
-    std::vector<const char*> trusted_opts;
-    trusted_opts.reserve( options.size() );
+    if( _jsPlayer->closing() )
+        return -1;
+
+    return _jsPlayer->playlistStore().add( mrl, options );
+}
+
+//playlist.addStream( readable | { read, seek, size }, { title, options, capacity, cacheSize } )
+//returns item index or -1
+void JsVlcPlaylist::jsAddStream( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    JsVlcPlaylist* jsPlaylist = ObjectWrap::Unwrap<JsVlcPlaylist>( args.Holder() );
+    PlaylistStore& store = jsPlaylist->_jsPlayer->playlistStore();
 
-    for( const std::string& opt: options ) {
-        trusted_opts.push_back( opt.c_str() );
+    if( !args[0]->IsObject() || jsPlaylist->_jsPlayer->closing() ) {
+        args.GetReturnValue().Set( Integer::New( isolate, -1 ) );
+        return;
     }
 
-    return _jsPlayer->player().add_media( mrl.c_str(),
-                                          0, nullptr,
-                                          trusted_opts.size(), trusted_opts.data() );
+#if LIBVLC_VERSION_INT < LIBVLC_VERSION( 3, 0, 0, 0 )
+    //stream items need media callbacks, so source is not even attached
+    args.GetReturnValue().Set( Integer::New( isolate, -1 ) );
+    return;
+#endif
+
+    size_t capacity = DEFAULT_STREAM_CAPACITY;
+    size_t cacheSize = DEFAULT_STREAM_CACHE_SIZE;
+    std::string title;
+    std::vector<std::string> options;
+
+    if( args[1]->IsObject() ) {
+        Local<Object> jsOptions = Local<Object>::Cast( args[1] );
+
+        Local<Value> jsCapacity =
+            jsOptions->Get( String::NewFromUtf8( isolate, "capacity", v8::String::kInternalizedString ) );
+        if( jsCapacity->IsNumber() )
+            capacity = std::max<size_t>( FromJsValue<unsigned>( jsCapacity ), MIN_STREAM_CAPACITY );
+
+        Local<Value> jsCacheSize =
+            jsOptions->Get( String::NewFromUtf8( isolate, "cacheSize", v8::String::kInternalizedString ) );
+        if( jsCacheSize->IsNumber() )
+            cacheSize = FromJsValue<unsigned>( jsCacheSize );
+
+        Local<Value> jsTitle =
+            jsOptions->Get( String::NewFromUtf8( isolate, "title", v8::String::kInternalizedString ) );
+        if( jsTitle->IsString() )
+            title = FromJsValue<std::string>( jsTitle );
+
+        Local<Value> jsItemOptions =
+            jsOptions->Get( String::NewFromUtf8( isolate, "options", v8::String::kInternalizedString ) );
+        if( jsItemOptions->IsArray() )
+            options = FromJsValue<std::vector<std::string> >( jsItemOptions );
+    }
+
+    std::shared_ptr<StreamInput> streamInput =
+        JsStreamSource::create( Local<Object>::Cast( args[0] ), capacity );
+
+    //demuxers seek a lot, so seekable sources are read through byte range cache
+    std::shared_ptr<MediaInput> input = streamInput;
+    if( streamInput && streamInput->seekable() && cacheSize )
+        input = std::make_shared<BlockCacheInput>( streamInput, cacheSize );
+
+    //libvlc reports "imem://" as mrl of callbacks based media
+    const int idx = input ? store.add( "imem://", input, options, title ) : -1;
+
+    args.GetReturnValue().Set( Integer::New( isolate, idx ) );
+}
+
+//playlist.addMany( [ mrl | { mrl, options }, ... ], { at } )
+//returns { start, end } range of added items
+void JsVlcPlaylist::jsAddMany( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    JsVlcPlaylist* jsPlaylist = ObjectWrap::Unwrap<JsVlcPlaylist>( args.Holder() );
+    PlaylistStore& store = jsPlaylist->_jsPlayer->playlistStore();
+
+    const unsigned firstIdx = store.count();
+    unsigned addedCount = 0;
+
+    //nothing is added to closed player, range is empty
+    if( args[0]->IsArray() && !jsPlaylist->_jsPlayer->closing() ) {
+        Local<Array> jsItems = Local<Array>::Cast( args[0] );
+
+        Local<String> mrlKey =
+            String::NewFromUtf8( isolate, "mrl", v8::String::kInternalizedString );
+        Local<String> optionsKey =
+            String::NewFromUtf8( isolate, "options", v8::String::kInternalizedString );
+
+        //items are only stored here, libvlc media will be created on demand,
+        //buffers are reused for all items to avoid reallocations
+        std::string mrl;
+        std::deque<std::string> options;
+        std::vector<const char*> trustedOpts;
+
+        const unsigned length = jsItems->Length();
+        for( unsigned i = 0; i < length; ++i ) {
+            Local<Value> jsItem = jsItems->Get( i );
+
+            options.clear();
+            trustedOpts.clear();
+
+            if( jsItem->IsString() ) {
+                String::Utf8Value jsMrl( jsItem );
+                mrl.assign( *jsMrl, jsMrl.length() );
+            } else if( jsItem->IsObject() ) {
+                Local<Object> jsItemObject = Local<Object>::Cast( jsItem );
+
+                //items without mrl are skipped the same way as non object ones
+                Local<Value> jsMrlValue = jsItemObject->Get( mrlKey );
+                if( !jsMrlValue->IsString() )
+                    continue;
+
+                String::Utf8Value jsMrl( jsMrlValue );
+                mrl.assign( *jsMrl, jsMrl.length() );
+
+                Local<Value> jsOptions = jsItemObject->Get( optionsKey );
+                if( jsOptions->IsArray() ) {
+                    Local<Array> jsOptionsArray = Local<Array>::Cast( jsOptions );
+                    for( unsigned o = 0; o < jsOptionsArray->Length(); ++o ) {
+                        String::Utf8Value jsOption( jsOptionsArray->Get( o )->ToString() );
+                        if( jsOption.length() ) {
+                            auto it = options.emplace( options.end(), *jsOption, jsOption.length() );
+                            trustedOpts.push_back( it->c_str() );
+                        }
+                    }
+                }
+            } else
+                continue;
+
+            if( store.add( mrl.data(), mrl.size(),
+                           trustedOpts.size(), trustedOpts.data() ) >= 0 )
+            {
+                ++addedCount;
+            }
+        }
+    }
+
+    unsigned startIdx = firstIdx;
+    if( addedCount && args[1]->IsObject() ) {
+        Local<Value> jsAt =
+            Local<Object>::Cast( args[1] )->Get(
+                String::NewFromUtf8( isolate, "at", v8::String::kInternalizedString ) );
+        if( jsAt->IsNumber() ) {
+            const unsigned at = FromJsValue<unsigned>( jsAt );
+            if( at < firstIdx ) {
+                //move added block from the end of playlist to requested position
+                store.moveTail( firstIdx, at );
+                jsPlaylist->_jsPlayer->playlistChanged();
+                startIdx = at;
+            }
+        }
+    }
+
+    Local<Object> jsRange = Object::New( isolate );
+    jsRange->Set( String::NewFromUtf8( isolate, "start", v8::String::kInternalizedString ),
+                  Integer::New( isolate, startIdx ) );
+    jsRange->Set( String::NewFromUtf8( isolate, "end", v8::String::kInternalizedString ),
+                  Integer::New( isolate, startIdx + addedCount ) );
+
+    args.GetReturnValue().Set( jsRange );
+}
+
+//playlist.search( query, limit )
+//returns array of indexes of items matching all query words
+void JsVlcPlaylist::jsSearch( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    JsVlcPlaylist* jsPlaylist = ObjectWrap::Unwrap<JsVlcPlaylist>( args.Holder() );
+
+    if( jsPlaylist->_jsPlayer->closing() ) {
+        args.GetReturnValue().Set( Array::New( isolate, 0 ) );
+        return;
+    }
+
+    String::Utf8Value jsQuery( args[0]->ToString() );
+    const unsigned limit = args[1]->IsNumber() ? FromJsValue<unsigned>( args[1] ) : 0;
+
+    const std::vector<unsigned> found =
+        jsPlaylist->_jsPlayer->playlistStore().search(
+            std::string( *jsQuery, jsQuery.length() ), limit );
+
+    Local<Array> jsFound = Array::New( isolate, found.size() );
+    for( unsigned i = 0; i < found.size(); ++i )
+        jsFound->Set( i, Integer::New( isolate, found[i] ) );
+
+    args.GetReturnValue().Set( jsFound );
 }
 
 void JsVlcPlaylist::play()
 {
-    _jsPlayer->player().play();
+    _jsPlayer->play();
 }
 
 bool JsVlcPlaylist::playItem( unsigned idx )
 {
-    return _jsPlayer->player().play( idx );
+    return _jsPlayer->playItem( idx );
+}
+
+v8::Local<v8::Value> JsVlcPlaylist::playItemAsync( unsigned idx )
+{
+    _jsPlayer->playlistStore().interruptInputs();
+
+    return _jsPlayer->queueCommand(
+        [] ( libvlc_media_player_t* mp ) {
+            libvlc_media_player_stop( mp );
+        },
+        [idx] ( JsVlcPlayer* jsPlayer ) {
+            jsPlayer->playItem( idx );
+        } );
 }
 
 void JsVlcPlaylist::pause()
 {
+    if( _jsPlayer->closing() )
+        return;
+
     _jsPlayer->player().pause();
 }
 
 void JsVlcPlaylist::togglePause()
 {
+    if( _jsPlayer->closing() )
+        return;
+
     _jsPlayer->player().togglePause();
 }
 
 void JsVlcPlaylist::stop()
 {
-    _jsPlayer->player().stop();
+    _jsPlayer->stop();
 }
 
 void JsVlcPlaylist::next()
 {
-    _jsPlayer->player().next();
+    _jsPlayer->playNext();
 }
 
 void JsVlcPlaylist::prev()
 {
-    _jsPlayer->player().prev();
+    _jsPlayer->playPrev();
 }
 
 void JsVlcPlaylist::clear()
 {
-    _jsPlayer->player().clear_items();
+    if( _jsPlayer->closing() )
+        return;
+
+    _jsPlayer->playlistStore().clear();
+    _jsPlayer->playlistChanged();
 }
 
 bool JsVlcPlaylist::removeItem( unsigned idx )
 {
-    return _jsPlayer->player().delete_item( idx );
+    if( _jsPlayer->closing() )
+        return false;
+
+    const bool removed = _jsPlayer->playlistStore().remove( idx );
+    _jsPlayer->playlistChanged();
+
+    return removed;
 }
 
 void JsVlcPlaylist::advanceItem( unsigned idx, int count )
 {
-    _jsPlayer->player().advance_item( idx, count );
+    if( _jsPlayer->closing() )
+        return;
+
+    _jsPlayer->playlistStore().advance( idx, count );
+    _jsPlayer->playlistChanged();
 }
 
 v8::Local<v8::Object> JsVlcPlaylist::items()
 {
     return v8::Local<v8::Object>::New( v8::Isolate::GetCurrent(), _jsItems );
 }
+
+v8::Local<v8::Value> JsVlcPlaylist::loadFile( const std::string& path )
+{
+    using namespace v8;
+
+    if( _jsPlayer->closing() ) {
+        Isolate* isolate = Isolate::GetCurrent();
+        EscapableHandleScope scope( isolate );
+
+        Local<Promise::Resolver> resolver = Promise::Resolver::New( isolate );
+        resolver->Reject(
+            Exception::Error( String::NewFromUtf8( isolate, "Player is closed" ) ) );
+        return scope.Escape( resolver->GetPromise() );
+    }
+
+    PlaylistLoadJob* job = new PlaylistLoadJob( _jsPlayer, path );
+    v8::Local<v8::Value> promise = job->promise();
+    job->start();
+
+    return promise;
+}
+
+v8::Local<v8::Value> JsVlcPlaylist::saveFile( const std::string& path )
+{
+    PlaylistStore& store = _jsPlayer->playlistStore();
+
+    std::vector<PlaylistFileItem> items;
+    items.reserve( store.count() );
+    for( unsigned i = 0; i < store.count(); ++i ) {
+        //items added with addStream can't be restored from file
+        if( store.input( i ) && store.inputMode( i ).empty() )
+            continue;
+
+        PlaylistFileItem item;
+        item.mrl = store.mrl( i );
+        item.title = store.title( i );
+        item.options = store.options( i );
+        items.push_back( std::move( item ) );
+    }
+
+    PlaylistSaveJob* job = new PlaylistSaveJob( path, &items );
+    v8::Local<v8::Value> promise = job->promise();
+    job->start();
+
+    return promise;
+}
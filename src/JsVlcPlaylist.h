@@ -21,6 +21,10 @@ public:
 
     static void initJsApi();
 
+    static void jsAddMany( const v8::FunctionCallbackInfo<v8::Value>& args );
+    static void jsAddStream( const v8::FunctionCallbackInfo<v8::Value>& args );
+    static void jsSearch( const v8::FunctionCallbackInfo<v8::Value>& args );
+
     unsigned itemCount();
     bool isPlaying();
 
@@ -30,10 +34,14 @@ public:
     unsigned mode();
     void setMode( unsigned );
 
+    bool gapless();
+    void setGapless( bool );
+
     int add( const std::string& mrl );
     int addWithOptions( const std::string& mrl, const std::vector<std::string>& options );
     void play();
     bool playItem( unsigned idx );
+    v8::Local<v8::Value> playItemAsync( unsigned idx );
     void pause();
     void togglePause();
     void stop();
@@ -43,6 +51,11 @@ public:
     bool removeItem( unsigned idx );
     void advanceItem( unsigned idx, int count );
 
+    //load/save of M3U/XSPF files on background thread,
+    //loaded items are added to the end of playlist in batches
+    v8::Local<v8::Value> loadFile( const std::string& path );
+    v8::Local<v8::Value> saveFile( const std::string& path );
+
     v8::Local<v8::Object> items();
 
 private:
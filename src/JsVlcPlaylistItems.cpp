@@ -3,6 +3,7 @@
 #include "NodeTools.h"
 #include "JsVlcPlayer.h"
 #include "JsVlcMedia.h"
+#include "MediaInfo.h"
 
 v8::Persistent<v8::Function> JsVlcPlaylistItems::_jsConstructor;
 
@@ -29,6 +30,7 @@ void JsVlcPlaylistItems::initJsApi()
 
     SET_METHOD( constructorTemplate, "clear", &JsVlcPlaylistItems::clear );
     SET_METHOD( constructorTemplate, "remove", &JsVlcPlaylistItems::remove );
+    NODE_SET_PROTOTYPE_METHOD( constructorTemplate, "slice", jsSlice );
 
     Local<Function> constructor = constructorTemplate->GetFunction();
     _jsConstructor.Reset( isolate, constructor );
@@ -74,27 +76,205 @@ void JsVlcPlaylistItems::jsCreate( const v8::FunctionCallbackInfo<v8::Value>& ar
 }
 
 JsVlcPlaylistItems::JsVlcPlaylistItems( v8::Local<v8::Object>& thisObject, JsVlcPlayer* jsPlayer ) :
-    _jsPlayer( jsPlayer )
+    _jsPlayer( jsPlayer ), _cacheGeneration( jsPlayer->playlistStore().generation() )
 {
     Wrap( thisObject );
 }
 
+JsVlcPlaylistItems::~JsVlcPlaylistItems()
+{
+    clearCache();
+}
+
+struct JsVlcPlaylistItems::CachedItem
+{
+    JsVlcPlaylistItems* owner;
+    uint32_t index;
+    v8::UniquePersistent<v8::Object> jsMedia;
+};
+
+void JsVlcPlaylistItems::cachedItemCollected(
+    const v8::WeakCallbackData<v8::Object, CachedItem>& data )
+{
+    CachedItem* cachedItem = data.GetParameter();
+
+    auto& cache = cachedItem->owner->_cache;
+    auto it = cache.find( cachedItem->index );
+    if( it != cache.end() && it->second == cachedItem )
+        cache.erase( it );
+
+    cachedItem->jsMedia.Reset();
+    delete cachedItem;
+}
+
+void JsVlcPlaylistItems::clearCache()
+{
+    for( auto& pair: _cache ) {
+        //Reset also cancels weak callback
+        pair.second->jsMedia.Reset();
+        delete pair.second;
+    }
+    _cache.clear();
+}
+
 v8::Local<v8::Object> JsVlcPlaylistItems::item( uint32_t index )
 {
-    return JsVlcMedia::create( *_jsPlayer, _jsPlayer->player().get_media( index ) );
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    EscapableHandleScope scope( isolate );
+
+    if( _jsPlayer->closing() )
+        return Local<Object>();
+
+    PlaylistStore& store = _jsPlayer->playlistStore();
+
+    if( _cacheGeneration != store.generation() ) {
+        clearCache();
+        _cacheGeneration = store.generation();
+    }
+
+    auto it = _cache.find( index );
+    if( it != _cache.end() )
+        return scope.Escape( Local<Object>::New( isolate, it->second->jsMedia ) );
+
+    if( index >= store.count() )
+        return Local<Object>();
+
+    Local<Object> jsMedia = JsVlcMedia::create( *_jsPlayer, store.media( index ) );
+
+    CachedItem* cachedItem = new CachedItem;
+    cachedItem->owner = this;
+    cachedItem->index = index;
+    cachedItem->jsMedia.Reset( isolate, jsMedia );
+    cachedItem->jsMedia.SetWeak( cachedItem, cachedItemCollected );
+    _cache.emplace( index, cachedItem );
+
+    return scope.Escape( jsMedia );
+}
+
+void JsVlcPlaylistItems::jsSlice( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    JsVlcPlaylistItems* jsItems = ObjectWrap::Unwrap<JsVlcPlaylistItems>( args.Holder() );
+    JsVlcPlayer* jsPlayer = jsItems->_jsPlayer;
+
+    PlaylistStore& store = jsPlayer->playlistStore();
+    vlc::player& player = jsPlayer->player();
+
+    //closing player has empty slice (with requested fields)
+    const unsigned count = jsPlayer->closing() ? 0 : store.count();
+    const unsigned start =
+        args[0]->IsNumber() ? std::min( FromJsValue<unsigned>( args[0] ), count ) : 0;
+    const unsigned end =
+        args[1]->IsNumber() ? std::min( FromJsValue<unsigned>( args[1] ), count ) : count;
+    const unsigned sliceSize = end > start ? end - start : 0;
+
+    std::vector<std::string> fields;
+    if( args[2]->IsArray() )
+        fields = FromJsValue<std::vector<std::string> >( args[2] );
+    else
+        fields = { "mrl", "title" };
+
+    //meta fields are available only for items with created libvlc media
+    //(except title from playlist file), for others null is returned,
+    //to not force media creation
+    enum {
+        FieldMrl = -1,
+        FieldSetting = -2,
+        FieldDisabled = -3,
+        FieldUnknown = -4,
+    };
+
+    Local<Object> jsSlice = Object::New( isolate );
+    for( const std::string& field: fields ) {
+        int fieldId = FieldUnknown;
+        if( field == "mrl" )
+            fieldId = FieldMrl;
+        else if( field == "setting" )
+            fieldId = FieldSetting;
+        else if( field == "disabled" )
+            fieldId = FieldDisabled;
+        else {
+            for( int m = 0; m < MediaInfo::MetaCount; ++m ) {
+                if( field == MetaNames[m] ) {
+                    fieldId = m;
+                    break;
+                }
+            }
+        }
+
+        if( FieldUnknown == fieldId )
+            continue;
+
+        Local<Array> jsValues = Array::New( isolate, sliceSize );
+        for( unsigned i = 0; i < sliceSize; ++i ) {
+            const unsigned idx = start + i;
+
+            if( FieldMrl == fieldId ) {
+                jsValues->Set( i, ToJsValue( store.mrl( idx ) ) );
+                continue;
+            }
+
+            const int playerIdx = store.findMaterialized( idx );
+            switch( fieldId ) {
+                case FieldSetting:
+                    jsValues->Set( i, playerIdx < 0 ?
+                                      ToJsValue( std::string() ) :
+                                      ToJsValue( player.get_item_data( playerIdx ) ) );
+                    break;
+                case FieldDisabled:
+                    jsValues->Set( i, ToJsValue( playerIdx >= 0 &&
+                                                 player.is_item_disabled( playerIdx ) ) );
+                    break;
+                default:
+                    if( playerIdx < 0 ) {
+                        //title could be known from playlist file
+                        const std::string title =
+                            libvlc_meta_Title == fieldId ? store.title( idx ) : std::string();
+                        jsValues->Set( i, title.empty() ?
+                                          Local<Value>( Null( isolate ) ) :
+                                          ToJsValue( title ) );
+                    }
+                    else
+                        jsValues->Set( i,
+                            ToJsValue( player.get_media( playerIdx ).meta(
+                                static_cast<libvlc_meta_t>( fieldId ) ) ) );
+                    break;
+            }
+        }
+
+        jsSlice->Set( String::NewFromUtf8( isolate, field.c_str() ), jsValues );
+    }
+
+    args.GetReturnValue().Set( jsSlice );
 }
 
 unsigned JsVlcPlaylistItems::count()
 {
-    return _jsPlayer->player().item_count();
+    return _jsPlayer->playlistStore().count();
 }
 
 void JsVlcPlaylistItems::clear()
 {
-    return _jsPlayer->player().clear_items();
+    if( _jsPlayer->closing() )
+        return;
+
+    _jsPlayer->playlistStore().clear();
+    _jsPlayer->playlistChanged();
 }
 
 bool JsVlcPlaylistItems::remove( unsigned int idx )
 {
-   return _jsPlayer->player().delete_item( idx );
+    if( _jsPlayer->closing() )
+        return false;
+
+    const bool removed = _jsPlayer->playlistStore().remove( idx );
+    _jsPlayer->playlistChanged();
+
+    return removed;
 }
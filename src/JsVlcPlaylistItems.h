@@ -1,5 +1,7 @@
 #pragma once
 
+#include <unordered_map>
+
 #include <v8.h>
 #include <node_object_wrap.h>
 
@@ -12,6 +14,10 @@ public:
     static void initJsApi();
     static v8::UniquePersistent<v8::Object> create( JsVlcPlayer& player );
 
+    //items.slice( start, end, [ field, ... ] )
+    //returns { field: [ value, ... ], ... } for items [start, end)
+    static void jsSlice( const v8::FunctionCallbackInfo<v8::Value>& args );
+
     v8::Local<v8::Object> item( uint32_t index );
 
     unsigned count();
@@ -21,9 +27,21 @@ public:
 private:
     static void jsCreate( const v8::FunctionCallbackInfo<v8::Value>& args );
     JsVlcPlaylistItems( v8::Local<v8::Object>& thisObject, JsVlcPlayer* );
+    ~JsVlcPlaylistItems();
+
+    struct CachedItem;
+    static void cachedItemCollected(
+        const v8::WeakCallbackData<v8::Object, CachedItem>& data );
+
+    void clearCache();
 
 private:
     static v8::Persistent<v8::Function> _jsConstructor;
 
     JsVlcPlayer* _jsPlayer;
+
+    //JsVlcMedia wrappers are cached while they are alive in js,
+    //cache is dropped when playlist indexes are shifted
+    unsigned _cacheGeneration;
+    std::unordered_map<uint32_t, CachedItem*> _cache;
 };
@@ -23,6 +23,7 @@ void JsVlcSubtitles::initJsApi()
     SET_RO_INDEXED_PROPERTY( instanceTemplate, &JsVlcSubtitles::description );
 
     SET_RO_PROPERTY( instanceTemplate, "count", &JsVlcSubtitles::count );
+    SET_RO_PROPERTY( instanceTemplate, "tracks", &JsVlcSubtitles::tracks );
 
     SET_RW_PROPERTY( instanceTemplate, "track", &JsVlcSubtitles::track, &JsVlcSubtitles::setTrack );
     SET_RW_PROPERTY( instanceTemplate, "delay", &JsVlcSubtitles::delay, &JsVlcSubtitles::setDelay );
@@ -78,52 +79,57 @@ JsVlcSubtitles::JsVlcSubtitles( v8::Local<v8::Object>& thisObject, JsVlcPlayer*
 
 std::string JsVlcSubtitles::description( uint32_t index )
 {
-    vlc_player& p = _jsPlayer->player();
+    if( _jsPlayer->closing() )
+        return std::string();
 
-    std::string name;
+    const std::vector<JsVlcPlayer::TrackDescription>& tracks =
+        _jsPlayer->tracks( libvlc_track_text );
 
-    libvlc_track_description_t* rootDesc =
-        libvlc_video_get_spu_description( p.get_mp() );
-    if( !rootDesc )
-        return name;
-
-    unsigned count = libvlc_video_get_spu_count( p.get_mp() );
-    if( count && index < count ) {
-        libvlc_track_description_t* desc = rootDesc;
-        for( ; index && desc; --index ){
-            desc = desc->p_next;
-        }
-
-        if ( desc && desc->psz_name ) {
-            name = desc->psz_name;
-        }
-    }
-    libvlc_track_description_list_release( rootDesc );
+    return index < tracks.size() ? tracks[index].name : std::string();
+}
 
-    return name;
+v8::Local<v8::Array> JsVlcSubtitles::tracks()
+{
+    return _jsPlayer->jsTracks( libvlc_track_text );
 }
 
 unsigned JsVlcSubtitles::count()
 {
-    return _jsPlayer->player().subtitles().track_count();
+    if( _jsPlayer->closing() )
+        return 0;
+
+    //the same list as descriptions, so both are invalidated together
+    return static_cast<unsigned>( _jsPlayer->tracks( libvlc_track_text ).size() );
 }
 
 int JsVlcSubtitles::track()
 {
+    if( _jsPlayer->closing() )
+        return -1;
+
     return _jsPlayer->player().subtitles().get_track();
 }
 
 void JsVlcSubtitles::setTrack( int track )
 {
+    if( _jsPlayer->closing() )
+        return;
+
     return _jsPlayer->player().subtitles().set_track( track );
 }
 
 int JsVlcSubtitles::delay()
 {
+    if( _jsPlayer->closing() )
+        return 0;
+
     return static_cast<int>( _jsPlayer->player().subtitles().get_delay() );
 }
 
 void JsVlcSubtitles::setDelay( int delay )
 {
+    if( _jsPlayer->closing() )
+        return;
+
     _jsPlayer->player().subtitles().set_delay( delay );
 }
@@ -24,6 +24,7 @@ void JsVlcVideo::initJsApi()
     instanceTemplate->SetInternalFieldCount( 1 );
 
     SET_RO_PROPERTY( instanceTemplate, "count", &JsVlcVideo::count );
+    SET_RO_PROPERTY( instanceTemplate, "tracks", &JsVlcVideo::tracks );
 
     SET_RO_PROPERTY( instanceTemplate, "deinterlace", &JsVlcVideo::deinterlace );
 
@@ -82,16 +83,31 @@ JsVlcVideo::JsVlcVideo( v8::Local<v8::Object>& thisObject, JsVlcPlayer* jsPlayer
 
 unsigned JsVlcVideo::count()
 {
-    return _jsPlayer->player().video().track_count();
+    if( _jsPlayer->closing() )
+        return 0;
+
+    //the same list as descriptions, so both are invalidated together
+    return static_cast<unsigned>( _jsPlayer->tracks( libvlc_track_video ).size() );
+}
+
+v8::Local<v8::Array> JsVlcVideo::tracks()
+{
+    return _jsPlayer->jsTracks( libvlc_track_video );
 }
 
 int JsVlcVideo::track()
 {
+    if( _jsPlayer->closing() )
+        return -1;
+
     return _jsPlayer->player().video().get_track();
 }
 
 void JsVlcVideo::setTrack( unsigned track )
 {
+    if( _jsPlayer->closing() )
+        return;
+
     _jsPlayer->player().video().set_track( track );
 }
 
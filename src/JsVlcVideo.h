@@ -15,6 +15,7 @@ public:
     static v8::UniquePersistent<v8::Object> create( JsVlcPlayer& player );
 
     unsigned count();
+    v8::Local<v8::Array> tracks();
 
     int track();
     void setTrack( unsigned );
@@ -0,0 +1,298 @@
+#include "JsVlcVideoPreview.h"
+
+#include <string.h>
+
+#include <chrono>
+#include <memory>
+#include <algorithm>
+
+#include "NodeTools.h"
+#include "AsyncJob.h"
+#include "ThreadPool.h"
+#include "MediaInfo.h"
+#include "MetaCache.h"
+#include "KeyframeIndex.h"
+#include "FrameGrabber.h"
+
+static const unsigned DEFAULT_PREVIEW_INTERVAL = 10000;
+static const unsigned MIN_PREVIEW_INTERVAL = 100;
+static const unsigned DEFAULT_TILE_WIDTH = 160;
+static const unsigned MAX_TILE_WIDTH = 1920;
+static const unsigned DEFAULT_SPRITE_COLUMNS = 10;
+static const unsigned MAX_SPRITE_TILES = 10000;
+static const uint64_t MAX_SPRITE_SIZE = 256 * 1024 * 1024;
+//in ms
+static const unsigned OPEN_TIMEOUT = 10000;
+static const unsigned GRAB_TIMEOUT = 3000;
+static const unsigned PREVIEW_PROGRESS_INTERVAL = 100;
+
+///////////////////////////////////////////////////////////////////////////////
+//Tiles are grabbed by own headless player, so it doesn't touch any player output.
+//Seeks go to keyframes if keyframe index of local file is available,
+//and tiles which fall on the same keyframe are decoded only once.
+class PreviewSpriteJob : public AsyncJob
+{
+public:
+    PreviewSpriteJob( libvlc_instance_t* libvlc, const std::string& mrl,
+                      unsigned interval, unsigned tileWidth, unsigned columns,
+                      const v8::Local<v8::Function>& onProgress );
+
+    void start();
+
+protected:
+    void onNotify() override;
+    v8::Local<v8::Value> result() override;
+
+private:
+    void build();
+    //RV32 (BGRA) frame to RGBA tile
+    void storeTile( unsigned tile, const uint8_t* frame );
+    void copyTile( unsigned from, unsigned to );
+    uint8_t* tileData( unsigned tile, unsigned line );
+
+private:
+    //released after workers are stopped
+    const LibvlcRef _libvlc;
+    const std::string _mrl;
+    const unsigned _interval;
+    const unsigned _tileWidth;
+    const unsigned _columns;
+
+    v8::UniquePersistent<v8::Function> _jsOnProgress;
+
+    unsigned _tileHeight;
+    unsigned _rows;
+    libvlc_time_t _duration;
+    std::vector<uint8_t> _sprite;
+    //time of frame in every tile
+    std::vector<double> _tileTimes;
+    std::atomic<unsigned> _completedTiles;
+
+    ThreadPool _worker; //should be last member, to be destroyed first
+};
+
+PreviewSpriteJob::PreviewSpriteJob( libvlc_instance_t* libvlc, const std::string& mrl,
+                                    unsigned interval, unsigned tileWidth, unsigned columns,
+                                    const v8::Local<v8::Function>& onProgress ) :
+    _libvlc( libvlc ), _mrl( mrl ),
+    _interval( interval ), _tileWidth( tileWidth ), _columns( columns ),
+    _tileHeight( 0 ), _rows( 0 ), _duration( 0 ), _completedTiles( 0 ), _worker( 1 )
+{
+    if( !onProgress.IsEmpty() )
+        _jsOnProgress.Reset( v8::Isolate::GetCurrent(), onProgress );
+}
+
+void PreviewSpriteJob::start()
+{
+    _worker.post( [this] () { build(); } );
+}
+
+uint8_t* PreviewSpriteJob::tileData( unsigned tile, unsigned line )
+{
+    const size_t spritePitch = static_cast<size_t>( _columns ) * _tileWidth * 4;
+    const size_t x = ( tile % _columns ) * _tileWidth;
+    const size_t y = ( tile / _columns ) * _tileHeight + line;
+
+    return &_sprite[y * spritePitch + x * 4];
+}
+
+void PreviewSpriteJob::storeTile( unsigned tile, const uint8_t* frame )
+{
+    for( unsigned line = 0; line < _tileHeight; ++line ) {
+        const uint8_t* src = frame + static_cast<size_t>( line ) * _tileWidth * 4;
+        uint8_t* dst = tileData( tile, line );
+        for( unsigned x = 0; x < _tileWidth; ++x, src += 4, dst += 4 ) {
+            dst[0] = src[2];
+            dst[1] = src[1];
+            dst[2] = src[0];
+            dst[3] = 0xFF;
+        }
+    }
+}
+
+void PreviewSpriteJob::copyTile( unsigned from, unsigned to )
+{
+    for( unsigned line = 0; line < _tileHeight; ++line )
+        memcpy( tileData( to, line ), tileData( from, line ), _tileWidth * 4 );
+}
+
+void PreviewSpriteJob::build()
+{
+    FrameGrabber grabber( _tileWidth );
+    if( !grabber.open( _libvlc.get(), _mrl, OPEN_TIMEOUT ) || grabber.length() <= 0 ) {
+        fail( "Can't decode video" );
+        return;
+    }
+
+    _duration = grabber.length();
+    _tileHeight = grabber.height();
+
+    const unsigned tiles =
+        static_cast<unsigned>( std::min<libvlc_time_t>(
+            MAX_SPRITE_TILES, ( _duration + _interval - 1 ) / _interval ) );
+    _rows = ( tiles + _columns - 1 ) / _columns;
+
+    const uint64_t spriteSize = static_cast<uint64_t>( _columns ) * _tileWidth * _rows * _tileHeight * 4;
+    if( spriteSize > MAX_SPRITE_SIZE ) {
+        fail( "Preview sprite is too large" );
+        return;
+    }
+    _sprite.assign( static_cast<size_t>( spriteSize ), 0 );
+    _tileTimes.assign( tiles, -1 );
+
+    //keyframes are decoded without preroll of following frames
+    const std::string path = MetaCache::localPath( _mrl );
+    std::shared_ptr<const KeyframeIndex> index =
+        path.empty() ? nullptr : KeyframeIndex::get( path );
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point lastNotify = Clock::now();
+
+    int lastTile = -1;
+    for( unsigned tile = 0; tile < tiles; ++tile ) {
+        libvlc_time_t time = static_cast<libvlc_time_t>( tile ) * _interval;
+        if( index ) {
+            const Keyframe& keyframe =
+                index->keyframes()[index->nearest( static_cast<int64_t>( time ) * 1000 )];
+            time = static_cast<libvlc_time_t>( keyframe.time / 1000 );
+        }
+
+        if( lastTile >= 0 && _tileTimes[lastTile] == time ) {
+            //long GOP, the same keyframe
+            copyTile( lastTile, tile );
+            _tileTimes[tile] = static_cast<double>( time );
+        } else if( const uint8_t* frame = grabber.grab( time, GRAB_TIMEOUT ) ) {
+            storeTile( tile, frame );
+            _tileTimes[tile] = static_cast<double>( time );
+            lastTile = tile;
+        }
+        //tile stays transparent if frame is not decoded
+
+        _completedTiles = tile + 1;
+
+        const Clock::time_point now = Clock::now();
+        if( now - lastNotify >= std::chrono::milliseconds( PREVIEW_PROGRESS_INTERVAL ) ) {
+            lastNotify = now;
+            notify();
+        }
+    }
+
+    grabber.close();
+
+    finish();
+}
+
+void PreviewSpriteJob::onNotify()
+{
+    using namespace v8;
+
+    if( _jsOnProgress.IsEmpty() || _tileTimes.empty() )
+        return;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    const unsigned completedTiles = _completedTiles;
+
+    Local<Function> jsOnProgress = Local<Function>::New( isolate, _jsOnProgress );
+    Local<Value> argv[] = {
+        ToJsValue( static_cast<double>( completedTiles ) / _tileTimes.size() ),
+        ToJsValue( completedTiles ),
+    };
+    jsOnProgress->Call( isolate->GetCurrentContext()->Global(), 2, argv );
+}
+
+v8::Local<v8::Value> PreviewSpriteJob::result()
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    EscapableHandleScope scope( isolate );
+
+    Local<Object> jsSprite = NewTypedArray( "Uint8Array", _sprite.size() );
+    memcpy( jsSprite->GetIndexedPropertiesExternalArrayData(), _sprite.data(), _sprite.size() );
+
+    Local<Array> jsTiles = Array::New( isolate, _tileTimes.size() );
+    for( unsigned i = 0; i < _tileTimes.size(); ++i ) {
+        jsTiles->Set( i, ToJsValue( _tileTimes[i] ) );
+    }
+
+    const PropertyAttribute attributes = static_cast<v8::PropertyAttribute>( ReadOnly | DontDelete );
+    jsSprite->ForceSet( String::NewFromUtf8( isolate, "width", v8::String::kInternalizedString ),
+                        ToJsValue( _columns * _tileWidth ), attributes );
+    jsSprite->ForceSet( String::NewFromUtf8( isolate, "height", v8::String::kInternalizedString ),
+                        ToJsValue( _rows * _tileHeight ), attributes );
+    jsSprite->ForceSet( String::NewFromUtf8( isolate, "tileWidth", v8::String::kInternalizedString ),
+                        ToJsValue( _tileWidth ), attributes );
+    jsSprite->ForceSet( String::NewFromUtf8( isolate, "tileHeight", v8::String::kInternalizedString ),
+                        ToJsValue( _tileHeight ), attributes );
+    jsSprite->ForceSet( String::NewFromUtf8( isolate, "columns", v8::String::kInternalizedString ),
+                        ToJsValue( _columns ), attributes );
+    jsSprite->ForceSet( String::NewFromUtf8( isolate, "interval", v8::String::kInternalizedString ),
+                        ToJsValue( _interval ), attributes );
+    jsSprite->ForceSet( String::NewFromUtf8( isolate, "duration", v8::String::kInternalizedString ),
+                        ToJsValue( static_cast<double>( _duration ) ), attributes );
+    jsSprite->ForceSet( String::NewFromUtf8( isolate, "tiles", v8::String::kInternalizedString ),
+                        jsTiles, attributes );
+
+    return scope.Escape( jsSprite );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void JsVlcVideoPreview::initJsApi( const v8::Local<v8::Function>& playerConstructor )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    playerConstructor->Set(
+        String::NewFromUtf8( isolate, "buildPreviewSprite", v8::String::kInternalizedString ),
+        FunctionTemplate::New( isolate, jsBuildPreviewSprite )->GetFunction() );
+}
+
+//buildPreviewSprite( mrl, { interval, tileWidth, columns, onProgress } ),
+//resolved with RGBA Uint8Array sprite, tile i is at column i % columns, row i / columns,
+//and sprite.tiles[i] is time (in ms) of its frame (-1 if frame was not decoded)
+void JsVlcVideoPreview::jsBuildPreviewSprite( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    HandleScope scope( isolate );
+
+    unsigned interval = DEFAULT_PREVIEW_INTERVAL;
+    unsigned tileWidth = DEFAULT_TILE_WIDTH;
+    unsigned columns = DEFAULT_SPRITE_COLUMNS;
+    Local<Function> onProgress;
+
+    if( args[1]->IsObject() ) {
+        Local<Object> options = Local<Object>::Cast( args[1] );
+
+        Local<Value> jsInterval =
+            options->Get( String::NewFromUtf8( isolate, "interval", v8::String::kInternalizedString ) );
+        if( jsInterval->IsNumber() )
+            interval = std::max( MIN_PREVIEW_INTERVAL, FromJsValue<unsigned>( jsInterval ) );
+
+        Local<Value> jsTileWidth =
+            options->Get( String::NewFromUtf8( isolate, "tileWidth", v8::String::kInternalizedString ) );
+        if( jsTileWidth->IsNumber() )
+            tileWidth = std::min( std::max( 2u, FromJsValue<unsigned>( jsTileWidth ) & ~1u ), MAX_TILE_WIDTH );
+
+        Local<Value> jsColumns =
+            options->Get( String::NewFromUtf8( isolate, "columns", v8::String::kInternalizedString ) );
+        if( jsColumns->IsNumber() )
+            columns = std::min( std::max( 1u, FromJsValue<unsigned>( jsColumns ) ), MAX_SPRITE_TILES );
+
+        Local<Value> jsOnProgress =
+            options->Get( String::NewFromUtf8( isolate, "onProgress", v8::String::kInternalizedString ) );
+        if( jsOnProgress->IsFunction() )
+            onProgress = Local<Function>::Cast( jsOnProgress );
+    }
+
+    PreviewSpriteJob* job =
+        new PreviewSpriteJob( SharedLibvlc(), FromJsValue<std::string>( args[0] ),
+                              interval, tileWidth, columns, onProgress );
+    args.GetReturnValue().Set( job->promise() );
+    job->start();
+}
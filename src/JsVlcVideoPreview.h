@@ -0,0 +1,14 @@
+#pragma once
+
+#include <v8.h>
+
+//offline (headless decode) video previews of media files
+class JsVlcVideoPreview
+{
+public:
+    //adds static methods to VlcPlayer constructor
+    static void initJsApi( const v8::Local<v8::Function>& playerConstructor );
+
+private:
+    static void jsBuildPreviewSprite( const v8::FunctionCallbackInfo<v8::Value>& args );
+};
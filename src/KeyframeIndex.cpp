@@ -0,0 +1,650 @@
+#include "KeyframeIndex.h"
+
+#include <list>
+#include <mutex>
+#include <algorithm>
+
+#include "MappedFile.h"
+
+//count of indexes kept by get()
+static const size_t INDEX_CACHE_SIZE = 16;
+
+///////////////////////////////////////////////////////////////////////////////
+namespace {
+
+struct Range
+{
+    const uint8_t* data;
+    uint64_t size;
+};
+
+uint32_t BE32( const uint8_t* p )
+{
+    return ( uint32_t( p[0] ) << 24 ) | ( uint32_t( p[1] ) << 16 ) |
+           ( uint32_t( p[2] ) << 8 ) | uint32_t( p[3] );
+}
+
+uint64_t BE64( const uint8_t* p )
+{
+    return ( uint64_t( BE32( p ) ) << 32 ) | BE32( p + 4 );
+}
+
+constexpr uint32_t Fourcc( const char* s )
+{
+    return ( uint32_t( uint8_t( s[0] ) ) << 24 ) | ( uint32_t( uint8_t( s[1] ) ) << 16 ) |
+           ( uint32_t( uint8_t( s[2] ) ) << 8 ) | uint32_t( uint8_t( s[3] ) );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//MP4 boxes
+
+//calls f( type, payload ) for every child box while it returns true
+template<typename F>
+void ForEachBox( const Range& range, F f )
+{
+    uint64_t pos = 0;
+    while( range.size - pos >= 8 ) {
+        const uint8_t* box = range.data + pos;
+        uint64_t size = BE32( box );
+        const uint32_t type = BE32( box + 4 );
+        uint64_t headerSize = 8;
+        if( 1 == size ) {
+            if( range.size - pos < 16 )
+                return;
+            size = BE64( box + 8 );
+            headerSize = 16;
+        } else if( 0 == size )
+            size = range.size - pos; //box extends to end of parent
+
+        if( size < headerSize || size > range.size - pos )
+            return;
+
+        if( !f( type, Range { box + headerSize, size - headerSize } ) )
+            return;
+
+        pos += size;
+    }
+}
+
+bool FindBox( const Range& range, uint32_t type, Range* found )
+{
+    bool result = false;
+    ForEachBox( range,
+        [type, found, &result] ( uint32_t boxType, const Range& payload ) {
+            if( boxType != type )
+                return true;
+            *found = payload;
+            result = true;
+            return false;
+        } );
+
+    return result;
+}
+
+bool FindBoxPath( Range range, std::initializer_list<const char*> path, Range* found )
+{
+    for( const char* type: path ) {
+        if( !FindBox( range, Fourcc( type ), &range ) )
+            return false;
+    }
+    *found = range;
+
+    return true;
+}
+
+//table of full box: [version/flags][entry count][entries], returns entry count
+uint32_t TableEntries( const Range& box, uint64_t headerSize, uint64_t entrySize )
+{
+    if( box.size < headerSize )
+        return 0;
+
+    const uint32_t count = BE32( box.data + headerSize - 4 );
+
+    return static_cast<uint32_t>(
+        std::min<uint64_t>( count, ( box.size - headerSize ) / entrySize ) );
+}
+
+//timescale of mvhd/mdhd
+uint32_t Timescale( const Range& box )
+{
+    if( box.size < 24 )
+        return 0;
+
+    return 1 == box.data[0] ? BE32( box.data + 20 ) : BE32( box.data + 12 );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//EBML elements
+
+const uint32_t EBML_ID = 0x1A45DFA3;
+const uint32_t SEGMENT_ID = 0x18538067;
+const uint32_t SEEK_HEAD_ID = 0x114D9B74;
+const uint32_t SEEK_ID = 0x4DBB;
+const uint32_t SEEK_ID_ID = 0x53AB;
+const uint32_t SEEK_POSITION_ID = 0x53AC;
+const uint32_t INFO_ID = 0x1549A966;
+const uint32_t TIMECODE_SCALE_ID = 0x2AD7B1;
+const uint32_t TRACKS_ID = 0x1654AE6B;
+const uint32_t TRACK_ENTRY_ID = 0xAE;
+const uint32_t TRACK_NUMBER_ID = 0xD7;
+const uint32_t TRACK_TYPE_ID = 0x83;
+const uint32_t DEFAULT_DURATION_ID = 0x23E383;
+const uint32_t CUES_ID = 0x1C53BB6B;
+const uint32_t CUE_POINT_ID = 0xBB;
+const uint32_t CUE_TIME_ID = 0xB3;
+const uint32_t CUE_TRACK_POSITIONS_ID = 0xB7;
+const uint32_t CUE_TRACK_ID = 0xF7;
+const uint32_t CUE_CLUSTER_POSITION_ID = 0xF1;
+
+const uint8_t MKV_VIDEO_TRACK = 1;
+
+//variable size integer, id keeps length marker bits
+bool ReadVint( const uint8_t* p, uint64_t available, bool keepMarker,
+               uint64_t* value, unsigned* length, bool* allOnes )
+{
+    if( !available || !p[0] )
+        return false;
+
+    unsigned len = 1;
+    while( !( p[0] & ( 0x80 >> ( len - 1 ) ) ) )
+        ++len;
+    if( len > available )
+        return false;
+
+    const uint8_t firstMask = 0xFF >> len;
+    uint64_t v = keepMarker ? p[0] : ( p[0] & firstMask );
+    bool ones = ( p[0] & firstMask ) == firstMask;
+    for( unsigned i = 1; i < len; ++i ) {
+        v = ( v << 8 ) | p[i];
+        ones = ones && 0xFF == p[i];
+    }
+
+    *value = v;
+    *length = len;
+    *allOnes = ones;
+
+    return true;
+}
+
+//reads element header at p, payload of element with unknown size extends to end of range
+bool ReadElement( const uint8_t* p, uint64_t available, uint32_t* id, Range* payload )
+{
+    uint64_t idValue, size;
+    unsigned idLength, sizeLength;
+    bool allOnes;
+    if( !ReadVint( p, available, true, &idValue, &idLength, &allOnes ) || idLength > 4 ||
+        !ReadVint( p + idLength, available - idLength, false, &size, &sizeLength, &allOnes ) )
+    {
+        return false;
+    }
+
+    const uint64_t headerSize = idLength + sizeLength;
+    if( allOnes )
+        size = available - headerSize;
+    else if( size > available - headerSize )
+        return false;
+
+    *id = static_cast<uint32_t>( idValue );
+    *payload = Range { p + headerSize, size };
+
+    return true;
+}
+
+//calls f( id, payload ) for every child element while it returns true
+template<typename F>
+void ForEachElement( const Range& range, F f )
+{
+    uint64_t pos = 0;
+    while( pos < range.size ) {
+        uint32_t id;
+        Range payload;
+        if( !ReadElement( range.data + pos, range.size - pos, &id, &payload ) )
+            return;
+
+        if( !f( id, payload ) )
+            return;
+
+        pos = ( payload.data + payload.size ) - range.data;
+    }
+}
+
+uint64_t ElementUint( const Range& payload )
+{
+    uint64_t value = 0;
+    for( uint64_t i = 0; i < payload.size && i < 8; ++i )
+        value = ( value << 8 ) | payload.data[i];
+
+    return value;
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<const KeyframeIndex> KeyframeIndex::build( const std::string& path )
+{
+    MappedFile file;
+    if( !file.open( path ) || file.size() < 8 )
+        return nullptr;
+
+    //container indexes are small, but scattered over file
+    file.adviseAccess( MappedFile::AccessPattern::Random );
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>( file.data() );
+
+    std::shared_ptr<KeyframeIndex> index( new KeyframeIndex );
+    const bool parsed =
+        EBML_ID == BE32( data ) ?
+            index->parseMkv( data, file.size() ) :
+            index->parseMp4( data, file.size() );
+    if( !parsed || index->_keyframes.empty() )
+        return nullptr;
+
+    std::sort( index->_keyframes.begin(), index->_keyframes.end(),
+        [] ( const Keyframe& l, const Keyframe& r ) {
+            return l.time < r.time;
+        } );
+
+    return index;
+}
+
+std::shared_ptr<const KeyframeIndex> KeyframeIndex::get( const std::string& path )
+{
+    struct CacheEntry
+    {
+        std::string path;
+        uint64_t size;
+        int64_t time;
+        std::shared_ptr<const KeyframeIndex> index;
+    };
+
+    static std::mutex guard;
+    //most recently used first
+    static std::list<CacheEntry> cache;
+
+    uint64_t size;
+    int64_t time;
+    if( !MappedFile::stat( path, &size, &time ) )
+        return nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock( guard );
+        for( auto it = cache.begin(); it != cache.end(); ++it ) {
+            if( it->path == path && it->size == size && it->time == time ) {
+                cache.splice( cache.begin(), cache, it );
+                return it->index;
+            }
+        }
+    }
+
+    //file is parsed without lock, so concurrent requests could build the same index twice
+    std::shared_ptr<const KeyframeIndex> index = build( path );
+    if( !index )
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock( guard );
+    cache.push_front( CacheEntry { path, size, time, index } );
+    if( cache.size() > INDEX_CACHE_SIZE )
+        cache.pop_back();
+
+    return index;
+}
+
+size_t KeyframeIndex::floor( int64_t time ) const
+{
+    auto it = std::upper_bound( _keyframes.begin(), _keyframes.end(), time,
+        [] ( int64_t time, const Keyframe& keyframe ) {
+            return time < keyframe.time;
+        } );
+
+    return it == _keyframes.begin() ? 0 : ( it - _keyframes.begin() ) - 1;
+}
+
+size_t KeyframeIndex::nearest( int64_t time ) const
+{
+    const size_t before = floor( time );
+    const size_t after = before + 1;
+    if( after < _keyframes.size() &&
+        _keyframes[after].time - time < time - _keyframes[before].time )
+    {
+        return after;
+    }
+
+    return before;
+}
+
+bool KeyframeIndex::parseMp4( const uint8_t* data, uint64_t size )
+{
+    Range moov;
+    if( !FindBox( Range { data, size }, Fourcc( "moov" ), &moov ) )
+        return false;
+
+    Range mvhd;
+    const uint32_t movieTimescale =
+        FindBox( moov, Fourcc( "mvhd" ), &mvhd ) ? Timescale( mvhd ) : 0;
+
+    //first video track
+    Range trak, mdia;
+    bool found = false;
+    ForEachBox( moov,
+        [&] ( uint32_t type, const Range& payload ) {
+            Range hdlr;
+            if( type != Fourcc( "trak" ) ||
+                !FindBox( payload, Fourcc( "mdia" ), &mdia ) ||
+                !FindBox( mdia, Fourcc( "hdlr" ), &hdlr ) ||
+                hdlr.size < 12 || BE32( hdlr.data + 8 ) != Fourcc( "vide" ) )
+            {
+                return true;
+            }
+            trak = payload;
+            found = true;
+            return false;
+        } );
+    if( !found )
+        return false;
+
+    Range mdhd, stbl, stts, stsz, stsc, stco;
+    if( !FindBox( mdia, Fourcc( "mdhd" ), &mdhd ) ||
+        !FindBoxPath( mdia, { "minf", "stbl" }, &stbl ) ||
+        !FindBox( stbl, Fourcc( "stts" ), &stts ) ||
+        !FindBox( stbl, Fourcc( "stsz" ), &stsz ) ||
+        !FindBox( stbl, Fourcc( "stsc" ), &stsc ) )
+    {
+        return false;
+    }
+
+    const uint32_t timescale = Timescale( mdhd );
+    if( !timescale )
+        return false;
+
+    bool largeOffsets = false;
+    if( !FindBox( stbl, Fourcc( "stco" ), &stco ) ) {
+        if( !FindBox( stbl, Fourcc( "co64" ), &stco ) )
+            return false;
+        largeOffsets = true;
+    }
+
+    //optional tables: no stss means every sample is sync sample
+    Range stss, ctts, elst;
+    const bool hasStss = FindBox( stbl, Fourcc( "stss" ), &stss );
+    const bool hasCtts = FindBox( stbl, Fourcc( "ctts" ), &ctts );
+    const bool hasElst = FindBoxPath( trak, { "edts", "elst" }, &elst );
+
+    //presentation time shift from edit list:
+    //empty edits delay track, first media edit skips media_time
+    int64_t shift = 0;
+    if( hasElst && movieTimescale ) {
+        const bool v1 = 1 == elst.data[0];
+        const uint64_t entrySize = v1 ? 20 : 12;
+        const uint32_t count = TableEntries( elst, 8, entrySize );
+        for( uint32_t i = 0; i < count; ++i ) {
+            const uint8_t* entry = elst.data + 8 + i * entrySize;
+            const uint64_t duration = v1 ? BE64( entry ) : BE32( entry );
+            const int64_t mediaTime =
+                v1 ? static_cast<int64_t>( BE64( entry + 8 ) ) :
+                     static_cast<int32_t>( BE32( entry + 4 ) );
+            if( -1 == mediaTime ) {
+                shift += static_cast<int64_t>( duration * timescale / movieTimescale );
+            } else {
+                shift -= mediaTime;
+                break;
+            }
+        }
+    }
+
+    const uint32_t sampleSize = stsz.size >= 12 ? BE32( stsz.data + 4 ) : 0;
+    const uint32_t sampleCount =
+        0 == sampleSize ?
+            TableEntries( Range { stsz.data + 4, stsz.size - 4 }, 8, 4 ) :
+            ( stsz.size >= 12 ? BE32( stsz.data + 8 ) : 0 );
+    const uint8_t* sampleSizes = stsz.data + 12;
+
+    const uint32_t sttsCount = TableEntries( stts, 8, 8 );
+    const uint32_t stssCount = hasStss ? TableEntries( stss, 8, 4 ) : 0;
+    const uint32_t cttsCount = hasCtts ? TableEntries( ctts, 8, 8 ) : 0;
+    const uint32_t stscCount = TableEntries( stsc, 8, 12 );
+    const uint32_t chunkCount = TableEntries( stco, 8, largeOffsets ? 8 : 4 );
+    if( !sampleCount || !sttsCount || !stscCount || !chunkCount )
+        return false;
+
+    //tables are walked together, sample by sample
+    uint32_t sttsIdx = 0, sttsLeft = BE32( stts.data + 8 );
+    uint32_t cttsIdx = 0, cttsLeft = cttsCount ? BE32( ctts.data + 8 ) : 0;
+    uint32_t stssIdx = 0;
+    uint32_t stscIdx = 0;
+    uint32_t chunk = 0; //0-based
+    uint32_t chunkSamplesLeft = 0;
+    uint64_t offset = 0;
+    int64_t dts = 0;
+
+    for( uint32_t sample = 0; sample < sampleCount; ++sample ) {
+        if( !chunkSamplesLeft ) {
+            if( sample ) ++chunk;
+            if( chunk >= chunkCount )
+                break;
+            //stsc entries are sorted by first chunk (1-based)
+            while( stscIdx + 1 < stscCount &&
+                   BE32( stsc.data + 8 + ( stscIdx + 1 ) * 12 ) <= chunk + 1 )
+            {
+                ++stscIdx;
+            }
+            chunkSamplesLeft = BE32( stsc.data + 8 + stscIdx * 12 + 4 );
+            if( !chunkSamplesLeft ) {
+                --sample;
+                continue;
+            }
+            offset = largeOffsets ?
+                BE64( stco.data + 8 + chunk * 8 ) :
+                BE32( stco.data + 8 + chunk * 4 );
+        }
+
+        while( !sttsLeft && ++sttsIdx < sttsCount )
+            sttsLeft = BE32( stts.data + 8 + sttsIdx * 8 );
+        const uint32_t delta = sttsIdx < sttsCount ? BE32( stts.data + 8 + sttsIdx * 8 + 4 ) : 0;
+
+        int64_t compositionOffset = 0;
+        if( cttsCount ) {
+            while( !cttsLeft && ++cttsIdx < cttsCount )
+                cttsLeft = BE32( ctts.data + 8 + cttsIdx * 8 );
+            if( cttsIdx < cttsCount ) {
+                compositionOffset = static_cast<int32_t>( BE32( ctts.data + 8 + cttsIdx * 8 + 4 ) );
+                --cttsLeft;
+            }
+        }
+
+        //stss sample numbers are 1-based and sorted
+        bool sync = !hasStss;
+        while( stssIdx < stssCount && BE32( stss.data + 8 + stssIdx * 4 ) < sample + 1 )
+            ++stssIdx;
+        if( stssIdx < stssCount && BE32( stss.data + 8 + stssIdx * 4 ) == sample + 1 )
+            sync = true;
+
+        if( sync ) {
+            const int64_t pts = dts + compositionOffset + shift;
+            _keyframes.push_back(
+                Keyframe { std::max<int64_t>( pts, 0 ) * 1000000 / timescale, offset } );
+        }
+
+        const uint32_t size =
+            sampleSize ? sampleSize :
+            ( sample < ( stsz.size - 12 ) / 4 ? BE32( sampleSizes + sample * 4 ) : 0 );
+        offset += size;
+        --chunkSamplesLeft;
+
+        dts += delta;
+        if( sttsLeft )
+            --sttsLeft;
+    }
+
+    if( sampleCount )
+        _frameDuration = dts * 1000000 / timescale / sampleCount;
+
+    return true;
+}
+
+bool KeyframeIndex::parseMkv( const uint8_t* data, uint64_t size )
+{
+    Range file { data, size };
+
+    Range segment;
+    bool found = false;
+    ForEachElement( file,
+        [&segment, &found] ( uint32_t id, const Range& payload ) {
+            if( id != SEGMENT_ID )
+                return true;
+            segment = payload;
+            found = true;
+            return false;
+        } );
+    if( !found )
+        return false;
+
+    uint64_t timecodeScale = 1000000;
+    uint64_t videoTrack = 0;
+    bool tracksParsed = false;
+    bool cuesParsed = false;
+
+    //positions (relative to segment data) of top level elements from SeekHead
+    uint64_t tracksPosition = 0, cuesPosition = 0, infoPosition = 0;
+
+    auto parseInfo =
+        [&timecodeScale] ( const Range& info ) {
+            ForEachElement( info,
+                [&timecodeScale] ( uint32_t id, const Range& payload ) {
+                    if( TIMECODE_SCALE_ID == id )
+                        timecodeScale = ElementUint( payload );
+                    return true;
+                } );
+        };
+
+    auto parseTracks =
+        [this, &videoTrack, &tracksParsed] ( const Range& tracks ) {
+            tracksParsed = true;
+            ForEachElement( tracks,
+                [this, &videoTrack] ( uint32_t id, const Range& entry ) {
+                    if( TRACK_ENTRY_ID != id )
+                        return true;
+
+                    uint64_t number = 0, type = 0, defaultDuration = 0;
+                    ForEachElement( entry,
+                        [&] ( uint32_t id, const Range& payload ) {
+                            if( TRACK_NUMBER_ID == id )
+                                number = ElementUint( payload );
+                            else if( TRACK_TYPE_ID == id )
+                                type = ElementUint( payload );
+                            else if( DEFAULT_DURATION_ID == id )
+                                defaultDuration = ElementUint( payload );
+                            return true;
+                        } );
+
+                    if( MKV_VIDEO_TRACK != type )
+                        return true;
+
+                    videoTrack = number;
+                    _frameDuration = static_cast<int64_t>( defaultDuration / 1000 );
+                    return false;
+                } );
+        };
+
+    //CueTime is in timecode scale units (ns), so Info should be parsed before Cues
+    std::vector<std::pair<uint64_t, uint64_t> > cues; //time, cluster position
+    auto parseCues =
+        [&cues, &videoTrack, &cuesParsed] ( const Range& cuesRange ) {
+            cuesParsed = true;
+            ForEachElement( cuesRange,
+                [&] ( uint32_t id, const Range& cuePoint ) {
+                    if( CUE_POINT_ID != id )
+                        return true;
+
+                    uint64_t time = 0;
+                    ForEachElement( cuePoint,
+                        [&] ( uint32_t id, const Range& payload ) {
+                            if( CUE_TIME_ID == id ) {
+                                time = ElementUint( payload );
+                            } else if( CUE_TRACK_POSITIONS_ID == id ) {
+                                uint64_t track = 0, position = 0;
+                                ForEachElement( payload,
+                                    [&] ( uint32_t id, const Range& value ) {
+                                        if( CUE_TRACK_ID == id )
+                                            track = ElementUint( value );
+                                        else if( CUE_CLUSTER_POSITION_ID == id )
+                                            position = ElementUint( value );
+                                        return true;
+                                    } );
+                                //CueTime precedes positions in all known muxers
+                                if( !videoTrack || track == videoTrack )
+                                    cues.emplace_back( time, position );
+                            }
+                            return true;
+                        } );
+                    return true;
+                } );
+        };
+
+    ForEachElement( segment,
+        [&] ( uint32_t id, const Range& payload ) {
+            switch( id ) {
+                case SEEK_HEAD_ID:
+                    ForEachElement( payload,
+                        [&] ( uint32_t id, const Range& seek ) {
+                            if( SEEK_ID != id )
+                                return true;
+                            uint64_t seekId = 0, position = 0;
+                            ForEachElement( seek,
+                                [&] ( uint32_t id, const Range& value ) {
+                                    if( SEEK_ID_ID == id )
+                                        seekId = ElementUint( value );
+                                    else if( SEEK_POSITION_ID == id )
+                                        position = ElementUint( value );
+                                    return true;
+                                } );
+                            if( CUES_ID == seekId )
+                                cuesPosition = position;
+                            else if( TRACKS_ID == seekId )
+                                tracksPosition = position;
+                            else if( INFO_ID == seekId )
+                                infoPosition = position;
+                            return true;
+                        } );
+                    break;
+                case INFO_ID:
+                    parseInfo( payload );
+                    infoPosition = 0;
+                    break;
+                case TRACKS_ID:
+                    parseTracks( payload );
+                    break;
+                case CUES_ID:
+                    parseCues( payload );
+                    break;
+            }
+
+            //cluster of unknown size spans to end of file, so Cues after it
+            //(if any) could be found only with SeekHead
+            return payload.data + payload.size < segment.data + segment.size;
+        } );
+
+    auto elementAt =
+        [&segment] ( uint64_t position, uint32_t expectedId, Range* payload ) {
+            uint32_t id;
+            return position < segment.size &&
+                   ReadElement( segment.data + position, segment.size - position, &id, payload ) &&
+                   id == expectedId;
+        };
+
+    Range payload;
+    if( infoPosition && elementAt( infoPosition, INFO_ID, &payload ) )
+        parseInfo( payload );
+    if( !tracksParsed && tracksPosition && elementAt( tracksPosition, TRACKS_ID, &payload ) )
+        parseTracks( payload );
+    if( !cuesParsed && cuesPosition && elementAt( cuesPosition, CUES_ID, &payload ) )
+        parseCues( payload );
+
+    const uint64_t segmentStart = segment.data - data;
+    for( const auto& cue: cues ) {
+        _keyframes.push_back(
+            Keyframe { static_cast<int64_t>( cue.first * timecodeScale / 1000 ),
+                       segmentStart + cue.second } );
+    }
+
+    return !_keyframes.empty();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+struct Keyframe
+{
+    //presentation time, in microseconds
+    int64_t time;
+    //byte offset of frame (MP4), or of cluster containing it (MKV)
+    uint64_t offset;
+};
+
+//Keyframes of first video track of local file, read from container index
+//(MP4 sample tables, MKV/WebM Cues) without decoding.
+//Fragmented MP4 and files without Cues are not supported.
+class KeyframeIndex
+{
+public:
+    //returns nullptr if file can't be indexed
+    static std::shared_ptr<const KeyframeIndex> build( const std::string& path );
+    //built indexes are cached in memory, validated by file size and modification time.
+    //Thread safe.
+    static std::shared_ptr<const KeyframeIndex> get( const std::string& path );
+
+    const std::vector<Keyframe>& keyframes() const
+        { return _keyframes; }
+    //average frame duration in microseconds, or 0 if unknown
+    int64_t frameDuration() const
+        { return _frameDuration; }
+
+    //index of last keyframe at or before time (first keyframe if there is no such)
+    size_t floor( int64_t time ) const;
+    //index of keyframe closest to time
+    size_t nearest( int64_t time ) const;
+
+private:
+    KeyframeIndex() : _frameDuration( 0 ) {}
+
+    bool parseMp4( const uint8_t* data, uint64_t size );
+    bool parseMkv( const uint8_t* data, uint64_t size );
+
+private:
+    //sorted by time
+    std::vector<Keyframe> _keyframes;
+    int64_t _frameDuration;
+};
@@ -0,0 +1,270 @@
+#include "LoudnessMeter.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "AudioConverter.h"
+
+namespace {
+
+const double Pi = 3.14159265358979323846;
+
+const unsigned SubBlocksPerMomentary = 4;  //400ms
+const unsigned SubBlocksPerShortTerm = 30; //3s
+
+const double AbsoluteGate = -70.;
+const double IntegratedRelativeGate = -10.;
+const double RangeRelativeGate = -20.;
+
+const unsigned OversamplingPhases = 4;
+const unsigned OversamplingTaps = 12;
+
+inline double Loudness( double energy )
+{
+    return energy > 0 ? -0.691 + 10 * log10( energy ) : -HUGE_VAL;
+}
+
+inline double Energy( double loudness )
+{
+    return pow( 10., ( loudness + 0.691 ) / 10 );
+}
+
+inline double Filter( double x, double* state, const double* coefficients )
+{
+    //direct form I: state is x1, x2, y1, y2
+    const double y = coefficients[0] * x + coefficients[1] * state[0] + coefficients[2] * state[1] -
+                     coefficients[3] * state[2] - coefficients[4] * state[3];
+    state[1] = state[0];
+    state[0] = x;
+    state[3] = state[2];
+    state[2] = y;
+    return y;
+}
+
+}
+
+LoudnessMeter::LoudnessMeter( unsigned rate, unsigned channels ) :
+    _rate( rate ), _channels( channels ),
+    _weights( channels, 1. ), _state( channels * 8, 0. ),
+    _subBlockFrames( std::max( 1u, rate / 10 ) ), _subBlockPosition( 0 ), _subBlockEnergy( 0 ),
+    _recentSubBlocks( SubBlocksPerShortTerm, 0. ), _subBlockCount( 0 ),
+    _peakHistory( channels * OversamplingTaps * 2, 0.f ), _peakHistoryPosition( 0 ),
+    _truePeak( 0 ), _samplePeak( 0 ), _processedFrames( 0 )
+{
+    for( unsigned c = 0; c < channels; ++c ) {
+        switch( AudioChannelAt( channels, c ) ) {
+            case AudioChannel::LFE:
+                _weights[c] = 0.;
+                break;
+            case AudioChannel::RearLeft:
+            case AudioChannel::RearRight:
+            case AudioChannel::RearCenter:
+            case AudioChannel::MiddleLeft:
+            case AudioChannel::MiddleRight:
+                _weights[c] = 1.41;
+                break;
+            default:
+                break;
+        }
+    }
+
+    //K-weighting for arbitrary sample rate, BS.1770 stage 1 (high shelf)...
+    {
+        const double f0 = 1681.974450955533;
+        const double gain = 3.999843853973347;
+        const double q = 0.7071752369554196;
+        const double k = tan( Pi * f0 / rate );
+        const double vh = pow( 10., gain / 20 );
+        const double vb = pow( vh, 0.4996667741545416 );
+        const double a0 = 1 + k / q + k * k;
+        _shelf.b0 = ( vh + vb * k / q + k * k ) / a0;
+        _shelf.b1 = 2 * ( k * k - vh ) / a0;
+        _shelf.b2 = ( vh - vb * k / q + k * k ) / a0;
+        _shelf.a1 = 2 * ( k * k - 1 ) / a0;
+        _shelf.a2 = ( 1 - k / q + k * k ) / a0;
+    }
+    //...and stage 2 (RLB high pass)
+    {
+        const double f0 = 38.13547087602444;
+        const double q = 0.5003270373238773;
+        const double k = tan( Pi * f0 / rate );
+        const double a0 = 1 + k / q + k * k;
+        _highPass.b0 = 1;
+        _highPass.b1 = -2;
+        _highPass.b2 = 1;
+        _highPass.a1 = 2 * ( k * k - 1 ) / a0;
+        _highPass.a2 = ( 1 - k / q + k * k ) / a0;
+    }
+
+    //4x oversampling interpolator, cutoff at source nyquist
+    const unsigned length = OversamplingPhases * OversamplingTaps;
+    const double center = ( length - 1 ) / 2.;
+    std::vector<double> response( length );
+    for( unsigned n = 0; n < length; ++n ) {
+        const double x = ( n - center ) / OversamplingPhases;
+        const double sinc = 0 == x ? 1. : sin( Pi * x ) / ( Pi * x );
+        const double window = 0.5 - 0.5 * cos( 2 * Pi * ( n + 0.5 ) / length );
+        response[n] = sinc * window;
+    }
+    _interpolator.resize( length );
+    for( unsigned p = 0; p < OversamplingPhases; ++p ) {
+        double sum = 0;
+        for( unsigned t = 0; t < OversamplingTaps; ++t )
+            sum += response[t * OversamplingPhases + p];
+        for( unsigned t = 0; t < OversamplingTaps; ++t ) {
+            _interpolator[p * OversamplingTaps + t] =
+                static_cast<float>( response[t * OversamplingPhases + p] / sum );
+        }
+    }
+}
+
+void LoudnessMeter::process( const float* samples, unsigned frames )
+{
+    const double shelf[] = { _shelf.b0, _shelf.b1, _shelf.b2, _shelf.a1, _shelf.a2 };
+    const double highPass[] = { _highPass.b0, _highPass.b1, _highPass.b2, _highPass.a1, _highPass.a2 };
+
+    for( unsigned f = 0; f < frames; ++f, samples += _channels ) {
+        double energy = 0;
+        for( unsigned c = 0; c < _channels; ++c ) {
+            const float sample = samples[c];
+
+            _samplePeak = std::max( _samplePeak, static_cast<double>( fabsf( sample ) ) );
+            _truePeak = std::max( _truePeak, truePeakOf( c, sample ) );
+
+            if( 0. == _weights[c] )
+                continue;
+
+            double* state = &_state[c * 8];
+            const double y = Filter( Filter( sample, state, shelf ), state + 4, highPass );
+            energy += _weights[c] * y * y;
+        }
+        _subBlockEnergy += energy;
+
+        _peakHistoryPosition = ( _peakHistoryPosition + 1 ) % OversamplingTaps;
+
+        if( ++_subBlockPosition == _subBlockFrames )
+            finishSubBlock();
+    }
+
+    _processedFrames += frames;
+}
+
+double LoudnessMeter::truePeakOf( unsigned channel, float sample )
+{
+    //history is duplicated, so last taps samples are always contiguous
+    float* history = &_peakHistory[channel * OversamplingTaps * 2];
+    history[_peakHistoryPosition] = sample;
+    history[_peakHistoryPosition + OversamplingTaps] = sample;
+
+    //newest sample is at the end of window
+    const float* window = history + _peakHistoryPosition + 1;
+
+    float peak = 0;
+    for( unsigned p = 0; p < OversamplingPhases; ++p ) {
+        const float* coefficients = &_interpolator[p * OversamplingTaps];
+        float sum = 0;
+        for( unsigned t = 0; t < OversamplingTaps; ++t )
+            sum += window[t] * coefficients[OversamplingTaps - 1 - t];
+        peak = std::max( peak, fabsf( sum ) );
+    }
+
+    return peak;
+}
+
+void LoudnessMeter::finishSubBlock()
+{
+    _recentSubBlocks[_subBlockCount % SubBlocksPerShortTerm] = _subBlockEnergy / _subBlockFrames;
+    ++_subBlockCount;
+
+    _subBlockPosition = 0;
+    _subBlockEnergy = 0;
+
+    //blocks overlap by 75% (momentary) and are evaluated every 100ms
+    if( _subBlockCount >= SubBlocksPerMomentary ) {
+        double sum = 0;
+        for( unsigned i = 1; i <= SubBlocksPerMomentary; ++i )
+            sum += _recentSubBlocks[( _subBlockCount - i ) % SubBlocksPerShortTerm];
+        _momentaryBlocks.push_back( sum / SubBlocksPerMomentary );
+    }
+
+    if( _subBlockCount >= SubBlocksPerShortTerm ) {
+        double sum = 0;
+        for( double e: _recentSubBlocks )
+            sum += e;
+        _shortTermBlocks.push_back( sum / SubBlocksPerShortTerm );
+    }
+}
+
+double LoudnessMeter::integrated() const
+{
+    const double absoluteGate = Energy( AbsoluteGate );
+
+    double sum = 0;
+    unsigned count = 0;
+    for( double e: _momentaryBlocks ) {
+        if( e > absoluteGate ) {
+            sum += e;
+            ++count;
+        }
+    }
+    if( !count )
+        return -HUGE_VAL;
+
+    const double relativeGate = Energy( Loudness( sum / count ) + IntegratedRelativeGate );
+
+    double gatedSum = 0;
+    unsigned gatedCount = 0;
+    for( double e: _momentaryBlocks ) {
+        if( e > absoluteGate && e > relativeGate ) {
+            gatedSum += e;
+            ++gatedCount;
+        }
+    }
+
+    return gatedCount ? Loudness( gatedSum / gatedCount ) : -HUGE_VAL;
+}
+
+double LoudnessMeter::range() const
+{
+    const double absoluteGate = Energy( AbsoluteGate );
+
+    double sum = 0;
+    unsigned count = 0;
+    for( double e: _shortTermBlocks ) {
+        if( e > absoluteGate ) {
+            sum += e;
+            ++count;
+        }
+    }
+    if( !count )
+        return 0;
+
+    const double relativeGate = Energy( Loudness( sum / count ) + RangeRelativeGate );
+
+    std::vector<double> gated;
+    gated.reserve( count );
+    for( double e: _shortTermBlocks ) {
+        if( e > absoluteGate && e > relativeGate )
+            gated.push_back( e );
+    }
+    if( gated.empty() )
+        return 0;
+
+    std::sort( gated.begin(), gated.end() );
+    const size_t low = static_cast<size_t>( ( gated.size() - 1 ) * 0.10 + 0.5 );
+    const size_t high = static_cast<size_t>( ( gated.size() - 1 ) * 0.95 + 0.5 );
+
+    return Loudness( gated[high] ) - Loudness( gated[low] );
+}
+
+double LoudnessMeter::truePeak() const
+{
+    const double peak = std::max( _truePeak, _samplePeak );
+    return peak > 0 ? 20 * log10( peak ) : -HUGE_VAL;
+}
+
+double LoudnessMeter::samplePeak() const
+{
+    return _samplePeak > 0 ? 20 * log10( _samplePeak ) : -HUGE_VAL;
+}
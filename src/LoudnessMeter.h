@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//EBU R128 (ITU-R BS.1770) loudness meter for interleaved float audio:
+//integrated loudness, loudness range and true peak (4x oversampling).
+//Channels are expected in libvlc order, LFE is not counted,
+//surround channels are weighted with +1.5dB.
+class LoudnessMeter
+{
+public:
+    LoudnessMeter( unsigned rate, unsigned channels );
+
+    void process( const float* samples, unsigned frames );
+
+    unsigned rate() const
+        { return _rate; }
+    unsigned channels() const
+        { return _channels; }
+    uint64_t processedFrames() const
+        { return _processedFrames; }
+
+    //in LUFS, -HUGE_VAL if input is silent
+    double integrated() const;
+    //in LU
+    double range() const;
+    //in dBTP/dBFS, -HUGE_VAL if input is silent
+    double truePeak() const;
+    double samplePeak() const;
+
+private:
+    struct Biquad
+    {
+        double b0, b1, b2, a1, a2;
+    };
+
+    void finishSubBlock();
+    double truePeakOf( unsigned channel, float sample );
+
+private:
+    const unsigned _rate;
+    const unsigned _channels;
+
+    std::vector<double> _weights;
+
+    Biquad _shelf;
+    Biquad _highPass;
+    //per channel filters state: x1, x2, y1, y2 of both stages
+    std::vector<double> _state;
+
+    //100ms sub-blocks
+    unsigned _subBlockFrames;
+    unsigned _subBlockPosition;
+    double _subBlockEnergy;
+    std::vector<double> _recentSubBlocks; //ring of last 30
+    unsigned _subBlockCount;
+
+    //mean energies of 400ms (momentary) and 3s (short term) blocks
+    std::vector<double> _momentaryBlocks;
+    std::vector<double> _shortTermBlocks;
+
+    //true peak interpolation
+    std::vector<float> _interpolator; //phases x taps
+    std::vector<float> _peakHistory; //per channel, taps values
+    unsigned _peakHistoryPosition;
+    double _truePeak;
+    double _samplePeak;
+
+    uint64_t _processedFrames;
+};
@@ -0,0 +1,299 @@
+#include "MappedFile.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <setjmp.h>
+
+#include <mutex>
+#include <atomic>
+#endif
+
+//address space of 32 bit process is too fragmented for larger mappings
+static const uint64_t MAX_MAPPED_SIZE =
+    sizeof( void* ) < 8 ? 512ULL * 1024 * 1024 : 1ULL << 40;
+
+#ifndef _WIN32
+namespace {
+
+//set while guarded copy runs on this thread
+thread_local sigjmp_buf* volatile FaultJump = nullptr;
+
+struct sigaction PrevBusAction;
+std::once_flag BusHandlerInstalled;
+
+void BusHandler( int signal, siginfo_t* info, void* context )
+{
+    if( FaultJump )
+        siglongjmp( *FaultJump, 1 );
+
+    //fault is not from guarded copy
+    if( PrevBusAction.sa_flags & SA_SIGINFO )
+        PrevBusAction.sa_sigaction( signal, info, context );
+    else if( SIG_DFL != PrevBusAction.sa_handler && SIG_IGN != PrevBusAction.sa_handler )
+        PrevBusAction.sa_handler( signal );
+    else
+        sigaction( SIGBUS, &PrevBusAction, nullptr ); //fault repeats with default action
+}
+
+void InstallBusHandler()
+{
+    struct sigaction action;
+    memset( &action, 0, sizeof( action ) );
+    action.sa_sigaction = BusHandler;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset( &action.sa_mask );
+
+    sigaction( SIGBUS, &action, &PrevBusAction );
+}
+
+}
+#endif
+
+#ifdef _WIN32
+std::wstring Utf8ToWide( const std::string& str )
+{
+    const int length =
+        MultiByteToWideChar( CP_UTF8, 0, str.c_str(), static_cast<int>( str.size() ), nullptr, 0 );
+    std::wstring wstr( length, L'\0' );
+    if( length > 0 ) {
+        MultiByteToWideChar( CP_UTF8, 0, str.c_str(), static_cast<int>( str.size() ),
+                             &wstr[0], length );
+    }
+
+    return wstr;
+}
+#endif
+
+MappedFile::MappedFile() :
+#ifdef _WIN32
+    _file( INVALID_HANDLE_VALUE ), _mapping( nullptr ),
+#else
+    _fd( -1 ),
+#endif
+    _data( nullptr ), _size( 0 )
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::canMap( uint64_t size )
+{
+    return size <= MAX_MAPPED_SIZE;
+}
+
+#ifdef _WIN32
+bool MappedFile::open( const std::string& path )
+{
+    close();
+
+    _file = CreateFileW( Utf8ToWide( path ).c_str(), GENERIC_READ,
+                         FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                         nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+    if( INVALID_HANDLE_VALUE == _file )
+        return false;
+
+    LARGE_INTEGER size;
+    if( !GetFileSizeEx( _file, &size ) || 0 == size.QuadPart || !canMap( size.QuadPart ) ) {
+        close();
+        return false;
+    }
+
+    _mapping = CreateFileMappingW( _file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    if( !_mapping ) {
+        close();
+        return false;
+    }
+
+    _data = static_cast<const char*>( MapViewOfFile( _mapping, FILE_MAP_READ, 0, 0, 0 ) );
+    if( !_data ) {
+        close();
+        return false;
+    }
+
+    _size = size.QuadPart;
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if( _data ) {
+        UnmapViewOfFile( _data );
+        _data = nullptr;
+    }
+    if( _mapping ) {
+        CloseHandle( _mapping );
+        _mapping = nullptr;
+    }
+    if( INVALID_HANDLE_VALUE != _file ) {
+        CloseHandle( _file );
+        _file = INVALID_HANDLE_VALUE;
+    }
+    _size = 0;
+}
+
+void MappedFile::adviseAccess( AccessPattern )
+{
+    //there is no per mapping access hints on Windows
+}
+
+void MappedFile::adviseWillNeed( uint64_t, uint64_t )
+{
+}
+
+bool MappedFile::copy( uint64_t offset, void* buffer, size_t size ) const
+{
+    //mapped file can't be truncated on Windows,
+    //but pages of network file could fail to load
+#ifdef _MSC_VER
+    __try {
+        memcpy( buffer, _data + offset, size );
+    } __except( EXCEPTION_IN_PAGE_ERROR == GetExceptionCode() ?
+                    EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH )
+    {
+        return false;
+    }
+#else
+    memcpy( buffer, _data + offset, size );
+#endif
+
+    return true;
+}
+
+bool MappedFile::stat( const std::string& path, uint64_t* size, int64_t* mtime )
+{
+    struct _stat64 st;
+    if( 0 != _wstat64( Utf8ToWide( path ).c_str(), &st ) )
+        return false;
+
+    *size = st.st_size;
+    *mtime = st.st_mtime;
+
+    return true;
+}
+#else
+bool MappedFile::open( const std::string& path )
+{
+    close();
+
+    _fd = ::open( path.c_str(), O_RDONLY );
+    if( _fd < 0 )
+        return false;
+
+    struct ::stat st;
+    if( 0 != fstat( _fd, &st ) || 0 == st.st_size ||
+        !canMap( static_cast<uint64_t>( st.st_size ) ) )
+    {
+        close();
+        return false;
+    }
+
+    void* data = mmap( nullptr, st.st_size, PROT_READ, MAP_SHARED, _fd, 0 );
+    if( MAP_FAILED == data ) {
+        close();
+        return false;
+    }
+
+    _data = static_cast<const char*>( data );
+    _size = st.st_size;
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if( _data ) {
+        munmap( const_cast<char*>( _data ), _size );
+        _data = nullptr;
+    }
+    if( _fd >= 0 ) {
+        ::close( _fd );
+        _fd = -1;
+    }
+    _size = 0;
+}
+
+void MappedFile::adviseAccess( AccessPattern pattern )
+{
+    if( !_data )
+        return;
+
+    int advice = MADV_NORMAL;
+    switch( pattern ) {
+        case AccessPattern::Normal:
+            advice = MADV_NORMAL;
+            break;
+        case AccessPattern::Sequential:
+            advice = MADV_SEQUENTIAL;
+            break;
+        case AccessPattern::Random:
+            advice = MADV_RANDOM;
+            break;
+    }
+
+    madvise( const_cast<char*>( _data ), _size, advice );
+}
+
+void MappedFile::adviseWillNeed( uint64_t offset, uint64_t length )
+{
+    if( !_data || offset >= _size )
+        return;
+
+    //madvise requires page aligned address
+    static const uint64_t pageSize = sysconf( _SC_PAGESIZE );
+    const uint64_t alignedOffset = offset - offset % pageSize;
+    if( offset + length > _size )
+        length = _size - offset;
+    length += offset - alignedOffset;
+
+    madvise( const_cast<char*>( _data ) + alignedOffset, length, MADV_WILLNEED );
+}
+
+bool MappedFile::copy( uint64_t offset, void* buffer, size_t size ) const
+{
+    std::call_once( BusHandlerInstalled, InstallBusHandler );
+
+    //access to pages beyond end of truncated file raises SIGBUS,
+    //handler jumps back here
+    sigjmp_buf jump;
+    if( sigsetjmp( jump, 1 ) ) {
+        FaultJump = nullptr;
+        return false;
+    }
+
+    //copy should not be moved out of guarded section by compiler
+    FaultJump = &jump;
+    std::atomic_signal_fence( std::memory_order_seq_cst );
+    memcpy( buffer, _data + offset, size );
+    std::atomic_signal_fence( std::memory_order_seq_cst );
+    FaultJump = nullptr;
+
+    return true;
+}
+
+bool MappedFile::stat( const std::string& path, uint64_t* size, int64_t* mtime )
+{
+    struct ::stat st;
+    if( 0 != ::stat( path.c_str(), &st ) )
+        return false;
+
+    *size = st.st_size;
+    *mtime = st.st_mtime;
+
+    return true;
+}
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//read only memory mapping of whole file
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    //false if file is too large to be mapped in this process
+    static bool canMap( uint64_t size );
+
+    bool open( const std::string& path );
+    void close();
+
+    bool isOpen() const
+        { return _data != nullptr; }
+
+    const char* data() const
+        { return _data; }
+    uint64_t size() const
+        { return _size; }
+
+    enum class AccessPattern {
+        Normal,
+        Sequential,
+        Random,
+    };
+    //hints to OS how mapping will be accessed
+    void adviseAccess( AccessPattern );
+    //hints to OS that range will be needed soon
+    void adviseWillNeed( uint64_t offset, uint64_t length );
+
+    //copies from mapping, returns false (instead of raising SIGBUS)
+    //if pages are gone since file was truncated after mapping
+    bool copy( uint64_t offset, void* buffer, size_t size ) const;
+
+    //file size and last modification time, without opening file
+    static bool stat( const std::string& path, uint64_t* size, int64_t* mtime );
+
+private:
+    MappedFile( const MappedFile& ) = delete;
+    MappedFile& operator=( const MappedFile& ) = delete;
+
+private:
+#ifdef _WIN32
+    void* _file;
+    void* _mapping;
+#else
+    int _fd;
+#endif
+    const char* _data;
+    uint64_t _size;
+};
+
+#ifdef _WIN32
+std::wstring Utf8ToWide( const std::string& );
+#endif
@@ -0,0 +1,131 @@
+#include "MappedInput.h"
+
+#include <algorithm>
+
+namespace {
+
+//range prefetched ahead of read position,
+//new hint is issued when half of it is consumed
+const uint64_t ReadAheadSize = 8 * 1024 * 1024;
+
+}
+
+MappedInput::MappedInput( const std::string& path ) :
+    _path( path ), _position( 0 ), _advisedTo( 0 ), _truncated( false ), _mapFailed( false ),
+    _bytesRead( 0 ), _readCount( 0 ), _seekCount( 0 ), _adviseCount( 0 )
+{
+}
+
+bool MappedInput::open( uint64_t* size )
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    if( !_file.isOpen() && !_file.open( _path ) ) {
+        uint64_t fileSize;
+        int64_t fileTime;
+        _mapFailed = MappedFile::stat( _path, &fileSize, &fileTime ) && fileSize > 0;
+        return false;
+    }
+
+    _truncated = false;
+
+    _file.adviseAccess( MappedFile::AccessPattern::Sequential );
+
+    _position = 0;
+    _advisedTo = 0;
+    adviseAhead();
+
+    *size = _file.size();
+
+    return true;
+}
+
+void MappedInput::adviseAhead()
+{
+    if( _advisedTo >= _file.size() || _position + ReadAheadSize / 2 < _advisedTo )
+        return;
+
+    const uint64_t from = std::max( _position, _advisedTo );
+    const uint64_t to = std::min( _position + ReadAheadSize, _file.size() );
+    if( from >= to )
+        return;
+
+    _file.adviseWillNeed( from, to - from );
+    _advisedTo = to;
+    ++_adviseCount;
+}
+
+int64_t MappedInput::read( uint8_t* buffer, size_t size )
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    if( !_file.isOpen() || _truncated )
+        return -1;
+
+    if( _position >= _file.size() )
+        return 0;
+
+    const size_t count =
+        static_cast<size_t>( std::min<uint64_t>( size, _file.size() - _position ) );
+
+    if( !_file.copy( _position, buffer, count ) ) {
+        _truncated = true;
+        return -1;
+    }
+
+    _position += count;
+    _bytesRead += count;
+    ++_readCount;
+
+    adviseAhead();
+
+    return static_cast<int64_t>( count );
+}
+
+bool MappedInput::seek( uint64_t offset )
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    if( !_file.isOpen() || offset > _file.size() )
+        return false;
+
+    if( offset == _position )
+        return true;
+
+    //hints restart from new position
+    const bool inAdvised = offset >= _position && offset < _advisedTo;
+    _position = offset;
+    if( !inAdvised )
+        _advisedTo = offset;
+    adviseAhead();
+
+    ++_seekCount;
+
+    return true;
+}
+
+void MappedInput::close()
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    //mapping is released while media is not playing
+    _file.close();
+}
+
+bool MappedInput::fallbackToMrl() const
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    return _mapFailed;
+}
+
+void MappedInput::stats( MediaInputStats* stats ) const
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    stats->push_back( { "mappedSize", static_cast<double>( _file.size() ) } );
+    stats->push_back( { "bytesRead", static_cast<double>( _bytesRead ) } );
+    stats->push_back( { "readCount", static_cast<double>( _readCount ) } );
+    stats->push_back( { "seekCount", static_cast<double>( _seekCount ) } );
+    stats->push_back( { "adviseCount", static_cast<double>( _adviseCount ) } );
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <mutex>
+
+#include "MediaInput.h"
+#include "MappedFile.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//Local file input served directly from memory mapping,
+//so libvlc reads don't need read() syscall per block.
+//Pages around read position are prefetched with WILLNEED hints,
+//which follow playback position and seeks. Reads of file truncated
+//after mapping fail instead of raising SIGBUS.
+class MappedInput : public MediaInput
+{
+public:
+    explicit MappedInput( const std::string& path );
+
+    bool open( uint64_t* size ) override;
+    int64_t read( uint8_t* buffer, size_t size ) override;
+    bool seek( uint64_t offset ) override;
+    void close() override;
+    bool fallbackToMrl() const override;
+    void stats( MediaInputStats* ) const override;
+
+private:
+    void adviseAhead();
+
+private:
+    const std::string _path;
+
+    mutable std::mutex _guard;
+    MappedFile _file;
+    uint64_t _position;
+    //end of range already advised as WILLNEED
+    uint64_t _advisedTo;
+    //file was truncated after mapping
+    bool _truncated;
+    //file exists, but can't be mapped
+    bool _mapFailed;
+
+    //stats
+    uint64_t _bytesRead;
+    unsigned _readCount;
+    unsigned _seekCount;
+    unsigned _adviseCount;
+};
@@ -0,0 +1,164 @@
+#include "MediaInfo.h"
+
+#include <mutex>
+#include <condition_variable>
+
+const char* const MetaNames[MediaInfo::MetaCount] =
+{
+    "title",
+    "artist",
+    "genre",
+    "copyright",
+    "album",
+    "trackNumber",
+    "description",
+    "rating",
+    "date",
+    "setting",
+    "URL",
+    "language",
+    "nowPlaying",
+    "publisher",
+    "encodedBy",
+    "artworkURL",
+    "trackID",
+};
+
+static libvlc_instance_t* sharedLibvlc = nullptr;
+
+libvlc_instance_t* SharedLibvlc()
+{
+    if( !sharedLibvlc ) {
+        const char* opts[] = { "--no-video-title-show", "--no-stats" };
+        sharedLibvlc = libvlc_new( sizeof( opts ) / sizeof( opts[0] ), opts );
+    }
+
+    return sharedLibvlc;
+}
+
+void ReleaseSharedLibvlc()
+{
+    if( sharedLibvlc ) {
+        libvlc_release( sharedLibvlc );
+        sharedLibvlc = nullptr;
+    }
+}
+
+libvlc_media_t* CreateMedia( libvlc_instance_t* libvlc, const std::string& mrlOrPath )
+{
+    if( mrlOrPath.find( "://" ) != std::string::npos )
+        return libvlc_media_new_location( libvlc, mrlOrPath.c_str() );
+    else
+        return libvlc_media_new_path( libvlc, mrlOrPath.c_str() );
+}
+
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION( 3, 0, 0, 0 )
+namespace {
+
+struct ParseWaiter
+{
+    ParseWaiter() : done( false ) {}
+
+    std::mutex guard;
+    std::condition_variable parsed;
+    bool done;
+};
+
+void onParsedChanged( const libvlc_event_t*, void* data )
+{
+    ParseWaiter* waiter = static_cast<ParseWaiter*>( data );
+
+    std::lock_guard<std::mutex> lock( waiter->guard );
+    waiter->done = true;
+    waiter->parsed.notify_one();
+}
+
+bool ParseAndWait( libvlc_media_t* media, int timeout )
+{
+    ParseWaiter waiter;
+
+    libvlc_event_manager_t* eventManager = libvlc_media_event_manager( media );
+    libvlc_event_attach( eventManager, libvlc_MediaParsedChanged, onParsedChanged, &waiter );
+
+    const int flags = libvlc_media_parse_local | libvlc_media_parse_network;
+    if( 0 == libvlc_media_parse_with_options( media,
+                                              static_cast<libvlc_media_parse_flag_t>( flags ),
+                                              timeout ) )
+    {
+        std::unique_lock<std::mutex> lock( waiter.guard );
+        waiter.parsed.wait( lock, [&waiter] () { return waiter.done; } );
+    }
+
+    libvlc_event_detach( eventManager, libvlc_MediaParsedChanged, onParsedChanged, &waiter );
+
+    return libvlc_media_parsed_status_done == libvlc_media_get_parsed_status( media );
+}
+
+}
+#endif
+
+bool ParseMedia( libvlc_instance_t* libvlc, const std::string& mrl, int timeout, MediaInfo* info )
+{
+    info->mrl = mrl;
+
+    libvlc_media_t* media = CreateMedia( libvlc, mrl );
+    if( !media )
+        return false;
+
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION( 3, 0, 0, 0 )
+    info->parsed = ParseAndWait( media, timeout );
+#else
+    //there is no way to limit parse time with libvlc 2.x
+    (void) timeout;
+    libvlc_media_parse( media );
+    info->parsed = libvlc_media_is_parsed( media ) != 0;
+#endif
+
+    for( unsigned i = 0; i < MediaInfo::MetaCount; ++i ) {
+        char* meta = libvlc_media_get_meta( media, static_cast<libvlc_meta_t>( i ) );
+        if( meta ) {
+            info->meta[i] = meta;
+            libvlc_free( meta );
+        }
+    }
+
+    info->duration = libvlc_media_get_duration( media );
+
+    libvlc_media_track_t** tracks = nullptr;
+    const unsigned trackCount = libvlc_media_tracks_get( media, &tracks );
+    info->tracks.resize( trackCount );
+    for( unsigned i = 0; i < trackCount; ++i ) {
+        const libvlc_media_track_t& track = *tracks[i];
+        MediaTrackInfo& trackInfo = info->tracks[i];
+
+        trackInfo.type = track.i_type;
+        trackInfo.id = track.i_id;
+        trackInfo.codec = track.i_codec;
+        trackInfo.bitrate = track.i_bitrate;
+        if( track.psz_language )
+            trackInfo.language = track.psz_language;
+        if( track.psz_description )
+            trackInfo.description = track.psz_description;
+
+        switch( track.i_type ) {
+            case libvlc_track_audio:
+                trackInfo.channels = track.audio->i_channels;
+                trackInfo.rate = track.audio->i_rate;
+                break;
+            case libvlc_track_video:
+                trackInfo.width = track.video->i_width;
+                trackInfo.height = track.video->i_height;
+                trackInfo.frameRateNum = track.video->i_frame_rate_num;
+                trackInfo.frameRateDen = track.video->i_frame_rate_den;
+                break;
+            default:
+                break;
+        }
+    }
+    if( tracks )
+        libvlc_media_tracks_release( tracks, trackCount );
+
+    libvlc_media_release( media );
+
+    return info->parsed;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <vlc/vlc.h>
+
+///////////////////////////////////////////////////////////////////////////////
+struct MediaTrackInfo
+{
+    MediaTrackInfo() :
+        type( libvlc_track_unknown ), id( 0 ), codec( 0 ), bitrate( 0 ),
+        channels( 0 ), rate( 0 ),
+        width( 0 ), height( 0 ), frameRateNum( 0 ), frameRateDen( 0 ) {}
+
+    libvlc_track_type_t type;
+    int id;
+    uint32_t codec;
+    unsigned bitrate;
+    std::string language;
+    std::string description;
+
+    //audio
+    unsigned channels;
+    unsigned rate;
+
+    //video
+    unsigned width;
+    unsigned height;
+    unsigned frameRateNum;
+    unsigned frameRateDen;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+struct MediaInfo
+{
+    enum {
+        MetaCount = libvlc_meta_TrackID + 1,
+    };
+
+    MediaInfo() :
+        parsed( false ), duration( -1 ) {}
+
+    std::string mrl;
+    bool parsed;
+    std::string meta[MetaCount];
+    libvlc_time_t duration;
+    std::vector<MediaTrackInfo> tracks;
+};
+
+//names of meta fields, the same as JsVlcMedia properties
+extern const char* const MetaNames[MediaInfo::MetaCount];
+
+//libvlc instance shared by all background jobs (parsing, analysis etc.),
+//should be accessed only from gui thread.
+//Jobs hold LibvlcRef, so instance is destroyed only after last of them.
+libvlc_instance_t* SharedLibvlc();
+void ReleaseSharedLibvlc();
+
+//reference to libvlc instance (could be null)
+class LibvlcRef
+{
+public:
+    explicit LibvlcRef( libvlc_instance_t* libvlc ) :
+        _libvlc( libvlc )
+        { if( _libvlc ) libvlc_retain( _libvlc ); }
+    ~LibvlcRef()
+        { if( _libvlc ) libvlc_release( _libvlc ); }
+
+    libvlc_instance_t* get() const
+        { return _libvlc; }
+
+private:
+    LibvlcRef( const LibvlcRef& ) = delete;
+    LibvlcRef& operator=( const LibvlcRef& ) = delete;
+
+private:
+    libvlc_instance_t *const _libvlc;
+};
+
+libvlc_media_t* CreateMedia( libvlc_instance_t*, const std::string& mrlOrPath );
+
+//blocks until media is parsed or timeout (in ms, if < 0 - libvlc default) expired,
+//so should be called only from worker thread
+bool ParseMedia( libvlc_instance_t*, const std::string& mrl, int timeout, MediaInfo* );
@@ -0,0 +1,74 @@
+#include "MediaInput.h"
+
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION( 3, 0, 0, 0 )
+
+namespace {
+
+typedef std::shared_ptr<MediaInput> InputRef;
+
+int open_cb( void* opaque, void** datap, uint64_t* sizep )
+{
+    MediaInput* input = static_cast<InputRef*>( opaque )->get();
+    *datap = input;
+
+    uint64_t size = MediaInput::UnknownSize;
+    if( !input->open( &size ) )
+        return -1;
+
+    *sizep = size;
+    return 0;
+}
+
+ssize_t read_cb( void* opaque, unsigned char* buf, size_t len )
+{
+    return static_cast<ssize_t>( static_cast<MediaInput*>( opaque )->read( buf, len ) );
+}
+
+int seek_cb( void* opaque, uint64_t offset )
+{
+    return static_cast<MediaInput*>( opaque )->seek( offset ) ? 0 : -1;
+}
+
+void close_cb( void* opaque )
+{
+    static_cast<MediaInput*>( opaque )->close();
+}
+
+void media_freed_cb( const libvlc_event_t*, void* data )
+{
+    delete static_cast<InputRef*>( data );
+}
+
+}
+
+libvlc_media_t* CreateMedia( libvlc_instance_t* libvlc, const std::shared_ptr<MediaInput>& input )
+{
+    if( !libvlc || !input )
+        return nullptr;
+
+    InputRef* ref = new InputRef( input );
+
+    libvlc_media_t* media =
+        libvlc_media_new_callbacks( libvlc, open_cb, read_cb,
+                                    input->seekable() ? seek_cb : nullptr,
+                                    close_cb, ref );
+    if( !media ) {
+        delete ref;
+        return nullptr;
+    }
+
+    //reference is released together with media
+    libvlc_event_attach( libvlc_media_event_manager( media ), libvlc_MediaFreed,
+                         media_freed_cb, ref );
+
+    return media;
+}
+
+#else
+
+libvlc_media_t* CreateMedia( libvlc_instance_t*, const std::shared_ptr<MediaInput>& )
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+#include <vlc/vlc.h>
+
+///////////////////////////////////////////////////////////////////////////////
+struct MediaInputStat
+{
+    const char* name;
+    double value;
+};
+typedef std::vector<MediaInputStat> MediaInputStats;
+
+//Custom byte source for libvlc (via libvlc_media_new_callbacks).
+//open/read/seek/close are called from libvlc input thread.
+class MediaInput
+{
+public:
+    enum : uint64_t {
+        UnknownSize = UINT64_MAX,
+    };
+
+    virtual ~MediaInput() {}
+
+    //size could be set to UnknownSize
+    virtual bool open( uint64_t* size ) = 0;
+    //returns count of read bytes, 0 on end of stream, -1 on error.
+    //Could block until data is available.
+    virtual int64_t read( uint8_t* buffer, size_t size ) = 0;
+    virtual bool seek( uint64_t offset ) = 0;
+    virtual void close() = 0;
+
+    //libvlc doesn't try to seek not seekable input
+    virtual bool seekable() const
+        { return true; }
+
+    //true if input found out it can't serve media (i.e. resource size
+    //is not known), so item should be played from its mrl as usual.
+    //Could be called from any thread
+    virtual bool fallbackToMrl() const
+        { return false; }
+
+    //could be called from any thread, should unblock pending read,
+    //since libvlc can't stop input until read returns
+    virtual void interrupt() {}
+
+    virtual void stats( MediaInputStats* ) const {}
+};
+
+//media keeps reference to input until libvlc media is released.
+//Returns nullptr if libvlc doesn't support media callbacks (< 3.0)
+libvlc_media_t* CreateMedia( libvlc_instance_t*, const std::shared_ptr<MediaInput>& );
@@ -0,0 +1,499 @@
+#include "MetaCache.h"
+
+#include <string.h>
+
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static const char CacheSignature[] = "WCJSMC01";
+static const size_t SignatureSize = sizeof( CacheSignature ) - 1;
+
+//cache file is rewritten on open if overridden records take more than
+//1 / CompactGarbageRatio of it (and at least CompactMinGarbage bytes)
+static const unsigned CompactGarbageRatio = 2;
+static const uint64_t CompactMinGarbage = 1024 * 1024;
+
+///////////////////////////////////////////////////////////////////////////////
+namespace {
+
+class RecordWriter
+{
+public:
+    void put( uint32_t value )
+        { _data.append( reinterpret_cast<const char*>( &value ), sizeof( value ) ); }
+    void put( int32_t value )
+        { put( static_cast<uint32_t>( value ) ); }
+    void put( uint64_t value )
+        { _data.append( reinterpret_cast<const char*>( &value ), sizeof( value ) ); }
+    void put( int64_t value )
+        { put( static_cast<uint64_t>( value ) ); }
+    void put( const std::string& value )
+        { put( static_cast<uint32_t>( value.size() ) ); _data.append( value ); }
+
+    const std::string& data() const
+        { return _data; }
+
+private:
+    std::string _data;
+};
+
+class RecordReader
+{
+public:
+    RecordReader( const char* data, uint64_t size ) :
+        _data( data ), _size( size ), _pos( 0 ), _failed( false ) {}
+
+    bool failed() const
+        { return _failed; }
+    uint64_t pos() const
+        { return _pos; }
+    uint64_t remaining() const
+        { return _size - _pos; }
+
+    template<typename T>
+    T get()
+    {
+        T value = T();
+        if( !ensure( sizeof( value ) ) )
+            return value;
+
+        memcpy( &value, _data + _pos, sizeof( value ) );
+        _pos += sizeof( value );
+
+        return value;
+    }
+
+    std::string getString()
+    {
+        const uint32_t size = get<uint32_t>();
+        if( !ensure( size ) )
+            return std::string();
+
+        std::string value( _data + _pos, size );
+        _pos += size;
+
+        return value;
+    }
+
+    void skip( uint64_t size )
+    {
+        if( ensure( size ) )
+            _pos += size;
+    }
+
+private:
+    bool ensure( uint64_t size )
+    {
+        if( _failed || _size - _pos < size )
+            _failed = true;
+
+        return !_failed;
+    }
+
+private:
+    const char* _data;
+    const uint64_t _size;
+    uint64_t _pos;
+    bool _failed;
+};
+
+//record: [u32 body size][u64 file size][i64 file time][mrl][media info]
+std::string SerializeRecord( uint64_t fileSize, int64_t fileTime, const MediaInfo& info )
+{
+    RecordWriter body;
+    body.put( fileSize );
+    body.put( fileTime );
+    body.put( info.mrl );
+    body.put( static_cast<uint32_t>( info.parsed ? 1 : 0 ) );
+    body.put( static_cast<int64_t>( info.duration ) );
+
+    body.put( static_cast<uint32_t>( MediaInfo::MetaCount ) );
+    for( unsigned i = 0; i < MediaInfo::MetaCount; ++i ) {
+        body.put( info.meta[i] );
+    }
+
+    body.put( static_cast<uint32_t>( info.tracks.size() ) );
+    for( const MediaTrackInfo& track: info.tracks ) {
+        body.put( static_cast<int32_t>( track.type ) );
+        body.put( static_cast<int32_t>( track.id ) );
+        body.put( track.codec );
+        body.put( static_cast<uint32_t>( track.bitrate ) );
+        body.put( track.language );
+        body.put( track.description );
+        body.put( static_cast<uint32_t>( track.channels ) );
+        body.put( static_cast<uint32_t>( track.rate ) );
+        body.put( static_cast<uint32_t>( track.width ) );
+        body.put( static_cast<uint32_t>( track.height ) );
+        body.put( static_cast<uint32_t>( track.frameRateNum ) );
+        body.put( static_cast<uint32_t>( track.frameRateDen ) );
+    }
+
+    RecordWriter record;
+    record.put( static_cast<uint32_t>( body.data().size() ) );
+
+    return record.data() + body.data();
+}
+
+//reads media info part of record body (after file size, file time and mrl)
+bool DeserializeMediaInfo( RecordReader* reader, MediaInfo* info )
+{
+    info->parsed = reader->get<uint32_t>() != 0;
+    info->duration = reader->get<int64_t>();
+
+    const uint32_t metaCount = reader->get<uint32_t>();
+    for( uint32_t i = 0; i < metaCount && !reader->failed(); ++i ) {
+        std::string meta = reader->getString();
+        if( i < MediaInfo::MetaCount )
+            info->meta[i].swap( meta );
+    }
+
+    const uint32_t trackCount = reader->get<uint32_t>();
+    for( uint32_t i = 0; i < trackCount && !reader->failed(); ++i ) {
+        MediaTrackInfo track;
+        track.type = static_cast<libvlc_track_type_t>( reader->get<int32_t>() );
+        track.id = reader->get<int32_t>();
+        track.codec = reader->get<uint32_t>();
+        track.bitrate = reader->get<uint32_t>();
+        track.language = reader->getString();
+        track.description = reader->getString();
+        track.channels = reader->get<uint32_t>();
+        track.rate = reader->get<uint32_t>();
+        track.width = reader->get<uint32_t>();
+        track.height = reader->get<uint32_t>();
+        track.frameRateNum = reader->get<uint32_t>();
+        track.frameRateDen = reader->get<uint32_t>();
+        info->tracks.push_back( track );
+    }
+
+    return !reader->failed();
+}
+
+int HexValue( char c )
+{
+    if( c >= '0' && c <= '9' ) return c - '0';
+    if( c >= 'a' && c <= 'f' ) return c - 'a' + 10;
+    if( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+    return -1;
+}
+
+FILE* OpenForAppend( const std::string& path )
+{
+#ifdef _WIN32
+    return _wfopen( Utf8ToWide( path ).c_str(), L"ab" );
+#else
+    return fopen( path.c_str(), "ab" );
+#endif
+}
+
+FILE* OpenForWrite( const std::string& path )
+{
+#ifdef _WIN32
+    return _wfopen( Utf8ToWide( path ).c_str(), L"wb" );
+#else
+    return fopen( path.c_str(), "wb" );
+#endif
+}
+
+void RemoveFile( const std::string& path )
+{
+#ifdef _WIN32
+    _wremove( Utf8ToWide( path ).c_str() );
+#else
+    remove( path.c_str() );
+#endif
+}
+
+bool ReplaceFile( const std::string& from, const std::string& to )
+{
+#ifdef _WIN32
+    //rename doesn't overwrite existing file on windows
+    _wremove( Utf8ToWide( to ).c_str() );
+    return 0 == _wrename( Utf8ToWide( from ).c_str(), Utf8ToWide( to ).c_str() );
+#else
+    return 0 == rename( from.c_str(), to.c_str() );
+#endif
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+MetaCache::MetaCache() :
+    _file( nullptr ), _writer( new ThreadPool( 1 ) )
+{
+}
+
+MetaCache::~MetaCache()
+{
+    //waits for pending writes
+    _writer.reset();
+
+    if( _file )
+        fclose( _file );
+}
+
+std::string MetaCache::localPath( const std::string& mrl )
+{
+    static const char FilePrefix[] = "file://";
+    static const size_t FilePrefixSize = sizeof( FilePrefix ) - 1;
+
+    if( 0 != mrl.compare( 0, FilePrefixSize, FilePrefix ) )
+        return mrl.find( "://" ) == std::string::npos ? mrl : std::string();
+
+    std::string path;
+    path.reserve( mrl.size() - FilePrefixSize );
+    for( size_t i = FilePrefixSize; i < mrl.size(); ++i ) {
+        if( '%' == mrl[i] && i + 2 < mrl.size() &&
+            HexValue( mrl[i + 1] ) >= 0 && HexValue( mrl[i + 2] ) >= 0 )
+        {
+            path.push_back( static_cast<char>( HexValue( mrl[i + 1] ) * 16 + HexValue( mrl[i + 2] ) ) );
+            i += 2;
+        } else
+            path.push_back( mrl[i] );
+    }
+
+#ifdef _WIN32
+    //file:///C:/dir/file
+    if( path.size() > 2 && '/' == path[0] && ':' == path[2] )
+        path.erase( 0, 1 );
+#endif
+
+    return path;
+}
+
+bool MetaCache::open( const std::string& path )
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    _path = path;
+    _entries.clear();
+
+    if( !loadIndex() ) {
+        //missing or broken cache, start new one
+        _mappedFile.close();
+        _entries.clear();
+
+        FILE* file = OpenForWrite( path );
+        if( !file )
+            return false;
+
+        fwrite( CacheSignature, 1, SignatureSize, file );
+        fclose( file );
+    }
+
+    _file = OpenForAppend( path );
+
+    return _file != nullptr;
+}
+
+bool MetaCache::loadIndex()
+{
+    if( !_mappedFile.open( _path ) )
+        return false;
+
+    const char* data = _mappedFile.data();
+    const uint64_t size = _mappedFile.size();
+
+    if( size < SignatureSize || 0 != memcmp( data, CacheSignature, SignatureSize ) )
+        return false;
+
+    _mappedFile.adviseAccess( MappedFile::AccessPattern::Sequential );
+
+    RecordReader reader( data + SignatureSize, size - SignatureSize );
+    bool truncated = false;
+    uint64_t recordStart = 0;
+    while( reader.remaining() > 0 ) {
+        recordStart = reader.pos();
+
+        const uint32_t bodySize = reader.get<uint32_t>();
+        const uint64_t bodyStart = reader.pos();
+
+        Entry entry;
+        entry.recordOffset = SignatureSize + recordStart;
+        entry.recordSize = sizeof( bodySize ) + bodySize;
+        entry.fileSize = reader.get<uint64_t>();
+        entry.fileTime = reader.get<int64_t>();
+        const std::string mrl = reader.getString();
+        entry.offset = SignatureSize + reader.pos();
+
+        const uint64_t headerSize = reader.pos() - bodyStart;
+        if( !reader.failed() && headerSize <= bodySize )
+            reader.skip( bodySize - headerSize );
+
+        if( reader.failed() || headerSize > bodySize ) {
+            truncated = true;
+            break;
+        }
+
+        //later records override earlier
+        _entries[mrl] = entry;
+    }
+
+    if( truncated ) {
+        //broken record at the end (application was killed during write?),
+        //drop it to not break records appended later
+        _mappedFile.close();
+
+        const uint64_t validSize = SignatureSize + recordStart;
+#ifdef _WIN32
+        FILE* file = _wfopen( Utf8ToWide( _path ).c_str(), L"r+b" );
+        if( !file )
+            return false;
+        const bool truncatedOk = 0 == _chsize_s( _fileno( file ), validSize );
+        fclose( file );
+#else
+        const bool truncatedOk = 0 == truncate( _path.c_str(), validSize );
+#endif
+        if( !truncatedOk || !_mappedFile.open( _path ) )
+            return false;
+    }
+
+    uint64_t liveSize = SignatureSize;
+    for( const auto& entry: _entries )
+        liveSize += entry.second.recordSize;
+
+    const uint64_t garbageSize = _mappedFile.size() - liveSize;
+    if( garbageSize >= CompactMinGarbage &&
+        garbageSize > _mappedFile.size() / CompactGarbageRatio )
+    {
+        //if it fails cache is still usable, just not compacted
+        if( !compact() && !_mappedFile.isOpen() )
+            return false;
+    }
+
+    _mappedFile.adviseAccess( MappedFile::AccessPattern::Random );
+
+    return true;
+}
+
+bool MetaCache::compact()
+{
+    const std::string tmpPath = _path + ".tmp";
+    FILE* file = OpenForWrite( tmpPath );
+    if( !file )
+        return false;
+
+    const char* data = _mappedFile.data();
+
+    //entries are updated only if new file replaced old one
+    std::vector<std::pair<Entry*, uint64_t> > newOffsets;
+    newOffsets.reserve( _entries.size() );
+
+    bool written = 1 == fwrite( CacheSignature, SignatureSize, 1, file );
+    uint64_t offset = SignatureSize;
+    for( auto it = _entries.begin(); it != _entries.end() && written; ++it ) {
+        Entry& entry = it->second;
+        written = 1 == fwrite( data + entry.recordOffset, entry.recordSize, 1, file );
+        newOffsets.emplace_back( &entry, offset );
+        offset += entry.recordSize;
+    }
+    written = 0 == fclose( file ) && written;
+
+    if( !written ) {
+        RemoveFile( tmpPath );
+        return false;
+    }
+
+    //mapping should be closed before file is replaced (on windows at least)
+    _mappedFile.close();
+    if( !ReplaceFile( tmpPath, _path ) ) {
+        RemoveFile( tmpPath );
+        _mappedFile.open( _path );
+        return false;
+    }
+
+    for( const auto& newOffset: newOffsets ) {
+        Entry& entry = *newOffset.first;
+        entry.offset += static_cast<int64_t>( newOffset.second ) - entry.recordOffset;
+        entry.recordOffset = newOffset.second;
+    }
+
+    return _mappedFile.open( _path );
+}
+
+bool MetaCache::find( const std::string& mrl, MediaInfo* info )
+{
+    const std::string path = localPath( mrl );
+    if( path.empty() )
+        return false;
+
+    uint64_t fileSize;
+    int64_t fileTime;
+    if( !MappedFile::stat( path, &fileSize, &fileTime ) )
+        return false;
+
+    std::unique_lock<std::mutex> lock( _guard );
+
+    auto it = _entries.find( mrl );
+    if( it == _entries.end() )
+        return false;
+
+    const Entry entry = it->second;
+    lock.unlock();
+
+    if( entry.fileSize != fileSize || entry.fileTime != fileTime )
+        return false;
+
+    if( entry.info ) {
+        *info = *entry.info;
+        return true;
+    }
+
+    //mapping is immutable after open, so it's safe to read it without lock
+    RecordReader reader( _mappedFile.data() + entry.offset,
+                         _mappedFile.size() - entry.offset );
+    MediaInfo cachedInfo;
+    cachedInfo.mrl = mrl;
+    if( !DeserializeMediaInfo( &reader, &cachedInfo ) )
+        return false;
+
+    *info = std::move( cachedInfo );
+
+    return true;
+}
+
+void MetaCache::store( const MediaInfo& info )
+{
+    const std::string path = localPath( info.mrl );
+    if( path.empty() )
+        return;
+
+    Entry entry;
+    if( !MappedFile::stat( path, &entry.fileSize, &entry.fileTime ) )
+        return;
+
+    entry.offset = -1;
+    entry.recordOffset = 0;
+    entry.recordSize = 0;
+    entry.info = std::make_shared<const MediaInfo>( info );
+
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+        if( !_file )
+            return;
+
+        _entries[info.mrl] = entry;
+    }
+
+    const std::string record = SerializeRecord( entry.fileSize, entry.fileTime, info );
+    _writer->post( [this, record] () { append( record ); } );
+}
+
+void MetaCache::append( const std::string& record )
+{
+    //_file is changed only in open(), which should not be called while cache is in use
+    if( 1 != fwrite( record.data(), record.size(), 1, _file ) )
+        return;
+
+    fflush( _file );
+}
+
+unsigned MetaCache::entryCount()
+{
+    std::lock_guard<std::mutex> lock( _guard );
+    return _entries.size();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <memory>
+#include <stdio.h>
+
+#include "MediaInfo.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//Persistent cache of parsed media info for local files.
+//Entries are keyed by mrl and validated by file size and modification time.
+//Cache file is memory mapped on open, new entries are appended
+//to it asynchronously. Overridden records are dropped from file
+//when it's opened, if they take big enough part of it.
+//All public methods are thread safe.
+class MetaCache
+{
+public:
+    MetaCache();
+    ~MetaCache(); //waits for pending writes
+
+    bool open( const std::string& path );
+
+    //returns false if there is no valid entry for mrl
+    bool find( const std::string& mrl, MediaInfo* );
+    void store( const MediaInfo& );
+
+    unsigned entryCount();
+
+    //local file path for "file://" mrl or plain path, empty string otherwise
+    static std::string localPath( const std::string& mrl );
+
+private:
+    struct Entry
+    {
+        uint64_t fileSize;
+        int64_t fileTime;
+        //offset of serialized MediaInfo in mapped file,
+        //or -1 if entry is stored only in memory
+        int64_t offset;
+        //whole record in mapped file (0 size if there is no such record)
+        uint64_t recordOffset;
+        uint32_t recordSize;
+        std::shared_ptr<const MediaInfo> info;
+    };
+
+    bool loadIndex();
+    //rewrites cache file with only live records
+    bool compact();
+    void append( const std::string& record );
+
+private:
+    std::mutex _guard;
+    std::string _path;
+    MappedFile _mappedFile;
+    std::unordered_map<std::string, Entry> _entries;
+
+    FILE* _file;
+    std::unique_ptr<ThreadPool> _writer;
+};
@@ -48,3 +48,53 @@ v8::Local<v8::Object> Require( const char* module )
 
     return Local<Object>::Cast(  RequireFunc()->Call( global, 1, argv ) );
 }
+
+v8::Local<v8::Object> NewTypedArray( const char* type, unsigned length )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    EscapableHandleScope scope( isolate );
+
+    Local<Object> global = isolate->GetCurrentContext()->Global();
+    Local<Value> abv =
+        global->Get( String::NewFromUtf8( isolate, type, String::kInternalizedString ) );
+    Local<Value> argv[] = { Integer::NewFromUnsigned( isolate, length ) };
+
+    return scope.Escape( Local<Function>::Cast( abv )->NewInstance( 1, argv ) );
+}
+
+v8::Local<v8::Value> CallJsMethod( const v8::Local<v8::Object>& object, const char* name,
+                                   int argc, v8::Local<v8::Value> argv[] )
+{
+    using namespace v8;
+
+    Isolate* isolate = Isolate::GetCurrent();
+    EscapableHandleScope scope( isolate );
+
+    Local<Value> method =
+        object->Get( String::NewFromUtf8( isolate, name, v8::String::kInternalizedString ) );
+    if( !method->IsFunction() )
+        return Local<Value>();
+
+    TryCatch tryCatch;
+    Local<Value> result = Local<Function>::Cast( method )->Call( object, argc, argv );
+    if( tryCatch.HasCaught() || result.IsEmpty() )
+        return Local<Value>();
+
+    return scope.Escape( result );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void AsyncNotifier::send()
+{
+    std::lock_guard<std::mutex> lock( guard );
+    if( async )
+        uv_async_send( async );
+}
+
+void AsyncNotifier::reset()
+{
+    std::lock_guard<std::mutex> lock( guard );
+    async = nullptr;
+}
@@ -2,8 +2,10 @@
 
 #include <string>
 #include <vector>
+#include <mutex>
 
 #include <v8.h>
+#include <uv.h>
 #include <node.h>
 #include <node_object_wrap.h>
 
@@ -212,6 +214,28 @@ void GetIndexedPropertyValue( R ( C::* getter ) ( uint32_t index ),
 
 v8::Local<v8::Object> Require( const char* module );
 
+//calls object[name]( argv ), returns empty handle
+//if method is missing or thrown exception
+v8::Local<v8::Value> CallJsMethod( const v8::Local<v8::Object>& object, const char* name,
+                                   int argc, v8::Local<v8::Value> argv[] );
+
+//wakes uv_async_t from any thread,
+//async should be reset (on gui thread) before it's closed
+struct AsyncNotifier
+{
+    explicit AsyncNotifier( uv_async_t* async ) :
+        async( async ) {}
+
+    void send();
+    void reset();
+
+    std::mutex guard;
+    uv_async_t* async;
+};
+
+//type is typed array constructor name, i.e. "Float32Array"
+v8::Local<v8::Object> NewTypedArray( const char* type, unsigned length );
+
 #define SET_RO_INDEXED_PROPERTY( objTemplate, member )         \
     objTemplate->SetIndexedPropertyHandler(                    \
         [] ( uint32_t index,                                   \
@@ -0,0 +1,422 @@
+#include "PlaylistFile.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+static const char Utf8Bom[] = "\xEF\xBB\xBF";
+static const size_t Utf8BomSize = sizeof( Utf8Bom ) - 1;
+
+static bool EndsWith( const std::string& str, const char* suffix )
+{
+    const size_t suffixSize = strlen( suffix );
+    if( str.size() < suffixSize )
+        return false;
+
+    for( size_t i = 0; i < suffixSize; ++i ) {
+        char c = str[str.size() - suffixSize + i];
+        if( c >= 'A' && c <= 'Z' )
+            c += 'a' - 'A';
+        if( c != suffix[i] )
+            return false;
+    }
+
+    return true;
+}
+
+static const char* FindBytes( const char* begin, const char* end, const char* what )
+{
+    const size_t whatSize = strlen( what );
+    for( const char* p = begin; p + whatSize <= end; ++p ) {
+        p = static_cast<const char*>( memchr( p, what[0], end - p ) );
+        if( !p || p + whatSize > end )
+            return nullptr;
+        if( 0 == memcmp( p, what, whatSize ) )
+            return p;
+    }
+
+    return nullptr;
+}
+
+static bool IsAbsolutePath( const std::string& path )
+{
+    if( path.empty() )
+        return false;
+
+#ifdef _WIN32
+    if( path.size() > 2 && ':' == path[1] && ( '\\' == path[2] || '/' == path[2] ) )
+        return true;
+    if( '\\' == path[0] )
+        return true;
+#endif
+
+    return '/' == path[0];
+}
+
+PlaylistFormat DetectPlaylistFormat( const std::string& path )
+{
+    return EndsWith( path, ".xspf" ) ? PlaylistFormat::XSPF : PlaylistFormat::M3U;
+}
+
+PlaylistFormat DetectPlaylistFormat( const std::string& path,
+                                     const char* data, uint64_t size )
+{
+    if( EndsWith( path, ".xspf" ) )
+        return PlaylistFormat::XSPF;
+    if( EndsWith( path, ".m3u" ) || EndsWith( path, ".m3u8" ) )
+        return PlaylistFormat::M3U;
+
+    const uint64_t headSize = size < 512 ? size : 512;
+    if( FindBytes( data, data + headSize, "<playlist" ) )
+        return PlaylistFormat::XSPF;
+
+    return PlaylistFormat::M3U;
+}
+
+std::string DirName( const std::string& path )
+{
+#ifdef _WIN32
+    const size_t pos = path.find_last_of( "/\\" );
+#else
+    const size_t pos = path.rfind( '/' );
+#endif
+    return pos == std::string::npos ? std::string() : path.substr( 0, pos );
+}
+
+std::string PathToMrl( const std::string& path )
+{
+    static const char HexDigits[] = "0123456789ABCDEF";
+
+    std::string mrl = "file://";
+#ifdef _WIN32
+    if( !path.empty() && '/' != path[0] && '\\' != path[0] )
+        mrl.push_back( '/' );
+#endif
+
+    for( const char pc: path ) {
+        const unsigned char c = static_cast<unsigned char>( pc );
+#ifdef _WIN32
+        if( '\\' == c ) {
+            mrl.push_back( '/' );
+            continue;
+        }
+#endif
+        if( ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) ||
+            ( c >= '0' && c <= '9' ) || strchr( "-_.~/:", c ) )
+        {
+            mrl.push_back( c );
+        } else {
+            mrl.push_back( '%' );
+            mrl.push_back( HexDigits[c >> 4] );
+            mrl.push_back( HexDigits[c & 0x0F] );
+        }
+    }
+
+    return mrl;
+}
+
+static std::string ResolveLocation( const std::string& location, const std::string& baseDir )
+{
+    if( location.find( "://" ) != std::string::npos )
+        return location;
+
+    if( IsAbsolutePath( location ) || baseDir.empty() )
+        return PathToMrl( location );
+
+    return PathToMrl( baseDir + '/' + location );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+static void ParseM3U( const char* data, uint64_t size,
+                      const std::string& baseDir,
+                      const PlaylistItemHandler& handler )
+{
+    const char* pos = data;
+    const char* end = data + size;
+
+    PlaylistFileItem item;
+
+    while( pos < end ) {
+        const char* lineEnd = static_cast<const char*>( memchr( pos, '\n', end - pos ) );
+        if( !lineEnd )
+            lineEnd = end;
+
+        const char* lineBegin = pos;
+        const char* lineLast = lineEnd;
+        pos = lineEnd + 1;
+
+        while( lineBegin < lineLast && ( ' ' == *lineBegin || '\t' == *lineBegin ) )
+            ++lineBegin;
+        while( lineLast > lineBegin &&
+               ( '\r' == lineLast[-1] || ' ' == lineLast[-1] || '\t' == lineLast[-1] ) )
+            --lineLast;
+
+        if( lineBegin == lineLast )
+            continue;
+
+        const std::string line( lineBegin, lineLast );
+
+        if( '#' != line[0] ) {
+            item.mrl = ResolveLocation( line, baseDir );
+            handler( item, pos < end ? pos - data : size );
+            item = PlaylistFileItem();
+        } else if( 0 == line.compare( 0, 8, "#EXTINF:" ) ) {
+            //#EXTINF:duration key="value with, comma",title
+            bool inQuotes = false;
+            for( size_t i = 8; i < line.size(); ++i ) {
+                if( '"' == line[i] )
+                    inQuotes = !inQuotes;
+                else if( ',' == line[i] && !inQuotes ) {
+                    item.title = line.substr( i + 1 );
+                    break;
+                }
+            }
+        } else if( 0 == line.compare( 0, 11, "#EXTVLCOPT:" ) ) {
+            std::string option = line.substr( 11 );
+            if( !option.empty() ) {
+                if( ':' != option[0] )
+                    option.insert( 0, 1, ':' );
+                item.options.push_back( option );
+            }
+        }
+    }
+}
+
+static std::string FormatM3U( const std::vector<PlaylistFileItem>& items )
+{
+    std::string out = "#EXTM3U\n";
+
+    for( const PlaylistFileItem& item: items ) {
+        if( !item.title.empty() ) {
+            out += "#EXTINF:-1,";
+            out += item.title;
+            out += '\n';
+        }
+        for( const std::string& option: item.options ) {
+            out += "#EXTVLCOPT:";
+            out.append( option, ':' == option[0] ? 1 : 0, std::string::npos );
+            out += '\n';
+        }
+        out += item.mrl;
+        out += '\n';
+    }
+
+    return out;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+static void AppendUtf8( unsigned long code, std::string* out )
+{
+    if( code < 0x80 ) {
+        out->push_back( static_cast<char>( code ) );
+    } else if( code < 0x800 ) {
+        out->push_back( static_cast<char>( 0xC0 | ( code >> 6 ) ) );
+        out->push_back( static_cast<char>( 0x80 | ( code & 0x3F ) ) );
+    } else if( code < 0x10000 ) {
+        out->push_back( static_cast<char>( 0xE0 | ( code >> 12 ) ) );
+        out->push_back( static_cast<char>( 0x80 | ( ( code >> 6 ) & 0x3F ) ) );
+        out->push_back( static_cast<char>( 0x80 | ( code & 0x3F ) ) );
+    } else if( code < 0x110000 ) {
+        out->push_back( static_cast<char>( 0xF0 | ( code >> 18 ) ) );
+        out->push_back( static_cast<char>( 0x80 | ( ( code >> 12 ) & 0x3F ) ) );
+        out->push_back( static_cast<char>( 0x80 | ( ( code >> 6 ) & 0x3F ) ) );
+        out->push_back( static_cast<char>( 0x80 | ( code & 0x3F ) ) );
+    }
+}
+
+static std::string XmlUnescape( const char* begin, const char* end )
+{
+    std::string out;
+    out.reserve( end - begin );
+
+    for( const char* p = begin; p < end; ++p ) {
+        if( '&' != *p ) {
+            out.push_back( *p );
+            continue;
+        }
+
+        const char* semicolon = static_cast<const char*>( memchr( p, ';', end - p ) );
+        if( !semicolon ) {
+            out.push_back( *p );
+            continue;
+        }
+
+        const std::string entity( p + 1, semicolon );
+        if( "amp" == entity ) out.push_back( '&' );
+        else if( "lt" == entity ) out.push_back( '<' );
+        else if( "gt" == entity ) out.push_back( '>' );
+        else if( "quot" == entity ) out.push_back( '"' );
+        else if( "apos" == entity ) out.push_back( '\'' );
+        else if( entity.size() > 1 && '#' == entity[0] ) {
+            const bool hex = 'x' == entity[1] || 'X' == entity[1];
+            AppendUtf8( strtoul( entity.c_str() + ( hex ? 2 : 1 ), nullptr, hex ? 16 : 10 ), &out );
+        } else {
+            out.append( p, semicolon + 1 );
+        }
+
+        p = semicolon;
+    }
+
+    return out;
+}
+
+static std::string XmlEscape( const std::string& text )
+{
+    std::string out;
+    out.reserve( text.size() );
+
+    for( const char c: text ) {
+        switch( c ) {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '"': out += "&quot;"; break;
+            default: out.push_back( c ); break;
+        }
+    }
+
+    return out;
+}
+
+//text of all <tag>...</tag> elements in [begin, end)
+static void ForEachElement( const char* begin, const char* end, const char* tag,
+                            const std::function<void( const char*, const char* )>& onElement )
+{
+    const std::string openTag = std::string( "<" ) + tag;
+    const std::string closeTag = std::string( "</" ) + tag + ">";
+
+    const char* pos = begin;
+    while( pos < end ) {
+        const char* open = FindBytes( pos, end, openTag.c_str() );
+        if( !open )
+            return;
+
+        const char* tagEnd = open + openTag.size();
+        if( tagEnd >= end )
+            return;
+        if( '>' != *tagEnd && ' ' != *tagEnd && '\t' != *tagEnd &&
+            '\r' != *tagEnd && '\n' != *tagEnd && '/' != *tagEnd )
+        {
+            //other tag with the same prefix
+            pos = tagEnd;
+            continue;
+        }
+
+        const char* contentBegin = static_cast<const char*>( memchr( tagEnd, '>', end - tagEnd ) );
+        if( !contentBegin )
+            return;
+
+        if( '/' == contentBegin[-1] ) {
+            //empty element
+            pos = contentBegin + 1;
+            continue;
+        }
+        ++contentBegin;
+
+        const char* contentEnd = FindBytes( contentBegin, end, closeTag.c_str() );
+        if( !contentEnd )
+            return;
+
+        onElement( contentBegin, contentEnd );
+
+        pos = contentEnd + closeTag.size();
+    }
+}
+
+static void ParseXSPF( const char* data, uint64_t size,
+                       const std::string& baseDir,
+                       const PlaylistItemHandler& handler )
+{
+    ForEachElement( data, data + size, "track",
+        [&] ( const char* trackBegin, const char* trackEnd ) {
+            PlaylistFileItem item;
+
+            ForEachElement( trackBegin, trackEnd, "location",
+                [&] ( const char* begin, const char* end ) {
+                    if( item.mrl.empty() )
+                        item.mrl = ResolveLocation( XmlUnescape( begin, end ), baseDir );
+                } );
+            if( item.mrl.empty() )
+                return;
+
+            ForEachElement( trackBegin, trackEnd, "title",
+                [&] ( const char* begin, const char* end ) {
+                    if( item.title.empty() )
+                        item.title = XmlUnescape( begin, end );
+                } );
+
+            ForEachElement( trackBegin, trackEnd, "vlc:option",
+                [&] ( const char* begin, const char* end ) {
+                    std::string option = XmlUnescape( begin, end );
+                    if( option.empty() )
+                        return;
+                    if( ':' != option[0] )
+                        option.insert( 0, 1, ':' );
+                    item.options.push_back( option );
+                } );
+
+            handler( item, trackEnd - data );
+        } );
+}
+
+static std::string FormatXSPF( const std::vector<PlaylistFileItem>& items )
+{
+    std::string out =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<playlist xmlns=\"http://xspf.org/ns/0/\" "
+        "xmlns:vlc=\"http://www.videolan.org/vlc/playlist/ns/0/\" version=\"1\">\n"
+        "\t<trackList>\n";
+
+    for( const PlaylistFileItem& item: items ) {
+        out += "\t\t<track>\n";
+        out += "\t\t\t<location>" + XmlEscape( item.mrl ) + "</location>\n";
+        if( !item.title.empty() )
+            out += "\t\t\t<title>" + XmlEscape( item.title ) + "</title>\n";
+        if( !item.options.empty() ) {
+            out += "\t\t\t<extension application=\"http://www.videolan.org/vlc/playlist/0\">\n";
+            for( const std::string& option: item.options ) {
+                out += "\t\t\t\t<vlc:option>" +
+                       XmlEscape( option.substr( ':' == option[0] ? 1 : 0 ) ) +
+                       "</vlc:option>\n";
+            }
+            out += "\t\t\t</extension>\n";
+        }
+        out += "\t\t</track>\n";
+    }
+
+    out +=
+        "\t</trackList>\n"
+        "</playlist>\n";
+
+    return out;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ParsePlaylist( PlaylistFormat format, const char* data, uint64_t size,
+                    const std::string& baseDir,
+                    const PlaylistItemHandler& handler )
+{
+    if( size >= Utf8BomSize && 0 == memcmp( data, Utf8Bom, Utf8BomSize ) ) {
+        data += Utf8BomSize;
+        size -= Utf8BomSize;
+    }
+
+    switch( format ) {
+        case PlaylistFormat::M3U:
+            ParseM3U( data, size, baseDir, handler );
+            break;
+        case PlaylistFormat::XSPF:
+            ParseXSPF( data, size, baseDir, handler );
+            break;
+    }
+}
+
+std::string FormatPlaylist( PlaylistFormat format, const std::vector<PlaylistFileItem>& items )
+{
+    switch( format ) {
+        case PlaylistFormat::XSPF:
+            return FormatXSPF( items );
+        case PlaylistFormat::M3U:
+        default:
+            return FormatM3U( items );
+    }
+}
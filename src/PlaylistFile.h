@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//M3U/M3U8 and XSPF playlist files parsing and formatting
+struct PlaylistFileItem
+{
+    std::string mrl;
+    std::string title;
+    //trusted libvlc options (":option=value")
+    std::vector<std::string> options;
+};
+
+enum class PlaylistFormat {
+    M3U,
+    XSPF,
+};
+
+//by file extension, or by content if extension is unknown
+PlaylistFormat DetectPlaylistFormat( const std::string& path,
+                                     const char* data, uint64_t size );
+PlaylistFormat DetectPlaylistFormat( const std::string& path );
+
+//called for every parsed item, with count of already processed bytes
+typedef std::function<void( PlaylistFileItem& item, uint64_t processed )> PlaylistItemHandler;
+
+//relative paths are resolved against baseDir
+void ParsePlaylist( PlaylistFormat, const char* data, uint64_t size,
+                    const std::string& baseDir,
+                    const PlaylistItemHandler& );
+
+std::string FormatPlaylist( PlaylistFormat, const std::vector<PlaylistFileItem>& );
+
+std::string DirName( const std::string& path );
+std::string PathToMrl( const std::string& path );
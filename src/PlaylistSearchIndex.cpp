@@ -0,0 +1,200 @@
+#include "PlaylistSearchIndex.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+const size_t GramSize = 3;
+
+inline uint32_t Gram( const char* s )
+{
+    return ( static_cast<uint32_t>( static_cast<unsigned char>( s[0] ) ) << 16 ) |
+           ( static_cast<uint32_t>( static_cast<unsigned char>( s[1] ) ) << 8 ) |
+             static_cast<uint32_t>( static_cast<unsigned char>( s[2] ) );
+}
+
+inline int HexValue( char c )
+{
+    if( c >= '0' && c <= '9' ) return c - '0';
+    if( c >= 'a' && c <= 'f' ) return c - 'a' + 10;
+    if( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+    return -1;
+}
+
+}
+
+PlaylistSearchIndex::PlaylistSearchIndex() :
+    _documentCount( 0 )
+{
+}
+
+void PlaylistSearchIndex::fold( const char* text, size_t length,
+                                bool decodePercent, std::string* out )
+{
+    std::string decoded;
+    if( decodePercent ) {
+        decoded.reserve( length );
+        for( size_t i = 0; i < length; ++i ) {
+            if( '%' == text[i] && i + 2 < length &&
+                HexValue( text[i + 1] ) >= 0 && HexValue( text[i + 2] ) >= 0 )
+            {
+                decoded.push_back( static_cast<char>( HexValue( text[i + 1] ) * 16 +
+                                                      HexValue( text[i + 2] ) ) );
+                i += 2;
+            } else
+                decoded.push_back( text[i] );
+        }
+        text = decoded.data();
+        length = decoded.size();
+    }
+
+    out->reserve( out->size() + length );
+    for( size_t i = 0; i < length; ++i ) {
+        const unsigned char c = static_cast<unsigned char>( text[i] );
+        if( c >= 'A' && c <= 'Z' ) {
+            out->push_back( static_cast<char>( c + ( 'a' - 'A' ) ) );
+        } else if( i + 1 < length && ( 0xC3 == c || 0xD0 == c ) ) {
+            //two bytes utf-8 sequences
+            const unsigned char c2 = static_cast<unsigned char>( text[i + 1] );
+            unsigned char f1 = c, f2 = c2;
+            if( 0xC3 == c && c2 >= 0x80 && c2 <= 0x9E && c2 != 0x97 ) {
+                //Latin-1: À..Þ except ×
+                f2 = c2 + 0x20;
+            } else if( 0xD0 == c && c2 >= 0x90 && c2 <= 0x9F ) {
+                //Cyrillic: А..П
+                f2 = c2 + 0x20;
+            } else if( 0xD0 == c && c2 >= 0xA0 && c2 <= 0xAF ) {
+                //Cyrillic: Р..Я
+                f1 = 0xD1; f2 = c2 - 0x20;
+            } else if( 0xD0 == c && c2 >= 0x80 && c2 <= 0x8F ) {
+                //Cyrillic: Ѐ..Џ
+                f1 = 0xD1; f2 = c2 + 0x10;
+            }
+            out->push_back( static_cast<char>( f1 ) );
+            out->push_back( static_cast<char>( f2 ) );
+            ++i;
+        } else
+            out->push_back( static_cast<char>( c ) );
+    }
+}
+
+std::vector<std::string> PlaylistSearchIndex::tokenize( const std::string& foldedQuery )
+{
+    std::vector<std::string> tokens;
+
+    size_t start = 0;
+    while( start < foldedQuery.size() ) {
+        const size_t end = foldedQuery.find_first_of( " \t\r\n", start );
+        const size_t tokenEnd = end == std::string::npos ? foldedQuery.size() : end;
+        if( tokenEnd > start )
+            tokens.emplace_back( foldedQuery, start, tokenEnd - start );
+        start = tokenEnd + 1;
+    }
+
+    //longest tokens are most selective
+    std::sort( tokens.begin(), tokens.end(),
+        [] ( const std::string& l, const std::string& r ) {
+            return l.size() > r.size();
+        } );
+
+    return tokens;
+}
+
+bool PlaylistSearchIndex::matches( const std::string& text,
+                                   const std::vector<std::string>& tokens )
+{
+    for( const std::string& token: tokens ) {
+        if( text.find( token ) == std::string::npos )
+            return false;
+    }
+
+    return true;
+}
+
+void PlaylistSearchIndex::add( uint32_t id, const std::string& text )
+{
+    if( text.size() < GramSize ) {
+        ++_documentCount;
+        return;
+    }
+
+    std::vector<uint32_t> grams;
+    grams.reserve( text.size() - GramSize + 1 );
+    for( size_t i = 0; i + GramSize <= text.size(); ++i )
+        grams.push_back( Gram( text.data() + i ) );
+
+    std::sort( grams.begin(), grams.end() );
+    grams.erase( std::unique( grams.begin(), grams.end() ), grams.end() );
+
+    for( uint32_t gram: grams ) {
+        Postings& postings = _postings[gram];
+        if( postings.empty() || postings.back() < id ) {
+            postings.push_back( id );
+            continue;
+        }
+
+        auto it = std::lower_bound( postings.begin(), postings.end(), id );
+        if( *it != id )
+            postings.insert( it, id );
+    }
+
+    ++_documentCount;
+}
+
+void PlaylistSearchIndex::clear()
+{
+    _postings.clear();
+    _documentCount = 0;
+}
+
+bool PlaylistSearchIndex::candidates( const std::vector<std::string>& tokens,
+                                      std::vector<uint32_t>* ids ) const
+{
+    ids->clear();
+
+    //collect posting lists of all query trigrams, shortest first
+    std::vector<const Postings*> lists;
+    for( const std::string& token: tokens ) {
+        for( size_t i = 0; i + GramSize <= token.size(); ++i ) {
+            auto it = _postings.find( Gram( token.data() + i ) );
+            if( it == _postings.end() )
+                return true; //nothing could match
+            lists.push_back( &it->second );
+        }
+    }
+
+    if( lists.empty() )
+        return false;
+
+    std::sort( lists.begin(), lists.end(),
+        [] ( const Postings* l, const Postings* r ) {
+            return l->size() < r->size();
+        } );
+
+    *ids = *lists[0];
+
+    std::vector<uint32_t> intersection;
+    for( size_t l = 1; l < lists.size() && !ids->empty(); ++l ) {
+        intersection.clear();
+        const Postings& postings = *lists[l];
+        if( ids->size() * 16 < postings.size() ) {
+            //few candidates left, binary search is faster than merge
+            auto from = postings.begin();
+            for( uint32_t id: *ids ) {
+                from = std::lower_bound( from, postings.end(), id );
+                if( from == postings.end() )
+                    break;
+                if( *from == id )
+                    intersection.push_back( id );
+            }
+        } else {
+            std::set_intersection( ids->begin(), ids->end(),
+                                   postings.begin(), postings.end(),
+                                   std::back_inserter( intersection ) );
+        }
+        ids->swap( intersection );
+    }
+
+    return true;
+}
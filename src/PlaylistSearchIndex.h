@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//Trigram index over case folded playlist item texts.
+//Documents are identified by ids, posting lists are kept sorted by id
+//(adding documents in growing id order is cheapest, but not required).
+//Index returns only candidates, so caller should verify them
+//against actual texts (that also makes stale postings harmless).
+class PlaylistSearchIndex
+{
+public:
+    PlaylistSearchIndex();
+
+    //text should be folded with fold()
+    void add( uint32_t id, const std::string& text );
+    void clear();
+
+    //returns false if query has no tokens long enough to use index,
+    //i.e. all documents are candidates
+    bool candidates( const std::vector<std::string>& tokens,
+                     std::vector<uint32_t>* ids ) const;
+
+    unsigned documentCount() const
+        { return _documentCount; }
+
+    //lowercases ASCII, Latin-1 and Cyrillic letters,
+    //optionally decodes %XX escapes (useful for mrls)
+    static void fold( const char* text, size_t length,
+                      bool decodePercent, std::string* out );
+    static std::vector<std::string> tokenize( const std::string& foldedQuery );
+
+    //true if all tokens are present in folded text
+    static bool matches( const std::string& text, const std::vector<std::string>& tokens );
+
+private:
+    typedef std::vector<uint32_t> Postings;
+    std::unordered_map<uint32_t, Postings> _postings;
+    unsigned _documentCount;
+};
@@ -0,0 +1,763 @@
+#include "PlaylistStore.h"
+
+#include <algorithm>
+
+#include <string.h>
+#include <ctype.h>
+
+#include "MappedInput.h"
+#include "MetaCache.h"
+
+//selects custom input for item, i.e. ":wcjs-input=mmap",
+//is handled by store and is not passed to libvlc
+static const char INPUT_OPTION[] = ":wcjs-input=";
+static const size_t INPUT_OPTION_SIZE = sizeof( INPUT_OPTION ) - 1;
+
+//max count of items with libvlc media, least recently used ones
+//(except current and prefetched) are released above it
+static const unsigned MAX_MATERIALIZED = 64;
+
+///////////////////////////////////////////////////////////////////////////////
+namespace {
+
+//raw elementary streams are recognized by libvlc only by file extension
+const struct {
+    const char* extension;
+    const char* demux;
+} DemuxHints[] = {
+    { "h264", "h264" },
+    { "264", "h264" },
+    { "hevc", "hevc" },
+    { "h265", "hevc" },
+    { "265", "hevc" },
+    { "m1v", "es" },
+    { "m2v", "es" },
+    { "mpv", "es" },
+};
+
+//subtitles which libvlc would autodetect next to file, by preference
+const char* const SubtitleExtensions[] = { "srt", "ass", "ssa", "vtt", "sub" };
+
+//callback media has no path, so libvlc can't take demux and subtitles
+//hints from it, they are passed as options instead
+void AddPathOptions( const std::string& path, std::vector<std::string>* options )
+{
+    const size_t nameStart = path.find_last_of( "/\\" );
+    const size_t dot = path.rfind( '.' );
+    if( dot == std::string::npos || ( nameStart != std::string::npos && dot < nameStart ) )
+        return;
+
+    std::string extension = path.substr( dot + 1 );
+    std::transform( extension.begin(), extension.end(), extension.begin(), ::tolower );
+
+    for( const auto& hint: DemuxHints ) {
+        if( extension == hint.extension ) {
+            options->push_back( std::string( ":demux=" ) + hint.demux );
+            break;
+        }
+    }
+
+    const std::string stem = path.substr( 0, dot + 1 );
+    for( const char* subtitleExtension: SubtitleExtensions ) {
+        uint64_t size;
+        int64_t mtime;
+        const std::string subtitlePath = stem + subtitleExtension;
+        if( MappedFile::stat( subtitlePath, &size, &mtime ) ) {
+            options->push_back( ":sub-file=" + subtitlePath );
+            break;
+        }
+    }
+}
+
+}
+
+PlaylistStore::PlaylistStore( vlc::player& player ) :
+    _player( player ), _libvlc( nullptr ), _arenaGarbage( 0 ), _optionSets( 1 ),
+    _useCounter( 0 ), _prefetchedId( NO_ID ), _generation( 0 ),
+    _nextId( 0 ), _staleDocuments( 0 )
+{
+}
+
+uint32_t PlaylistStore::internOption( const char* option, size_t length )
+{
+    std::string key( option, length );
+
+    auto it = _optionIds.find( key );
+    if( it != _optionIds.end() )
+        return it->second;
+
+    const uint32_t id = static_cast<uint32_t>( _options.size() );
+    _options.push_back( key );
+    _optionIds.emplace( std::move( key ), id );
+
+    return id;
+}
+
+uint32_t PlaylistStore::internOptionSet( const std::vector<uint32_t>& optionSet )
+{
+    if( optionSet.empty() )
+        return 0;
+
+    auto it = _optionSetIds.find( optionSet );
+    if( it != _optionSetIds.end() )
+        return it->second;
+
+    const uint32_t id = static_cast<uint32_t>( _optionSets.size() );
+    _optionSets.push_back( optionSet );
+    _optionSetIds.emplace( optionSet, id );
+
+    return id;
+}
+
+int PlaylistStore::add( const char* mrl, size_t mrlLength,
+                        unsigned optionCount, const char* const* options,
+                        const char* title, size_t titleLength )
+{
+    if( !mrl || !mrlLength )
+        return -1;
+
+    uint32_t optionSet = 0;
+    if( optionCount ) {
+        std::vector<uint32_t> optionIds;
+        optionIds.reserve( optionCount );
+        for( unsigned i = 0; i < optionCount; ++i ) {
+            if( options[i] && *options[i] )
+                optionIds.push_back( internOption( options[i], strlen( options[i] ) ) );
+        }
+        optionSet = internOptionSet( optionIds );
+    }
+
+    Entry entry;
+    entry.id = _nextId++;
+    entry.mrlOffset = static_cast<uint32_t>( _arena.size() );
+    entry.mrlLength = static_cast<uint32_t>( mrlLength );
+    entry.titleLength = title ? static_cast<uint32_t>( titleLength ) : 0;
+    entry.optionSet = optionSet;
+
+    _arena.insert( _arena.end(), mrl, mrl + mrlLength );
+    if( entry.titleLength )
+        _arena.insert( _arena.end(), title, title + titleLength );
+    _entries.push_back( entry );
+
+    if( _searchIndex ) {
+        _searchTexts.push_back( searchText( entry ) );
+        _searchIndex->add( entry.id, _searchTexts.back() );
+    }
+
+    return static_cast<int>( _entries.size() - 1 );
+}
+
+int PlaylistStore::add( const std::string& mrl,
+                        const std::vector<std::string>& options,
+                        const std::string& title )
+{
+    std::vector<const char*> optionsPtrs;
+    optionsPtrs.reserve( options.size() );
+    for( const std::string& option: options )
+        optionsPtrs.push_back( option.c_str() );
+
+    return add( mrl.data(), mrl.size(), optionsPtrs.size(), optionsPtrs.data(),
+                title.data(), title.size() );
+}
+
+int PlaylistStore::add( const std::string& mrl,
+                        const std::shared_ptr<MediaInput>& input,
+                        const std::vector<std::string>& options,
+                        const std::string& title )
+{
+#if LIBVLC_VERSION_INT < LIBVLC_VERSION( 3, 0, 0, 0 )
+    //item couldn't be played without media callbacks
+    return -1;
+#endif
+
+    if( !input )
+        return -1;
+
+    const int idx = add( mrl, options, title );
+    if( idx >= 0 )
+        _inputs.emplace( _entries[idx].id, input );
+
+    return idx;
+}
+
+void PlaylistStore::moveTail( unsigned first, unsigned at )
+{
+    if( first >= _entries.size() || at >= first )
+        return;
+
+    std::rotate( _entries.begin() + at, _entries.begin() + first, _entries.end() );
+    if( _searchIndex )
+        std::rotate( _searchTexts.begin() + at, _searchTexts.begin() + first, _searchTexts.end() );
+    ++_generation;
+
+    const unsigned tailSize = _entries.size() - first;
+    for( unsigned& materializedIdx: _materialized ) {
+        if( materializedIdx >= at )
+            materializedIdx += tailSize;
+    }
+}
+
+bool PlaylistStore::remove( unsigned idx )
+{
+    if( idx >= _entries.size() )
+        return false;
+
+    auto it = std::lower_bound( _materialized.begin(), _materialized.end(), idx );
+    if( it != _materialized.end() && *it == idx ) {
+        if( !_player.delete_item( it - _materialized.begin() ) )
+            return false;
+        it = _materialized.erase( it );
+    }
+    for( ; it != _materialized.end(); ++it )
+        --( *it );
+
+    _lastUse.erase( _entries[idx].id );
+
+    auto inputIt = _inputs.find( _entries[idx].id );
+    if( inputIt != _inputs.end() ) {
+        //media could be still playing
+        if( inputIt->second )
+            inputIt->second->interrupt();
+        _inputs.erase( inputIt );
+    }
+
+    _arenaGarbage += _entries[idx].mrlLength + _entries[idx].titleLength;
+    _metaTexts.erase( _entries[idx].id );
+    if( _searchIndex ) {
+        ++_staleDocuments;
+        _searchTexts.erase( _searchTexts.begin() + idx );
+    }
+    _entries.erase( _entries.begin() + idx );
+    ++_generation;
+
+    if( _arenaGarbage > 64 * 1024 && _arenaGarbage > _arena.size() / 2 )
+        compactArena();
+
+    return true;
+}
+
+void PlaylistStore::clear()
+{
+    interruptInputs();
+    _player.clear_items();
+    _inputs.clear();
+
+    _materialized.clear();
+    _lastUse.clear();
+    _prefetchedId = NO_ID;
+    std::vector<Entry>().swap( _entries );
+    ++_generation;
+    std::vector<char>().swap( _arena );
+    _arenaGarbage = 0;
+
+    _options.clear();
+    _optionIds.clear();
+    _optionSets.resize( 1 );
+    _optionSetIds.clear();
+
+    _metaTexts.clear();
+    _searchIndex.reset();
+    _staleDocuments = 0;
+    std::vector<std::string>().swap( _searchTexts );
+    std::vector<bool>().swap( _candidateMarks );
+}
+
+void PlaylistStore::advance( unsigned idx, int count )
+{
+    if( idx >= _entries.size() || !count )
+        return;
+
+    int target = static_cast<int>( idx ) + count;
+    target = std::max( 0, std::min( target, static_cast<int>( _entries.size() ) - 1 ) );
+    const unsigned to = static_cast<unsigned>( target );
+    if( to == idx )
+        return;
+
+    const Entry entry = _entries[idx];
+    _entries.erase( _entries.begin() + idx );
+    _entries.insert( _entries.begin() + to, entry );
+    if( _searchIndex ) {
+        std::string text = std::move( _searchTexts[idx] );
+        _searchTexts.erase( _searchTexts.begin() + idx );
+        _searchTexts.insert( _searchTexts.begin() + to, std::move( text ) );
+    }
+    ++_generation;
+
+    int oldPlayerIdx = -1;
+    for( unsigned i = 0; i < _materialized.size(); ++i ) {
+        unsigned& materializedIdx = _materialized[i];
+        if( materializedIdx == idx ) {
+            oldPlayerIdx = i;
+            materializedIdx = to;
+        } else if( idx < to && materializedIdx > idx && materializedIdx <= to )
+            --materializedIdx;
+        else if( to < idx && materializedIdx >= to && materializedIdx < idx )
+            ++materializedIdx;
+    }
+
+    if( oldPlayerIdx < 0 )
+        return;
+
+    //only moved item could change it's rank among materialized ones
+    std::sort( _materialized.begin(), _materialized.end() );
+    const int newPlayerIdx = playerIndex( to );
+    if( newPlayerIdx != oldPlayerIdx )
+        _player.advance_item( oldPlayerIdx, newPlayerIdx - oldPlayerIdx );
+}
+
+std::string PlaylistStore::mrl( unsigned idx ) const
+{
+    if( idx >= _entries.size() )
+        return std::string();
+
+    const Entry& entry = _entries[idx];
+    return std::string( _arena.data() + entry.mrlOffset, entry.mrlLength );
+}
+
+std::string PlaylistStore::title( unsigned idx ) const
+{
+    if( idx >= _entries.size() )
+        return std::string();
+
+    const Entry& entry = _entries[idx];
+    return std::string( _arena.data() + entry.mrlOffset + entry.mrlLength, entry.titleLength );
+}
+
+std::vector<std::string> PlaylistStore::options( unsigned idx ) const
+{
+    std::vector<std::string> options;
+    if( idx >= _entries.size() )
+        return options;
+
+    for( uint32_t optionId: _optionSets[_entries[idx].optionSet] )
+        options.push_back( _options[optionId] );
+
+    return options;
+}
+
+std::shared_ptr<MediaInput> PlaylistStore::input( unsigned idx ) const
+{
+    if( idx >= _entries.size() )
+        return std::shared_ptr<MediaInput>();
+
+    auto it = _inputs.find( _entries[idx].id );
+    if( it == _inputs.end() )
+        return std::shared_ptr<MediaInput>();
+
+    return it->second;
+}
+
+std::string PlaylistStore::inputMode( unsigned idx ) const
+{
+    if( idx >= _entries.size() )
+        return std::string();
+
+    for( uint32_t optionId: _optionSets[_entries[idx].optionSet] ) {
+        const std::string& option = _options[optionId];
+        if( 0 == option.compare( 0, INPUT_OPTION_SIZE, INPUT_OPTION ) )
+            return option.substr( INPUT_OPTION_SIZE );
+    }
+
+    return std::string();
+}
+
+void PlaylistStore::interruptInputs()
+{
+    for( const auto& input: _inputs ) {
+        if( input.second )
+            input.second->interrupt();
+    }
+}
+
+bool PlaylistStore::fallbackToMrl( unsigned idx )
+{
+    if( idx >= _entries.size() )
+        return false;
+
+    auto inputIt = _inputs.find( _entries[idx].id );
+    if( inputIt == _inputs.end() || !inputIt->second || !inputIt->second->fallbackToMrl() )
+        return false;
+
+    //empty input is kept, so input selected by option is not created again
+    inputIt->second.reset();
+
+    return dematerialize( idx );
+}
+
+unsigned PlaylistStore::playerIndex( unsigned idx ) const
+{
+    return std::lower_bound( _materialized.begin(), _materialized.end(), idx ) -
+           _materialized.begin();
+}
+
+bool PlaylistStore::isMaterialized( unsigned idx ) const
+{
+    return std::binary_search( _materialized.begin(), _materialized.end(), idx );
+}
+
+int PlaylistStore::findMaterialized( unsigned idx ) const
+{
+    const unsigned playerIdx = playerIndex( idx );
+    if( playerIdx < _materialized.size() && _materialized[playerIdx] == idx )
+        return playerIdx;
+
+    return -1;
+}
+
+bool PlaylistStore::dematerialize( unsigned idx )
+{
+    const int playerIdx = findMaterialized( idx );
+    if( playerIdx < 0 )
+        return true;
+
+    if( !_player.delete_item( playerIdx ) )
+        return false;
+
+    _materialized.erase( _materialized.begin() + playerIdx );
+    _lastUse.erase( _entries[idx].id );
+
+    return true;
+}
+
+void PlaylistStore::evictMaterialized()
+{
+    const int currentIdx = current();
+
+    //linear scan is fine, there are at most MAX_MATERIALIZED items
+    int evictIdx = -1;
+    uint64_t evictUse = 0;
+    for( unsigned playerIdx = 0; playerIdx < _materialized.size(); ++playerIdx ) {
+        const unsigned idx = _materialized[playerIdx];
+        const uint32_t id = _entries[idx].id;
+        //disabled flag lives only in vlc::player
+        if( static_cast<int>( idx ) == currentIdx || id == _prefetchedId ||
+            _player.is_item_disabled( playerIdx ) )
+        {
+            continue;
+        }
+
+        const uint64_t use = _lastUse[id];
+        if( evictIdx < 0 || use < evictUse ) {
+            evictIdx = idx;
+            evictUse = use;
+        }
+    }
+
+    if( evictIdx >= 0 )
+        dematerialize( evictIdx );
+}
+
+int PlaylistStore::prefetch( unsigned idx )
+{
+    const int playerIdx = materialize( idx );
+    if( playerIdx >= 0 )
+        _prefetchedId = _entries[idx].id;
+
+    return playerIdx;
+}
+
+int PlaylistStore::materialize( unsigned idx )
+{
+    if( idx >= _entries.size() )
+        return -1;
+
+    _lastUse[_entries[idx].id] = ++_useCounter;
+
+    unsigned playerIdx = playerIndex( idx );
+    if( playerIdx < _materialized.size() && _materialized[playerIdx] == idx )
+        return playerIdx;
+
+    if( _materialized.size() >= MAX_MATERIALIZED ) {
+        evictMaterialized();
+        playerIdx = playerIndex( idx );
+    }
+
+    const std::string itemMrl = mrl( idx );
+
+    const std::vector<uint32_t>& optionSet = _optionSets[_entries[idx].optionSet];
+    std::vector<const char*> trustedOpts;
+    trustedOpts.reserve( optionSet.size() );
+    for( uint32_t optionId: optionSet ) {
+        const std::string& option = _options[optionId];
+        if( 0 != option.compare( 0, INPUT_OPTION_SIZE, INPUT_OPTION ) )
+            trustedOpts.push_back( option.c_str() );
+    }
+
+#if LIBVLC_VERSION_INT >= LIBVLC_VERSION( 3, 0, 0, 0 )
+    //input selected by option is created together with media
+    const std::string mode = inputMode( idx );
+    if( !mode.empty() && !_inputs.count( _entries[idx].id ) ) {
+        std::shared_ptr<MediaInput> input;
+        if( "mmap" == mode ) {
+            //file too large to be mapped is played from mrl
+            const std::string path = MetaCache::localPath( itemMrl );
+            uint64_t fileSize;
+            int64_t fileTime;
+            if( !path.empty() &&
+                ( !MappedFile::stat( path, &fileSize, &fileTime ) ||
+                  MappedFile::canMap( fileSize ) ) )
+            {
+                input = std::make_shared<MappedInput>( path );
+            }
+        } else if( _inputFactory )
+            input = _inputFactory( mode, itemMrl );
+
+        if( input )
+            _inputs.emplace( _entries[idx].id, input );
+    }
+#endif
+
+    int addedIdx = -1;
+    auto inputIt = _inputs.find( _entries[idx].id );
+    if( inputIt != _inputs.end() && inputIt->second ) {
+        libvlc_media_t* media = CreateMedia( _libvlc, inputIt->second );
+        if( !media )
+            return -1;
+
+        //item options go after path ones, so they could override them
+        std::vector<std::string> pathOptions;
+        if( "mmap" == inputMode( idx ) )
+            AddPathOptions( MetaCache::localPath( itemMrl ), &pathOptions );
+        for( const std::string& option: pathOptions )
+            libvlc_media_add_option_flag( media, option.c_str(), libvlc_media_option_trusted );
+
+        for( const char* option: trustedOpts )
+            libvlc_media_add_option_flag( media, option, libvlc_media_option_trusted );
+
+        addedIdx = _player.add_media( vlc::media( media, false ) );
+    } else {
+        addedIdx =
+            _player.add_media( itemMrl.c_str(),
+                               0, nullptr,
+                               trustedOpts.size(), trustedOpts.data() );
+    }
+    if( addedIdx < 0 )
+        return -1;
+
+    if( static_cast<unsigned>( addedIdx ) != playerIdx )
+        _player.advance_item( addedIdx, static_cast<int>( playerIdx ) - addedIdx );
+
+    _materialized.insert( _materialized.begin() + playerIdx, idx );
+
+    if( _entries[idx].titleLength )
+        _player.get_media( playerIdx ).set_meta( libvlc_meta_Title, title( idx ) );
+
+    return playerIdx;
+}
+
+vlc::media PlaylistStore::media( unsigned idx )
+{
+    const int playerIdx = materialize( idx );
+    if( playerIdx < 0 )
+        return vlc::media();
+
+    return _player.get_media( playerIdx );
+}
+
+int PlaylistStore::fromPlayerIndex( int playerIdx ) const
+{
+    if( playerIdx < 0 || static_cast<unsigned>( playerIdx ) >= _materialized.size() )
+        return -1;
+
+    return _materialized[playerIdx];
+}
+
+int PlaylistStore::current() const
+{
+    return fromPlayerIndex( _player.current_item() );
+}
+
+void PlaylistStore::setCurrent( unsigned idx )
+{
+    const int playerIdx = materialize( idx );
+    if( playerIdx >= 0 )
+        _player.set_current( playerIdx );
+}
+
+bool PlaylistStore::play( unsigned idx )
+{
+    const int playerIdx = materialize( idx );
+    if( playerIdx < 0 )
+        return false;
+
+    //current item is stopped first
+    interruptInputs();
+
+    return _player.play( playerIdx );
+}
+
+bool PlaylistStore::isDisabled( unsigned idx ) const
+{
+    const int playerIdx = findMaterialized( idx );
+    if( playerIdx >= 0 )
+        return _player.is_item_disabled( playerIdx );
+
+    //only materialized item could be disabled
+    return false;
+}
+
+size_t PlaylistStore::memoryUsage() const
+{
+    size_t usage =
+        _entries.capacity() * sizeof( Entry ) +
+        _arena.capacity() +
+        _materialized.capacity() * sizeof( unsigned ) +
+        _lastUse.size() * ( sizeof( uint32_t ) + sizeof( uint64_t ) );
+
+    for( const std::string& option: _options )
+        usage += 2 * ( option.capacity() + sizeof( uint32_t ) );
+    for( const std::vector<uint32_t>& optionSet: _optionSets )
+        usage += 2 * optionSet.capacity() * sizeof( uint32_t );
+    for( const std::string& text: _searchTexts )
+        usage += sizeof( std::string ) + text.capacity();
+
+    return usage;
+}
+
+void PlaylistStore::compactArena()
+{
+    std::vector<char> arena;
+    arena.reserve( _arena.size() - _arenaGarbage );
+
+    for( Entry& entry: _entries ) {
+        const uint32_t offset = static_cast<uint32_t>( arena.size() );
+        arena.insert( arena.end(),
+                      _arena.begin() + entry.mrlOffset,
+                      _arena.begin() + entry.mrlOffset + entry.mrlLength + entry.titleLength );
+        entry.mrlOffset = offset;
+    }
+
+    _arena.swap( arena );
+    _arenaGarbage = 0;
+}
+
+std::string PlaylistStore::searchText( const Entry& entry ) const
+{
+    std::string text;
+    PlaylistSearchIndex::fold( _arena.data() + entry.mrlOffset, entry.mrlLength, true, &text );
+    if( entry.titleLength ) {
+        text.push_back( '\n' );
+        PlaylistSearchIndex::fold( _arena.data() + entry.mrlOffset + entry.mrlLength,
+                                   entry.titleLength, false, &text );
+    }
+
+    auto it = _metaTexts.find( entry.id );
+    if( it != _metaTexts.end() ) {
+        text.push_back( '\n' );
+        text.append( it->second );
+    }
+
+    return text;
+}
+
+void PlaylistStore::updateMeta( unsigned idx )
+{
+    const int playerIdx = findMaterialized( idx );
+    if( playerIdx < 0 )
+        return;
+
+    vlc::media media = _player.get_media( playerIdx );
+
+    const std::string meta =
+        media.meta( libvlc_meta_Title ) + '\n' +
+        media.meta( libvlc_meta_Artist ) + '\n' +
+        media.meta( libvlc_meta_Album );
+
+    std::string metaText;
+    PlaylistSearchIndex::fold( meta.data(), meta.size(), false, &metaText );
+
+    Entry& entry = _entries[idx];
+
+    auto it = _metaTexts.find( entry.id );
+    if( it != _metaTexts.end() && it->second == metaText )
+        return;
+
+    if( it != _metaTexts.end() )
+        _metaTexts.erase( it );
+
+    //new id keeps posting lists sorted,
+    //postings of old id are just never matched anymore
+    const uint32_t oldId = entry.id;
+    entry.id = _nextId++;
+
+    auto inputIt = _inputs.find( oldId );
+    if( inputIt != _inputs.end() ) {
+        std::shared_ptr<MediaInput> input = std::move( inputIt->second );
+        _inputs.erase( inputIt );
+        _inputs.emplace( entry.id, std::move( input ) );
+    }
+
+    _metaTexts.emplace( entry.id, std::move( metaText ) );
+
+    if( _searchIndex ) {
+        ++_staleDocuments;
+        _searchTexts[idx] = searchText( entry );
+        _searchIndex->add( entry.id, _searchTexts[idx] );
+    }
+}
+
+void PlaylistStore::rebuildSearchIndex()
+{
+    _searchIndex.reset( new PlaylistSearchIndex );
+    _staleDocuments = 0;
+
+    _searchTexts.clear();
+    _searchTexts.reserve( _entries.size() );
+    for( const Entry& entry: _entries )
+        _searchTexts.push_back( searchText( entry ) );
+
+    //ids are not in store order after items reordering,
+    //and index is filled fastest in id order
+    std::vector<unsigned> byId( _entries.size() );
+    for( unsigned i = 0; i < byId.size(); ++i )
+        byId[i] = i;
+    std::sort( byId.begin(), byId.end(),
+        [this] ( unsigned l, unsigned r ) {
+            return _entries[l].id < _entries[r].id;
+        } );
+
+    for( unsigned i: byId )
+        _searchIndex->add( _entries[i].id, _searchTexts[i] );
+}
+
+std::vector<unsigned> PlaylistStore::search( const std::string& query, unsigned limit )
+{
+    std::vector<unsigned> found;
+
+    std::string foldedQuery;
+    PlaylistSearchIndex::fold( query.data(), query.size(), false, &foldedQuery );
+    const std::vector<std::string> tokens = PlaylistSearchIndex::tokenize( foldedQuery );
+    if( tokens.empty() )
+        return found;
+
+    if( !_searchIndex || _staleDocuments > _entries.size() )
+        rebuildSearchIndex();
+
+    std::vector<uint32_t> candidates;
+    const bool useCandidates = _searchIndex->candidates( tokens, &candidates );
+    if( useCandidates && candidates.empty() )
+        return found;
+
+    //items are scanned in playlist order, so candidates are marked by id
+    if( useCandidates ) {
+        _candidateMarks.resize( _nextId );
+        for( uint32_t id: candidates )
+            _candidateMarks[id] = true;
+    }
+
+    for( unsigned i = 0; i < _entries.size(); ++i ) {
+        if( useCandidates && !_candidateMarks[_entries[i].id] )
+            continue;
+
+        if( PlaylistSearchIndex::matches( _searchTexts[i], tokens ) ) {
+            found.push_back( i );
+            if( limit && found.size() >= limit )
+                break;
+        }
+    }
+
+    for( uint32_t id: candidates )
+        _candidateMarks[id] = false;
+
+    return found;
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <functional>
+#include <stdint.h>
+
+#include <libvlc_wrapper/vlc_player.h>
+
+#include "PlaylistSearchIndex.h"
+#include "MediaInput.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//Compact playlist representation.
+//Mrls are kept in single arena, options are interned, so repeated
+//option sets (typical for IPTV lists) are stored only once.
+//libvlc media is created (item is materialized in vlc::player)
+//only when item becomes current, is prefetched, or is accessed as media,
+//and is released again when too many items are materialized.
+//Materialized items are kept in vlc::player in the same order as in store,
+//so vlc::player index is the rank of item among materialized ones.
+//Not thread safe, should be used from gui thread only.
+class PlaylistStore
+{
+public:
+    PlaylistStore( vlc::player& player );
+
+    //required to materialize items with custom input
+    void setLibvlc( libvlc_instance_t* libvlc )
+        { _libvlc = libvlc; }
+
+    //creates input for ":wcjs-input=" modes not handled by store itself,
+    //empty pointer means item is played from mrl as usual
+    typedef std::function<std::shared_ptr<MediaInput>( const std::string& mode,
+                                                       const std::string& mrl )> InputFactory;
+    void setInputFactory( const InputFactory& factory )
+        { _inputFactory = factory; }
+
+    unsigned count() const
+        { return static_cast<unsigned>( _entries.size() ); }
+
+    //changed every time item indexes are shifted (i.e. on remove/clear/advance)
+    unsigned generation() const
+        { return _generation; }
+
+    //appends item without libvlc media creation, returns item index.
+    //title (if not empty) is set as media title when media is created
+    int add( const char* mrl, size_t mrlLength,
+             unsigned optionCount, const char* const* options,
+             const char* title = nullptr, size_t titleLength = 0 );
+    int add( const std::string& mrl,
+             const std::vector<std::string>& options = std::vector<std::string>(),
+             const std::string& title = std::string() );
+    //item media is read from input instead of mrl (mrl is used only as item name),
+    //returns -1 if libvlc doesn't support media callbacks (< 3.0)
+    int add( const std::string& mrl,
+             const std::shared_ptr<MediaInput>& input,
+             const std::vector<std::string>& options = std::vector<std::string>(),
+             const std::string& title = std::string() );
+
+    //moves items [first, count()) to position "at",
+    //items should be not materialized yet (i.e. just added)
+    void moveTail( unsigned first, unsigned at );
+
+    bool remove( unsigned idx );
+    void clear();
+    void advance( unsigned idx, int count );
+
+    std::string mrl( unsigned idx ) const;
+    std::string title( unsigned idx ) const;
+    std::vector<std::string> options( unsigned idx ) const;
+    std::shared_ptr<MediaInput> input( unsigned idx ) const;
+    //value of ":wcjs-input=" item option (i.e. "mmap"), or empty string
+    std::string inputMode( unsigned idx ) const;
+
+    //unblocks reads of all custom inputs,
+    //should be called before libvlc is asked to stop playback
+    void interruptInputs();
+
+    //if custom input of item can't serve it (see MediaInput::fallbackToMrl()),
+    //input is dropped and item media is recreated from mrl on next use.
+    //Returns false if item has no such input
+    bool fallbackToMrl( unsigned idx );
+
+    bool isMaterialized( unsigned idx ) const;
+    //vlc::player index of item, or -1 if it's not materialized
+    int findMaterialized( unsigned idx ) const;
+    //creates libvlc media for item if it's not created yet,
+    //returns vlc::player index of item or -1.
+    //Least recently used item could be released to make room for it
+    int materialize( unsigned idx );
+    //the same as materialize(), but item is not released
+    //until other item is prefetched
+    int prefetch( unsigned idx );
+    vlc::media media( unsigned idx );
+
+    //store index of item with vlc::player index, or -1
+    int fromPlayerIndex( int playerIdx ) const;
+
+    //store index of vlc::player current item or -1
+    int current() const;
+    void setCurrent( unsigned idx );
+    bool play( unsigned idx );
+
+    bool isDisabled( unsigned idx ) const;
+
+    //takes title/artist/album of materialized item into search index
+    void updateMeta( unsigned idx );
+
+    //indexes of items containing all query words in mrl or meta,
+    //in playlist order. Index is built on first search.
+    std::vector<unsigned> search( const std::string& query, unsigned limit );
+
+    size_t memoryUsage() const;
+
+private:
+    struct Entry
+    {
+        //stable item id, used by search index
+        uint32_t id;
+        uint32_t mrlOffset;
+        uint32_t mrlLength;
+        //title is stored in arena right after mrl
+        uint32_t titleLength;
+        uint32_t optionSet;
+    };
+
+    uint32_t internOption( const char* option, size_t length );
+    uint32_t internOptionSet( const std::vector<uint32_t>& );
+
+    //rank of item among materialized ones
+    unsigned playerIndex( unsigned idx ) const;
+    //releases libvlc media of item
+    bool dematerialize( unsigned idx );
+    //releases least recently used item except current and prefetched ones
+    void evictMaterialized();
+
+    void compactArena();
+
+    std::string searchText( const Entry& ) const;
+    void rebuildSearchIndex();
+
+private:
+    vlc::player& _player;
+    libvlc_instance_t* _libvlc;
+    InputFactory _inputFactory;
+
+    std::vector<Entry> _entries;
+
+    std::vector<char> _arena;
+    size_t _arenaGarbage;
+
+    std::vector<std::string> _options;
+    std::unordered_map<std::string, uint32_t> _optionIds;
+    //option set 0 is always empty set
+    std::vector<std::vector<uint32_t> > _optionSets;
+    std::map<std::vector<uint32_t>, uint32_t> _optionSetIds;
+
+    //sorted store indices of materialized items,
+    //position in this vector is the index in vlc::player
+    std::vector<unsigned> _materialized;
+    //use serials of materialized items, by id
+    std::unordered_map<uint32_t, uint64_t> _lastUse;
+    uint64_t _useCounter;
+    static const uint32_t NO_ID = 0xFFFFFFFF;
+    uint32_t _prefetchedId;
+
+    unsigned _generation;
+    uint32_t _nextId;
+
+    //folded meta of items, by id
+    std::unordered_map<uint32_t, std::string> _metaTexts;
+    std::unique_ptr<PlaylistSearchIndex> _searchIndex;
+    unsigned _staleDocuments;
+    //folded search texts of items, in store order,
+    //kept only while search index exists
+    std::vector<std::string> _searchTexts;
+    //search candidates marks by id, cleared after every search
+    std::vector<bool> _candidateMarks;
+
+    //custom inputs of items, by id.
+    //Empty input means input mode of item fell back to mrl
+    std::unordered_map<uint32_t, std::shared_ptr<MediaInput> > _inputs;
+};
@@ -0,0 +1,94 @@
+#include "SeekScheduler.h"
+
+#include <algorithm>
+
+SeekScheduler::SeekScheduler() :
+    _inFlight( false ), _issueTime( 0 ), _target( 0 ), _fromTime( 0 ),
+    _landed( false ), _landedFrame( 0 ),
+    _hasPending( false ), _pendingTime( 0 ),
+    _seekCount( 0 ), _coalescedCount( 0 ), _timeoutCount( 0 ),
+    _latencyCount( 0 ), _latencySum( 0 ), _lastLatency( 0 ), _maxLatency( 0 )
+{
+}
+
+bool SeekScheduler::request( int64_t time, int64_t currentTime, double now )
+{
+    if( _inFlight ) {
+        if( _hasPending )
+            ++_coalescedCount;
+
+        _hasPending = true;
+        _pendingTime = time;
+
+        return false;
+    }
+
+    _inFlight = true;
+    _issueTime = now;
+    _target = time;
+    _fromTime = currentTime;
+    _landed = false;
+    ++_seekCount;
+
+    return true;
+}
+
+bool SeekScheduler::timeChanged( int64_t time, uint64_t frame )
+{
+    if( !_inFlight || _landed )
+        return false;
+
+    //time reported before seek took effect is closer to previous position
+    const int64_t distance = time > _target ? time - _target : _target - time;
+    const int64_t fromDistance = time > _fromTime ? time - _fromTime : _fromTime - time;
+    if( distance > TimeTolerance || distance > fromDistance )
+        return false;
+
+    _landed = true;
+    _landedFrame = frame;
+
+    return true;
+}
+
+bool SeekScheduler::frameDisplayed( uint64_t frame ) const
+{
+    return _inFlight && _landed && frame > _landedFrame;
+}
+
+bool SeekScheduler::completed( double now, bool timedOut, int64_t* time )
+{
+    if( !_inFlight )
+        return false;
+
+    if( timedOut ) {
+        ++_timeoutCount;
+    } else {
+        _lastLatency = now - _issueTime;
+        _maxLatency = std::max( _maxLatency, _lastLatency );
+        _latencySum += _lastLatency;
+        ++_latencyCount;
+    }
+
+    if( !_hasPending ) {
+        _inFlight = false;
+        return false;
+    }
+
+    _hasPending = false;
+    _issueTime = now;
+    //player is at previous target now (or somewhere on the way to it)
+    _fromTime = _target;
+    _target = _pendingTime;
+    _landed = false;
+    ++_seekCount;
+    *time = _pendingTime;
+
+    return true;
+}
+
+void SeekScheduler::reset()
+{
+    _inFlight = false;
+    _hasPending = false;
+    _landed = false;
+}
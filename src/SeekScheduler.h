@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//Coalesces seeks while scrubbing: only one seek is in flight at a time,
+//and while it's not done only latest requested target is kept.
+//Seek is done when frame is displayed after player reported time
+//near seek target (frames decoded before seek took effect don't count).
+//Times are in ms, "now" is monotonic clock in ms,
+//frame serials are counts of frames displayed so far.
+class SeekScheduler
+{
+public:
+    //max distance between reported time and target of landed seek
+    static const int64_t TimeTolerance = 2000;
+
+    SeekScheduler();
+
+    //returns true if seek to time should be issued right now,
+    //otherwise time replaces pending target.
+    //currentTime is player time before seek.
+    bool request( int64_t time, int64_t currentTime, double now );
+
+    //player reported time, frame is serial of last frame displayed before report.
+    //Returns true if in-flight seek took effect with this report
+    bool timeChanged( int64_t time, uint64_t frame );
+    //returns true if frame belongs to in-flight seek, i.e. seek is done
+    bool frameDisplayed( uint64_t frame ) const;
+
+    //in-flight seek is done (see frameDisplayed()), or it's timed out.
+    //Returns true if pending target (stored to time) should be issued right now.
+    bool completed( double now, bool timedOut, int64_t* time );
+
+    //drops in-flight and pending seeks (on media change, stop, etc.)
+    void reset();
+
+    bool inFlight() const
+        { return _inFlight; }
+
+    //count of issued seeks
+    unsigned seekCount() const
+        { return _seekCount; }
+    //count of requests replaced by later ones without being issued
+    unsigned coalescedCount() const
+        { return _coalescedCount; }
+    //count of seeks which didn't produce frame in time
+    unsigned timeoutCount() const
+        { return _timeoutCount; }
+
+    //time from seek issue to first frame displayed after it
+    double lastLatency() const
+        { return _lastLatency; }
+    double averageLatency() const
+        { return _latencyCount ? _latencySum / _latencyCount : 0; }
+    double maxLatency() const
+        { return _maxLatency; }
+
+private:
+    bool _inFlight;
+    double _issueTime;
+    int64_t _target;
+    int64_t _fromTime;
+    //player reported time near target
+    bool _landed;
+    uint64_t _landedFrame;
+
+    bool _hasPending;
+    int64_t _pendingTime;
+
+    unsigned _seekCount;
+    unsigned _coalescedCount;
+    unsigned _timeoutCount;
+
+    unsigned _latencyCount;
+    double _latencySum;
+    double _lastLatency;
+    double _maxLatency;
+};
@@ -0,0 +1,266 @@
+#include "StreamInput.h"
+
+#include <string.h>
+
+#include <chrono>
+#include <algorithm>
+
+StreamInput::StreamInput( uint64_t size, bool seekable, size_t capacity,
+                          const std::function<void()>& notify ) :
+    _size( size ), _seekable( seekable && UnknownSize != size ),
+    _capacity( capacity ), _notify( notify ),
+    _chunkOffset( 0 ), _buffered( 0 ), _consumedChunks( 0 ),
+    _position( 0 ), _generation( 0 ), _seekPending( false ),
+    _ended( false ), _failed( false ), _interrupted( false ),
+    _bytesRead( 0 ), _starvationTime( 0 ), _starvationCount( 0 ), _seekCount( 0 )
+{
+}
+
+StreamInput::~StreamInput()
+{
+    //producer should release its chunks
+    if( _notify )
+        _notify();
+}
+
+unsigned StreamInput::generation() const
+{
+    std::lock_guard<std::mutex> lock( _guard );
+    return _generation;
+}
+
+bool StreamInput::takeSeek( uint64_t* offset, unsigned* generation )
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    if( !_seekPending )
+        return false;
+
+    _seekPending = false;
+    *offset = _position;
+    *generation = _generation;
+
+    return true;
+}
+
+bool StreamInput::push( unsigned generation, const void* data, size_t size )
+{
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+
+        if( generation != _generation || _seekPending || _ended || !size )
+            return false;
+
+        Chunk chunk = { static_cast<const uint8_t*>( data ), size };
+        _chunks.push_back( chunk );
+        _buffered += size;
+    }
+
+    _dataAvailable.notify_one();
+
+    return true;
+}
+
+void StreamInput::endOfStream( unsigned generation, bool error )
+{
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+
+        if( generation != _generation )
+            return;
+
+        _ended = true;
+        _failed = error;
+    }
+
+    _dataAvailable.notify_one();
+}
+
+uint64_t StreamInput::consumedChunks() const
+{
+    std::lock_guard<std::mutex> lock( _guard );
+    return _consumedChunks;
+}
+
+size_t StreamInput::freeSpace() const
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    if( _ended || _seekPending )
+        return 0;
+
+    return _buffered < _capacity ? _capacity - _buffered : 0;
+}
+
+bool StreamInput::atEnd() const
+{
+    std::lock_guard<std::mutex> lock( _guard );
+    return _ended;
+}
+
+void StreamInput::dropChunks()
+{
+    _consumedChunks += _chunks.size();
+    _chunks.clear();
+    _chunkOffset = 0;
+    _buffered = 0;
+}
+
+bool StreamInput::open( uint64_t* size )
+{
+    bool notify = false;
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+
+        _interrupted = false;
+
+        //input is reopened on every playback start
+        if( 0 != _position || _seekPending ) {
+            if( !_seekable )
+                return false;
+
+            dropChunks();
+            _position = 0;
+            ++_generation;
+            _seekPending = true;
+            _ended = false;
+            _failed = false;
+            notify = true;
+        }
+
+        *size = _size;
+    }
+
+    if( notify )
+        _notify();
+
+    return true;
+}
+
+int64_t StreamInput::read( uint8_t* buffer, size_t size )
+{
+    typedef std::chrono::steady_clock Clock;
+
+    size_t read = 0;
+    bool chunkConsumed = false;
+    {
+        std::unique_lock<std::mutex> lock( _guard );
+
+        if( _chunks.empty() && !_ended && !_interrupted ) {
+            //starvation: libvlc is waiting for producer
+            const Clock::time_point waitStart = Clock::now();
+            _dataAvailable.wait( lock,
+                [this] () { return !_chunks.empty() || _ended || _interrupted; } );
+            _starvationTime +=
+                std::chrono::duration_cast<std::chrono::microseconds>( Clock::now() - waitStart ).count();
+            ++_starvationCount;
+        }
+
+        if( _interrupted )
+            return -1;
+
+        while( read < size && !_chunks.empty() ) {
+            const Chunk& chunk = _chunks.front();
+            const size_t count = std::min( size - read, chunk.size - _chunkOffset );
+            memcpy( buffer + read, chunk.data + _chunkOffset, count );
+            read += count;
+            _chunkOffset += count;
+
+            if( _chunkOffset == chunk.size ) {
+                _chunks.pop_front();
+                _chunkOffset = 0;
+                ++_consumedChunks;
+                chunkConsumed = true;
+            }
+        }
+
+        _buffered -= read;
+        _position += read;
+        _bytesRead += read;
+
+        if( !read && _failed )
+            return -1;
+    }
+
+    if( chunkConsumed )
+        _notify();
+
+    return static_cast<int64_t>( read );
+}
+
+bool StreamInput::seek( uint64_t offset )
+{
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+
+        if( offset == _position )
+            return true;
+
+        //seek forward inside queued data doesn't need producer
+        if( offset > _position && offset - _position <= _buffered ) {
+            bool chunkConsumed = false;
+            uint64_t skip = offset - _position;
+            while( skip ) {
+                const Chunk& chunk = _chunks.front();
+                const size_t count =
+                    static_cast<size_t>( std::min<uint64_t>( skip, chunk.size - _chunkOffset ) );
+                skip -= count;
+                _chunkOffset += count;
+                _buffered -= count;
+                if( _chunkOffset == chunk.size ) {
+                    _chunks.pop_front();
+                    _chunkOffset = 0;
+                    ++_consumedChunks;
+                    chunkConsumed = true;
+                }
+            }
+            _position = offset;
+
+            if( !chunkConsumed )
+                return true;
+        } else {
+            if( !_seekable || offset > _size )
+                return false;
+
+            dropChunks();
+            _position = offset;
+            ++_generation;
+            _seekPending = true;
+            _ended = false;
+            _failed = false;
+            ++_seekCount;
+        }
+    }
+
+    //producer should release skipped chunks, or serve seek
+    _notify();
+
+    return true;
+}
+
+void StreamInput::close()
+{
+}
+
+void StreamInput::interrupt()
+{
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+        _interrupted = true;
+    }
+
+    _dataAvailable.notify_all();
+}
+
+void StreamInput::stats( MediaInputStats* stats ) const
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    stats->push_back( { "buffered", static_cast<double>( _buffered ) } );
+    stats->push_back( { "capacity", static_cast<double>( _capacity ) } );
+    stats->push_back( { "bytesRead", static_cast<double>( _bytesRead ) } );
+    //in ms
+    stats->push_back( { "starvationTime", _starvationTime / 1000. } );
+    stats->push_back( { "starvationCount", static_cast<double>( _starvationCount ) } );
+    stats->push_back( { "seekCount", static_cast<double>( _seekCount ) } );
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "MediaInput.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//Bounded queue of producer owned chunks, consumed by libvlc input thread.
+//Chunk memory is not copied: producer should keep it alive until
+//chunk is consumed (consumedChunks() counter passes it).
+//Seek (from libvlc) drops queued chunks and starts new generation,
+//chunks pushed for old generation are rejected.
+//notify is called (from any thread) when producer attention is needed:
+//chunks consumed, seek requested, input is opened or destroyed.
+class StreamInput : public MediaInput
+{
+public:
+    StreamInput( uint64_t size, bool seekable, size_t capacity,
+                 const std::function<void()>& notify );
+    ~StreamInput();
+
+    //producer side
+    unsigned generation() const;
+    //returns true if seek was requested, request is cleared
+    bool takeSeek( uint64_t* offset, unsigned* generation );
+    //returns false if chunk was not queued (stale generation, or end of stream)
+    bool push( unsigned generation, const void* data, size_t size );
+    void endOfStream( unsigned generation, bool error );
+    //count of chunks consumed or dropped since creation
+    uint64_t consumedChunks() const;
+    //count of bytes producer is allowed to push without exceeding capacity
+    size_t freeSpace() const;
+    bool atEnd() const;
+
+    //MediaInput
+    bool open( uint64_t* size ) override;
+    int64_t read( uint8_t* buffer, size_t size ) override;
+    bool seek( uint64_t offset ) override;
+    void close() override;
+    bool seekable() const override
+        { return _seekable; }
+    void interrupt() override;
+    void stats( MediaInputStats* ) const override;
+
+private:
+    //should be called with _guard locked
+    void dropChunks();
+
+private:
+    struct Chunk
+    {
+        const uint8_t* data;
+        size_t size;
+    };
+
+    const uint64_t _size;
+    const bool _seekable;
+    const size_t _capacity;
+    const std::function<void()> _notify;
+
+    mutable std::mutex _guard;
+    std::condition_variable _dataAvailable;
+
+    std::deque<Chunk> _chunks;
+    //already read bytes of first chunk
+    size_t _chunkOffset;
+    size_t _buffered;
+    uint64_t _consumedChunks;
+
+    //position of next byte to read
+    uint64_t _position;
+    unsigned _generation;
+    bool _seekPending;
+    bool _ended;
+    bool _failed;
+    bool _interrupted;
+
+    //stats
+    uint64_t _bytesRead;
+    //in microseconds
+    uint64_t _starvationTime;
+    unsigned _starvationCount;
+    unsigned _seekCount;
+};
@@ -0,0 +1,57 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool( unsigned threadCount ) :
+    _threadCount( threadCount ? threadCount : 1 ),
+    _idleThreads( 0 ), _stopping( false )
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+    _guard.lock();
+    _stopping = true;
+    _guard.unlock();
+    _taskAvailable.notify_all();
+
+    for( std::thread& thread: _threads ) {
+        thread.join();
+    }
+}
+
+void ThreadPool::post( const Task& task )
+{
+    std::unique_lock<std::mutex> lock( _guard );
+
+    _tasks.push_back( task );
+
+    if( _idleThreads < _tasks.size() && _threads.size() < _threadCount )
+        _threads.emplace_back( &ThreadPool::worker, this );
+
+    lock.unlock();
+    _taskAvailable.notify_one();
+}
+
+void ThreadPool::cancelPending()
+{
+    std::lock_guard<std::mutex> lock( _guard );
+    _tasks.clear();
+}
+
+void ThreadPool::worker()
+{
+    for( ;; ) {
+        std::unique_lock<std::mutex> lock( _guard );
+        ++_idleThreads;
+        _taskAvailable.wait( lock, [this] () { return _stopping || !_tasks.empty(); } );
+        --_idleThreads;
+
+        if( _tasks.empty() )
+            return; //stopping and nothing left to do
+
+        Task task = std::move( _tasks.front() );
+        _tasks.pop_front();
+        lock.unlock();
+
+        task();
+    }
+}
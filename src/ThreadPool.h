@@ -0,0 +1,42 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+///////////////////////////////////////////////////////////////////////////////
+class ThreadPool
+{
+public:
+    typedef std::function<void()> Task;
+
+    //threads are started on first post
+    explicit ThreadPool( unsigned threadCount = 1 );
+    //waits until already posted tasks are done
+    ~ThreadPool();
+
+    unsigned threadCount() const
+        { return _threadCount; }
+
+    //with threadCount == 1 tasks are executed in posting order
+    void post( const Task& );
+
+    //drops tasks which are not started yet
+    void cancelPending();
+
+private:
+    void worker();
+
+private:
+    const unsigned _threadCount;
+
+    std::mutex _guard;
+    std::condition_variable _taskAvailable;
+    std::deque<Task> _tasks;
+    std::vector<std::thread> _threads;
+    size_t _idleThreads;
+    bool _stopping;
+};
@@ -0,0 +1,253 @@
+#include "VlcAudioOutput.h"
+
+#include <string.h>
+#include <cassert>
+
+#include <atomic>
+#include <algorithm>
+
+namespace {
+
+//libvlc_audio_set_callbacks pins player to amem module (with "none" fallback),
+//so default module has to be set back explicitly
+const char* const DefaultAudioOutputs[] = {
+#if defined( _WIN32 )
+    "mmdevice", "directsound", "waveout",
+#elif defined( __APPLE__ )
+    "auhal",
+#else
+    "pulse", "alsa", "oss",
+#endif
+};
+
+}
+
+VlcAudioOutput::VlcAudioOutput() :
+    _mp( nullptr ), _sampleFormat( SampleFormat::S16 ), _rate( 44100 ), _channels( 2 ),
+    _nativeConversion( false ),
+    _buffer( nullptr ), _frames( 0 ), _bufferFormat( SampleFormat::S16 ), _bufferChannels( 0 ),
+    _cursors( nullptr ), _outputFormat( SampleFormat::S16 ), _outputChannels( 0 ),
+    _converting( false )
+{
+}
+
+VlcAudioOutput::~VlcAudioOutput()
+{
+    close();
+}
+
+unsigned VlcAudioOutput::sampleSize( SampleFormat format )
+{
+    switch( format ) {
+        case SampleFormat::F32:
+            return sizeof( float );
+        case SampleFormat::S16:
+        default:
+            return sizeof( int16_t );
+    }
+}
+
+void VlcAudioOutput::open( libvlc_media_player_t* mp, SampleFormat format,
+                           unsigned rate, unsigned channels, bool nativeConversion )
+{
+    if( !mp || !rate || !channels ) {
+        assert( false );
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( _guard );
+        _sampleFormat = format;
+        _rate = rate;
+        _channels = channels;
+        _nativeConversion = nativeConversion;
+    }
+
+    if( _mp == mp )
+        return;
+
+    _mp = mp;
+
+    libvlc_audio_set_callbacks( mp, play_cb, pause_cb, resume_cb, flush_cb, drain_cb, this );
+    libvlc_audio_set_format_callbacks( mp, setup_cb, cleanup_cb );
+}
+
+void VlcAudioOutput::close()
+{
+    if( !_mp )
+        return;
+
+    libvlc_audio_set_callbacks( _mp, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr );
+    libvlc_audio_set_format_callbacks( _mp, nullptr, nullptr );
+
+    //first module available in this libvlc build wins
+    for( const char* module: DefaultAudioOutputs ) {
+        if( 0 == libvlc_audio_output_set( _mp, module ) )
+            break;
+    }
+
+    _mp = nullptr;
+}
+
+void VlcAudioOutput::setBuffer( void* buffer, unsigned frames, uint32_t* cursors )
+{
+    assert( !buffer || ( frames && !( frames & ( frames - 1 ) ) && cursors ) );
+
+    std::lock_guard<std::mutex> lock( _guard );
+
+    _buffer = static_cast<uint8_t*>( buffer );
+    _frames = buffer ? frames : 0;
+    _cursors = buffer ? cursors : nullptr;
+    _bufferFormat = _sampleFormat;
+    _bufferChannels = _channels;
+
+    if( _cursors )
+        std::fill( _cursors, _cursors + CursorsCount, 0 );
+
+    _analyzer.setup( 0, 0, 0, 0, AudioAnalyzer::Window::None, nullptr );
+}
+
+void VlcAudioOutput::setAnalysis( float* levels, unsigned fftSize, unsigned bands,
+                                  AudioAnalyzer::Window window )
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    _analyzer.setup( _bufferChannels, _rate, fftSize, bands, window,
+                     _buffer ? levels : nullptr );
+}
+
+int VlcAudioOutput::setup_cb( void** opaque, char* format,
+                              unsigned* rate, unsigned* channels )
+{
+    VlcAudioOutput* output = static_cast<VlcAudioOutput*>( *opaque );
+
+    std::lock_guard<std::mutex> lock( output->_guard );
+
+    output->_converting = false;
+    if( output->_nativeConversion && *rate && *channels ) {
+        //keep source rate and channels, only samples format is forced
+        memcpy( format, "FL32", 4 );
+        output->_converter.setup( *rate, *channels,
+                                  output->_sampleFormat, output->_rate, output->_channels );
+        output->_converting = !output->_converter.isPassthrough();
+    } else {
+        //libvlc converts and resamples decoded audio to requested format
+        memcpy( format, SampleFormat::F32 == output->_sampleFormat ? "FL32" : "S16N", 4 );
+        *rate = output->_rate;
+        *channels = output->_channels;
+    }
+
+    output->_outputFormat = output->_sampleFormat;
+    output->_outputChannels = output->_channels;
+
+    return 0;
+}
+
+void VlcAudioOutput::cleanup_cb( void* opaque )
+{
+    VlcAudioOutput* output = static_cast<VlcAudioOutput*>( opaque );
+
+    std::lock_guard<std::mutex> lock( output->_guard );
+    output->_outputChannels = 0;
+}
+
+void VlcAudioOutput::play_cb( void* opaque, const void* samples,
+                              unsigned count, int64_t /*pts*/ )
+{
+    static_cast<VlcAudioOutput*>( opaque )->play( samples, count );
+}
+
+void VlcAudioOutput::play( const void* samples, unsigned count )
+{
+    std::lock_guard<std::mutex> lock( _guard );
+
+    if( !_buffer || !count ||
+        _outputChannels != _bufferChannels || _outputFormat != _bufferFormat )
+    {
+        return;
+    }
+
+    if( _converting ) {
+        count = _converter.process( static_cast<const float*>( samples ), count );
+        samples = _converter.output();
+    }
+
+    if( !count )
+        return;
+
+    if( _analyzer.isActive() )
+        _analyzer.process( samples, count, _bufferFormat );
+
+    write( samples, count );
+}
+
+//should be called with _guard locked
+void VlcAudioOutput::write( const void* samples, unsigned count )
+{
+    const unsigned frameSize = sampleSize( _bufferFormat ) * _bufferChannels;
+    const uint8_t* data = static_cast<const uint8_t*>( samples );
+
+    const uint32_t writeCursor = _cursors[WriteCursor];
+    const uint32_t readCursor = _cursors[ReadCursor];
+
+    //unread frames which will be overwritten
+    const uint32_t unread = std::min<uint32_t>( writeCursor - readCursor, _frames );
+    if( unread + count > _frames )
+        _cursors[OverrunFrames] += std::min<uint32_t>( unread + count - _frames, count );
+
+    //only tail of packet bigger than whole buffer is kept
+    unsigned skip = 0;
+    if( count > _frames )
+        skip = count - _frames;
+
+    uint32_t position = ( writeCursor + skip ) & ( _frames - 1 );
+    unsigned left = count - skip;
+    data += static_cast<size_t>( skip ) * frameSize;
+    while( left ) {
+        const unsigned chunk = std::min( left, _frames - position );
+        memcpy( _buffer + static_cast<size_t>( position ) * frameSize, data,
+                static_cast<size_t>( chunk ) * frameSize );
+        data += static_cast<size_t>( chunk ) * frameSize;
+        left -= chunk;
+        position = 0;
+    }
+
+    //samples should be visible to reader before cursor
+    std::atomic_thread_fence( std::memory_order_release );
+    _cursors[WriteCursor] = writeCursor + count;
+}
+
+void VlcAudioOutput::pause_cb( void* opaque, int64_t /*pts*/ )
+{
+    VlcAudioOutput* output = static_cast<VlcAudioOutput*>( opaque );
+
+    std::lock_guard<std::mutex> lock( output->_guard );
+    if( output->_cursors )
+        output->_cursors[Paused] = 1;
+}
+
+void VlcAudioOutput::resume_cb( void* opaque, int64_t /*pts*/ )
+{
+    VlcAudioOutput* output = static_cast<VlcAudioOutput*>( opaque );
+
+    std::lock_guard<std::mutex> lock( output->_guard );
+    if( output->_cursors )
+        output->_cursors[Paused] = 0;
+}
+
+void VlcAudioOutput::flush_cb( void* opaque, int64_t /*pts*/ )
+{
+    VlcAudioOutput* output = static_cast<VlcAudioOutput*>( opaque );
+
+    std::lock_guard<std::mutex> lock( output->_guard );
+    if( output->_converting )
+        output->_converter.reset();
+    output->_analyzer.reset();
+    if( output->_cursors )
+        ++output->_cursors[FlushCount];
+}
+
+void VlcAudioOutput::drain_cb( void* /*opaque*/ )
+{
+    //all written data is already available to reader
+}
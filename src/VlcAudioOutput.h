@@ -0,0 +1,121 @@
+#pragma once
+
+#include <mutex>
+#include <stdint.h>
+
+#include <vlc/vlc.h>
+
+#include "AudioConverter.h"
+#include "AudioAnalyzer.h"
+
+///////////////////////////////////////////////////////////////////////////////
+//Redirects decoded audio of media player from audio device to ring buffer.
+//Buffer and cursors memory is owned by caller (usually it's typed arrays
+//storage), so samples are copied only once - from libvlc to buffer,
+//and nothing is allocated per audio packet.
+//Buffer capacity (in frames) should be power of two, so
+//"cursor % frames" stays valid when cursors wrap around 2^32.
+class VlcAudioOutput
+{
+public:
+    typedef AudioSampleFormat SampleFormat;
+
+    enum Cursor
+    {
+        //total count of frames written by audio thread
+        WriteCursor = 0,
+        //total count of frames consumed by reader, updated by reader
+        ReadCursor,
+        //count of frames overwritten before they were read
+        OverrunFrames,
+        //incremented every time libvlc drops queued audio (i.e. on seek)
+        FlushCount,
+        //1 if playback is paused
+        Paused,
+
+        CursorsCount,
+    };
+
+    VlcAudioOutput();
+    ~VlcAudioOutput();
+
+    static unsigned sampleSize( SampleFormat );
+
+    //format is requested from libvlc on audio output (re)start,
+    //i.e. takes effect on next media start.
+    //With nativeConversion libvlc delivers audio with source rate and
+    //channels, and it's converted by AudioConverter on audio thread
+    //instead of libvlc converters.
+    void open( libvlc_media_player_t*, SampleFormat, unsigned rate, unsigned channels,
+               bool nativeConversion = false );
+    //restores default audio output (also on next media start)
+    void close();
+
+    bool isOpen() const
+        { return _mp != nullptr; }
+
+    SampleFormat sampleFormat() const
+        { return _sampleFormat; }
+    unsigned rate() const
+        { return _rate; }
+    unsigned channels() const
+        { return _channels; }
+    bool nativeConversion() const
+        { return _nativeConversion; }
+
+    //buffer should have place for frames * channels() samples of sampleFormat(),
+    //cursors should have place for CursorsCount values.
+    //Could be called during playback, nullptr buffer discards audio.
+    //Audio is discarded also while running audio output format
+    //differs from buffer format (until next media start).
+    void setBuffer( void* buffer, unsigned frames, uint32_t* cursors );
+
+    //levels are computed from audio written to buffer (see AudioAnalyzer),
+    //should be called after setBuffer(), which disables analysis.
+    //nullptr levels disables analysis
+    void setAnalysis( float* levels, unsigned fftSize, unsigned bands,
+                      AudioAnalyzer::Window );
+    //changed every time levels are updated
+    unsigned levelsSequence() const
+        { return _analyzer.sequence(); }
+
+    //should be called from the same thread as setBuffer()
+    uint32_t cursor( Cursor c ) const
+        { return _cursors ? _cursors[c] : 0; }
+
+private:
+    static int setup_cb( void** opaque, char* format, unsigned* rate, unsigned* channels );
+    static void cleanup_cb( void* opaque );
+    static void play_cb( void* opaque, const void* samples, unsigned count, int64_t pts );
+    static void pause_cb( void* opaque, int64_t pts );
+    static void resume_cb( void* opaque, int64_t pts );
+    static void flush_cb( void* opaque, int64_t pts );
+    static void drain_cb( void* opaque );
+
+    void play( const void* samples, unsigned count );
+    void write( const void* frames, unsigned count );
+
+private:
+    libvlc_media_player_t* _mp;
+
+    SampleFormat _sampleFormat;
+    unsigned _rate;
+    unsigned _channels;
+    bool _nativeConversion;
+
+    //protects buffer against replacement during write
+    std::mutex _guard;
+    uint8_t* _buffer;
+    unsigned _frames;
+    SampleFormat _bufferFormat;
+    unsigned _bufferChannels;
+    uint32_t* _cursors;
+
+    //format of running libvlc audio output, 0 channels if it's not running
+    SampleFormat _outputFormat;
+    unsigned _outputChannels;
+    bool _converting;
+    AudioConverter _converter;
+
+    AudioAnalyzer _analyzer;
+};
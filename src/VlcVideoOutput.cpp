@@ -203,37 +203,51 @@ void VlcVideoOutput::FrameReadyEvent::process( VlcVideoOutput* videoOutput )
 ///////////////////////////////////////////////////////////////////////////////
 struct VlcVideoOutput::FrameCleanupEvent : public VlcVideoOutput::VideoEvent
 {
+    FrameCleanupEvent( const std::shared_ptr<VideoFrame>& videoFrame ) :
+        _videoFrame( videoFrame ) {}
+
     void process( VlcVideoOutput* ) override;
+
+    std::weak_ptr<VideoFrame> _videoFrame;
 };
 
 void VlcVideoOutput::FrameCleanupEvent::process( VlcVideoOutput* videoOutput )
 {
-    if( videoOutput->_currentVideoFrame ) {
+    //held frame could be released after next vout setup
+    std::shared_ptr<VideoFrame> videoFrame = _videoFrame.lock();
+    if( videoFrame && videoOutput->_currentVideoFrame == videoFrame ) {
         videoOutput->onFrameCleanup();
         videoOutput->_currentVideoFrame.reset();
     }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-VlcVideoOutput::VlcVideoOutput()
+VlcVideoOutput::VlcVideoOutput() :
+    _videoFramePixelFormat( PixelFormat::RV32 ), _async( new uv_async_t ),
+    _holdFrame( false ), _frameHeld( false ), _displayedFrames( 0 )
 {
     uv_loop_t* loop = uv_default_loop();
 
-    uv_async_init( loop, &_async,
+    uv_async_init( loop, _async,
         [] ( uv_async_t* handle ) {
             if( handle->data )
                 reinterpret_cast<VlcVideoOutput*>( handle->data )->handleAsync();
         }
     );
-    _async.data = this;
+    _async->data = this;
 
     _waitingFrame.test_and_set(); //FIXME! use memory_order
 }
 
 VlcVideoOutput::~VlcVideoOutput()
 {
-    uv_close( reinterpret_cast<uv_handle_t*>( &_async ), 0 );
-    _async.data = nullptr;
+    //handle is freed by close callback, since player is gone by then
+    _async->data = nullptr;
+    uv_close( reinterpret_cast<uv_handle_t*>( _async ),
+        [] ( uv_handle_t* handle ) {
+            delete reinterpret_cast<uv_async_t*>( handle );
+        }
+    );
 }
 
 unsigned VlcVideoOutput::video_format_cb( char* chroma,
@@ -241,44 +255,113 @@ unsigned VlcVideoOutput::video_format_cb( char* chroma,
                                           unsigned* pitches, unsigned* lines )
 {
     std::unique_ptr<VideoEvent> frameSetupEvent;
+    std::shared_ptr<VideoFrame> videoFrame;
     switch( _pixelFormat ) {
         case PixelFormat::RV32: {
-            std::shared_ptr<RV32VideoFrame> videoFrame( new RV32VideoFrame() );
-            frameSetupEvent.reset( new RV32FrameSetupEvent( videoFrame ) );
-            _videoFrame = videoFrame;
+            std::shared_ptr<RV32VideoFrame> rv32VideoFrame( new RV32VideoFrame() );
+            frameSetupEvent.reset( new RV32FrameSetupEvent( rv32VideoFrame ) );
+            videoFrame = rv32VideoFrame;
             break;
         }
         case PixelFormat::I420:
         default: {
-            std::shared_ptr<I420VideoFrame> videoFrame( new I420VideoFrame() );
-            frameSetupEvent.reset( new I420FrameSetupEvent( videoFrame ) );
-            _videoFrame = videoFrame;
+            std::shared_ptr<I420VideoFrame> i420VideoFrame( new I420VideoFrame() );
+            frameSetupEvent.reset( new I420FrameSetupEvent( i420VideoFrame ) );
+            videoFrame = i420VideoFrame;
             break;
         }
     }
 
-    const unsigned planeCount = _videoFrame->video_format_cb( chroma,
-                                                              width, height,
-                                                              pitches, lines );
+    const unsigned planeCount = videoFrame->video_format_cb( chroma,
+                                                             width, height,
+                                                             pitches, lines );
+
+    std::lock_guard<std::mutex> lock( _holdGuard );
+
+    const bool frameHeld = _frameHeld;
+    _holdFrame = _frameHeld = false;
+
+    if( frameHeld && _videoFrame && _videoFrame->bufferFilled() &&
+        _videoFramePixelFormat == _pixelFormat &&
+        _videoFrame->width() == videoFrame->width() &&
+        _videoFrame->height() == videoFrame->height() &&
+        _videoFrame->size() == videoFrame->size() )
+    {
+        //geometry is the same, so just continue to use held frame buffer
+        return planeCount;
+    }
+
+    //previous vout is already closed, so held frame is cleaned up
+    //before setup of new one
+    if( frameHeld && _videoFrame )
+        cleanupFrame( _videoFrame );
+
+    //cached frames have old geometry
+    _frameCache.clear();
+
+    _videoFrame = videoFrame;
+    _videoFramePixelFormat = _pixelFormat;
 
     _guard.lock();
     _videoEvents.push_back( std::move( frameSetupEvent ) );
     _guard.unlock();
-    uv_async_send( &_async );
+    uv_async_send( _async );
 
     return planeCount;
 }
 
 void VlcVideoOutput::video_cleanup_cb()
 {
-    _videoFrame->video_cleanup_cb();
+    std::shared_ptr<VideoFrame> videoFrame;
+    {
+        std::lock_guard<std::mutex> lock( _holdGuard );
+        if( _holdFrame ) {
+            _frameHeld = true;
+            return;
+        }
+        videoFrame = _videoFrame;
+    }
 
-    notifyFrameReady();
+    cleanupFrame( videoFrame );
+}
+
+void VlcVideoOutput::cleanupFrame( const std::shared_ptr<VideoFrame>& videoFrame )
+{
+    videoFrame->video_cleanup_cb();
+
+    if( videoFrame->bufferFilled() ) {
+        _waitingFrame.clear(); //FIXME! use memory_order
+
+        _guard.lock();
+        _videoEvents.emplace_back( new FrameReadyEvent );
+        _guard.unlock();
+    }
 
     _guard.lock();
-    _videoEvents.emplace_back( new FrameCleanupEvent );
+    _videoEvents.emplace_back( new FrameCleanupEvent( videoFrame ) );
     _guard.unlock();
-    uv_async_send( &_async );
+    uv_async_send( _async );
+}
+
+void VlcVideoOutput::holdFrame()
+{
+    std::lock_guard<std::mutex> lock( _holdGuard );
+    _holdFrame = true;
+}
+
+void VlcVideoOutput::releaseFrame()
+{
+    //lock is held during cleanup, so new vout setup (if any)
+    //waits for it and is not mixed with cleanup events
+    std::lock_guard<std::mutex> lock( _holdGuard );
+    const bool frameHeld = _frameHeld;
+    _holdFrame = _frameHeld = false;
+
+    if( !frameHeld || !_videoFrame )
+        return;
+
+    //held frame is not used by any vout, so it's safe to touch frame buffer from here
+    cleanupFrame( _videoFrame );
 }
 
 void* VlcVideoOutput::video_lock_cb( void** planes )
@@ -293,9 +376,22 @@ void VlcVideoOutput::video_unlock_cb( void* picture, void *const * planes )
 
 void VlcVideoOutput::video_display_cb( void* /*picture*/ )
 {
+    if( _videoFrame->bufferFilled() && _frameCache.limit() )
+        _frameCache.add( _videoFrame->_frameBuffer, _videoFrame->size() );
+
+    ++_displayedFrames;
+
     notifyFrameReady();
 }
 
+bool VlcVideoOutput::restoreCachedFrame( uint64_t serial )
+{
+    if( !_currentVideoFrame || !_currentVideoFrame->_frameBuffer )
+        return false;
+
+    return _frameCache.copy( serial, _currentVideoFrame->_frameBuffer, _currentVideoFrame->size() );
+}
+
 void VlcVideoOutput::notifyFrameReady()
 {
     if( _videoFrame->bufferFilled() ) {
@@ -304,7 +400,7 @@ void VlcVideoOutput::notifyFrameReady()
         _guard.lock();
         _videoEvents.emplace_back( new FrameReadyEvent );
         _guard.unlock();
-        uv_async_send( &_async );
+        uv_async_send( _async );
     }
 }
 
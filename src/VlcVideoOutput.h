@@ -9,6 +9,8 @@
 
 #include <libvlc_wrapper/vlc_vmem.h>
 
+#include "FrameCache.h"
+
 ///////////////////////////////////////////////////////////////////////////////
 class VlcVideoOutput :
     private vlc::basic_vmem_wrapper
@@ -44,6 +46,26 @@ protected:
     //will reset current flag state
     bool isFrameReady();
 
+    //keep current frame (and it's buffer) on vout cleanup,
+    //so it could be reused by next vout with the same geometry
+    //(otherwise it's cleaned up by next vout setup)
+    void holdFrame();
+    //should be called from gui thread if no vout will be created
+    //for held frame (i.e. playback is stopped)
+    void releaseFrame();
+
+    //copies of recently displayed frames (limit is in bytes, 0 - disabled),
+    //captured on decode thread
+    FrameCache& frameCache()
+        { return _frameCache; }
+    //copies cached frame to current frame buffer, returns false if it's not cached.
+    //Should be called from gui thread, while nothing is decoded (i.e. on pause).
+    bool restoreCachedFrame( uint64_t serial );
+
+    //count of frames displayed by vout so far, could be called from any thread
+    uint64_t displayedFrames() const
+        { return _displayedFrames; }
+
 private:
     struct VideoEvent;
     struct RV32FrameSetupEvent;
@@ -64,17 +86,26 @@ private:
     void video_display_cb( void* picture ) override;
 
     void notifyFrameReady();
+    void cleanupFrame( const std::shared_ptr<VideoFrame>& );
 
 private:
     PixelFormat _pixelFormat; //FIXME! maybe we need std::atomic here
     std::shared_ptr<VideoFrame> _videoFrame; //should be accessed only from decode thread
+    PixelFormat _videoFramePixelFormat;
     std::shared_ptr<VideoFrame> _currentVideoFrame; //should be accessed only from gui thread
 
-    uv_async_t _async;
+    uv_async_t* _async;
     std::mutex _guard;
     std::deque<std::unique_ptr<VideoEvent> > _videoEvents;
 
     std::atomic_flag _waitingFrame;
+
+    std::mutex _holdGuard;
+    bool _holdFrame;
+    bool _frameHeld;
+
+    FrameCache _frameCache;
+    std::atomic<uint64_t> _displayedFrames;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
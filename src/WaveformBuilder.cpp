@@ -0,0 +1,107 @@
+#include "WaveformBuilder.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+WaveformBuilder::WaveformBuilder( float* output, unsigned buckets, uint64_t totalFrames ) :
+    _output( output ), _buckets( buckets ), _totalFrames( std::max<uint64_t>( totalFrames, buckets ) ),
+    _processedFrames( 0 ), _bucket( 0 ),
+    _min( 0 ), _max( 0 ), _sumSquares( 0 ), _bucketFrames( 0 )
+{
+    _bucketEnd = buckets > 1 ? _totalFrames / buckets : UINT64_MAX;
+    std::fill( _output, _output + buckets * ValuesPerBucket, 0.f );
+}
+
+void WaveformBuilder::process( const float* samples, unsigned frames )
+{
+    while( frames ) {
+        unsigned chunk = frames;
+        if( _bucket + 1 < _buckets )
+            chunk = static_cast<unsigned>( std::min<uint64_t>( frames, _bucketEnd - _processedFrames ) );
+
+        reduce( samples, chunk );
+
+        samples += chunk;
+        frames -= chunk;
+        _processedFrames += chunk;
+
+        if( _bucket + 1 < _buckets && _processedFrames == _bucketEnd ) {
+            storeBucket();
+            ++_bucket;
+            _bucketEnd = ( _totalFrames * ( _bucket + 1 ) ) / _buckets;
+        }
+    }
+}
+
+void WaveformBuilder::finish()
+{
+    if( _bucket < _buckets && _bucketFrames ) {
+        storeBucket();
+        ++_bucket;
+    }
+}
+
+void WaveformBuilder::reduce( const float* samples, unsigned frames )
+{
+    if( !frames )
+        return;
+
+    if( !_bucketFrames )
+        _min = _max = samples[0];
+
+    float minValue = _min, maxValue = _max;
+    double sumSquares = 0;
+
+    unsigned f = 0;
+#ifdef USE_SSE2
+    if( frames >= 4 ) {
+        __m128 minimums = _mm_set1_ps( minValue );
+        __m128 maximums = _mm_set1_ps( maxValue );
+        __m128 squares = _mm_setzero_ps();
+        for( ; f + 4 <= frames; f += 4 ) {
+            const __m128 v = _mm_loadu_ps( samples + f );
+            minimums = _mm_min_ps( minimums, v );
+            maximums = _mm_max_ps( maximums, v );
+            squares = _mm_add_ps( squares, _mm_mul_ps( v, v ) );
+        }
+
+        float lanes[4];
+        _mm_storeu_ps( lanes, minimums );
+        minValue = std::min( std::min( lanes[0], lanes[1] ), std::min( lanes[2], lanes[3] ) );
+        _mm_storeu_ps( lanes, maximums );
+        maxValue = std::max( std::max( lanes[0], lanes[1] ), std::max( lanes[2], lanes[3] ) );
+        _mm_storeu_ps( lanes, squares );
+        sumSquares = static_cast<double>( lanes[0] ) + lanes[1] + lanes[2] + lanes[3];
+    }
+#endif
+
+    for( ; f < frames; ++f ) {
+        const float v = samples[f];
+        minValue = std::min( minValue, v );
+        maxValue = std::max( maxValue, v );
+        sumSquares += v * v;
+    }
+
+    _min = minValue;
+    _max = maxValue;
+    _sumSquares += sumSquares;
+    _bucketFrames += frames;
+}
+
+void WaveformBuilder::storeBucket()
+{
+    float* values = _output + _bucket * ValuesPerBucket;
+    values[0] = _min;
+    values[1] = _max;
+    values[2] = _bucketFrames ? static_cast<float>( sqrt( _sumSquares / _bucketFrames ) ) : 0.f;
+
+    _min = _max = 0;
+    _sumSquares = 0;
+    _bucketFrames = 0;
+}
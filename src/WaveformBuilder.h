@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+//Reduces mono audio to fixed count of buckets, every bucket is
+//[ min, max, rms ] triple in output array (of buckets * 3 floats).
+//Bucket of frame is chosen by expected total frames count,
+//frames beyond it go to the last bucket.
+//Output is written in place, so completed buckets could be read
+//while rest of audio is processed.
+class WaveformBuilder
+{
+public:
+    enum {
+        ValuesPerBucket = 3,
+    };
+
+    WaveformBuilder( float* output, unsigned buckets, uint64_t totalFrames );
+
+    void process( const float* samples, unsigned frames );
+    //writes last incomplete bucket
+    void finish();
+
+    //count of completely written buckets
+    unsigned completedBuckets() const
+        { return _bucket; }
+
+private:
+    void reduce( const float* samples, unsigned frames );
+    void storeBucket();
+
+private:
+    float *const _output;
+    const unsigned _buckets;
+    const uint64_t _totalFrames;
+
+    uint64_t _processedFrames;
+    unsigned _bucket;
+    //first frame of next bucket
+    uint64_t _bucketEnd;
+
+    float _min;
+    float _max;
+    double _sumSquares;
+    uint64_t _bucketFrames;
+};